@@ -0,0 +1,551 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <map>
+
+#include <google/protobuf/compiler/us/us_cpp_delta.h>
+#include <google/protobuf/compiler/us/us_helpers.h>
+#include <google/protobuf/io/printer.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/stubs/strutil.h>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace us {
+
+namespace {
+
+// Enums of other packages may be used, so their names are fully qualified.
+string QualifiedCppEnumName(const EnumDescriptor* descriptor) {
+  string name = "::";
+  if (!descriptor->file()->package().empty()) {
+    name += StringReplace(descriptor->file()->package(), ".", "::", true);
+    name += "::";
+  }
+  return name + CppClassName(descriptor);
+}
+
+// Whether ApplyDelta() needs a 64 bit variable to read values into.
+bool Any64BitField(const Descriptor* descriptor) {
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    if (GetUnrealScriptType(descriptor->field(i)) == UNREALSCRIPT_TYPE_INT64) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
+CppDeltaGenerator::CppDeltaGenerator(const FileDescriptor* file,
+                                     const GeneratorOptions& options)
+  : file_(file),
+    options_(options) {
+}
+
+CppDeltaGenerator::~CppDeltaGenerator() {}
+
+string CppDeltaGenerator::filename() const {
+  return StripProto(file_->name()) + ".us_delta.h";
+}
+
+void CppDeltaGenerator::Generate(io::Printer* printer) {
+  string guard = "US_DELTA_" + FilenameIdentifier(file_->name()) +
+                 "__INCLUDED";
+
+  printer->Print(
+    "// Generated by the protocol buffer compiler.  DO NOT EDIT!\n"
+    "// source: $filename$\n"
+    "//\n"
+    "// Delta encoding matching the SerializeDelta() and ApplyDelta()\n"
+    "// functions of the UnrealScript classes generated from this file.\n"
+    "\n"
+    "#ifndef $guard$\n"
+    "#define $guard$\n"
+    "\n"
+    "#include <google/protobuf/io/coded_stream.h>\n"
+    "#include <google/protobuf/wire_format_lite.h>\n"
+    "#include \"$basename$.pb.h\"\n"
+    "\n",
+    "filename", file_->name(),
+    "guard", guard,
+    "basename", StripProto(file_->name()));
+
+  vector<string> package_parts;
+  SplitPackage(file_, &package_parts);
+
+  for (int i = 0; i < package_parts.size(); i++) {
+    printer->Print("namespace $part$ {\n", "part", package_parts[i]);
+  }
+  printer->Print("namespace us_delta {\n\n");
+
+  vector<const Descriptor*> messages;
+  ListMessages(file_, &messages);
+
+  // Declare everything first, as messages may refer to each other.
+  for (int i = 0; i < messages.size(); i++) {
+    printer->Print(
+      "inline bool Equals(const $classname$& a, const $classname$& b);\n"
+      "inline void SerializeDelta(const $classname$& message,\n"
+      "    const $classname$* baseline,\n"
+      "    ::google::protobuf::io::CodedOutputStream* output);\n"
+      "inline bool ApplyDelta(::google::protobuf::io::CodedInputStream* input,\n"
+      "    $classname$* message);\n",
+      "classname", CppClassName(messages[i]));
+  }
+
+  for (int i = 0; i < messages.size(); i++) {
+    const Descriptor* descriptor = messages[i];
+
+    printer->Print(
+      "\n"
+      "// ===================================================================\n"
+      "// $fullname$\n",
+      "fullname", descriptor->full_name());
+
+    GenerateEquals(printer, descriptor);
+    GenerateSerializeDelta(printer, descriptor);
+    GenerateApplyDelta(printer, descriptor);
+  }
+
+  printer->Print("\n}  // namespace us_delta\n");
+  for (int i = package_parts.size() - 1; i >= 0; i--) {
+    printer->Print("}  // namespace $part$\n", "part", package_parts[i]);
+  }
+
+  printer->Print(
+    "\n"
+    "#endif  // $guard$\n",
+    "guard", guard);
+}
+
+void CppDeltaGenerator::GenerateFieldComparison(io::Printer* printer,
+                                                const FieldDescriptor* field,
+                                                const string& a,
+                                                const string& b,
+                                                const string& statement) {
+  map<string, string> vars;
+  vars["a"] = a;
+  vars["b"] = b;
+  vars["name"] = CppFieldName(field);
+  vars["statement"] = statement;
+
+  // Messages of other files have no Equals(), so compare their encodings.
+  string value_a = field->is_repeated() ? "$a$$name$(i)" : "$a$$name$()";
+  string value_b = field->is_repeated() ? "$b$$name$(i)" : "$b$$name$()";
+  string differs;
+
+  if (field->type() != FieldDescriptor::TYPE_MESSAGE) {
+    differs = value_a + " != " + value_b;
+  } else if (field->message_type()->file() == file_) {
+    differs = "!Equals(" + value_a + ", " + value_b + ")";
+  } else {
+    differs = value_a + ".SerializeAsString() != " +
+              value_b + ".SerializeAsString()";
+  }
+
+  // A singular message that is set differs from an unset one, even if
+  // it is empty.
+  if (field->type() == FieldDescriptor::TYPE_MESSAGE &&
+      !field->is_repeated()) {
+    differs = "$a$has_$name$() != $b$has_$name$() || " + differs;
+  }
+
+  if (field->is_repeated()) {
+    printer->Print(vars,
+      "if ($a$$name$_size() != $b$$name$_size()) {\n"
+      "  $statement$\n"
+      "} else {\n"
+      "  for (int i = 0; i < $a$$name$_size(); i++) {\n");
+    printer->Print(vars, ("    if (" + differs + ") {\n").c_str());
+    printer->Print(vars, "      $statement$\n");
+
+    // The loop only needs leaving if the statement doesn't already.
+    if (!HasPrefixString(statement, "return")) {
+      printer->Print("      break;\n");
+    }
+
+    printer->Print(
+      "    }\n"
+      "  }\n"
+      "}\n");
+  } else {
+    printer->Print(vars, ("if (" + differs + ") {\n").c_str());
+    printer->Print(vars,
+      "  $statement$\n"
+      "}\n");
+  }
+}
+
+void CppDeltaGenerator::GenerateEquals(io::Printer* printer,
+                                       const Descriptor* descriptor) {
+  printer->Print(
+    "\ninline bool Equals(const $classname$& a, const $classname$& b) {\n",
+    "classname", CppClassName(descriptor));
+  printer->Indent();
+
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    GenerateFieldComparison(printer, descriptor->field(i), "a.", "b.",
+                            "return false;");
+  }
+
+  printer->Print("return true;\n");
+  printer->Outdent();
+  printer->Print("}\n");
+}
+
+void CppDeltaGenerator::GenerateSerializeDelta(io::Printer* printer,
+                                               const Descriptor* descriptor) {
+  int words = DeltaMaskWords(descriptor);
+
+  printer->Print(
+    "\n"
+    "inline void SerializeDelta(const $classname$& message,\n"
+    "    const $classname$* baseline,\n"
+    "    ::google::protobuf::io::CodedOutputStream* output) {\n",
+    "classname", CppClassName(descriptor));
+  printer->Indent();
+
+  if (words > 0) {
+    printer->Print(
+      "::google::protobuf::uint32 changed[$words$] = { 0 };\n"
+      "\n"
+      "if (baseline == NULL) {\n",
+      "words", SimpleItoa(words));
+
+    for (int i = 0; i < words; i++) {
+      printer->Print("  changed[$word$] = $mask$u;\n",
+        "word", SimpleItoa(i),
+        "mask", SimpleItoa(FullDeltaMask(descriptor, i)));
+    }
+
+    printer->Print("} else {\n");
+    printer->Indent();
+
+    for (int i = 0; i < descriptor->field_count(); i++) {
+      GenerateFieldComparison(printer, descriptor->field(i),
+        "message.", "baseline->",
+        "changed[" + SimpleItoa(i / 32) + "] |= 1u << " +
+        SimpleItoa(i % 32) + ";");
+    }
+
+    printer->Outdent();
+    printer->Print("}\n\n");
+
+    for (int i = 0; i < words; i++) {
+      printer->Print("output->WriteVarint32(changed[$word$]);\n",
+        "word", SimpleItoa(i));
+    }
+  }
+
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+    map<string, string> vars;
+    vars["name"] = CppFieldName(field);
+    vars["word"] = SimpleItoa(i / 32);
+    vars["bit"] = SimpleItoa(i % 32);
+
+    printer->Print(vars, "if ((changed[$word$] & (1u << $bit$)) != 0) {\n");
+    printer->Indent();
+
+    if (field->is_repeated()) {
+      printer->Print(vars,
+        "output->WriteVarint32(message.$name$_size());\n"
+        "for (int i = 0; i < message.$name$_size(); i++) {\n");
+      printer->Indent();
+      GenerateValueSerializer(printer, field, "message." + vars["name"] + "(i)");
+      printer->Outdent();
+      printer->Print("}\n");
+    } else if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+      // Prefixed by the size plus one, or 0 when unset.
+      printer->Print(vars,
+        "if (message.has_$name$()) {\n"
+        "  output->WriteVarint32(message.$name$().ByteSize() + 1);\n"
+        "  message.$name$().SerializeWithCachedSizes(output);\n"
+        "} else {\n"
+        "  output->WriteVarint32(0);\n"
+        "}\n");
+    } else {
+      GenerateValueSerializer(printer, field, "message." + vars["name"] + "()");
+    }
+
+    printer->Outdent();
+    printer->Print("}\n");
+  }
+
+  printer->Outdent();
+  printer->Print("}\n");
+}
+
+void CppDeltaGenerator::GenerateApplyDelta(io::Printer* printer,
+                                           const Descriptor* descriptor) {
+  int words = DeltaMaskWords(descriptor);
+
+  printer->Print(
+    "\n"
+    "inline bool ApplyDelta(::google::protobuf::io::CodedInputStream* input,\n"
+    "    $classname$* message) {\n",
+    "classname", CppClassName(descriptor));
+  printer->Indent();
+
+  if (words > 0) {
+    printer->Print(
+      "::google::protobuf::uint32 changed[$words$];\n"
+      "::google::protobuf::uint32 value;\n"
+      "\n",
+      "words", SimpleItoa(words));
+
+    if (Any64BitField(descriptor)) {
+      printer->Print("::google::protobuf::uint64 value64;\n\n");
+    }
+
+    for (int i = 0; i < words; i++) {
+      printer->Print(
+        "if (!input->ReadVarint32(&changed[$word$])) return false;\n",
+        "word", SimpleItoa(i));
+    }
+  }
+
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+    map<string, string> vars;
+    vars["name"] = CppFieldName(field);
+    vars["word"] = SimpleItoa(i / 32);
+    vars["bit"] = SimpleItoa(i % 32);
+
+    printer->Print(vars, "if ((changed[$word$] & (1u << $bit$)) != 0) {\n");
+    printer->Indent();
+
+    if (field->is_repeated()) {
+      // Every element takes at least one byte, so a corrupt count fails
+      // as soon as the input runs out.
+      printer->Print(vars,
+        "::google::protobuf::uint32 count;\n"
+        "if (!input->ReadVarint32(&count)) return false;\n"
+        "message->clear_$name$();\n"
+        "for (::google::protobuf::uint32 i = 0; i < count; i++) {\n");
+      printer->Indent();
+      GenerateValueDeserializer(printer, field);
+      printer->Outdent();
+      printer->Print("}\n");
+    } else {
+      GenerateValueDeserializer(printer, field);
+    }
+
+    printer->Outdent();
+    printer->Print("}\n");
+  }
+
+  printer->Print("return true;\n");
+  printer->Outdent();
+  printer->Print("}\n");
+}
+
+void CppDeltaGenerator::GenerateValueSerializer(io::Printer* printer,
+                                                const FieldDescriptor* field,
+                                                const string& value) {
+  // Same encodings as the *NoTag writers of CodedOutputStream.uc, which
+  // write negative int32 values as 5 byte varints.
+  const char* text = NULL;
+
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_UINT32:
+    case FieldDescriptor::TYPE_ENUM:
+      text = "output->WriteVarint32(static_cast< ::google::protobuf::uint32>($value$));\n";
+      break;
+    case FieldDescriptor::TYPE_SINT32:
+      text = "output->WriteVarint32(\n"
+             "  ::google::protobuf::internal::WireFormatLite::ZigZagEncode32($value$));\n";
+      break;
+    case FieldDescriptor::TYPE_FIXED32:
+    case FieldDescriptor::TYPE_SFIXED32:
+      text = "output->WriteLittleEndian32(static_cast< ::google::protobuf::uint32>($value$));\n";
+      break;
+    case FieldDescriptor::TYPE_FLOAT:
+      text = "output->WriteLittleEndian32(\n"
+             "  ::google::protobuf::internal::WireFormatLite::EncodeFloat($value$));\n";
+      break;
+    case FieldDescriptor::TYPE_INT64:
+    case FieldDescriptor::TYPE_UINT64:
+      text = "output->WriteVarint64(static_cast< ::google::protobuf::uint64>($value$));\n";
+      break;
+    case FieldDescriptor::TYPE_SINT64:
+      text = "output->WriteVarint64(\n"
+             "  ::google::protobuf::internal::WireFormatLite::ZigZagEncode64($value$));\n";
+      break;
+    case FieldDescriptor::TYPE_FIXED64:
+    case FieldDescriptor::TYPE_SFIXED64:
+      text = "output->WriteLittleEndian64(static_cast< ::google::protobuf::uint64>($value$));\n";
+      break;
+    case FieldDescriptor::TYPE_BOOL:
+      text = "output->WriteVarint32($value$ ? 1 : 0);\n";
+      break;
+    case FieldDescriptor::TYPE_STRING:
+    case FieldDescriptor::TYPE_BYTES:
+      text = "output->WriteVarint32($value$.size());\n"
+             "output->WriteString($value$);\n";
+      break;
+    case FieldDescriptor::TYPE_MESSAGE:
+      text = "output->WriteVarint32($value$.ByteSize());\n"
+             "$value$.SerializeWithCachedSizes(output);\n";
+      break;
+    default:
+      GOOGLE_LOG(FATAL) << "Unsupported Delta Type!" << GetTypeLabel(field);
+      return;
+  }
+
+  printer->Print(text, "value", value);
+}
+
+void CppDeltaGenerator::GenerateValueDeserializer(io::Printer* printer,
+                                                  const FieldDescriptor* field) {
+  map<string, string> vars;
+  vars["name"] = CppFieldName(field);
+  vars["store"] = field->is_repeated() ? "add_" : "set_";
+  vars["mutable"] = field->is_repeated() ? "add_" : "mutable_";
+
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_SFIXED32:
+      printer->Print(vars,
+        GetType(field) == FieldDescriptor::TYPE_INT32 ?
+          "if (!input->ReadVarint32(&value)) return false;\n" :
+          "if (!input->ReadLittleEndian32(&value)) return false;\n");
+      printer->Print(vars,
+        "message->$store$$name$(static_cast< ::google::protobuf::int32>(value));\n");
+      break;
+    case FieldDescriptor::TYPE_UINT32:
+      printer->Print(vars,
+        "if (!input->ReadVarint32(&value)) return false;\n"
+        "message->$store$$name$(value);\n");
+      break;
+    case FieldDescriptor::TYPE_SINT32:
+      printer->Print(vars,
+        "if (!input->ReadVarint32(&value)) return false;\n"
+        "message->$store$$name$(\n"
+        "  ::google::protobuf::internal::WireFormatLite::ZigZagDecode32(value));\n");
+      break;
+    case FieldDescriptor::TYPE_ENUM:
+      // UnrealScript takes any value, but the C++ setters only take known
+      // ones.
+      vars["enum"] = QualifiedCppEnumName(field->enum_type());
+      printer->Print(vars,
+        "if (!input->ReadVarint32(&value) ||\n"
+        "    !$enum$_IsValid(static_cast< ::google::protobuf::int32>(value))) {\n"
+        "  return false;\n"
+        "}\n"
+        "message->$store$$name$(static_cast< $enum$>(value));\n");
+      break;
+    case FieldDescriptor::TYPE_FIXED32:
+      printer->Print(vars,
+        "if (!input->ReadLittleEndian32(&value)) return false;\n"
+        "message->$store$$name$(value);\n");
+      break;
+    case FieldDescriptor::TYPE_FLOAT:
+      printer->Print(vars,
+        "if (!input->ReadLittleEndian32(&value)) return false;\n"
+        "message->$store$$name$(\n"
+        "  ::google::protobuf::internal::WireFormatLite::DecodeFloat(value));\n");
+      break;
+    case FieldDescriptor::TYPE_INT64:
+    case FieldDescriptor::TYPE_SFIXED64:
+      printer->Print(vars,
+        GetType(field) == FieldDescriptor::TYPE_INT64 ?
+          "if (!input->ReadVarint64(&value64)) return false;\n" :
+          "if (!input->ReadLittleEndian64(&value64)) return false;\n");
+      printer->Print(vars,
+        "message->$store$$name$(static_cast< ::google::protobuf::int64>(value64));\n");
+      break;
+    case FieldDescriptor::TYPE_UINT64:
+    case FieldDescriptor::TYPE_FIXED64:
+      printer->Print(vars,
+        GetType(field) == FieldDescriptor::TYPE_UINT64 ?
+          "if (!input->ReadVarint64(&value64)) return false;\n" :
+          "if (!input->ReadLittleEndian64(&value64)) return false;\n");
+      printer->Print(vars, "message->$store$$name$(value64);\n");
+      break;
+    case FieldDescriptor::TYPE_SINT64:
+      printer->Print(vars,
+        "if (!input->ReadVarint64(&value64)) return false;\n"
+        "message->$store$$name$(\n"
+        "  ::google::protobuf::internal::WireFormatLite::ZigZagDecode64(value64));\n");
+      break;
+    case FieldDescriptor::TYPE_BOOL:
+      printer->Print(vars,
+        "if (!input->ReadVarint32(&value)) return false;\n"
+        "message->$store$$name$(value != 0);\n");
+      break;
+    case FieldDescriptor::TYPE_STRING:
+    case FieldDescriptor::TYPE_BYTES:
+      printer->Print(vars,
+        "if (!input->ReadVarint32(&value) ||\n"
+        "    !input->ReadString(message->$mutable$$name$(), value)) {\n"
+        "  return false;\n"
+        "}\n");
+      break;
+    case FieldDescriptor::TYPE_MESSAGE:
+      // Messages are sent whole, so they replace rather than merge.  The
+      // length of a singular one is its size plus one, or 0 when unset.
+      if (field->is_repeated()) {
+        printer->Print(vars,
+          "{\n"
+          "  if (!input->ReadVarint32(&value)) return false;\n");
+      } else {
+        printer->Print(vars,
+          "if (!input->ReadVarint32(&value)) return false;\n"
+          "if (value == 0) {\n"
+          "  message->clear_$name$();\n"
+          "} else {\n"
+          "  value--;\n");
+      }
+      printer->Print(vars,
+        "  ::google::protobuf::io::CodedInputStream::Limit limit =\n"
+        "    input->PushLimit(value);\n"
+        "  ::google::protobuf::MessageLite* nested = message->$mutable$$name$();\n"
+        "  nested->Clear();\n"
+        "  if (!nested->MergePartialFromCodedStream(input) ||\n"
+        "      !input->ConsumedEntireMessage()) {\n"
+        "    return false;\n"
+        "  }\n"
+        "  input->PopLimit(limit);\n"
+        "}\n");
+      break;
+    default:
+      GOOGLE_LOG(FATAL) << "Unsupported Delta Type!" << GetTypeLabel(field);
+      break;
+  }
+}
+
+}  // namespace us
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,102 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Generates the C++ counterpart of the delta encoding of the UnrealScript
+// classes, for the host side.
+
+#ifndef GOOGLE_PROTOBUF_COMPILER_US_CPP_DELTA_H__
+#define GOOGLE_PROTOBUF_COMPILER_US_CPP_DELTA_H__
+
+#include <string>
+#include <google/protobuf/stubs/common.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/compiler/us/us_generator_options.h>
+
+namespace google {
+namespace protobuf {
+  namespace io {
+    class Printer;             // printer.h
+  }
+}
+
+namespace protobuf {
+namespace compiler {
+namespace us {
+
+// Generates <file>.us_delta.h, holding Equals(), SerializeDelta() and
+// ApplyDelta() functions for the classes the C++ generator produces from
+// the same file.
+class CppDeltaGenerator {
+ public:
+  CppDeltaGenerator(const FileDescriptor* file,
+                    const GeneratorOptions& options);
+  ~CppDeltaGenerator();
+
+  // Name of the generated header.
+  string filename() const;
+
+  void Generate(io::Printer* printer);
+
+ private:
+  void GenerateEquals(io::Printer* printer, const Descriptor* descriptor);
+  void GenerateSerializeDelta(io::Printer* printer,
+                              const Descriptor* descriptor);
+  void GenerateApplyDelta(io::Printer* printer,
+                          const Descriptor* descriptor);
+
+  // Prints a check running statement if the field differs between the
+  // messages a and b, given as expressions ending in "." or "->".
+  void GenerateFieldComparison(io::Printer* printer,
+                               const FieldDescriptor* field,
+                               const string& a, const string& b,
+                               const string& statement);
+
+  // Prints the statements writing the value held by the C++ expression
+  // value, without tag.
+  void GenerateValueSerializer(io::Printer* printer,
+                               const FieldDescriptor* field,
+                               const string& value);
+
+  // Prints the statements reading a value of the field into *message.
+  void GenerateValueDeserializer(io::Printer* printer,
+                                 const FieldDescriptor* field);
+
+  const FileDescriptor* file_;
+  const GeneratorOptions& options_;
+
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(CppDeltaGenerator);
+};
+
+}  // namespace us
+}  // namespace compiler
+}  // namespace protobuf
+
+}  // namespace google
+#endif  // GOOGLE_PROTOBUF_COMPILER_US_CPP_DELTA_H__
@@ -0,0 +1,869 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <map>
+#include <set>
+
+#include <google/protobuf/compiler/us/us_cpp_struct.h>
+#include <google/protobuf/compiler/us/us_helpers.h>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/io/printer.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/wire_format_lite.h>
+#include <google/protobuf/stubs/strutil.h>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace us {
+
+namespace {
+
+using internal::WireFormatLite;
+
+// How the values of a field are laid out on the wire.
+enum Encoding {
+  ENCODING_VARINT32,
+  ENCODING_VARINT64,
+  ENCODING_FIXED32,
+  ENCODING_FIXED64,
+  ENCODING_STRING,
+  ENCODING_MESSAGE,
+};
+
+Encoding GetEncoding(const FieldDescriptor* field) {
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_UINT32:
+    case FieldDescriptor::TYPE_SINT32:
+    case FieldDescriptor::TYPE_ENUM:
+    case FieldDescriptor::TYPE_BOOL:
+      return ENCODING_VARINT32;
+    case FieldDescriptor::TYPE_INT64:
+    case FieldDescriptor::TYPE_UINT64:
+    case FieldDescriptor::TYPE_SINT64:
+      return ENCODING_VARINT64;
+    case FieldDescriptor::TYPE_FIXED32:
+    case FieldDescriptor::TYPE_SFIXED32:
+    case FieldDescriptor::TYPE_FLOAT:
+      return ENCODING_FIXED32;
+    case FieldDescriptor::TYPE_FIXED64:
+    case FieldDescriptor::TYPE_SFIXED64:
+      return ENCODING_FIXED64;
+    case FieldDescriptor::TYPE_STRING:
+    case FieldDescriptor::TYPE_BYTES:
+      return ENCODING_STRING;
+    case FieldDescriptor::TYPE_MESSAGE:
+      return ENCODING_MESSAGE;
+    default:
+      GOOGLE_LOG(FATAL) << "Unsupported Struct Type!" << GetTypeLabel(field);
+      return ENCODING_VARINT32;
+  }
+}
+
+uint32 UnpackedTag(const FieldDescriptor* field) {
+  return WireFormatLite::MakeTag(field->number(),
+    WireFormatLite::WireTypeForFieldType(
+      static_cast<WireFormatLite::FieldType>(field->type())));
+}
+
+uint32 PackedTag(const FieldDescriptor* field) {
+  return WireFormatLite::MakeTag(field->number(),
+    WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+}
+
+string TagSize(const FieldDescriptor* field) {
+  return SimpleItoa(io::CodedOutputStream::VarintSize32(UnpackedTag(field)));
+}
+
+// Arguments of the quantize functions of us_encoder.h for the field.
+string QuantizeArguments(const FieldDescriptor* field) {
+  double min, max, precision;
+  GetQuantization(field, &min, &max, &precision);
+  return FloatLiteral(min) + "f, " + FloatLiteral(max) + "f, " +
+         FloatLiteral(precision) + "f";
+}
+
+// The integer sent for value, a C++ expression holding a value of the
+// field, for the fields whose values aren't copied as they are.
+string WireValue(const FieldDescriptor* field, const string& value) {
+  if (IsQuantized(field)) {
+    return "::google::protobuf::us::QuantizeFloat(" + value + ", " +
+           QuantizeArguments(field) + ")";
+  }
+
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_SINT32:
+      return "::google::protobuf::internal::WireFormatLite::ZigZagEncode32(" +
+             value + ")";
+    case FieldDescriptor::TYPE_SINT64:
+      return "::google::protobuf::internal::WireFormatLite::ZigZagEncode64(" +
+             value + ")";
+    case FieldDescriptor::TYPE_FLOAT:
+      return "::google::protobuf::internal::WireFormatLite::EncodeFloat(" +
+             value + ")";
+    case FieldDescriptor::TYPE_BOOL:
+      return "(" + value + " ? 1 : 0)";
+    default:
+      break;
+  }
+
+  switch (GetEncoding(field)) {
+    case ENCODING_VARINT32:
+    case ENCODING_FIXED32:
+      return "static_cast< ::google::protobuf::uint32>(" + value + ")";
+    case ENCODING_VARINT64:
+    case ENCODING_FIXED64:
+      return "static_cast< ::google::protobuf::uint64>(" + value + ")";
+    default:
+      return value;
+  }
+}
+
+// Size of value without its tag.  Messages must have their size cached.
+string ValueSize(const FieldDescriptor* field, const string& value) {
+  switch (GetEncoding(field)) {
+    case ENCODING_VARINT32:
+      return GetType(field) == FieldDescriptor::TYPE_BOOL ? "1" :
+        "::google::protobuf::us::Encoder::VarintSize32(" +
+        WireValue(field, value) + ")";
+    case ENCODING_VARINT64:
+      return "::google::protobuf::us::Encoder::VarintSize64(" +
+             WireValue(field, value) + ")";
+    case ENCODING_FIXED32:
+      return "4";
+    case ENCODING_FIXED64:
+      return "8";
+    case ENCODING_STRING:
+      return "::google::protobuf::us::Encoder::StringSize(" + value + ")";
+    case ENCODING_MESSAGE:
+      return "::google::protobuf::us::Encoder::VarintSize32(" + value +
+             "._cachedSize) + " + value + "._cachedSize";
+  }
+  return "";
+}
+
+// Statements writing value without its tag.
+void PrintValueSerializer(io::Printer* printer, const FieldDescriptor* field,
+                          const string& value) {
+  const char* text = NULL;
+
+  switch (GetEncoding(field)) {
+    case ENCODING_VARINT32:
+      text = "output->WriteVarint32($wire$);\n";
+      break;
+    case ENCODING_VARINT64:
+      text = "output->WriteVarint64($wire$);\n";
+      break;
+    case ENCODING_FIXED32:
+      text = "output->WriteLittleEndian32($wire$);\n";
+      break;
+    case ENCODING_FIXED64:
+      text = "output->WriteLittleEndian64($wire$);\n";
+      break;
+    case ENCODING_STRING:
+      text = "output->WriteString($value$);\n";
+      break;
+    case ENCODING_MESSAGE:
+      text = "output->WriteVarint32($value$._cachedSize);\n"
+             "$value$.SerializeWithCachedSizes(output);\n";
+      break;
+  }
+
+  printer->Print(text,
+    "value", value,
+    "wire", WireValue(field, value));
+}
+
+// Expression reading a value of a scalar field from input.
+string ReadValue(const FieldDescriptor* field) {
+  if (IsQuantized(field)) {
+    return "::google::protobuf::us::DequantizeFloat(input->ReadVarint32(), " +
+           QuantizeArguments(field) + ")";
+  }
+
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_ENUM:
+      return "static_cast< ::google::protobuf::int32>(input->ReadVarint32())";
+    case FieldDescriptor::TYPE_UINT32:
+      return "input->ReadVarint32()";
+    case FieldDescriptor::TYPE_SINT32:
+      return "::google::protobuf::internal::WireFormatLite::ZigZagDecode32(\n"
+             "    input->ReadVarint32())";
+    case FieldDescriptor::TYPE_BOOL:
+      return "input->ReadVarint32() != 0";
+    case FieldDescriptor::TYPE_FIXED32:
+      return "input->ReadLittleEndian32()";
+    case FieldDescriptor::TYPE_SFIXED32:
+      return "static_cast< ::google::protobuf::int32>(input->ReadLittleEndian32())";
+    case FieldDescriptor::TYPE_FLOAT:
+      return "::google::protobuf::internal::WireFormatLite::DecodeFloat(\n"
+             "    input->ReadLittleEndian32())";
+    case FieldDescriptor::TYPE_INT64:
+      return "static_cast< ::google::protobuf::int64>(input->ReadVarint64())";
+    case FieldDescriptor::TYPE_UINT64:
+      return "input->ReadVarint64()";
+    case FieldDescriptor::TYPE_SINT64:
+      return "::google::protobuf::internal::WireFormatLite::ZigZagDecode64(\n"
+             "    input->ReadVarint64())";
+    case FieldDescriptor::TYPE_FIXED64:
+      return "input->ReadLittleEndian64()";
+    case FieldDescriptor::TYPE_SFIXED64:
+      return "static_cast< ::google::protobuf::int64>(input->ReadLittleEndian64())";
+    default:
+      GOOGLE_LOG(FATAL) << "Unsupported Struct Type!" << GetTypeLabel(field);
+      return "";
+  }
+}
+
+// Value Clear() and the constructor give a singular scalar field.
+const char* ZeroValue(const FieldDescriptor* field) {
+  switch (GetUnrealScriptType(field)) {
+    case UNREALSCRIPT_TYPE_BOOLEAN:
+      return "false";
+    case UNREALSCRIPT_TYPE_FLOAT:
+      return "0.0f";
+    default:
+      return "0";
+  }
+}
+
+bool IsScalar(const FieldDescriptor* field) {
+  return !field->is_repeated() &&
+         GetEncoding(field) != ENCODING_STRING &&
+         GetEncoding(field) != ENCODING_MESSAGE;
+}
+
+}  // namespace
+
+CppStructGenerator::CppStructGenerator(const FileDescriptor* file,
+                                       const GeneratorOptions& options)
+  : file_(file),
+    options_(options) {
+  ListMessages(file_, &messages_);
+  recursive_ = OrderMessages();
+}
+
+CppStructGenerator::~CppStructGenerator() {}
+
+string CppStructGenerator::FileName(const FileDescriptor* file) {
+  return StripProto(file->name()) + ".us_structs.h";
+}
+
+bool CppStructGenerator::Validate(string* error) {
+  if (recursive_ != NULL) {
+    error->assign(file_->name());
+    error->append(": Message \"" + recursive_->full_name() + "\" contains "
+                  "itself, which the cpp_structs option doesn't support.");
+    return false;
+  }
+
+  return true;
+}
+
+const Descriptor* CppStructGenerator::OrderMessages() {
+  // Depth first, printing a message once all the ones it holds have been.
+  // Messages of other files come from their own headers.
+  vector<const Descriptor*> ordered;
+  set<const Descriptor*> done;
+  set<const Descriptor*> visiting;
+  vector<pair<const Descriptor*, int> > stack;
+
+  for (int i = 0; i < messages_.size(); i++) {
+    if (done.count(messages_[i]) > 0) continue;
+
+    stack.push_back(make_pair(messages_[i], 0));
+    visiting.insert(messages_[i]);
+
+    while (!stack.empty()) {
+      const Descriptor* descriptor = stack.back().first;
+      int next = stack.back().second++;
+
+      if (next == descriptor->field_count()) {
+        visiting.erase(descriptor);
+        done.insert(descriptor);
+        ordered.push_back(descriptor);
+        stack.pop_back();
+        continue;
+      }
+
+      const FieldDescriptor* field = descriptor->field(next);
+      if (field->type() != FieldDescriptor::TYPE_MESSAGE) continue;
+
+      const Descriptor* child = field->message_type();
+      if (child->file() != file_ || done.count(child) > 0) continue;
+      if (visiting.count(child) > 0) return child;
+
+      stack.push_back(make_pair(child, 0));
+      visiting.insert(child);
+    }
+  }
+
+  messages_.swap(ordered);
+  return NULL;
+}
+
+string CppStructGenerator::StructName(const Descriptor* descriptor) {
+  if (descriptor->file() == file_) {
+    return UnrealScriptClassName(descriptor);
+  }
+
+  string name = "::";
+  if (!descriptor->file()->package().empty()) {
+    name += StringReplace(descriptor->file()->package(), ".", "::", true);
+    name += "::";
+  }
+  return name + "us_structs::" + UnrealScriptClassName(descriptor);
+}
+
+string CppStructGenerator::ValueType(const FieldDescriptor* field) {
+  if (GetUnrealScriptType(field) == UNREALSCRIPT_TYPE_FLOAT) {
+    return "float";
+  }
+
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_SINT32:
+    case FieldDescriptor::TYPE_SFIXED32:
+    case FieldDescriptor::TYPE_ENUM:
+      return "::google::protobuf::int32";
+    case FieldDescriptor::TYPE_UINT32:
+    case FieldDescriptor::TYPE_FIXED32:
+      return "::google::protobuf::uint32";
+    case FieldDescriptor::TYPE_INT64:
+    case FieldDescriptor::TYPE_SINT64:
+    case FieldDescriptor::TYPE_SFIXED64:
+      return "::google::protobuf::int64";
+    case FieldDescriptor::TYPE_UINT64:
+    case FieldDescriptor::TYPE_FIXED64:
+      return "::google::protobuf::uint64";
+    case FieldDescriptor::TYPE_BOOL:
+      return "bool";
+    case FieldDescriptor::TYPE_STRING:
+    case FieldDescriptor::TYPE_BYTES:
+      return "::std::string";
+    case FieldDescriptor::TYPE_MESSAGE:
+      return StructName(field->message_type());
+    default:
+      GOOGLE_LOG(FATAL) << "Unsupported Struct Type!" << GetTypeLabel(field);
+      return "";
+  }
+}
+
+void CppStructGenerator::Generate(io::Printer* printer) {
+  string guard = "US_STRUCTS_" + FilenameIdentifier(file_->name()) +
+                 "__INCLUDED";
+
+  printer->Print(
+    "// Generated by the protocol buffer compiler.  DO NOT EDIT!\n"
+    "// source: $filename$\n"
+    "//\n"
+    "// Structs laid out like the UnrealScript classes generated from this\n"
+    "// file, encoded and decoded the way those classes are.\n"
+    "\n"
+    "#ifndef $guard$\n"
+    "#define $guard$\n"
+    "\n"
+    "#include <string>\n"
+    "#include <vector>\n"
+    "#include <google/protobuf/wire_format_lite.h>\n"
+    "#include <google/protobuf/us/us_decoder.h>\n"
+    "#include <google/protobuf/us/us_encoder.h>\n",
+    "filename", file_->name(),
+    "guard", guard);
+
+  // Messages of other files are held by value, so their structs are needed.
+  set<const FileDescriptor*> dependencies;
+  for (int i = 0; i < messages_.size(); i++) {
+    for (int j = 0; j < messages_[i]->field_count(); j++) {
+      const FieldDescriptor* field = messages_[i]->field(j);
+      if (field->type() == FieldDescriptor::TYPE_MESSAGE &&
+          field->message_type()->file() != file_) {
+        dependencies.insert(field->message_type()->file());
+      }
+    }
+  }
+
+  for (int i = 0; i < file_->dependency_count(); i++) {
+    if (dependencies.count(file_->dependency(i)) > 0) {
+      printer->Print("#include \"$header$\"\n",
+        "header", FileName(file_->dependency(i)));
+    }
+  }
+
+  printer->Print("\n");
+
+  vector<string> package_parts;
+  SplitPackage(file_, &package_parts);
+
+  for (int i = 0; i < package_parts.size(); i++) {
+    printer->Print("namespace $part$ {\n", "part", package_parts[i]);
+  }
+  printer->Print("namespace us_structs {\n");
+
+  vector<const EnumDescriptor*> enums;
+  ListEnums(file_, &enums);
+
+  for (int i = 0; i < enums.size(); i++) {
+    GenerateEnum(printer, enums[i]);
+  }
+
+  for (int i = 0; i < messages_.size(); i++) {
+    GenerateStruct(printer, messages_[i]);
+  }
+
+  for (int i = 0; i < messages_.size(); i++) {
+    const Descriptor* descriptor = messages_[i];
+
+    printer->Print(
+      "\n"
+      "// ===================================================================\n"
+      "// $fullname$\n",
+      "fullname", descriptor->full_name());
+
+    GenerateClear(printer, descriptor);
+    GenerateSerializedSize(printer, descriptor);
+    GenerateSerialize(printer, descriptor);
+    GenerateDeserialize(printer, descriptor);
+  }
+
+  printer->Print("\n}  // namespace us_structs\n");
+  for (int i = package_parts.size() - 1; i >= 0; i--) {
+    printer->Print("}  // namespace $part$\n", "part", package_parts[i]);
+  }
+
+  printer->Print(
+    "\n"
+    "#endif  // $guard$\n",
+    "guard", guard);
+}
+
+void CppStructGenerator::GenerateEnum(io::Printer* printer,
+                                      const EnumDescriptor* descriptor) {
+  printer->Print(
+    "\n"
+    "// Values of the enum $fullname$.\n"
+    "struct $classname$ {\n",
+    "fullname", descriptor->full_name(),
+    "classname", UnrealScriptClassName(descriptor));
+  printer->Indent();
+
+  for (int i = 0; i < descriptor->value_count(); i++) {
+    const EnumValueDescriptor* value = descriptor->value(i);
+
+    printer->Print("static const ::google::protobuf::int32 $name$ = $number$;\n",
+      "name", value->name(),
+      "number", SimpleItoa(value->number()));
+  }
+
+  printer->Outdent();
+  printer->Print("};\n");
+}
+
+void CppStructGenerator::GenerateStruct(io::Printer* printer,
+                                        const Descriptor* descriptor) {
+  printer->Print(
+    "\n"
+    "// $fullname$\n"
+    "struct $classname$ {\n",
+    "fullname", descriptor->full_name(),
+    "classname", UnrealScriptClassName(descriptor));
+  printer->Indent();
+
+  printer->Print("static const int TYPE_ID = $typeid$;\n",
+    "typeid", SimpleItoa(MessageTypeId(descriptor, options_)));
+
+  if (descriptor->field_count() > 0) {
+    printer->Print("\n");
+  }
+
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+
+    printer->Print(
+      "static const int $constname$_FIELD_NUMBER = $number$;\n"
+      "static const ::google::protobuf::uint32 $constname$_TAG = $tag$;\n",
+      "constname", ToUpperCase(field->name()),
+      "number", SimpleItoa(field->number()),
+      "tag", SimpleItoa(UnpackedTag(field)));
+
+    if (field->is_repeated() && field->is_packable() && !IsQuantized(field)) {
+      printer->Print(
+        "static const ::google::protobuf::uint32 $constname$_PACKED_TAG = $tag$;\n",
+        "constname", ToUpperCase(field->name()),
+        "tag", SimpleItoa(PackedTag(field)));
+    }
+  }
+
+  printer->Print(
+    "\n"
+    "$classname$();\n"
+    "\n"
+    "// Resets every field, keeping the memory held by strings and vectors.\n"
+    "void Clear();\n"
+    "\n"
+    "// Computes the encoded size and caches it, along with the sizes of\n"
+    "// the nested messages, for SerializeWithCachedSizes().\n"
+    "int GetSerializedSize() const;\n"
+    "void SerializeWithCachedSizes(::google::protobuf::us::Encoder* output) const;\n"
+    "\n"
+    "// Appends the encoding to *output.\n"
+    "void Serialize(::std::string* output) const;\n"
+    "\n"
+    "// Merges the fields read from input into this struct.  Returns false\n"
+    "// if the input is malformed.\n"
+    "bool Deserialize(::google::protobuf::us::Decoder* input);\n"
+    "\n"
+    "// Clears the struct and decodes the given buffer.\n"
+    "bool Deserialize(const void* data, int size);\n"
+    "\n",
+    "classname", UnrealScriptClassName(descriptor));
+
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+
+    if (field->is_repeated()) {
+      printer->Print("::std::vector< $type$> $name$;\n",
+        "type", ValueType(field),
+        "name", CppFieldName(field));
+    } else {
+      printer->Print("$type$ $name$;\n",
+        "type", ValueType(field),
+        "name", CppFieldName(field));
+    }
+  }
+
+  if (HasUnknownFields(descriptor)) {
+    printer->Print("::std::string _unknownFields;\n");
+  }
+
+  printer->Print("mutable int _cachedSize;\n");
+
+  printer->Outdent();
+  printer->Print("};\n");
+}
+
+void CppStructGenerator::GenerateClear(io::Printer* printer,
+                                       const Descriptor* descriptor) {
+  // Print the constructor, which leaves the struct cleared.
+  printer->Print(
+    "\n"
+    "inline $classname$::$classname$()\n",
+    "classname", UnrealScriptClassName(descriptor));
+
+  printer->Print("  : ");
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+    if (!IsScalar(field)) continue;
+
+    printer->Print("$name$($value$),\n    ",
+      "name", CppFieldName(field),
+      "value", ZeroValue(field));
+  }
+  printer->Print("_cachedSize(0) {\n}\n");
+
+  // Print Clear
+  printer->Print(
+    "\n"
+    "inline void $classname$::Clear() {\n",
+    "classname", UnrealScriptClassName(descriptor));
+  printer->Indent();
+
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+
+    if (field->is_repeated() || GetEncoding(field) == ENCODING_STRING) {
+      printer->Print("$name$.clear();\n", "name", CppFieldName(field));
+    } else if (GetEncoding(field) == ENCODING_MESSAGE) {
+      printer->Print("$name$.Clear();\n", "name", CppFieldName(field));
+    } else {
+      printer->Print("$name$ = $value$;\n",
+        "name", CppFieldName(field),
+        "value", ZeroValue(field));
+    }
+  }
+
+  if (HasUnknownFields(descriptor)) {
+    printer->Print("_unknownFields.clear();\n");
+  }
+
+  printer->Outdent();
+  printer->Print("}\n");
+}
+
+void CppStructGenerator::GenerateSerializedSize(io::Printer* printer,
+                                                const Descriptor* descriptor) {
+  printer->Print(
+    "\n"
+    "inline int $classname$::GetSerializedSize() const {\n"
+    "  int size = 0;\n",
+    "classname", UnrealScriptClassName(descriptor));
+  printer->Indent();
+
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+    map<string, string> vars;
+    vars["name"] = CppFieldName(field);
+    vars["tagsize"] = TagSize(field);
+
+    printer->Print("\n");
+
+    if (IsPacked(field)) {
+      // Empty packed fields aren't written at all.
+      vars["valuesize"] = ValueSize(field, vars["name"] + "[i]");
+      printer->Print(vars,
+        "if (!$name$.empty()) {\n"
+        "  int data_size = 0;\n"
+        "  for (size_t i = 0; i < $name$.size(); i++) {\n"
+        "    data_size += $valuesize$;\n"
+        "  }\n"
+        "  size += $tagsize$ +\n"
+        "      ::google::protobuf::us::Encoder::VarintSize32(data_size) +\n"
+        "      data_size;\n"
+        "}\n");
+    } else if (field->is_repeated()) {
+      vars["valuesize"] = ValueSize(field, vars["name"] + "[i]");
+      printer->Print(vars, "for (size_t i = 0; i < $name$.size(); i++) {\n");
+      if (GetEncoding(field) == ENCODING_MESSAGE) {
+        printer->Print(vars, "  $name$[i].GetSerializedSize();\n");
+      }
+      printer->Print(vars,
+        "  size += $tagsize$ + $valuesize$;\n"
+        "}\n");
+    } else {
+      vars["valuesize"] = ValueSize(field, vars["name"]);
+      if (GetEncoding(field) == ENCODING_MESSAGE) {
+        printer->Print(vars, "$name$.GetSerializedSize();\n");
+      }
+      printer->Print(vars, "size += $tagsize$ + $valuesize$;\n");
+    }
+  }
+
+  if (HasUnknownFields(descriptor)) {
+    printer->Print("\nsize += _unknownFields.size();\n");
+  }
+
+  printer->Outdent();
+  printer->Print(
+    "\n"
+    "  _cachedSize = size;\n"
+    "  return size;\n"
+    "}\n");
+}
+
+void CppStructGenerator::GenerateSerialize(io::Printer* printer,
+                                           const Descriptor* descriptor) {
+  printer->Print(
+    "\n"
+    "inline void $classname$::SerializeWithCachedSizes(\n"
+    "    ::google::protobuf::us::Encoder* output) const {\n",
+    "classname", UnrealScriptClassName(descriptor));
+  printer->Indent();
+
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+    map<string, string> vars;
+    vars["name"] = CppFieldName(field);
+    vars["constname"] = ToUpperCase(field->name());
+
+    if (IsPacked(field)) {
+      vars["valuesize"] = ValueSize(field, vars["name"] + "[i]");
+      printer->Print(vars,
+        "if (!$name$.empty()) {\n"
+        "  int data_size = 0;\n"
+        "  for (size_t i = 0; i < $name$.size(); i++) {\n"
+        "    data_size += $valuesize$;\n"
+        "  }\n"
+        "  output->WriteVarint32($constname$_PACKED_TAG);\n"
+        "  output->WriteVarint32(data_size);\n"
+        "  for (size_t i = 0; i < $name$.size(); i++) {\n");
+      printer->Indent();
+      printer->Indent();
+      PrintValueSerializer(printer, field, vars["name"] + "[i]");
+      printer->Outdent();
+      printer->Outdent();
+      printer->Print(
+        "  }\n"
+        "}\n");
+    } else if (field->is_repeated()) {
+      printer->Print(vars,
+        "for (size_t i = 0; i < $name$.size(); i++) {\n"
+        "  output->WriteVarint32($constname$_TAG);\n");
+      printer->Indent();
+      PrintValueSerializer(printer, field, vars["name"] + "[i]");
+      printer->Outdent();
+      printer->Print("}\n");
+    } else {
+      printer->Print(vars, "output->WriteVarint32($constname$_TAG);\n");
+      PrintValueSerializer(printer, field, vars["name"]);
+    }
+  }
+
+  if (HasUnknownFields(descriptor)) {
+    printer->Print(
+      "output->WriteRaw(_unknownFields.data(), _unknownFields.size());\n");
+  }
+
+  printer->Outdent();
+  printer->Print("}\n");
+
+  printer->Print(
+    "\n"
+    "inline void $classname$::Serialize(::std::string* output) const {\n"
+    "  int size = GetSerializedSize();\n"
+    "  if (size == 0) return;\n"
+    "\n"
+    "  size_t start = output->size();\n"
+    "  output->resize(start + size);\n"
+    "  ::google::protobuf::us::Encoder encoder(&(*output)[start]);\n"
+    "  SerializeWithCachedSizes(&encoder);\n"
+    "}\n",
+    "classname", UnrealScriptClassName(descriptor));
+}
+
+void CppStructGenerator::GenerateDeserialize(io::Printer* printer,
+                                             const Descriptor* descriptor) {
+  printer->Print(
+    "\n"
+    "inline bool $classname$::Deserialize(\n"
+    "    ::google::protobuf::us::Decoder* input) {\n",
+    "classname", UnrealScriptClassName(descriptor));
+  printer->Indent();
+
+  printer->Print(
+    "for (::google::protobuf::uint32 tag = input->ReadTag(); tag > 0;\n"
+    "     tag = input->ReadTag()) {\n"
+    "  switch (tag) {\n");
+  printer->Indent();
+  printer->Indent();
+
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+    map<string, string> vars;
+    vars["name"] = CppFieldName(field);
+    vars["constname"] = ToUpperCase(field->name());
+    vars["type"] = ValueType(field);
+
+    printer->Print(vars, "case $constname$_TAG:\n");
+    printer->Indent();
+
+    switch (GetEncoding(field)) {
+      case ENCODING_MESSAGE:
+        // Nested messages are merged, as in the UnrealScript classes.
+        printer->Print(vars,
+          "{\n"
+          "  int limit = input->PushLimit(\n"
+          "      static_cast<int>(input->ReadVarint32()));\n");
+        if (field->is_repeated()) {
+          printer->Print(vars,
+            "  $name$.push_back($type$());\n"
+            "  $name$.back().Deserialize(input);\n");
+        } else {
+          printer->Print(vars, "  $name$.Deserialize(input);\n");
+        }
+        printer->Print(
+          "  input->PopLimit(limit);\n"
+          "}\n");
+        break;
+
+      case ENCODING_STRING:
+        if (field->is_repeated()) {
+          printer->Print(vars,
+            "$name$.push_back(::std::string());\n"
+            "input->ReadString(&$name$.back());\n");
+        } else {
+          printer->Print(vars, "input->ReadString(&$name$);\n");
+        }
+        break;
+
+      default:
+        vars["value"] = ReadValue(field);
+        if (field->is_repeated()) {
+          printer->Print(vars, "$name$.push_back($value$);\n");
+        } else {
+          printer->Print(vars, "$name$ = $value$;\n");
+        }
+        break;
+    }
+
+    printer->Print("break;\n");
+    printer->Outdent();
+
+    // Both encodings are accepted, whatever the field is declared as.
+    if (field->is_repeated() && field->is_packable() && !IsQuantized(field)) {
+      vars["value"] = ReadValue(field);
+      printer->Print(vars,
+        "case $constname$_PACKED_TAG: {\n"
+        "  int limit = input->PushLimit(\n"
+        "      static_cast<int>(input->ReadVarint32()));\n"
+        "  while (!input->IsAtEnd()) {\n"
+        "    $name$.push_back($value$);\n"
+        "  }\n"
+        "  input->PopLimit(limit);\n"
+        "  break;\n"
+        "}\n");
+    }
+  }
+
+  printer->Print("default:\n");
+  if (HasUnknownFields(descriptor)) {
+    printer->Print(
+      "  if (!input->ReadUnknownField(tag, &_unknownFields)) return false;\n");
+  } else {
+    printer->Print("  if (!input->SkipField(tag)) return false;\n");
+  }
+  printer->Print("  break;\n");
+
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print(
+    "  }\n"
+    "}\n"
+    "\n"
+    "return input->error() == ::google::protobuf::us::Decoder::ERROR_NONE;\n");
+
+  printer->Outdent();
+  printer->Print("}\n");
+
+  printer->Print(
+    "\n"
+    "inline bool $classname$::Deserialize(const void* data, int size) {\n"
+    "  Clear();\n"
+    "  ::google::protobuf::us::Decoder decoder(data, size);\n"
+    "  return Deserialize(&decoder);\n"
+    "}\n",
+    "classname", UnrealScriptClassName(descriptor));
+}
+
+}  // namespace us
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
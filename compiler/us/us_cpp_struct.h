@@ -0,0 +1,114 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Generates plain C++ structs mirroring the UnrealScript classes, with
+// inline codecs following the encoding rules of the UnrealScript runtime.
+
+#ifndef GOOGLE_PROTOBUF_COMPILER_US_CPP_STRUCT_H__
+#define GOOGLE_PROTOBUF_COMPILER_US_CPP_STRUCT_H__
+
+#include <string>
+#include <vector>
+#include <google/protobuf/stubs/common.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/compiler/us/us_generator_options.h>
+
+namespace google {
+namespace protobuf {
+  namespace io {
+    class Printer;             // printer.h
+  }
+}
+
+namespace protobuf {
+namespace compiler {
+namespace us {
+
+// Generates <file>.us_structs.h, holding a struct per message of the file,
+// named like its UnrealScript class, with Serialize() and Deserialize()
+// built on the Encoder and Decoder of cpp-lib.  Servers can use these
+// instead of the classes of the C++ generator, without reflection or
+// arenas.
+class CppStructGenerator {
+ public:
+  CppStructGenerator(const FileDescriptor* file,
+                     const GeneratorOptions& options);
+  ~CppStructGenerator();
+
+  // Name of the generated header.
+  static string FileName(const FileDescriptor* file);
+
+  // Structs hold nested messages by value, so a message can't contain
+  // itself.  Returns false with a description in *error if one does.
+  bool Validate(string* error);
+
+  void Generate(io::Printer* printer);
+
+ private:
+  // Orders messages_ so that every struct comes after the ones it holds.
+  // Returns the message found to hold itself, or NULL, in which case the
+  // order is left as is.
+  const Descriptor* OrderMessages();
+
+  void GenerateEnum(io::Printer* printer, const EnumDescriptor* descriptor);
+  void GenerateStruct(io::Printer* printer, const Descriptor* descriptor);
+  void GenerateClear(io::Printer* printer, const Descriptor* descriptor);
+  void GenerateSerializedSize(io::Printer* printer,
+                              const Descriptor* descriptor);
+  void GenerateSerialize(io::Printer* printer, const Descriptor* descriptor);
+  void GenerateDeserialize(io::Printer* printer,
+                           const Descriptor* descriptor);
+
+  // Name of the struct of the message, qualified if it comes from another
+  // file.
+  string StructName(const Descriptor* descriptor);
+
+  // C++ type of a single value of the field.
+  string ValueType(const FieldDescriptor* field);
+
+  const FileDescriptor* file_;
+  const GeneratorOptions& options_;
+
+  // Messages of the file, nested ones included, in the order their structs
+  // are printed.
+  vector<const Descriptor*> messages_;
+
+  // A message holding itself, directly or not, or NULL.
+  const Descriptor* recursive_;
+
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(CppStructGenerator);
+};
+
+}  // namespace us
+}  // namespace compiler
+}  // namespace protobuf
+
+}  // namespace google
+#endif  // GOOGLE_PROTOBUF_COMPILER_US_CPP_STRUCT_H__
@@ -32,12 +32,22 @@
 //  Based on original Protocol Buffers design by
 //  Sanjay Ghemawat, Jeff Dean, and others.
 
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <map>
+#include <thread>
+
+#include <google/protobuf/compiler/us/us_cpp_delta.h>
+#include <google/protobuf/compiler/us/us_cpp_struct.h>
+#include <google/protobuf/compiler/us/us_enum.h>
 #include <google/protobuf/compiler/us/us_file.h>
 #include <google/protobuf/compiler/us/us_helpers.h>
 #include <google/protobuf/compiler/us/us_message.h>
 #include <google/protobuf/compiler/code_generator.h>
 #include <google/protobuf/io/printer.h>
 #include <google/protobuf/io/zero_copy_stream.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
 #include <google/protobuf/descriptor.pb.h>
 #include <google/protobuf/stubs/strutil.h>
 
@@ -46,15 +56,47 @@ namespace protobuf {
 namespace compiler {
 namespace us {
 
-FileGenerator::FileGenerator(const FileDescriptor* file)
+namespace {
+
+// Returns the name of the C++ registry header generated for the file.
+string CppRegistryFileName(const FileDescriptor* file) {
+  return StripProto(file->name()) + ".us_registry.h";
+}
+
+// Adds the files imported by the file, directly or not, to imports.  Those
+// of protobuf itself, e.g. descriptor.proto for us_options.proto, are never
+// generated and left out.
+void ListImports(const FileDescriptor* file,
+                 vector<const FileDescriptor*>* imports) {
+  for (int i = 0; i < file->dependency_count(); i++) {
+    const FileDescriptor* dependency = file->dependency(i);
+
+    if (HasPrefixString(dependency->name(), "google/protobuf/") ||
+        find(imports->begin(), imports->end(), dependency) != imports->end()) {
+      continue;
+    }
+
+    imports->push_back(dependency);
+    ListImports(dependency, imports);
+  }
+}
+
+}  // namespace
+
+FileGenerator::FileGenerator(const FileDescriptor* file,
+                             const GeneratorOptions& options)
   : file_(file),
+    options_(options),
     java_package_(FileJavaPackage(file)),
     classname_(FileClassName(file)) {
+  ListMessages(file_, &messages_);
+  ListEnums(file_, &enums_);
 }
 
 FileGenerator::~FileGenerator() {}
 
-bool FileGenerator::Validate(string* error) {
+bool FileGenerator::Validate(const map<int, string>& used_type_ids,
+                             string* error) {
   // Check that no class name matches the file's class name.  This is a common
   // problem that leads to Java compile errors that can be hard to understand.
   // It's especially bad when using the java_multiple_files, since we would
@@ -89,44 +131,446 @@ bool FileGenerator::Validate(string* error) {
     return false;
   }
 
+  // Nested types are flattened, so Outer.Inner and a message named
+  // Outer_Inner would both be generated as MessageOuter_Inner.  UnrealScript
+  // names are case insensitive too.
+  vector<pair<string, string> > classes;
+  classes.push_back(make_pair(RegistryClassName(file_), file_->name()));
+  for (int i = 0; i < messages_.size(); i++) {
+    classes.push_back(make_pair(UnrealScriptClassName(messages_[i]),
+                                messages_[i]->full_name()));
+  }
+  for (int i = 0; i < enums_.size(); i++) {
+    classes.push_back(make_pair(UnrealScriptClassName(enums_[i]),
+                                enums_[i]->full_name()));
+  }
+
+  map<string, string> class_names;
+  for (int i = 0; i < classes.size(); i++) {
+    string key = classes[i].first;
+    LowerString(&key);
+
+    if (class_names.count(key) > 0) {
+      error->assign(file_->name());
+      error->append(": \"" + class_names[key] + "\" and \"" +
+                    classes[i].second + "\" would both be generated as "
+                    "class " + classes[i].first + ".  Please rename one of "
+                    "them.");
+      return false;
+    }
+
+    class_names[key] = classes[i].second;
+  }
+
+  // Type ids identify messages on the wire, so they must be distinct among
+  // all the messages a client registers.  Those are taken to be the
+  // messages of this file, of the files it imports and of the files
+  // generated earlier in the same run.
+  map<int, string> other_type_ids(used_type_ids);
+  vector<const FileDescriptor*> imports;
+  ListImports(file_, &imports);
+  for (int i = 0; i < imports.size(); i++) {
+    vector<const Descriptor*> imported;
+    ListMessages(imports[i], &imported);
+    for (int j = 0; j < imported.size(); j++) {
+      other_type_ids.insert(make_pair(MessageTypeId(imported[j], options_),
+                                      imported[j]->full_name()));
+    }
+  }
+
+  map<int, const Descriptor*> type_ids;
+  for (int i = 0; i < messages_.size(); i++) {
+    const Descriptor* descriptor = messages_[i];
+    int type_id = MessageTypeId(descriptor, options_);
+
+    if (type_id <= 0) {
+      error->assign(file_->name());
+      error->append(": Message \"" + descriptor->full_name() +
+                    "\" has type id " + SimpleItoa(type_id) +
+                    ", type ids must be positive.");
+      return false;
+    }
+
+    if (type_ids.count(type_id) > 0) {
+      error->assign(file_->name());
+      error->append(": Messages \"" + type_ids[type_id]->full_name() +
+                    "\" and \"" + descriptor->full_name() +
+                    "\" have the same type id " + SimpleItoa(type_id) +
+                    ".  Please assign one of them a type id with the "
+                    "(us.type_id) option or the type_ids generator parameter.");
+      return false;
+    }
+
+    map<int, string>::const_iterator other = other_type_ids.find(type_id);
+    if (other != other_type_ids.end() &&
+        other->second != descriptor->full_name()) {
+      error->assign(file_->name());
+      error->append(": Message \"" + descriptor->full_name() +
+                    "\" has the same type id " + SimpleItoa(type_id) +
+                    " as \"" + other->second + "\" of another file.  "
+                    "Please assign one of them a type id with the "
+                    "(us.type_id) option or the type_ids generator parameter.");
+      return false;
+    }
+
+    type_ids[type_id] = descriptor;
+  }
+
+  if (options_.cpp_structs) {
+    CppStructGenerator struct_generator(file_, options_);
+
+    if (!struct_generator.Validate(error)) {
+      return false;
+    }
+  }
+
+  // Quantized floats are sent as uint32 varints.  UnrealScript ints are
+  // signed and floats only hold 24 bits of mantissa, so the number of
+  // steps is limited to 2^24.
+  for (int i = 0; i < messages_.size(); i++) {
+    for (int j = 0; j < messages_[i]->field_count(); j++) {
+      const FieldDescriptor* field = messages_[i]->field(j);
+      double min, max, precision;
+      if (!GetQuantization(field, &min, &max, &precision)) continue;
+
+      string problem;
+      if (field->type() != FieldDescriptor::TYPE_UINT32) {
+        problem = "must be declared uint32";
+      } else if (IsPacked(field)) {
+        problem = "can't be packed";
+      } else if (!(precision > 0)) {
+        problem = "needs a positive (us.quantize_precision)";
+      } else if (!(max > min)) {
+        problem = "needs a (us.quantize_max) above (us.quantize_min)";
+      } else if ((max - min) / precision > (1 << 24)) {
+        problem = "has more than 2^24 steps between (us.quantize_min) and "
+                  "(us.quantize_max)";
+      }
+
+      if (!problem.empty()) {
+        error->assign(file_->name());
+        error->append(": Quantized field \"" + field->full_name() + "\" " +
+                      problem + ".");
+        return false;
+      }
+    }
+  }
+
   return true;
 }
 
-template<typename GeneratorClass, typename DescriptorClass>
-static void GenerateSibling(const string& package_dir,
-                            const string& java_package,
-                            const DescriptorClass* descriptor,
-                            GeneratorContext* context,
-                            vector<string>* file_list,
-                            const string& name_suffix,
-                            void (GeneratorClass::*pfn)(io::Printer* printer)) {
-  string filename = package_dir + "Message" + descriptor->name() + name_suffix + ".uc";
+void FileGenerator::AddTypeIds(map<int, string>* type_ids) {
+  for (int i = 0; i < messages_.size(); i++) {
+    type_ids->insert(make_pair(MessageTypeId(messages_[i], options_),
+                               messages_[i]->full_name()));
+  }
+}
 
-  file_list->push_back(filename);
+namespace {
 
-  scoped_ptr<io::ZeroCopyOutputStream> output(context->Open(filename));
+// Text of a generated file, rendered in memory so that the classes can be
+// generated in parallel and compared with the previous run.
+struct OutputFile {
+  string name;
+  string contents;
+};
 
-  io::Printer printer(output.get(), '$');
+// Renders the output of a generator function into *contents.
+template<typename GeneratorClass>
+void Render(GeneratorClass* generator,
+            void (GeneratorClass::*pfn)(io::Printer* printer),
+            string* contents) {
+  io::StringOutputStream output(contents);
+  io::Printer printer(&output, '$');
+  (generator->*pfn)(&printer);
+}
 
-  printer.Print(
+template<typename GeneratorClass, typename DescriptorClass>
+void GenerateSibling(const DescriptorClass* descriptor,
+                     const GeneratorOptions& options,
+                     string* contents,
+                     void (GeneratorClass::*pfn)(io::Printer* printer)) {
+  contents->assign(
     "// Generated by the protocol buffer compiler.  DO NOT EDIT!\n"
     "\n");
 
-  GeneratorClass generator(descriptor);
-  (generator.*pfn)(&printer);
+  string text;
+  GeneratorClass generator(descriptor, options);
+  Render(&generator, pfn, &text);
+  contents->append(text);
+}
+
+// The classes of a file, shared by the threads generating them.  Each
+// thread takes the next class until none is left.
+struct ClassJobs {
+  const vector<const Descriptor*>* messages;
+  const vector<const EnumDescriptor*>* enums;
+  const GeneratorOptions* options;
+
+  // One file per message, followed by one per enum.
+  vector<OutputFile>* files;
+  std::atomic<int> next;
+};
+
+void GenerateClasses(ClassJobs* jobs) {
+  int message_count = jobs->messages->size();
+  int count = jobs->files->size();
+
+  for (int i = jobs->next++; i < count; i = jobs->next++) {
+    string* contents = &(*jobs->files)[i].contents;
+
+    if (i < message_count) {
+      GenerateSibling<MessageGenerator>((*jobs->messages)[i], *jobs->options,
+                                        contents, &MessageGenerator::Generate);
+    } else {
+      GenerateSibling<EnumGenerator>((*jobs->enums)[i - message_count],
+                                     *jobs->options, contents,
+                                     &EnumGenerator::Generate);
+    }
+  }
+}
+
+// 64 bit FNV-1a hash of the contents, as recorded in the manifest.
+string ContentHash(const string& contents) {
+  uint64 hash = GOOGLE_ULONGLONG(14695981039346656037);
+  for (int i = 0; i < contents.size(); i++) {
+    hash ^= static_cast<uint8>(contents[i]);
+    hash *= GOOGLE_ULONGLONG(1099511628211);
+  }
+
+  char buffer[kFastToBufferSize];
+  return FastHex64ToBuffer(hash, buffer);
+}
+
+// Reads a manifest written by an earlier run, mapping file names to the
+// hashes of their contents.  A missing manifest reads as an empty one.
+void ReadManifest(const string& path, map<string, string>* hashes) {
+  ifstream input(path.c_str());
+  string hash, name;
+
+  while (input >> hash >> name) {
+    (*hashes)[name] = hash;
+  }
+}
+
+bool FileExists(const string& path) {
+  ifstream input(path.c_str());
+  return input.good();
+}
+
+void WriteFile(GeneratorContext* context, const string& name,
+               const string& contents) {
+  scoped_ptr<io::ZeroCopyOutputStream> output(context->Open(name));
+  io::Printer printer(output.get(), '$');
+  printer.PrintRaw(contents);
 }
 
+}  // namespace
+
 void FileGenerator::Generate(const string& package_dir,
                                      GeneratorContext* context,
                                      vector<string>* file_list) {
-  for (int i = 0; i < file_->message_type_count(); i++) {
-    GenerateSibling<MessageGenerator>(package_dir, java_package_,
-                                      file_->message_type(i),
-                                      context, file_list, "",
-                                      &MessageGenerator::Generate);
+  vector<OutputFile> files(messages_.size() + enums_.size());
+
+  for (int i = 0; i < messages_.size(); i++) {
+    files[i].name = package_dir + UnrealScriptClassName(messages_[i]) + ".uc";
+  }
+  for (int i = 0; i < enums_.size(); i++) {
+    files[messages_.size() + i].name =
+      package_dir + UnrealScriptClassName(enums_[i]) + ".uc";
+  }
+
+  // Every class is generated on its own, so schemas with hundreds of
+  // messages are spread over the available processors.
+  ClassJobs jobs;
+  jobs.messages = &messages_;
+  jobs.enums = &enums_;
+  jobs.options = &options_;
+  jobs.files = &files;
+  jobs.next = 0;
+
+  int thread_count = options_.jobs;
+  if (thread_count == 0) {
+    thread_count = max(1u, std::thread::hardware_concurrency());
+  }
+  thread_count = min<int>(thread_count, files.size());
+
+  vector<std::thread> threads;
+  for (int i = 1; i < thread_count; i++) {
+    threads.push_back(std::thread(GenerateClasses, &jobs));
+  }
+  GenerateClasses(&jobs);
+  for (int i = 0; i < threads.size(); i++) {
+    threads[i].join();
+  }
+
+  files.push_back(OutputFile());
+  files.back().name = package_dir + RegistryClassName(file_) + ".uc";
+  files.back().contents =
+    "// Generated by the protocol buffer compiler.  DO NOT EDIT!\n"
+    "\n";
+  {
+    string text;
+    Render(this, &FileGenerator::GenerateRegistry, &text);
+    files.back().contents.append(text);
+  }
+
+  if (options_.cpp_registry) {
+    files.push_back(OutputFile());
+    files.back().name = package_dir + CppRegistryFileName(file_);
+    Render(this, &FileGenerator::GenerateCppRegistry, &files.back().contents);
+  }
+
+  if (options_.delta) {
+    CppDeltaGenerator delta_generator(file_, options_);
+
+    files.push_back(OutputFile());
+    files.back().name = package_dir + delta_generator.filename();
+    Render(&delta_generator, &CppDeltaGenerator::Generate,
+           &files.back().contents);
+  }
+
+  if (options_.cpp_structs) {
+    CppStructGenerator struct_generator(file_, options_);
+
+    files.push_back(OutputFile());
+    files.back().name = package_dir + CppStructGenerator::FileName(file_);
+    Render(&struct_generator, &CppStructGenerator::Generate,
+           &files.back().contents);
+  }
+
+  // In incremental mode, files whose contents match the manifest of the
+  // previous run are not handed to protoc at all, so it leaves them and
+  // their timestamps alone and the script compiler doesn't rebuild them.
+  bool incremental = !options_.incremental_dir.empty();
+  string manifest_name = package_dir + StripProto(file_->name()) +
+                         ".us_manifest";
+  map<string, string> previous_hashes;
+
+  if (incremental) {
+    ReadManifest(options_.incremental_dir + "/" + manifest_name,
+                 &previous_hashes);
+  }
+
+  string manifest;
+
+  for (int i = 0; i < files.size(); i++) {
+    const OutputFile& file = files[i];
+    string hash = ContentHash(file.contents);
+
+    file_list->push_back(file.name);
+    manifest += hash + " " + file.name + "\n";
+
+    map<string, string>::const_iterator previous =
+      previous_hashes.find(file.name);
+    if (previous != previous_hashes.end() && previous->second == hash &&
+        FileExists(options_.incremental_dir + "/" + file.name)) {
+      continue;
+    }
+
+    WriteFile(context, file.name, file.contents);
+  }
+
+  if (incremental) {
+    WriteFile(context, manifest_name, manifest);
+  }
+}
+
+void FileGenerator::GenerateRegistry(io::Printer* printer) {
+  printer->Print("class $classname$ extends MessageRegistry;\n\n",
+    "classname", RegistryClassName(file_));
+
+  printer->Print("static function class<Message> GetMessageClass(int typeId)\n{\n");
+  printer->Indent();
+  printer->Indent();
+  printer->Print("switch (typeId)\n{\n");
+  printer->Indent();
+  printer->Indent();
+
+  for (int i = 0; i < messages_.size(); i++) {
+    const Descriptor* descriptor = messages_[i];
+
+    printer->Print("case $typeid$:\n",
+      "typeid", SimpleItoa(MessageTypeId(descriptor, options_)));
+    printer->Indent();
+    printer->Indent();
+    printer->Print("return class'$classname$';\n",
+      "classname", UnrealScriptClassName(descriptor));
+    printer->Outdent();
+    printer->Outdent();
   }
+
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("}\n\nreturn none;\n");
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("}\n");
 }
 
+void FileGenerator::GenerateCppRegistry(io::Printer* printer) {
+  string guard = "US_REGISTRY_" + FilenameIdentifier(file_->name()) +
+                 "__INCLUDED";
+
+  printer->Print(
+    "// Generated by the protocol buffer compiler.  DO NOT EDIT!\n"
+    "// source: $filename$\n"
+    "\n"
+    "#ifndef $guard$\n"
+    "#define $guard$\n"
+    "\n"
+    "#include <google/protobuf/us/us_type_registry.h>\n"
+    "#include \"$basename$.pb.h\"\n"
+    "\n",
+    "filename", file_->name(),
+    "guard", guard,
+    "basename", StripProto(file_->name()));
+
+  vector<string> package_parts;
+  SplitPackage(file_, &package_parts);
+
+  for (int i = 0; i < package_parts.size(); i++) {
+    printer->Print("namespace $part$ {\n", "part", package_parts[i]);
+  }
+
+  printer->Print("\n// Type ids sent in the frame headers.\n");
+
+  for (int i = 0; i < messages_.size(); i++) {
+    const Descriptor* descriptor = messages_[i];
+
+    printer->Print("const ::google::protobuf::uint32 k$name$TypeId = $typeid$;\n",
+      "name", CppClassName(descriptor),
+      "typeid", SimpleItoa(MessageTypeId(descriptor, options_)));
+  }
+
+  printer->Print(
+    "\n"
+    "inline void Register$classname$Types(\n"
+    "    ::google::protobuf::us::TypeRegistry* registry) {\n",
+    "classname", classname_);
+  printer->Indent();
+
+  for (int i = 0; i < messages_.size(); i++) {
+    const Descriptor* descriptor = messages_[i];
+
+    printer->Print(
+      "registry->Register(k$name$TypeId, &$classname$::default_instance());\n",
+      "name", CppClassName(descriptor),
+      "classname", CppClassName(descriptor));
+  }
+
+  printer->Outdent();
+  printer->Print("}\n\n");
+
+  for (int i = package_parts.size() - 1; i >= 0; i--) {
+    printer->Print("}  // namespace $part$\n", "part", package_parts[i]);
+  }
+
+  printer->Print(
+    "\n"
+    "#endif  // $guard$\n",
+    "guard", guard);
+}
 
 bool FileGenerator::ShouldIncludeDependency(const FileDescriptor* descriptor) {
   return true;
@@ -35,13 +35,17 @@
 #ifndef GOOGLE_PROTOBUF_COMPILER_US_FILE_H__
 #define GOOGLE_PROTOBUF_COMPILER_US_FILE_H__
 
+#include <map>
 #include <string>
 #include <vector>
 #include <google/protobuf/stubs/common.h>
+#include <google/protobuf/compiler/us/us_generator_options.h>
 
 namespace google {
 namespace protobuf {
   class FileDescriptor;        // descriptor.h
+  class Descriptor;            // descriptor.h
+  class EnumDescriptor;        // descriptor.h
   namespace io {
     class Printer;             // printer.h
   }
@@ -56,13 +60,18 @@ namespace us {
 
 class FileGenerator {
  public:
-  explicit FileGenerator(const FileDescriptor* file);
+  FileGenerator(const FileDescriptor* file, const GeneratorOptions& options);
   ~FileGenerator();
 
   // Checks for problems that would otherwise lead to cryptic compile errors.
   // Returns true if there are no problems, or writes an error description to
-  // the given string and returns false otherwise.
-  bool Validate(string* error);
+  // the given string and returns false otherwise.  used_type_ids holds the
+  // full names of the messages generated earlier in the same run, by type
+  // id; the file's type ids must differ from those.
+  bool Validate(const map<int, string>& used_type_ids, string* error);
+
+  // Adds the full names of the file's messages to type_ids, by type id.
+  void AddTypeIds(map<int, string>* type_ids);
 
   // If we aren't putting everything into one file, this will write all the
   // files other than the outer file (i.e. one for each message, enum, and
@@ -71,6 +80,14 @@ class FileGenerator {
                         GeneratorContext* generator_context,
                         vector<string>* file_list);
 
+  // Generates the registry class mapping type ids to the message classes
+  // of the file.
+  void GenerateRegistry(io::Printer* printer);
+
+  // Generates a C++ header with the type ids of the file's messages and a
+  // function registering them with a cpp-lib TypeRegistry.
+  void GenerateCppRegistry(io::Printer* printer);
+
   const string& java_package() { return java_package_; }
   const string& classname()    { return classname_;    }
 
@@ -82,9 +99,15 @@ class FileGenerator {
   bool ShouldIncludeDependency(const FileDescriptor* descriptor);
 
   const FileDescriptor* file_;
+  const GeneratorOptions& options_;
   string java_package_;
   string classname_;
 
+  // Every message and enum of the file, nested ones included.  Each gets
+  // its own class.
+  vector<const Descriptor*> messages_;
+  vector<const EnumDescriptor*> enums_;
+
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(FileGenerator);
 };
 
@@ -32,6 +32,9 @@
 //  Based on original Protocol Buffers design by
 //  Sanjay Ghemawat, Jeff Dean, and others.
 
+#include <fstream>
+#include <sstream>
+
 #include <google/protobuf/compiler/us/us_generator.h>
 #include <google/protobuf/compiler/us/us_file.h>
 #include <google/protobuf/compiler/us/us_helpers.h>
@@ -45,6 +48,46 @@ namespace protobuf {
 namespace compiler {
 namespace us {
 
+namespace {
+
+// Reads a file of "<name> <value>" lines into the given map.  Blank lines
+// and lines starting with '#' are ignored.
+bool LoadNameValueFile(const string& filename, map<string, int>* values,
+                       string* error) {
+  ifstream input(filename.c_str());
+
+  if (!input) {
+    *error = filename + ": Unable to open file.";
+    return false;
+  }
+
+  string line;
+  int line_number = 0;
+
+  while (getline(input, line)) {
+    line_number++;
+
+    istringstream fields(line);
+    string name;
+    int value;
+
+    if (!(fields >> name) || name[0] == '#') {
+      continue;
+    }
+
+    if (!(fields >> value)) {
+      *error = filename + ":" + SimpleItoa(line_number) +
+               ": Expected a name followed by an integer.";
+      return false;
+    }
+
+    (*values)[name] = value;
+  }
+
+  return true;
+}
+
+}  // namespace
 
 UnrealScriptGenerator::UnrealScriptGenerator() {}
 UnrealScriptGenerator::~UnrealScriptGenerator() {}
@@ -54,6 +97,7 @@ bool UnrealScriptGenerator::Generate(const FileDescriptor* file,
                              GeneratorContext* context,
                              string* error) const {
   string output_list_file;
+  GeneratorOptions generator_options;
 
   vector<pair<string, string> > options;
 
@@ -62,18 +106,50 @@ bool UnrealScriptGenerator::Generate(const FileDescriptor* file,
   for (int i = 0; i < options.size(); i++) {
     if (options[i].first == "output_list_file") {
       output_list_file = options[i].second;
+    } else if (options[i].first == "profile") {
+      if (!LoadNameValueFile(options[i].second,
+                             &generator_options.field_frequency, error)) {
+        return false;
+      }
+    } else if (options[i].first == "type_ids") {
+      if (!LoadNameValueFile(options[i].second,
+                             &generator_options.type_ids, error)) {
+        return false;
+      }
+    } else if (options[i].first == "cpp_registry") {
+      generator_options.cpp_registry = true;
+    } else if (options[i].first == "delta") {
+      generator_options.delta = true;
+    } else if (options[i].first == "debug_log") {
+      generator_options.debug_log = true;
+    } else if (options[i].first == "cpp_structs") {
+      generator_options.cpp_structs = true;
+    } else if (options[i].first == "jobs") {
+      istringstream value(options[i].second);
+      if (!(value >> generator_options.jobs) || generator_options.jobs < 1) {
+        *error = "The jobs option takes a positive number of threads.";
+        return false;
+      }
+    } else if (options[i].first == "incremental") {
+      if (options[i].second.empty()) {
+        *error = "The incremental option takes the output directory.";
+        return false;
+      }
+      generator_options.incremental_dir = options[i].second;
     } else {
       *error = "Unknown generator option: " + options[i].first;
       return false;
     }
   }
 
-  FileGenerator file_generator(file);
+  FileGenerator file_generator(file, generator_options);
 
-  if (!file_generator.Validate(error)) {
+  if (!file_generator.Validate(type_ids_, error)) {
     return false;
   }
 
+  file_generator.AddTypeIds(&type_ids_);
+
   vector<string> all_files;
 
   // Generate sibling files.
@@ -37,6 +37,7 @@
 #ifndef GOOGLE_PROTOBUF_COMPILER_US_GENERATOR_H__
 #define GOOGLE_PROTOBUF_COMPILER_US_GENERATOR_H__
 
+#include <map>
 #include <string>
 #include <google/protobuf/compiler/code_generator.h>
 
@@ -61,6 +62,11 @@ class LIBPROTOC_EXPORT UnrealScriptGenerator : public CodeGenerator {
                 string* error) const;
 
  private:
+  // Full names of the messages generated so far, by type id.  protoc runs
+  // the same generator for every file of a run, so this catches type ids
+  // colliding across files.
+  mutable map<int, string> type_ids_;
+
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(UnrealScriptGenerator);
 };
 
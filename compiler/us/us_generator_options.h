@@ -0,0 +1,95 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef GOOGLE_PROTOBUF_COMPILER_US_GENERATOR_OPTIONS_H__
+#define GOOGLE_PROTOBUF_COMPILER_US_GENERATOR_OPTIONS_H__
+
+#include <map>
+#include <string>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace us {
+
+// Options controlling the generated code.  UnrealScriptGenerator parses
+// these from the --us_out parameter and hands them down to the file and
+// message generators.
+struct GeneratorOptions {
+  GeneratorOptions()
+    : cpp_registry(false), delta(false), debug_log(false),
+      cpp_structs(false), jobs(0) {}
+
+  // Expected decode frequency of fields, keyed by full field name.  Loaded
+  // from the file named by the "profile" parameter.  Takes precedence over
+  // the (us.frequency) field option.
+  map<string, int> field_frequency;
+
+  // Message type ids, keyed by full message name.  Loaded from the file
+  // named by the "type_ids" parameter.  Takes precedence over the
+  // (us.type_id) message option.
+  map<string, int> type_ids;
+
+  // Whether to also generate a C++ header registering the messages with
+  // the host-side runtime in cpp-lib.  Set by the "cpp_registry" parameter.
+  bool cpp_registry;
+
+  // Whether to generate delta encoding against a baseline message, for
+  // UnrealScript and in a C++ header for the host side.  Set by the
+  // "delta" parameter.
+  bool delta;
+
+  // Whether to log every field read by the generated decoders through the
+  // `PBLog macro, which only logs when PROTOBUF_DEBUG is defined.  Set by
+  // the "debug_log" parameter.
+  bool debug_log;
+
+  // Whether to also generate a C++ header with plain structs mirroring the
+  // UnrealScript classes and their codecs, for servers that don't need the
+  // classes of the C++ generator.  Set by the "cpp_structs" parameter.
+  bool cpp_structs;
+
+  // Number of threads generating the classes of a file, 0 for one per
+  // processor.  Set by the "jobs" parameter.
+  int jobs;
+
+  // Directory the output goes to, the same as given to --us_out.  If set,
+  // a manifest of the generated files is kept there and files that haven't
+  // changed since the previous run are not rewritten.  Set by the
+  // "incremental" parameter.
+  string incremental_dir;
+};
+
+}  // namespace us
+}  // namespace compiler
+}  // namespace protobuf
+
+}  // namespace google
+#endif  // GOOGLE_PROTOBUF_COMPILER_US_GENERATOR_OPTIONS_H__
@@ -33,10 +33,13 @@
 //  Sanjay Ghemawat, Jeff Dean, and others.
 
 #include <limits>
+#include <stdio.h>
+#include <string.h>
 #include <vector>
 
 #include <google/protobuf/compiler/us/us_helpers.h>
 #include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/unknown_field_set.h>
 #include <google/protobuf/stubs/strutil.h>
 #include <google/protobuf/stubs/substitute.h>
 
@@ -184,6 +187,87 @@ string ClassName(const FileDescriptor* descriptor) {
   return result;
 }
 
+string FlatTypeName(const string& full_name, const FileDescriptor* file) {
+  string name = full_name;
+  if (!file->package().empty()) {
+    name = name.substr(file->package().size() + 1);
+  }
+  return StringReplace(name, ".", "_", true);
+}
+
+string UnrealScriptClassName(const Descriptor* descriptor) {
+  return "Message" + FlatTypeName(descriptor->full_name(), descriptor->file());
+}
+
+string UnrealScriptClassName(const EnumDescriptor* descriptor) {
+  return "Enum" + FlatTypeName(descriptor->full_name(), descriptor->file());
+}
+
+namespace {
+
+void ListNestedTypes(const Descriptor* descriptor,
+                     vector<const Descriptor*>* messages,
+                     vector<const EnumDescriptor*>* enums) {
+  if (messages != NULL) messages->push_back(descriptor);
+
+  for (int i = 0; enums != NULL && i < descriptor->enum_type_count(); i++) {
+    enums->push_back(descriptor->enum_type(i));
+  }
+  for (int i = 0; i < descriptor->nested_type_count(); i++) {
+    ListNestedTypes(descriptor->nested_type(i), messages, enums);
+  }
+}
+
+}  // namespace
+
+void ListMessages(const FileDescriptor* file,
+                  vector<const Descriptor*>* messages) {
+  for (int i = 0; i < file->message_type_count(); i++) {
+    ListNestedTypes(file->message_type(i), messages, NULL);
+  }
+}
+
+void ListEnums(const FileDescriptor* file,
+               vector<const EnumDescriptor*>* enums) {
+  for (int i = 0; i < file->enum_type_count(); i++) {
+    enums->push_back(file->enum_type(i));
+  }
+  for (int i = 0; i < file->message_type_count(); i++) {
+    ListNestedTypes(file->message_type(i), NULL, enums);
+  }
+}
+
+string RegistryClassName(const FileDescriptor* file) {
+  return FileClassName(file) + "Registry";
+}
+
+int MessageTypeId(const Descriptor* descriptor,
+                  const GeneratorOptions& options) {
+  map<string, int>::const_iterator iter =
+    options.type_ids.find(descriptor->full_name());
+  if (iter != options.type_ids.end()) {
+    return iter->second;
+  }
+
+  uint64 type_id;
+  if (GetCustomOption(descriptor->options(), kTypeIdOptionNumber, &type_id)) {
+    return static_cast<int>(type_id);
+  }
+
+  // FNV-1a of the full name, folded down to 21 bits so the id takes at
+  // most three bytes as a varint.  Collisions are reported by
+  // FileGenerator::Validate().
+  const string& name = descriptor->full_name();
+  uint32 hash = 2166136261u;
+  for (int i = 0; i < name.size(); i++) {
+    hash ^= static_cast<uint8>(name[i]);
+    hash *= 16777619u;
+  }
+  hash = (hash >> 21) ^ (hash & 0x1FFFFF);
+
+  return hash == 0 ? 1 : static_cast<int>(hash);
+}
+
 string FieldConstantName(const FieldDescriptor *field) {
   string name = field->name() + "_FIELD_NUMBER";
   UpperString(&name);
@@ -204,18 +288,59 @@ string ToUpperCase(string str) {
 
 string SafeFieldname(string str)
 {
-	if( str.compare("name") == 0 ) 
-		str = "_name";
+	// UnrealScript keywords, the variables Object and Message already
+	// declare, and the parameters and locals of the generated functions.
+	// Identifiers are case-insensitive.
+	static const char* const kReserved[] = {
+		"abstract", "array", "arraycount", "assert", "auto", "automated",
+		"bool", "break", "byte", "case", "class", "coerce",
+		"collapsecategories", "config", "const", "continue", "default",
+		"defaultproperties", "delegate", "dependson", "deprecated", "do",
+		"dontcollapsecategories", "editconst", "editinline", "editinlinenew",
+		"else", "enum", "enumcount", "event", "exec", "expands", "export",
+		"extends", "false", "final", "float", "for", "foreach", "function",
+		"global", "globalconfig", "goto", "hidecategories", "if", "ignores",
+		"implements", "import", "instanced", "int", "interface", "intrinsic",
+		"iterator", "latent", "local", "localized", "name", "native",
+		"nativereplication", "new", "noexport", "none", "noteditinlinenew",
+		"notplaceable", "operator", "optional", "out", "perobjectconfig",
+		"placeable", "postoperator", "preoperator", "private", "protected",
+		"public", "reliable", "replication", "return", "self",
+		"showcategories", "simulated", "singular", "state", "static",
+		"string", "struct", "super", "switch", "transient", "true",
+		"unreliable", "until", "var", "while", "within",
+
+		"outer", "id", "typeid", "cachedsize",
+
+		"stream", "pool", "other", "baseline", "value", "fieldnumber",
+		"idx", "count", "limit", "length", "tag",
+	};
+
+	string lower = str;
+	LowerString(&lower);
+
+	for (int i = 0; i < sizeof(kReserved) / sizeof(kReserved[0]); i++)
+		if (lower == kReserved[i])
+			return "_" + str;
 	return str;
 }
 
 UnrealScriptType GetUnrealScriptType(const FieldDescriptor* field) {
+  double min, max, precision;
+  if (GetQuantization(field, &min, &max, &precision)) {
+    return UNREALSCRIPT_TYPE_FLOAT;
+  }
+
   switch (GetType(field)) {
+    case FieldDescriptor::TYPE_FLOAT:
+      return UNREALSCRIPT_TYPE_FLOAT;
+
     case FieldDescriptor::TYPE_INT32:
     case FieldDescriptor::TYPE_UINT32:
     case FieldDescriptor::TYPE_SINT32:
     case FieldDescriptor::TYPE_FIXED32:
     case FieldDescriptor::TYPE_SFIXED32:
+    case FieldDescriptor::TYPE_ENUM:
       return UNREALSCRIPT_TYPE_INT;
 
     case FieldDescriptor::TYPE_STRING:
@@ -229,6 +354,13 @@ UnrealScriptType GetUnrealScriptType(const FieldDescriptor* field) {
 
     case FieldDescriptor::TYPE_BYTES:
       return UNREALSCRIPT_TYPE_BYTES;
+
+    case FieldDescriptor::TYPE_INT64:
+    case FieldDescriptor::TYPE_UINT64:
+    case FieldDescriptor::TYPE_SINT64:
+    case FieldDescriptor::TYPE_FIXED64:
+    case FieldDescriptor::TYPE_SFIXED64:
+      return UNREALSCRIPT_TYPE_INT64;
   }
 
   GOOGLE_LOG(FATAL) << "Unsupported UnrealScript Type!" << GetTypeLabel(field);
@@ -267,7 +399,14 @@ const char* GetDeserializeMethodName(const FieldDescriptor* field)
 {
 	switch (GetType(field))
 	{
+	    case FieldDescriptor::TYPE_FLOAT: return "ReadFloat";
 	    case FieldDescriptor::TYPE_INT32: return "ReadInt32";
+	    case FieldDescriptor::TYPE_ENUM: return "ReadInt32";
+	    case FieldDescriptor::TYPE_INT64: return "ReadInt64";
+	    case FieldDescriptor::TYPE_UINT64: return "ReadUInt64";
+	    case FieldDescriptor::TYPE_SINT64: return "ReadSInt64";
+	    case FieldDescriptor::TYPE_FIXED64: return "ReadFixed64";
+	    case FieldDescriptor::TYPE_SFIXED64: return "ReadSFixed64";
 	    case FieldDescriptor::TYPE_UINT32: return "ReadUInt32";
 	    case FieldDescriptor::TYPE_SINT32: return "ReadSInt32";
 	    case FieldDescriptor::TYPE_FIXED32: return "ReadFixed32";
@@ -286,7 +425,14 @@ const char* GetDeserializeMethodName(const FieldDescriptor* field)
 
 const char* GetSerializeMethodName(const FieldDescriptor* field) {
   switch (GetType(field)) {
+    case FieldDescriptor::TYPE_FLOAT: return "WriteFloat";
     case FieldDescriptor::TYPE_INT32: return "WriteInt32";
+    case FieldDescriptor::TYPE_ENUM: return "WriteInt32";
+    case FieldDescriptor::TYPE_INT64: return "WriteInt64";
+    case FieldDescriptor::TYPE_UINT64: return "WriteUInt64";
+    case FieldDescriptor::TYPE_SINT64: return "WriteSInt64";
+    case FieldDescriptor::TYPE_FIXED64: return "WriteFixed64";
+    case FieldDescriptor::TYPE_SFIXED64: return "WriteSFixed64";
     case FieldDescriptor::TYPE_UINT32: return "WriteUInt32";
     case FieldDescriptor::TYPE_SINT32: return "WriteSInt32";
     case FieldDescriptor::TYPE_FIXED32: return "WriteFixed32";
@@ -305,7 +451,14 @@ const char* GetSerializeMethodName(const FieldDescriptor* field) {
 
 const char* GetComputeSizeMethodName(const FieldDescriptor* field) {
   switch (GetType(field)) {
+    case FieldDescriptor::TYPE_FLOAT: return "ComputeFloatSize";
     case FieldDescriptor::TYPE_INT32: return "ComputeInt32Size";
+    case FieldDescriptor::TYPE_ENUM: return "ComputeInt32Size";
+    case FieldDescriptor::TYPE_INT64: return "ComputeInt64Size";
+    case FieldDescriptor::TYPE_UINT64: return "ComputeUInt64Size";
+    case FieldDescriptor::TYPE_SINT64: return "ComputeSInt64Size";
+    case FieldDescriptor::TYPE_FIXED64: return "ComputeFixed64Size";
+    case FieldDescriptor::TYPE_SFIXED64: return "ComputeSFixed64Size";
     case FieldDescriptor::TYPE_UINT32: return "ComputeUInt32Size";
     case FieldDescriptor::TYPE_SINT32: return "ComputeSInt32Size";
     case FieldDescriptor::TYPE_FIXED32: return "ComputeFixed32Size";
@@ -330,6 +483,8 @@ const char* GetPrimitiveTypeName(UnrealScriptType type)
 		case UNREALSCRIPT_TYPE_BOOLEAN: return "bool";
 		case UNREALSCRIPT_TYPE_MESSAGE: return "NULL";
 		case UNREALSCRIPT_TYPE_BYTES: return "Array<byte>";
+		case UNREALSCRIPT_TYPE_INT64: return "Int64";
+		case UNREALSCRIPT_TYPE_FLOAT: return "float";
 			
 	}
 
@@ -337,6 +492,160 @@ const char* GetPrimitiveTypeName(UnrealScriptType type)
 	return "NULL";
 }
 
+bool IsPacked(const FieldDescriptor* field) {
+  return field->is_packable() && field->options().packed();
+}
+
+const char* GetPackedDeserializeMethodName(const FieldDescriptor* field) {
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_FLOAT: return "ReadPackedFloat";
+    case FieldDescriptor::TYPE_INT32: return "ReadPackedInt32";
+    case FieldDescriptor::TYPE_ENUM: return "ReadPackedInt32";
+    case FieldDescriptor::TYPE_INT64: return "ReadPackedInt64";
+    case FieldDescriptor::TYPE_UINT64: return "ReadPackedUInt64";
+    case FieldDescriptor::TYPE_SINT64: return "ReadPackedSInt64";
+    case FieldDescriptor::TYPE_FIXED64: return "ReadPackedFixed64";
+    case FieldDescriptor::TYPE_SFIXED64: return "ReadPackedSFixed64";
+    case FieldDescriptor::TYPE_UINT32: return "ReadPackedUInt32";
+    case FieldDescriptor::TYPE_SINT32: return "ReadPackedSInt32";
+    case FieldDescriptor::TYPE_FIXED32: return "ReadPackedFixed32";
+    case FieldDescriptor::TYPE_SFIXED32: return "ReadPackedSFixed32";
+    case FieldDescriptor::TYPE_BOOL: return "ReadPackedBool";
+  }
+
+  GOOGLE_LOG(FATAL) << "Unsupported Packed Deserialize Method Type!" << GetTypeLabel(field);
+
+  return "NULL";
+}
+
+const char* GetPackedSerializeMethodName(const FieldDescriptor* field) {
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_FLOAT: return "WritePackedFloat";
+    case FieldDescriptor::TYPE_INT32: return "WritePackedInt32";
+    case FieldDescriptor::TYPE_ENUM: return "WritePackedInt32";
+    case FieldDescriptor::TYPE_INT64: return "WritePackedInt64";
+    case FieldDescriptor::TYPE_UINT64: return "WritePackedUInt64";
+    case FieldDescriptor::TYPE_SINT64: return "WritePackedSInt64";
+    case FieldDescriptor::TYPE_FIXED64: return "WritePackedFixed64";
+    case FieldDescriptor::TYPE_SFIXED64: return "WritePackedSFixed64";
+    case FieldDescriptor::TYPE_UINT32: return "WritePackedUInt32";
+    case FieldDescriptor::TYPE_SINT32: return "WritePackedSInt32";
+    case FieldDescriptor::TYPE_FIXED32: return "WritePackedFixed32";
+    case FieldDescriptor::TYPE_SFIXED32: return "WritePackedSFixed32";
+    case FieldDescriptor::TYPE_BOOL: return "WritePackedBool";
+  }
+
+  GOOGLE_LOG(FATAL) << "Unsupported Packed Serialize Method Type!" << GetTypeLabel(field);
+
+  return "NULL";
+}
+
+const char* GetPackedComputeSizeMethodName(const FieldDescriptor* field) {
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_FLOAT: return "ComputePackedFloatSize";
+    case FieldDescriptor::TYPE_INT32: return "ComputePackedInt32Size";
+    case FieldDescriptor::TYPE_ENUM: return "ComputePackedInt32Size";
+    case FieldDescriptor::TYPE_INT64: return "ComputePackedInt64Size";
+    case FieldDescriptor::TYPE_UINT64: return "ComputePackedUInt64Size";
+    case FieldDescriptor::TYPE_SINT64: return "ComputePackedSInt64Size";
+    case FieldDescriptor::TYPE_FIXED64: return "ComputePackedFixed64Size";
+    case FieldDescriptor::TYPE_SFIXED64: return "ComputePackedSFixed64Size";
+    case FieldDescriptor::TYPE_UINT32: return "ComputePackedUInt32Size";
+    case FieldDescriptor::TYPE_SINT32: return "ComputePackedSInt32Size";
+    case FieldDescriptor::TYPE_FIXED32: return "ComputePackedFixed32Size";
+    case FieldDescriptor::TYPE_SFIXED32: return "ComputePackedSFixed32Size";
+    case FieldDescriptor::TYPE_BOOL: return "ComputePackedBoolSize";
+  }
+
+  GOOGLE_LOG(FATAL) << "Unsupported Packed Size Type!" << GetTypeLabel(field);
+
+  return "NULL";
+}
+
+string GetSerializeNoTagMethodName(const FieldDescriptor* field) {
+  return string(GetSerializeMethodName(field)) + "NoTag";
+}
+
+string GetComputeSizeNoTagMethodName(const FieldDescriptor* field) {
+  return string(GetComputeSizeMethodName(field)) + "NoTag";
+}
+
+bool GetCustomOption(const Message& options, int number, uint64* value) {
+  const UnknownFieldSet& unknown_fields =
+    options.GetReflection()->GetUnknownFields(options);
+
+  // Like a parsed extension, the last occurrence wins.
+  bool found = false;
+  for (int i = 0; i < unknown_fields.field_count(); i++) {
+    const UnknownField& field = unknown_fields.field(i);
+    if (field.number() != number) continue;
+
+    switch (field.type()) {
+      case UnknownField::TYPE_VARINT:
+        *value = field.varint();
+        found = true;
+        break;
+      case UnknownField::TYPE_FIXED32:
+        *value = field.fixed32();
+        found = true;
+        break;
+      case UnknownField::TYPE_FIXED64:
+        *value = field.fixed64();
+        found = true;
+        break;
+      default:
+        break;
+    }
+  }
+
+  return found;
+}
+
+namespace {
+
+// Double options are stored as the bits of the double.
+bool GetDoubleOption(const Message& options, int number, double* value) {
+  uint64 bits;
+  if (!GetCustomOption(options, number, &bits)) return false;
+
+  memcpy(value, &bits, sizeof(*value));
+  return true;
+}
+
+}  // namespace
+
+bool GetQuantization(const FieldDescriptor* field,
+                     double* min, double* max, double* precision) {
+  *min = *max = *precision = 0;
+
+  bool found = GetDoubleOption(field->options(), kQuantizeMinOptionNumber, min);
+  found |= GetDoubleOption(field->options(), kQuantizeMaxOptionNumber, max);
+  found |= GetDoubleOption(field->options(), kQuantizePrecisionOptionNumber,
+                           precision);
+  return found;
+}
+
+string FloatLiteral(double value) {
+  string text = SimpleDtoa(value);
+  if (text.find_first_of("eE") != string::npos) {
+    char buffer[400];
+    snprintf(buffer, sizeof(buffer), "%.40f", value);
+    text = buffer;
+    text.erase(text.find_last_not_of('0') + 1);
+  }
+  if (text.find('.') == string::npos) {
+    text += ".0";
+  } else if (text[text.size() - 1] == '.') {
+    text += "0";
+  }
+  return text;
+}
+
+bool IsQuantized(const FieldDescriptor* field) {
+  double min, max, precision;
+  return GetQuantization(field, &min, &max, &precision);
+}
+
 bool AllAscii(const string& text) {
   for (int i = 0; i < text.size(); i++) {
     if ((text[i] & 0x80) != 0) {
@@ -455,6 +764,65 @@ bool IsDefaultValueJavaDefault(const FieldDescriptor* field) {
   return false;
 }
 
+int DeltaMaskWords(const Descriptor* descriptor) {
+  return (descriptor->field_count() + 31) / 32;
+}
+
+uint32 FullDeltaMask(const Descriptor* descriptor, int word) {
+  int bits = min(descriptor->field_count() - word * 32, 32);
+  return bits == 32 ? 0xFFFFFFFFu : (1u << bits) - 1;
+}
+
+string FilenameIdentifier(const string& filename) {
+  string result;
+  for (int i = 0; i < filename.size(); i++) {
+    if (ascii_isalnum(filename[i])) {
+      result.push_back(filename[i]);
+    } else {
+      result.push_back('_');
+      char buffer[kFastToBufferSize];
+      result.append(FastHexToBuffer(static_cast<uint8>(filename[i]), buffer));
+    }
+  }
+  return result;
+}
+
+string CppClassName(const Descriptor* descriptor) {
+  return FlatTypeName(descriptor->full_name(), descriptor->file());
+}
+
+string CppClassName(const EnumDescriptor* descriptor) {
+  return FlatTypeName(descriptor->full_name(), descriptor->file());
+}
+
+string CppFieldName(const FieldDescriptor* field) {
+  static const char* const kKeywords[] = {
+    "and", "auto", "bool", "break", "case", "catch", "char", "class",
+    "const", "continue", "default", "delete", "do", "double", "else",
+    "enum", "explicit", "extern", "false", "float", "for", "friend",
+    "goto", "if", "inline", "int", "long", "mutable", "namespace", "new",
+    "not", "operator", "or", "private", "protected", "public", "register",
+    "return", "short", "signed", "sizeof", "static", "struct", "switch",
+    "template", "this", "throw", "true", "try", "typedef", "typename",
+    "union", "unsigned", "using", "virtual", "void", "volatile", "while",
+  };
+
+  string name = field->name();
+  LowerString(&name);
+
+  for (int i = 0; i < sizeof(kKeywords) / sizeof(kKeywords[0]); i++) {
+    if (name == kKeywords[i]) {
+      name.push_back('_');
+      break;
+    }
+  }
+  return name;
+}
+
+void SplitPackage(const FileDescriptor* file, vector<string>* parts) {
+  SplitStringUsing(file->package(), ".", parts);
+}
+
 }  // namespace us
 }  // namespace compiler
 }  // namespace protobuf
@@ -40,8 +40,10 @@
 #endif
 
 #include <string>
+#include <vector>
 #include <google/protobuf/descriptor.pb.h>
 #include <google/protobuf/descriptor.h>
+#include <google/protobuf/compiler/us/us_generator_options.h>
 
 namespace google {
 namespace protobuf {
@@ -96,6 +98,38 @@ inline string ExtensionIdentifierName(const FieldDescriptor* descriptor) {
 }
 string ClassName(const FileDescriptor* descriptor);
 
+// Full name of the type without the package, with nested names joined by
+// underscores, e.g. "Outer_Inner" for the type Inner declared in Outer.
+// This is also how the C++ generator names nested types.
+string FlatTypeName(const string& full_name, const FileDescriptor* file);
+
+// Name of the UnrealScript class generated for the message.  Nested
+// messages are flattened, see FlatTypeName().
+string UnrealScriptClassName(const Descriptor* descriptor);
+
+// Name of the UnrealScript class holding the values of the enum as
+// constants.
+string UnrealScriptClassName(const EnumDescriptor* descriptor);
+
+// Appends the messages of the file, nested ones included, in declaration
+// order with every message before the messages nested in it.
+void ListMessages(const FileDescriptor* file,
+                  vector<const Descriptor*>* messages);
+
+// Same as ListMessages() for the enums of the file.
+void ListEnums(const FileDescriptor* file,
+               vector<const EnumDescriptor*>* enums);
+
+// Name of the UnrealScript class mapping type ids to the message classes
+// of the file.
+string RegistryClassName(const FileDescriptor* file);
+
+// Returns the id identifying the message type in frame headers: the
+// type_ids= file entry if any, else the (us.type_id) option, else a hash of
+// the full name that fits in a three byte varint.
+int MessageTypeId(const Descriptor* descriptor,
+                  const GeneratorOptions& options);
+
 // Get the unqualified name that should be used for a field's field
 // number constant.
 string FieldConstantName(const FieldDescriptor *field);
@@ -110,7 +144,9 @@ enum UnrealScriptType {
   UNREALSCRIPT_TYPE_STRING,
   UNREALSCRIPT_TYPE_BOOLEAN,
   UNREALSCRIPT_TYPE_MESSAGE,
-  UNREALSCRIPT_TYPE_BYTES
+  UNREALSCRIPT_TYPE_BYTES,
+  UNREALSCRIPT_TYPE_INT64,   // The Int64 struct declared in Message.uc.
+  UNREALSCRIPT_TYPE_FLOAT
 };
 
 UnrealScriptType GetUnrealScriptType(const FieldDescriptor* field);
@@ -121,9 +157,80 @@ const char* GetSerializeMethodName(const FieldDescriptor* field);
 const char* GetComputeSizeMethodName(const FieldDescriptor* field);
 const char* GetPrimitiveTypeName(UnrealScriptType type);
 
+// Is the field a repeated scalar declared with [packed=true]?  Packable
+// fields are read in either encoding regardless of the option.
+bool IsPacked(const FieldDescriptor* field);
+const char* GetPackedDeserializeMethodName(const FieldDescriptor* field);
+const char* GetPackedSerializeMethodName(const FieldDescriptor* field);
+const char* GetPackedComputeSizeMethodName(const FieldDescriptor* field);
+
+// Name of the CodedOutputStream method writing a value of the field without
+// its tag, e.g. "WriteInt32NoTag".  Not valid for message fields.
+string GetSerializeNoTagMethodName(const FieldDescriptor* field);
+
+// Name of the CodedUtil function computing the size of a value of the field
+// without its tag, e.g. "ComputeInt32SizeNoTag".
+string GetComputeSizeNoTagMethodName(const FieldDescriptor* field);
+
 string ToUpperCase(string str);
+
+// Name of the UnrealScript variable of a field, prefixed with "_" if it
+// is reserved, e.g. "_name" or "_state".
 string SafeFieldname(string str);
 
+// Field numbers of the extensions declared in us_options.proto.
+const int kFrequencyOptionNumber = 51001;
+const int kTypeIdOptionNumber = 51002;
+const int kDirtyTrackingOptionNumber = 51003;
+const int kQuantizeMinOptionNumber = 51004;
+const int kQuantizeMaxOptionNumber = 51005;
+const int kQuantizePrecisionOptionNumber = 51006;
+
+// Looks up a custom option declared in us_options.proto.  Those extensions
+// are not linked into the compiler, so protoc leaves their values among the
+// unknown fields of the options message.  Returns false if the option is
+// not set.
+bool GetCustomOption(const Message& options, int number, uint64* value);
+
+// Float literal in decimal notation, without exponent, which UnrealScript
+// doesn't read.  Also valid C++ with an "f" appended.
+string FloatLiteral(double value);
+
+// Reads the quantize options of the field.  Returns false if none is set;
+// otherwise unset ones are left at 0.
+bool GetQuantization(const FieldDescriptor* field,
+                     double* min, double* max, double* precision);
+
+// Whether the field is a float sent as a fixed-point integer.
+bool IsQuantized(const FieldDescriptor* field);
+
+// A delta starts with a mask of the fields that differ from the baseline,
+// one bit per field in declaration order, in as many 32 bit words as
+// needed.  Returns the number of words.
+int DeltaMaskWords(const Descriptor* descriptor);
+
+// Returns the given mask word with the bits of all fields set.
+uint32 FullDeltaMask(const Descriptor* descriptor, int word);
+
+// Helpers for the C++ files generated for the host side.  They follow the
+// naming of the C++ generator, whose classes the generated code works on.
+
+// Escapes all characters of the file name other than letters and digits,
+// for use in header guards.
+string FilenameIdentifier(const string& filename);
+
+// Name of the C++ class of the message, relative to its package namespace.
+string CppClassName(const Descriptor* descriptor);
+
+// Name of the C++ enum, relative to its package namespace.
+string CppClassName(const EnumDescriptor* descriptor);
+
+// Name of the C++ accessors of the field.
+string CppFieldName(const FieldDescriptor* field);
+
+// Splits the file's package into the C++ namespaces it maps to.
+void SplitPackage(const FileDescriptor* file, vector<string>* parts);
+
 string DefaultValue(const FieldDescriptor* field);
 bool IsDefaultValueJavaDefault(const FieldDescriptor* field);
 
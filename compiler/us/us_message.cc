@@ -33,10 +33,13 @@
 //  Sanjay Ghemawat, Jeff Dean, and others.
 
 #include <algorithm>
+#include <map>
+#include <vector>
 #include <google/protobuf/stubs/hash.h>
 #include <google/protobuf/compiler/us/us_message.h>
 #include <google/protobuf/compiler/us/us_helpers.h>
 #include <google/protobuf/stubs/strutil.h>
+#include <google/protobuf/stubs/substitute.h>
 #include <google/protobuf/io/printer.h>
 #include <google/protobuf/io/coded_stream.h>
 #include <google/protobuf/wire_format.h>
@@ -66,6 +69,69 @@ struct ExtensionRangeOrdering {
   }
 };
 
+// Tag of the field in its regular, unpacked encoding.
+uint32 UnpackedTag(const FieldDescriptor* field) {
+  return WireFormatLite::MakeTag(field->number(),
+    WireFormatLite::WireTypeForFieldType(
+      static_cast<WireFormatLite::FieldType>(field->type())));
+}
+
+// Tag of a packable repeated field in its length delimited encoding.
+uint32 PackedTag(const FieldDescriptor* field) {
+  return WireFormatLite::MakeTag(field->number(),
+    WireFormatLite::WIRETYPE_LENGTH_DELIMITED);
+}
+
+// UnrealScript expression Clear() resets a singular scalar field to.
+const char* ClearedValue(const FieldDescriptor* field) {
+  switch (GetUnrealScriptType(field)) {
+    case UNREALSCRIPT_TYPE_STRING:
+      return "\"\"";
+    case UNREALSCRIPT_TYPE_BOOLEAN:
+      return "false";
+    default:
+      return "0";
+  }
+}
+
+// The value sent for value, the UnrealScript expression holding a value
+// of the field.  Only quantized fields differ.
+string ToWireValue(const FieldDescriptor* field, const string& value) {
+  if (!IsQuantized(field)) return value;
+
+  return strings::Substitute(
+    "class'CodedUtil'.static.QuantizeFloat($0, $1_MIN, $1_MAX, $1_PRECISION)",
+    value, ToUpperCase(field->name()));
+}
+
+// The reverse of ToWireValue.
+string FromWireValue(const FieldDescriptor* field, const string& value) {
+  if (!IsQuantized(field)) return value;
+
+  return strings::Substitute(
+    "class'CodedUtil'.static.DequantizeFloat($0, $1_MIN, $1_MAX, $1_PRECISION)",
+    value, ToUpperCase(field->name()));
+}
+
+// Whether any field is repeated, packed or not.
+bool AnyFieldRepeated(const Descriptor* descriptor) {
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    if (descriptor->field(i)->is_repeated()) return true;
+  }
+  return false;
+}
+
+// Whether any field holds a single message, which may be none.
+bool AnySingularMessageField(const Descriptor* descriptor) {
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    if (descriptor->field(i)->type() == FieldDescriptor::TYPE_MESSAGE &&
+        !descriptor->field(i)->is_repeated()) {
+      return true;
+    }
+  }
+  return false;
+}
+
 // Sort the fields of the given Descriptor by number into a new[]'d array
 // and return it.
 const FieldDescriptor** SortFieldsByNumber(const Descriptor* descriptor) {
@@ -83,28 +149,41 @@ const FieldDescriptor** SortFieldsByNumber(const Descriptor* descriptor) {
 
 // ===================================================================
 
-MessageGenerator::MessageGenerator(const Descriptor* descriptor)
-  : descriptor_(descriptor) {
+MessageGenerator::MessageGenerator(const Descriptor* descriptor,
+                                   const GeneratorOptions& options)
+  : descriptor_(descriptor),
+    options_(options) {
 }
 
 MessageGenerator::~MessageGenerator() {}
 
 // ===================================================================
 
+// Packed fields are handled without a loop so they don't count here.
 bool MessageGenerator::HasRepeatedField()
 {
 	for (int i = 0; i < descriptor_->field_count(); i++)
-		if (descriptor_->field(i)->is_repeated())
+		if (descriptor_->field(i)->is_repeated() && !IsPacked(descriptor_->field(i)))
+			return true;
+	return false;
+}
+
+bool MessageGenerator::HasMessageField()
+{
+	for (int i = 0; i < descriptor_->field_count(); i++)
+		if (descriptor_->field(i)->type() == FieldDescriptor::TYPE_MESSAGE)
 			return true;
 	return false;
 }
 
 void MessageGenerator::Generate(io::Printer* printer) {
   // Print class declaration
-  printer->Print("class $classname$ extends Message;\n\n", "classname", "Message" + descriptor_->name());
+  printer->Print("class $classname$ extends Message;\n\n", "classname", UnrealScriptClassName(descriptor_));
 
   // Print class constants
   printer->Print("// Class constants\n");
+  printer->Print("const TYPE_ID = $typeid$;\n\n",
+    "typeid", SimpleItoa(MessageTypeId(descriptor_, options_)));
 
   for (int i = 0; i < descriptor_->field_count(); i++) {
     printer->Print("const $fieldname$_FIELD_NUMBER = $fieldnumber$;\n",
@@ -112,6 +191,45 @@ void MessageGenerator::Generate(io::Printer* printer) {
 	  "fieldnumber", SimpleItoa(descriptor_->field(i)->number())); 
   }
 
+  // Full tags, wire type included, that Deserialize switches on.
+  if (descriptor_->field_count() > 0)
+    printer->Print("\n");
+
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    const FieldDescriptor* field = descriptor_->field(i);
+
+    printer->Print("const $fieldname$_TAG = $tag$;\n",
+      "fieldname", ToUpperCase(field->name()),
+      "tag", SimpleItoa(UnpackedTag(field)));
+
+    if (field->is_repeated() && field->is_packable() && !IsQuantized(field)) {
+      printer->Print("const $fieldname$_PACKED_TAG = $tag$;\n",
+        "fieldname", ToUpperCase(field->name()),
+        "tag", SimpleItoa(PackedTag(field)));
+    }
+  }
+
+  // Range and step of the quantized floats.
+  bool quantized_printed = false;
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    const FieldDescriptor* field = descriptor_->field(i);
+    double min, max, precision;
+    if (!GetQuantization(field, &min, &max, &precision)) continue;
+
+    if (!quantized_printed)
+      printer->Print("\n");
+    quantized_printed = true;
+
+    printer->Print(
+      "const $fieldname$_MIN = $min$;\n"
+      "const $fieldname$_MAX = $max$;\n"
+      "const $fieldname$_PRECISION = $precision$;\n",
+      "fieldname", ToUpperCase(field->name()),
+      "min", FloatLiteral(min),
+      "max", FloatLiteral(max),
+      "precision", FloatLiteral(precision));
+  }
+
   // Print class variables
   printer->Print("\n// Class variables\n");
 
@@ -120,23 +238,105 @@ void MessageGenerator::Generate(io::Printer* printer) {
       printer->Print("var array<$fieldtype$> $fieldname$;\n",
         "fieldtype",
           (descriptor_->field(i)->type() == FieldDescriptor::TYPE_MESSAGE) ? 
-            "Message" + descriptor_->field(i)->message_type()->name() : 
+            UnrealScriptClassName(descriptor_->field(i)->message_type()) : 
             GetPrimitiveTypeName(GetUnrealScriptType(descriptor_->field(i))),
         "fieldname", SafeFieldname(descriptor_->field(i)->name()));
     } else {
       printer->Print("var $fieldtype$ $fieldname$;\n",
         "fieldtype",
           (descriptor_->field(i)->type() == FieldDescriptor::TYPE_MESSAGE) ? 
-            "Message" + descriptor_->field(i)->message_type()->name() : 
+            UnrealScriptClassName(descriptor_->field(i)->message_type()) : 
             GetPrimitiveTypeName(GetUnrealScriptType(descriptor_->field(i))),
         "fieldname", SafeFieldname(descriptor_->field(i)->name()));
     }
   }
 
+  // Unknown fields are kept so they survive a round trip, except for
+  // messages optimized for the lite runtime.
+  if (HasUnknownFields(descriptor_))
+    printer->Print("var array<byte> _unknownFields;\n");
+
+  // One bit per field, set by the generated setters.
+  if (UseDirtyTracking() && DeltaMaskWords(descriptor_) > 0)
+    printer->Print("var int _dirty[$words$];\n",
+      "words", SimpleItoa(DeltaMaskWords(descriptor_)));
+
   printer->Print("\n// Class functions\n");
 
-  // Print Serialize method
-  printer->Print("function Serialize(CodedOutputStream stream)\n{\n");
+  GenerateSerialize(printer);
+  GenerateDeserialize(printer);
+  GenerateSerializedSize(printer);
+  GenerateClear(printer);
+
+  if (options_.delta) {
+    GenerateEquals(printer);
+    GenerateSerializeDelta(printer);
+  }
+
+  if (UseDirtyTracking()) {
+    GenerateDirtyTracking(printer);
+  }
+
+  // Dirty fields are sent in the delta format as well.
+  if (options_.delta || UseDirtyTracking()) {
+    GenerateApplyDelta(printer);
+  }
+
+  // Print defaultproperties block
+  printer->Print("\ndefaultproperties\n{\n");
+  printer->Indent();
+  printer->Indent();
+  printer->Print("id = \"$classname$\";\n",
+    "classname", FlatTypeName(descriptor_->full_name(), descriptor_->file()));
+  printer->Print("typeId = $typeid$;\n",
+    "typeid", SimpleItoa(MessageTypeId(descriptor_, options_)));
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("}\n");
+}
+
+// ===================================================================
+
+void MessageGenerator::GenerateFieldSerializer(io::Printer* printer,
+                                               const FieldDescriptor* field,
+                                               const string& value) {
+  if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+    // Write the length prefix from the child's size and let the child
+    // serialize itself straight into this stream.  Going through
+    // CodedOutputStream.WriteMessage would serialize into a temporary
+    // stream and copy it byte by byte, once per nesting level.  The size
+    // was cached by the GetSerializedSize() pass in Serialize().  Unset
+    // messages are none and are left out, like unset fields elsewhere.
+    printer->Print(
+      "if ($value$ != none)\n"
+      "{\n"
+      "    stream.WriteTag($constname$_FIELD_NUMBER, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);\n"
+      "    stream.WriteRawVarint32($value$.GetCachedSize());\n"
+      "    $value$.SerializeWithCachedSizes(stream);\n"
+      "}\n",
+      "constname", ToUpperCase(field->name()),
+      "value", value);
+  } else {
+    printer->Print("stream.$methodname$($constname$_FIELD_NUMBER, $value$);\n",
+      "methodname", GetSerializeMethodName(field),
+      "constname", ToUpperCase(field->name()),
+      "value", ToWireValue(field, value));
+  }
+}
+
+void MessageGenerator::GenerateSerialize(io::Printer* printer) {
+  // Print Serialize method.  A single size pass caches the size of every
+  // nested message, which the serializer then reuses for length prefixes,
+  // and sizes the output buffer so that it grows at most once.
+  printer->Print(
+    "function Serialize(CodedOutputStream stream)\n"
+    "{\n"
+    "    stream.Reserve(GetSerializedSize());\n"
+    "    SerializeWithCachedSizes(stream);\n"
+    "}\n");
+
+  // Print SerializeWithCachedSizes method
+  printer->Print("\nfunction SerializeWithCachedSizes(CodedOutputStream stream)\n{\n");
   printer->Indent();
   printer->Indent();
 
@@ -144,103 +344,218 @@ void MessageGenerator::Generate(io::Printer* printer) {
   if( HasRepeatedField() )
 	printer->Print("local int idx;\n\n");
 
+  if (options_.debug_log)
+    printer->Print("`PBLog(\"Serializing $classname$, \" $$ cachedSize $$ \" bytes\");\n\n",
+      "classname", descriptor_->name());
+
   for (int i = 0; i < descriptor_->field_count(); i++) {
-    if (descriptor_->field(i)->is_repeated()) {
+    const FieldDescriptor* field = descriptor_->field(i);
+
+    if (IsPacked(field)) {
+      printer->Print("stream.$methodname$($constname$_FIELD_NUMBER, $fieldname$);\n",
+        "methodname", GetPackedSerializeMethodName(field),
+        "constname", ToUpperCase(field->name()),
+        "fieldname", SafeFieldname(field->name()));
+    } else if (field->is_repeated()) {
       printer->Print("\nfor (idx = 0; idx < $fieldname$.Length; idx++)\n{\n",
-        "fieldname", SafeFieldname(descriptor_->field(i)->name()));
+        "fieldname", SafeFieldname(field->name()));
       printer->Indent();
       printer->Indent();
-      printer->Print("stream.$methodname$($constname$_FIELD_NUMBER, $fieldname$[idx]);\n",
-        "methodname", GetSerializeMethodName(descriptor_->field(i)),
-        "constname", ToUpperCase(descriptor_->field(i)->name()),
-        "fieldname", SafeFieldname(descriptor_->field(i)->name()));
+      GenerateFieldSerializer(printer, field, SafeFieldname(field->name()) + "[idx]");
       printer->Outdent();
       printer->Outdent();
       printer->Print("}\n");
     } else {
-      printer->Print("stream.$methodname$($constname$_FIELD_NUMBER, $fieldname$);\n",
-        "methodname", GetSerializeMethodName(descriptor_->field(i)),
-        "constname", ToUpperCase(descriptor_->field(i)->name()),
-        "fieldname", SafeFieldname(descriptor_->field(i)->name()));
+      GenerateFieldSerializer(printer, field, SafeFieldname(field->name()));
     }
   }
 
+  if (HasUnknownFields(descriptor_))
+    printer->Print("stream.WriteRawBytes(_unknownFields);\n");
+
   printer->Outdent();
   printer->Outdent();
   printer->Print("}\n");
-  
+}
+
+void MessageGenerator::GenerateFieldDeserializer(io::Printer* printer,
+                                                 const FieldDescriptor* field,
+                                                 bool packed) {
+  map<string, string> vars;
+  vars["fieldname"] = SafeFieldname(field->name());
+
+  if (packed) {
+    vars["methodname"] = GetPackedDeserializeMethodName(field);
+    printer->Print(vars, "stream.$methodname$($fieldname$);\n");
+  } else if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+    // Nested messages are read in place from the same buffer by limiting
+    // the stream to their length.
+    vars["fieldtype"] = UnrealScriptClassName(field->message_type());
+    printer->Print(vars, "limit = stream.PushLimit(stream.ReadRawVarint32());\n");
+
+    // New messages come from the stream's pool, if it has one.  A
+    // singular field that is already set is merged into, the way repeated
+    // occurrences of it are supposed to be.
+    if (field->is_repeated()) {
+      printer->Print(vars,
+        "$fieldname$.AddItem($fieldtype$(stream.NewMessage(class'$fieldtype$')));\n"
+        "$fieldname$[$fieldname$.Length - 1].Deserialize(stream);\n");
+    } else {
+      printer->Print(vars,
+        "if ($fieldname$ == none)\n"
+        "{\n"
+        "    $fieldname$ = $fieldtype$(stream.NewMessage(class'$fieldtype$'));\n"
+        "}\n"
+        "$fieldname$.Deserialize(stream);\n");
+    }
+
+    printer->Print(vars, "stream.PopLimit(limit);\n");
+  } else {
+    vars["value"] = FromWireValue(field,
+      string("stream.") + GetDeserializeMethodName(field) + "()");
+
+    if (field->is_repeated()) {
+      printer->Print(vars, "$fieldname$.AddItem($value$);\n");
+    } else {
+      printer->Print(vars, "$fieldname$ = $value$;\n");
+    }
+  }
+}
+
+bool MessageGenerator::UseDirtyTracking() {
+  uint64 dirty_tracking;
+  return GetCustomOption(descriptor_->options(), kDirtyTrackingOptionNumber,
+                         &dirty_tracking) && dirty_tracking != 0;
+}
+
+void MessageGenerator::GenerateFieldDebugLog(io::Printer* printer,
+                                             const FieldDescriptor* field) {
+  if (!options_.debug_log) return;
+
+  map<string, string> vars;
+  vars["classname"] = descriptor_->name();
+  vars["name"] = field->name();
+  vars["fieldname"] = SafeFieldname(field->name());
+
+  // Printer variables are delimited by '$', so the UnrealScript string
+  // concatenation operator is written as "$$".
+  if (field->is_repeated()) {
+    printer->Print(vars,
+      "`PBLog(\"$classname$.$name$.Length = \" $$ $fieldname$.Length);\n");
+  } else if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+    printer->Print(vars,
+      "`PBLog(\"$classname$.$name$ = \" $$ $fieldname$.id);\n");
+  } else if (GetUnrealScriptType(field) == UNREALSCRIPT_TYPE_INT64) {
+    printer->Print(vars,
+      "`PBLog(\"$classname$.$name$ = \" $$ $fieldname$.hi $$ \":\" $$ $fieldname$.lo);\n");
+  } else if (GetUnrealScriptType(field) == UNREALSCRIPT_TYPE_STRING) {
+    printer->Print(vars,
+      "`PBLog(\"$classname$.$name$ = '\" $$ $fieldname$ $$ \"'\");\n");
+  } else {
+    printer->Print(vars,
+      "`PBLog(\"$classname$.$name$ = \" $$ $fieldname$);\n");
+  }
+}
+
+int MessageGenerator::FieldFrequency(const FieldDescriptor* field) {
+  map<string, int>::const_iterator iter =
+    options_.field_frequency.find(field->full_name());
+  if (iter != options_.field_frequency.end()) {
+    return iter->second;
+  }
+
+  uint64 frequency;
+  if (GetCustomOption(field->options(), kFrequencyOptionNumber, &frequency)) {
+    return static_cast<int>(frequency);
+  }
+
+  return 0;
+}
+
+void MessageGenerator::GenerateDeserialize(io::Printer* printer) {
+  // UnrealScript tests the cases of a switch one after the other, so the
+  // fields expected most often go first.  Ties keep declaration order.
+  vector<pair<int, int> > order;
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    order.push_back(make_pair(-FieldFrequency(descriptor_->field(i)), i));
+  }
+  sort(order.begin(), order.end());
+
   // Print Deserialize method
   printer->Print("\nfunction Deserialize(CodedInputStream stream)\n{\n");
   printer->Indent();
   printer->Indent();
-  //printer->Print("local int tag, fieldNumber;\n\n");
 
-  // Only print the field number if there are fields to iterate on
-  if( descriptor_->field_count() > 0 )
-	printer->Print("local int tag, fieldNumber;\n\n");
-  else
-	printer->Print("local int tag;\n\n");
+  printer->Print("local int tag;\n");
+
+  if( HasMessageField() )
+	printer->Print("local int limit;\n");
 
-  printer->Print("tag = stream.ReadTag();\n\n");
+  printer->Print("\ntag = stream.ReadTag();\n\n");
   printer->Print("while (tag > 0)\n{\n");
   printer->Indent();
   printer->Indent();
 
-  if( descriptor_->field_count() > 0 )
-	printer->Print("fieldNumber = class'WireFormat'.static.GetTagFieldNumber(tag);\n");
-  else
-	printer->Print("class'WireFormat'.static.GetTagFieldNumber(tag);\n");
-  
+  // The tag includes the wire type, so a field sent with an unexpected
+  // wire type falls through to the default case along with unknown fields.
+  printer->Print("switch (tag)\n{\n");
+  printer->Indent();
+  printer->Indent();
 
-  for (int i = 0; i < descriptor_->field_count(); i++) {
-    printer->Print("$if$ (fieldNumber == $constname$_FIELD_NUMBER)\n{\n",
-      "if", (i == 0) ? "if" : "else if", "constname", ToUpperCase(descriptor_->field(i)->name()));
+  for (int i = 0; i < order.size(); i++) {
+    const FieldDescriptor* field = descriptor_->field(order[i].second);
+
+    printer->Print("case $constname$_TAG:\n",
+      "constname", ToUpperCase(field->name()));
     printer->Indent();
     printer->Indent();
+    GenerateFieldDeserializer(printer, field, false);
+    GenerateFieldDebugLog(printer, field);
+    printer->Print("break;\n");
+    printer->Outdent();
+    printer->Outdent();
 
-    if (descriptor_->field(i)->is_repeated())
-	{
-		// Check for a the type of message, so we can pass in the proper class
-		if( descriptor_->field(i)->type() == FieldDescriptor::TYPE_MESSAGE )
-		{
-			printer->Print("$fieldname$.AddItem( $fieldtype$(stream.$methodname$(class'$fieldtype$')) );\n",
-				"fieldname", SafeFieldname(descriptor_->field(i)->name()), 
-				"methodname", GetDeserializeMethodName(descriptor_->field(i)),
-				"fieldtype","Message" + descriptor_->field(i)->message_type()->name() );
-		}
-		else
-		{
-			printer->Print("$fieldname$.AddItem(stream.$methodname$());\n",
-				"fieldname", SafeFieldname(descriptor_->field(i)->name()), 
-				"methodname", GetDeserializeMethodName(descriptor_->field(i))
-			);
-		}
+    // Accept both packed and unpacked input, whatever the field is
+    // declared as.  Quantized fields are never packed, the packed readers
+    // can't convert the values.
+    if (field->is_repeated() && field->is_packable() && !IsQuantized(field)) {
+      printer->Print("case $constname$_PACKED_TAG:\n",
+        "constname", ToUpperCase(field->name()));
+      printer->Indent();
+      printer->Indent();
+      GenerateFieldDeserializer(printer, field, true);
+      GenerateFieldDebugLog(printer, field);
+      printer->Print("break;\n");
+      printer->Outdent();
+      printer->Outdent();
     }
-	else
-	{
-		// Check for a the type of message, so we can pass in the proper class
-		if( descriptor_->field(i)->type() == FieldDescriptor::TYPE_MESSAGE )
-		{
-			printer->Print("$fieldname$ = $fieldtype$(stream.$methodname$(class'$fieldtype$'));\n", 
-				"fieldname", SafeFieldname(descriptor_->field(i)->name()), 
-				"methodname", GetDeserializeMethodName(descriptor_->field(i)),
-				"fieldtype","Message" + descriptor_->field(i)->message_type()->name()
-			);
-		}
-		else
-		{
-			printer->Print("$fieldname$ = stream.$methodname$();\n", 
-				"fieldname", SafeFieldname(descriptor_->field(i)->name()), 
-				"methodname", GetDeserializeMethodName(descriptor_->field(i))
-			);
-		}
+  }
 
-    }
+  printer->Print("default:\n");
+  printer->Indent();
+  printer->Indent();
 
-    printer->Outdent();
-    printer->Outdent();
-    printer->Print("}\n");
-  }
+  if (options_.debug_log)
+    printer->Print("`PBLog(\"$classname$: unknown field, tag = \" $$ tag);\n",
+      "classname", descriptor_->name());
+
+  printer->Print(
+    "// Unknown field or unexpected wire type.  Skip it so that newer\n"
+    "// senders can add fields, and stop if it can't be skipped.  Any\n"
+    "// other error makes the next ReadTag return 0.\n"
+    "if (!stream.$method$)\n"
+    "{\n"
+    "    return;\n"
+    "}\n"
+    "break;\n",
+    "method", HasUnknownFields(descriptor_) ?
+      "ReadUnknownField(tag, _unknownFields)" : "SkipField(tag)");
+  printer->Outdent();
+  printer->Outdent();
+
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("}\n");
 
   printer->Print("\ntag = stream.ReadTag();\n");
   printer->Outdent();
@@ -249,7 +564,9 @@ void MessageGenerator::Generate(io::Printer* printer) {
   printer->Outdent();
   printer->Outdent();
   printer->Print("}\n");
+}
 
+void MessageGenerator::GenerateSerializedSize(io::Printer* printer) {
   // Print GetSerializedSize method
   printer->Print("\nfunction int GetSerializedSize()\n{\n");
   printer->Indent();
@@ -264,23 +581,32 @@ void MessageGenerator::Generate(io::Printer* printer) {
   
   for (int i = 0; i < descriptor_->field_count(); i++)
   {
+	if (IsPacked(descriptor_->field(i)))
+	{
+		printer->Print("_size += class'CodedUtil'.static.$methodname$($constname$_FIELD_NUMBER, $fieldname$);\n",
+		  "methodname", GetPackedComputeSizeMethodName(descriptor_->field(i)),
+		  "constname", ToUpperCase(descriptor_->field(i)->name()),
+		  "fieldname", SafeFieldname(descriptor_->field(i)->name()));
+		continue;
+	}
+
 	if (descriptor_->field(i)->is_repeated())
 	{
-		printer->Print("\nfor (idx = 0; idx < $fieldname$.Length; idx++)\n{\n", "fieldname", descriptor_->field(i)->name());
+		printer->Print("\nfor (idx = 0; idx < $fieldname$.Length; idx++)\n{\n", "fieldname", SafeFieldname(descriptor_->field(i)->name()));
 		printer->Indent();
 		printer->Indent();
 
-		printer->Print("_size += class'CodedUtil'.static.$methodname$($constname$_FIELD_NUMBER, $fieldname$[idx]);\n",
+		printer->Print("_size += class'CodedUtil'.static.$methodname$($constname$_FIELD_NUMBER, $value$);\n",
 		  "methodname", GetComputeSizeMethodName(descriptor_->field(i)),
 		  "constname", ToUpperCase(descriptor_->field(i)->name()),
-		  "fieldname", SafeFieldname(descriptor_->field(i)->name()));
+		  "value", ToWireValue(descriptor_->field(i), SafeFieldname(descriptor_->field(i)->name()) + "[idx]"));
     }
 	else
 	{
-		printer->Print("_size += class'CodedUtil'.static.$methodname$($constname$_FIELD_NUMBER, $fieldname$);\n",
+		printer->Print("_size += class'CodedUtil'.static.$methodname$($constname$_FIELD_NUMBER, $value$);\n",
 		  "methodname", GetComputeSizeMethodName(descriptor_->field(i)),
 		  "constname", ToUpperCase(descriptor_->field(i)->name()),
-		  "fieldname", SafeFieldname(descriptor_->field(i)->name()));
+		  "value", ToWireValue(descriptor_->field(i), SafeFieldname(descriptor_->field(i)->name())));
 	}
 
 
@@ -291,16 +617,597 @@ void MessageGenerator::Generate(io::Printer* printer) {
     }
   }
 
-  printer->Print("\nreturn _size;\n");
+  if (HasUnknownFields(descriptor_))
+    printer->Print("_size += _unknownFields.Length;\n");
+
+  printer->Print("\ncachedSize = _size;\n");
+  printer->Print("return _size;\n");
   printer->Outdent();
   printer->Outdent();
   printer->Print("}\n");
+}
 
-  // Print defaultproperties block
-  printer->Print("\ndefaultproperties\n{\n");
+void MessageGenerator::GenerateClear(io::Printer* printer) {
+  // Print Clear method.  Nested messages are handed to the pool rather
+  // than dropped, so decoding into a cleared message allocates as little
+  // as possible.  Singular ones are set to none even so, since an empty
+  // message would still be sent.
+  printer->Print("\nfunction Clear(optional MessagePool pool)\n{\n");
   printer->Indent();
   printer->Indent();
-  printer->Print("_id = \"$classname$\";\n", "classname", descriptor_->name());
+
+  bool has_repeated_message = false;
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    const FieldDescriptor* field = descriptor_->field(i);
+
+    if (field->is_repeated() &&
+        field->type() == FieldDescriptor::TYPE_MESSAGE) {
+      has_repeated_message = true;
+    }
+  }
+
+  if (has_repeated_message)
+    printer->Print("local int idx;\n\n");
+
+  // Blocks are set apart by blank lines, printed lazily so that adjacent
+  // blocks are only separated by one.
+  bool blank_line = false;
+
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    const FieldDescriptor* field = descriptor_->field(i);
+    map<string, string> vars;
+    vars["fieldname"] = SafeFieldname(field->name());
+
+    bool block = field->type() == FieldDescriptor::TYPE_MESSAGE;
+    if (i > 0 && (block || blank_line))
+      printer->Print("\n");
+    blank_line = block;
+
+    if (field->is_repeated()) {
+      if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+        printer->Print(vars,
+          "if (pool != none)\n"
+          "{\n"
+          "    for (idx = 0; idx < $fieldname$.Length; idx++)\n"
+          "    {\n"
+          "        pool.Release($fieldname$[idx]);\n"
+          "    }\n"
+          "}\n\n");
+      }
+
+      printer->Print(vars, "$fieldname$.Length = 0;\n");
+    } else if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+      printer->Print(vars,
+        "if (pool != none)\n"
+        "{\n"
+        "    pool.Release($fieldname$);\n"
+        "}\n"
+        "\n"
+        "$fieldname$ = none;\n");
+    } else if (GetUnrealScriptType(field) == UNREALSCRIPT_TYPE_INT64) {
+      printer->Print(vars,
+        "$fieldname$.lo = 0;\n"
+        "$fieldname$.hi = 0;\n");
+    } else {
+      vars["value"] = ClearedValue(field);
+      printer->Print(vars, "$fieldname$ = $value$;\n");
+    }
+  }
+
+  if (HasUnknownFields(descriptor_)) {
+    if (blank_line)
+      printer->Print("\n");
+    printer->Print("_unknownFields.Length = 0;\n");
+  }
+
+  printer->Print("\nsuper.Clear(pool);\n");
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("}\n");
+}
+
+void MessageGenerator::GenerateFieldComparison(io::Printer* printer,
+                                               const FieldDescriptor* field,
+                                               const string& other,
+                                               const string& statement) {
+  map<string, string> vars;
+  vars["fieldname"] = SafeFieldname(field->name());
+  vars["other"] = other;
+  vars["statement"] = statement;
+
+  bool is_message = field->type() == FieldDescriptor::TYPE_MESSAGE;
+
+  if (field->is_repeated()) {
+    vars["differs"] = is_message ?
+      "!class'Message'.static.MessagesEqual($fieldname$[idx], $other$.$fieldname$[idx])" :
+      "$fieldname$[idx] != $other$.$fieldname$[idx]";
+
+    printer->Print(vars,
+      "if ($fieldname$.Length != $other$.$fieldname$.Length)\n"
+      "{\n"
+      "    $statement$\n"
+      "}\n"
+      "else\n"
+      "{\n"
+      "    for (idx = 0; idx < $fieldname$.Length; idx++)\n"
+      "    {\n");
+    printer->Print(vars,
+      (string("        if (") + vars["differs"] + ")\n").c_str());
+    printer->Print(vars,
+      "        {\n"
+      "            $statement$\n");
+
+    // The loop only needs leaving if the statement doesn't already.
+    if (!HasPrefixString(statement, "return")) {
+      printer->Print("            break;\n");
+    }
+
+    printer->Print(
+      "        }\n"
+      "    }\n"
+      "}\n");
+  } else {
+    vars["differs"] = is_message ?
+      "!class'Message'.static.MessagesEqual($fieldname$, $other$.$fieldname$)" :
+      "$fieldname$ != $other$.$fieldname$";
+
+    printer->Print(vars, (string("if (") + vars["differs"] + ")\n").c_str());
+    printer->Print(vars,
+      "{\n"
+      "    $statement$\n"
+      "}\n");
+  }
+}
+
+void MessageGenerator::GenerateEquals(io::Printer* printer) {
+  // Print Equals method, which tells SerializeDelta which fields changed.
+  printer->Print(
+    "\nfunction bool Equals(Message other)\n"
+    "{\n"
+    "    local $classname$ _other;\n",
+    "classname", UnrealScriptClassName(descriptor_));
+  printer->Indent();
+  printer->Indent();
+
+  if (AnyFieldRepeated(descriptor_))
+    printer->Print("local int idx;\n");
+
+  printer->Print(
+    "\n_other = $classname$(other);\n"
+    "\n"
+    "if (_other == none)\n"
+    "{\n"
+    "    return false;\n"
+    "}\n",
+    "classname", UnrealScriptClassName(descriptor_));
+
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    printer->Print("\n");
+    GenerateFieldComparison(printer, descriptor_->field(i), "_other",
+                            "return false;");
+  }
+
+  printer->Print("\nreturn true;\n");
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("}\n");
+}
+
+void MessageGenerator::GenerateSerializeDelta(io::Printer* printer) {
+  // Print SerializeDelta method.  The delta starts with a mask of the
+  // fields that differ from the baseline, one bit per field in declaration
+  // order, followed by the values of those fields without tags.  Repeated
+  // fields are sent whole, prefixed by their element count.  Singular
+  // messages are prefixed by their size plus one, or 0 when they are none.
+  int words = DeltaMaskWords(descriptor_);
+
+  printer->Print(
+    "\nfunction SerializeDelta(CodedOutputStream stream, Message baseline)\n"
+    "{\n");
+  printer->Indent();
+  printer->Indent();
+
+  if (words > 0) {
+    printer->Print(
+      "local $classname$ _base;\n"
+      "local int _changed[$words$];\n",
+      "classname", UnrealScriptClassName(descriptor_),
+      "words", SimpleItoa(words));
+
+    if (AnyFieldRepeated(descriptor_))
+      printer->Print("local int idx;\n");
+
+    printer->Print(
+      "\n_base = $classname$(baseline);\n"
+      "\n"
+      "if (_base == none)\n"
+      "{\n",
+      "classname", UnrealScriptClassName(descriptor_));
+
+    for (int i = 0; i < words; i++) {
+      printer->Print("    _changed[$word$] = $mask$;\n",
+        "word", SimpleItoa(i),
+        "mask", SimpleItoa(static_cast<int32>(FullDeltaMask(descriptor_, i))));
+    }
+
+    printer->Print(
+      "}\n"
+      "else\n"
+      "{\n");
+    printer->Indent();
+    printer->Indent();
+
+    for (int i = 0; i < descriptor_->field_count(); i++) {
+      string statement = "_changed[" + SimpleItoa(i / 32) + "] = _changed[" +
+                         SimpleItoa(i / 32) + "] | (1 << " +
+                         SimpleItoa(i % 32) + ");";
+
+      if (i > 0)
+        printer->Print("\n");
+      GenerateFieldComparison(printer, descriptor_->field(i), "_base",
+                              statement);
+    }
+
+    printer->Outdent();
+    printer->Outdent();
+    printer->Print("}\n\n");
+
+    for (int i = 0; i < words; i++) {
+      printer->Print("stream.WriteRawVarint32(_changed[$word$]);\n",
+        "word", SimpleItoa(i));
+    }
+  }
+
+  GenerateDeltaFieldsSerializer(printer);
+
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("}\n");
+}
+
+void MessageGenerator::GenerateDeltaFieldsSerializer(io::Printer* printer) {
+  // Writes the fields whose bit is set in the local _changed mask.
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    const FieldDescriptor* field = descriptor_->field(i);
+    map<string, string> vars;
+    vars["fieldname"] = SafeFieldname(field->name());
+    vars["word"] = SimpleItoa(i / 32);
+    vars["bit"] = SimpleItoa(i % 32);
+
+    printer->Print(vars,
+      "\nif ((_changed[$word$] & (1 << $bit$)) != 0)\n"
+      "{\n");
+    printer->Indent();
+    printer->Indent();
+
+    string value = vars["fieldname"];
+
+    if (field->is_repeated()) {
+      printer->Print(vars,
+        "stream.WriteRawVarint32($fieldname$.Length);\n"
+        "\n"
+        "for (idx = 0; idx < $fieldname$.Length; idx++)\n"
+        "{\n");
+      printer->Indent();
+      printer->Indent();
+      value += "[idx]";
+    }
+
+    if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+      // Elements of repeated fields can't be missing in protobuf, so none
+      // is sent as an empty message there.
+      printer->Print(
+        "if ($value$ != none)\n"
+        "{\n"
+        "    stream.WriteRawVarint32($value$.GetSerializedSize()$plus_one$);\n"
+        "    $value$.SerializeWithCachedSizes(stream);\n"
+        "}\n"
+        "else\n"
+        "{\n"
+        "    stream.WriteRawVarint32(0);\n"
+        "}\n",
+        "value", value,
+        "plus_one", field->is_repeated() ? "" : " + 1");
+    } else {
+      printer->Print("stream.$methodname$($value$);\n",
+        "methodname", GetSerializeNoTagMethodName(field),
+        "value", ToWireValue(field, value));
+    }
+
+    if (field->is_repeated()) {
+      printer->Outdent();
+      printer->Outdent();
+      printer->Print("}\n");
+    }
+
+    printer->Outdent();
+    printer->Outdent();
+    printer->Print("}\n");
+  }
+}
+
+void MessageGenerator::GenerateApplyDelta(io::Printer* printer) {
+  // Print ApplyDelta method, the reverse of SerializeDelta.  Fields not in
+  // the delta keep their values.
+  int words = DeltaMaskWords(descriptor_);
+
+  printer->Print(
+    "\nfunction ApplyDelta(CodedInputStream stream)\n"
+    "{\n");
+  printer->Indent();
+  printer->Indent();
+
+  if (words > 0) {
+    printer->Print("local int _changed[$words$];\n",
+      "words", SimpleItoa(words));
+
+    if (AnyFieldRepeated(descriptor_))
+      printer->Print("local int idx, count;\n");
+
+    if (AnySingularMessageField(descriptor_))
+      printer->Print("local int limit, length;\n");
+    else if (HasMessageField())
+      printer->Print("local int limit;\n");
+
+    printer->Print("\n");
+
+    for (int i = 0; i < words; i++) {
+      printer->Print("_changed[$word$] = stream.ReadRawVarint32();\n",
+        "word", SimpleItoa(i));
+    }
+
+    // A corrupt mask would have every field below read garbage.
+    printer->Print(
+      "\n"
+      "if (stream.error != class'CodedInputStream'.const.ERROR_NONE)\n"
+      "{\n"
+      "    return;\n"
+      "}\n");
+  }
+
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    const FieldDescriptor* field = descriptor_->field(i);
+    map<string, string> vars;
+    vars["fieldname"] = SafeFieldname(field->name());
+    vars["word"] = SimpleItoa(i / 32);
+    vars["bit"] = SimpleItoa(i % 32);
+
+    printer->Print(vars,
+      "\nif ((_changed[$word$] & (1 << $bit$)) != 0)\n"
+      "{\n");
+    printer->Indent();
+    printer->Indent();
+
+    if (field->is_repeated()) {
+      if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+        printer->Print(vars,
+          "if (stream.pool != none)\n"
+          "{\n"
+          "    for (idx = 0; idx < $fieldname$.Length; idx++)\n"
+          "    {\n"
+          "        stream.pool.Release($fieldname$[idx]);\n"
+          "    }\n"
+          "}\n"
+          "\n");
+      }
+
+      // Stop early on truncated input rather than trusting the count.
+      printer->Print(vars,
+        "$fieldname$.Length = 0;\n"
+        "count = stream.ReadRawVarint32();\n"
+        "\n"
+        "for (idx = 0; idx < count && !stream.IsAtEnd(); idx++)\n"
+        "{\n");
+      printer->Indent();
+      printer->Indent();
+      GenerateFieldDeserializer(printer, field, false);
+      printer->Outdent();
+      printer->Outdent();
+      printer->Print("}\n");
+    } else if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+      // Messages are sent whole, so they replace rather than merge, and a
+      // length of 0 means the sender's is none.
+      vars["fieldtype"] = UnrealScriptClassName(field->message_type());
+      printer->Print(vars,
+        "length = stream.ReadRawVarint32();\n"
+        "\n"
+        "if (length == 0)\n"
+        "{\n"
+        "    if (stream.pool != none)\n"
+        "    {\n"
+        "        stream.pool.Release($fieldname$);\n"
+        "    }\n"
+        "\n"
+        "    $fieldname$ = none;\n"
+        "}\n"
+        "else\n"
+        "{\n"
+        "    if ($fieldname$ == none)\n"
+        "    {\n"
+        "        $fieldname$ = $fieldtype$(stream.NewMessage(class'$fieldtype$'));\n"
+        "    }\n"
+        "    else\n"
+        "    {\n"
+        "        $fieldname$.Clear(stream.pool);\n"
+        "    }\n"
+        "\n"
+        "    limit = stream.PushLimit(length - 1);\n"
+        "    $fieldname$.Deserialize(stream);\n"
+        "    stream.PopLimit(limit);\n"
+        "}\n");
+    } else {
+      GenerateFieldDeserializer(printer, field, false);
+    }
+
+    printer->Outdent();
+    printer->Outdent();
+    printer->Print("}\n");
+  }
+
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("}\n");
+}
+
+void MessageGenerator::GenerateDirtyTracking(io::Printer* printer) {
+  int words = DeltaMaskWords(descriptor_);
+
+  // Print setters, which mark the fields they assign as dirty.
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    const FieldDescriptor* field = descriptor_->field(i);
+    map<string, string> vars;
+    vars["fieldname"] = SafeFieldname(field->name());
+    vars["name"] = UnderscoresToCapitalizedCamelCase(field);
+    vars["fieldtype"] = field->type() == FieldDescriptor::TYPE_MESSAGE ?
+      UnrealScriptClassName(field->message_type()) :
+      GetPrimitiveTypeName(GetUnrealScriptType(field));
+    vars["word"] = SimpleItoa(i / 32);
+    vars["bit"] = SimpleItoa(i % 32);
+
+    if (field->is_repeated()) {
+      printer->Print(vars,
+        "\nfunction Add$name$($fieldtype$ value)\n"
+        "{\n"
+        "    $fieldname$.AddItem(value);\n"
+        "    _dirty[$word$] = _dirty[$word$] | (1 << $bit$);\n"
+        "}\n");
+    } else {
+      printer->Print(vars,
+        "\nfunction Set$name$($fieldtype$ value)\n"
+        "{\n"
+        "    $fieldname$ = value;\n"
+        "    _dirty[$word$] = _dirty[$word$] | (1 << $bit$);\n"
+        "}\n");
+    }
+  }
+
+  // Print MarkDirty, for fields changed without a setter.
+  printer->Print(
+    "\nfunction MarkDirty(int fieldNumber)\n"
+    "{\n");
+  printer->Indent();
+  printer->Indent();
+
+  if (words > 0) {
+    printer->Print("switch (fieldNumber)\n{\n");
+    printer->Indent();
+    printer->Indent();
+
+    for (int i = 0; i < descriptor_->field_count(); i++) {
+      printer->Print(
+        "case $constname$_FIELD_NUMBER:\n"
+        "    _dirty[$word$] = _dirty[$word$] | (1 << $bit$);\n"
+        "    break;\n",
+        "constname", ToUpperCase(descriptor_->field(i)->name()),
+        "word", SimpleItoa(i / 32),
+        "bit", SimpleItoa(i % 32));
+    }
+
+    printer->Outdent();
+    printer->Outdent();
+    printer->Print("}\n");
+  }
+
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("}\n");
+
+  // Print ClearDirty
+  printer->Print(
+    "\nfunction ClearDirty()\n"
+    "{\n");
+  for (int i = 0; i < words; i++) {
+    printer->Print("    _dirty[$word$] = 0;\n", "word", SimpleItoa(i));
+  }
+  printer->Print("}\n");
+
+  // Print SerializeDirty, which writes the dirty fields the way
+  // SerializeDelta writes changed ones, so ApplyDelta reads both.
+  printer->Print(
+    "\nfunction SerializeDirty(CodedOutputStream stream)\n"
+    "{\n");
+  printer->Indent();
+  printer->Indent();
+
+  if (words > 0) {
+    printer->Print("local int _changed[$words$];\n",
+      "words", SimpleItoa(words));
+
+    if (AnyFieldRepeated(descriptor_))
+      printer->Print("local int idx;\n");
+
+    printer->Print("\n");
+
+    for (int i = 0; i < words; i++) {
+      printer->Print(
+        "_changed[$word$] = _dirty[$word$];\n"
+        "stream.WriteRawVarint32(_changed[$word$]);\n",
+        "word", SimpleItoa(i));
+    }
+
+    GenerateDeltaFieldsSerializer(printer);
+
+    printer->Print("\nClearDirty();\n");
+  }
+
+  printer->Outdent();
+  printer->Outdent();
+  printer->Print("}\n");
+
+  // Print GetDirtySerializedSize
+  printer->Print(
+    "\nfunction int GetDirtySerializedSize()\n"
+    "{\n");
+  printer->Indent();
+  printer->Indent();
+
+  printer->Print("local int _size;\n");
+
+  if (AnyFieldRepeated(descriptor_))
+    printer->Print("local int idx;\n");
+
+  printer->Print("\n_size = 0;\n");
+
+  for (int i = 0; i < words; i++) {
+    printer->Print(
+      "_size += class'CodedUtil'.static.ComputeRawVarint32Size(_dirty[$word$]);\n",
+      "word", SimpleItoa(i));
+  }
+
+  for (int i = 0; i < descriptor_->field_count(); i++) {
+    const FieldDescriptor* field = descriptor_->field(i);
+    map<string, string> vars;
+    vars["fieldname"] = SafeFieldname(field->name());
+    vars["methodname"] = GetComputeSizeNoTagMethodName(field);
+    vars["value"] = ToWireValue(field, vars["fieldname"]);
+    vars["element"] = ToWireValue(field, vars["fieldname"] + "[idx]");
+    vars["word"] = SimpleItoa(i / 32);
+    vars["bit"] = SimpleItoa(i % 32);
+
+    printer->Print(vars,
+      "\nif ((_dirty[$word$] & (1 << $bit$)) != 0)\n"
+      "{\n");
+
+    if (field->is_repeated()) {
+      printer->Print(vars,
+        "    _size += class'CodedUtil'.static.ComputeRawVarint32Size($fieldname$.Length);\n"
+        "\n"
+        "    for (idx = 0; idx < $fieldname$.Length; idx++)\n"
+        "    {\n"
+        "        _size += class'CodedUtil'.static.$methodname$($element$);\n"
+        "    }\n");
+    } else if (field->type() == FieldDescriptor::TYPE_MESSAGE) {
+      printer->Print(vars,
+        "    _size += class'CodedUtil'.static.ComputeDeltaMessageSize($value$);\n");
+    } else {
+      printer->Print(vars,
+        "    _size += class'CodedUtil'.static.$methodname$($value$);\n");
+    }
+
+    printer->Print("}\n");
+  }
+
+  printer->Print("\nreturn _size;\n");
   printer->Outdent();
   printer->Outdent();
   printer->Print("}\n");
@@ -38,6 +38,7 @@
 #include <string>
 #include <google/protobuf/stubs/common.h>
 #include <google/protobuf/descriptor.h>
+#include <google/protobuf/compiler/us/us_generator_options.h>
 
 namespace google {
 namespace protobuf {
@@ -52,20 +53,67 @@ namespace us {
 
 class MessageGenerator {
  public:
-  explicit MessageGenerator(const Descriptor* descriptor);
+  MessageGenerator(const Descriptor* descriptor,
+                   const GeneratorOptions& options);
   ~MessageGenerator();
 
   // Generate the class itself.
   void Generate(io::Printer* printer);
 
  private:
-  enum UseMemoization {
-    MEMOIZE,
-    DONT_MEMOIZE
-  };
+  void GenerateSerialize(io::Printer* printer);
+  void GenerateDeserialize(io::Printer* printer);
+  void GenerateSerializedSize(io::Printer* printer);
+  void GenerateClear(io::Printer* printer);
+
+  // Delta encoding, generated with the "delta" option.
+  void GenerateEquals(io::Printer* printer);
+  void GenerateSerializeDelta(io::Printer* printer);
+  void GenerateApplyDelta(io::Printer* printer);
+
+  // Prints the statements writing the values of the fields whose bit is
+  // set in the _changed mask, in the delta format.
+  void GenerateDeltaFieldsSerializer(io::Printer* printer);
+
+  // Setters, dirty mask and SerializeDirty(), generated for messages with
+  // the (us.dirty_tracking) option.
+  void GenerateDirtyTracking(io::Printer* printer);
+  bool UseDirtyTracking();
+
+  // Prints a check running statement if the given field of this message
+  // differs from the one of other, the UnrealScript expression holding a
+  // message of the same class.
+  void GenerateFieldComparison(io::Printer* printer,
+                               const FieldDescriptor* field,
+                               const string& other,
+                               const string& statement);
+
+  // Prints the statements that write a single value of the given field,
+  // where value is the UnrealScript expression holding that value.
+  void GenerateFieldSerializer(io::Printer* printer,
+                               const FieldDescriptor* field,
+                               const string& value);
+
+  // Prints the statements that read a single occurrence of the given
+  // field from the stream.  packed is true for the length delimited
+  // encoding of a packable repeated field.
+  void GenerateFieldDeserializer(io::Printer* printer,
+                                 const FieldDescriptor* field,
+                                 bool packed);
+
+  // Prints a `PBLog line showing the value just read into the field, if
+  // the debug_log option is set.
+  void GenerateFieldDebugLog(io::Printer* printer,
+                             const FieldDescriptor* field);
+
+  // Expected decode frequency of the field, from the profile file or the
+  // (us.frequency) option.  0 if neither is given.
+  int FieldFrequency(const FieldDescriptor* field);
 
   bool HasRepeatedField();
+  bool HasMessageField();
   const Descriptor* descriptor_;
+  const GeneratorOptions& options_;
 
   GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(MessageGenerator);
 };
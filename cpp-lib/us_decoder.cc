@@ -0,0 +1,279 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <google/protobuf/us/us_decoder.h>
+#include <google/protobuf/wire_format_lite.h>
+
+namespace google {
+namespace protobuf {
+namespace us {
+
+namespace {
+
+typedef internal::WireFormatLite WireFormatLite;
+
+const int kMaxVarint32Bytes = 5;
+const int kMaxVarint64Bytes = 10;
+
+}  // namespace
+
+Decoder::Decoder(const void* data, int size)
+  : data_(static_cast<const uint8*>(data)),
+    size_(size),
+    position_(0),
+    limit_(kint32max),
+    group_depth_(0),
+    error_(ERROR_NONE) {
+}
+
+Decoder::~Decoder() {}
+
+uint32 Decoder::ReadTag() {
+  if (IsAtEnd()) return 0;
+
+  uint32 tag = ReadVarint32();
+
+  if (WireFormatLite::GetTagFieldNumber(tag) == 0) {
+    SetError(ERROR_INVALID_TAG);
+    return 0;
+  }
+
+  return tag;
+}
+
+uint32 Decoder::ReadVarint32() {
+  uint32 result = 0;
+
+  for (int i = 0; i < kMaxVarint32Bytes; i++) {
+    if (position_ >= size_) {
+      SetError(ERROR_TRUNCATED);
+      return 0;
+    }
+
+    uint8 b = data_[position_++];
+    result |= static_cast<uint32>(b & 0x7F) << (7 * i);
+
+    if (b < 0x80) return result;
+  }
+
+  return SkipVarint64Tail(result);
+}
+
+uint32 Decoder::SkipVarint64Tail(uint32 result) {
+  for (int i = kMaxVarint32Bytes; i < kMaxVarint64Bytes; i++) {
+    if (position_ >= size_) {
+      SetError(ERROR_TRUNCATED);
+      return 0;
+    }
+
+    if (data_[position_++] < 0x80) return result;
+  }
+
+  SetError(ERROR_MALFORMED_VARINT);
+  return 0;
+}
+
+uint32 Decoder::ReadLittleEndian32() {
+  if (!CheckAvailable(4)) return 0;
+
+  const uint8* p = data_ + position_;
+  position_ += 4;
+
+  return static_cast<uint32>(p[0]) |
+         (static_cast<uint32>(p[1]) << 8) |
+         (static_cast<uint32>(p[2]) << 16) |
+         (static_cast<uint32>(p[3]) << 24);
+}
+
+uint64 Decoder::ReadVarint64() {
+  uint64 result = 0;
+
+  for (int i = 0; i < kMaxVarint64Bytes; i++) {
+    if (position_ >= size_) {
+      SetError(ERROR_TRUNCATED);
+      return 0;
+    }
+
+    uint8 b = data_[position_++];
+    result |= static_cast<uint64>(b & 0x7F) << (7 * i);
+
+    if (b < 0x80) return result;
+  }
+
+  SetError(ERROR_MALFORMED_VARINT);
+  return 0;
+}
+
+uint64 Decoder::ReadLittleEndian64() {
+  if (!CheckAvailable(8)) return 0;
+
+  uint64 low = ReadLittleEndian32();
+  uint64 high = ReadLittleEndian32();
+
+  return low | (high << 32);
+}
+
+bool Decoder::ReadString(string* value) {
+  uint32 size = ReadVarint32();
+
+  if (error_ != ERROR_NONE || !CheckAvailable(size)) return false;
+
+  value->assign(reinterpret_cast<const char*>(data_ + position_), size);
+  position_ += size;
+
+  return true;
+}
+
+bool Decoder::SkipField(uint32 tag) {
+  switch (WireFormatLite::GetTagWireType(tag)) {
+    case WireFormatLite::WIRETYPE_VARINT:
+      for (int i = 0; i < kMaxVarint64Bytes; i++) {
+        if (!CheckAvailable(1)) return false;
+        if (data_[position_++] < 0x80) return true;
+      }
+      SetError(ERROR_MALFORMED_VARINT);
+      return false;
+
+    case WireFormatLite::WIRETYPE_FIXED64:
+      if (!CheckAvailable(8)) return false;
+      position_ += 8;
+      return true;
+
+    case WireFormatLite::WIRETYPE_LENGTH_DELIMITED: {
+      uint32 size = ReadVarint32();
+      if (error_ != ERROR_NONE || !CheckAvailable(size)) return false;
+      position_ += size;
+      return true;
+    }
+
+    case WireFormatLite::WIRETYPE_START_GROUP:
+      return SkipGroup(WireFormatLite::GetTagFieldNumber(tag));
+
+    case WireFormatLite::WIRETYPE_FIXED32:
+      if (!CheckAvailable(4)) return false;
+      position_ += 4;
+      return true;
+
+    default:
+      SetError(ERROR_INVALID_TAG);
+      return false;
+  }
+}
+
+bool Decoder::ReadUnknownField(uint32 tag, string* unknown_fields) {
+  int start = position_;
+
+  if (!SkipField(tag)) return false;
+
+  while (tag >= 0x80) {
+    unknown_fields->push_back(static_cast<char>((tag & 0x7F) | 0x80));
+    tag >>= 7;
+  }
+  unknown_fields->push_back(static_cast<char>(tag));
+
+  unknown_fields->append(reinterpret_cast<const char*>(data_ + start),
+                         position_ - start);
+  return true;
+}
+
+bool Decoder::SkipGroup(uint32 field_number) {
+  if (group_depth_ >= kMaxGroupDepth) {
+    SetError(ERROR_TOO_DEEP);
+    return false;
+  }
+
+  group_depth_++;
+
+  for (uint32 tag = ReadTag(); tag > 0; tag = ReadTag()) {
+    if (WireFormatLite::GetTagWireType(tag) ==
+        WireFormatLite::WIRETYPE_END_GROUP) {
+      if (WireFormatLite::GetTagFieldNumber(tag) ==
+          static_cast<int>(field_number)) {
+        group_depth_--;
+        return true;
+      }
+      break;
+    }
+
+    if (!SkipField(tag)) break;
+  }
+
+  // Unterminated group or mismatched end group tag.
+  group_depth_--;
+  SetError(ERROR_INVALID_TAG);
+  return false;
+}
+
+bool Decoder::SkipMessage() {
+  for (uint32 tag = ReadTag(); tag > 0; tag = ReadTag()) {
+    if (!SkipField(tag)) break;
+  }
+
+  return error_ == ERROR_NONE;
+}
+
+int Decoder::PushLimit(int byte_limit) {
+  int old_limit = limit_;
+
+  if (byte_limit < 0 || byte_limit > min(size_, limit_) - position_) {
+    SetError(ERROR_TRUNCATED);
+    byte_limit = 0;
+  }
+
+  limit_ = position_ + byte_limit;
+
+  return old_limit;
+}
+
+void Decoder::PopLimit(int old_limit) {
+  if (position_ > limit_) {
+    SetError(ERROR_TRUNCATED);
+  }
+
+  limit_ = old_limit;
+}
+
+bool Decoder::CheckAvailable(uint32 count) {
+  if (count <= static_cast<uint32>(size_ - position_)) return true;
+
+  SetError(ERROR_TRUNCATED);
+  position_ = size_;
+  return false;
+}
+
+void Decoder::SetError(Error error) {
+  if (error_ == ERROR_NONE) {
+    error_ = error;
+  }
+}
+
+}  // namespace us
+}  // namespace protobuf
+}  // namespace google
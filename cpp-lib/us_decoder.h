@@ -0,0 +1,138 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// A reference implementation of the decoding rules of the UnrealScript
+// CodedInputStream class.  Servers can run it over a frame body to reject
+// anything a client would reject before spending time on a full parse, and
+// it is small enough to fuzz.
+//
+// Like CodedInputStream, Decoder never fails loudly: the first malformed
+// input sets error(), after which IsAtEnd() returns true and ReadTag()
+// returns 0, so every decoding loop stops at the next field and a corrupt
+// frame costs no more than the bytes read up to the corruption.
+
+#ifndef GOOGLE_PROTOBUF_US_DECODER_H__
+#define GOOGLE_PROTOBUF_US_DECODER_H__
+
+#include <string>
+#include <google/protobuf/stubs/common.h>
+
+namespace google {
+namespace protobuf {
+namespace us {
+
+class Decoder {
+ public:
+  // Same values as the ERROR_ constants of CodedInputStream.uc.
+  enum Error {
+    ERROR_NONE = 0,
+    ERROR_MALFORMED_VARINT = 1,  // A varint is longer than 10 bytes.
+    ERROR_TRUNCATED = 2,         // A value or length runs past the end.
+    ERROR_INVALID_TAG = 3,       // Field number 0, bad wire type or group.
+    ERROR_TOO_DEEP = 4,          // Groups are nested too deeply.
+  };
+
+  // Groups nested deeper than this are rejected, as in SkipGroup.
+  static const int kMaxGroupDepth = 64;
+
+  // Decodes the given buffer, which must outlive the decoder.
+  Decoder(const void* data, int size);
+  ~Decoder();
+
+  // Returns 0 at the end of the buffer or current limit, or once an error
+  // has been set.
+  uint32 ReadTag();
+
+  // Returns 0 and sets an error on truncated or malformed input.  Values
+  // sign extended to 10 bytes are truncated to 32 bits.
+  uint32 ReadVarint32();
+  uint32 ReadLittleEndian32();
+  uint64 ReadVarint64();
+  uint64 ReadLittleEndian64();
+
+  // Reads a length delimited value.  Returns false if it is truncated.
+  bool ReadString(string* value);
+
+  // Skips the value of a field whose tag has just been read.  Returns false
+  // if an error has been set.
+  bool SkipField(uint32 tag);
+
+  // Skips the value of a field whose tag has just been read and appends
+  // the field, tag included, to *unknown_fields, as ReadUnknownField does.
+  // Returns false if an error has been set.
+  bool ReadUnknownField(uint32 tag, string* unknown_fields);
+
+  // Skips every field up to the end of the buffer or current limit.  This
+  // checks a message body the way any generated Deserialize would, without
+  // knowing its type.  Returns false if an error has been set.
+  bool SkipMessage();
+
+  // Limits reading to the next byte_limit bytes and returns the previous
+  // limit, to be passed to PopLimit().  Sets ERROR_TRUNCATED if the limit
+  // lies past the end of the buffer or of the current limit.
+  int PushLimit(int byte_limit);
+  void PopLimit(int old_limit);
+
+  bool IsAtEnd() const {
+    return position_ >= size_ || position_ >= limit_ || error_ != ERROR_NONE;
+  }
+
+  Error error() const { return error_; }
+  int position() const { return position_; }
+
+ private:
+  // Returns true if count more bytes can be read, otherwise sets
+  // ERROR_TRUNCATED and moves to the end of the buffer.
+  bool CheckAvailable(uint32 count);
+
+  // Skips the fields of a group up to and including its end group tag.
+  bool SkipGroup(uint32 field_number);
+
+  // Skips the 5 bytes past the first 5 of a sign extended varint.
+  uint32 SkipVarint64Tail(uint32 result);
+
+  // Sets error_ unless an earlier error is already set.
+  void SetError(Error error);
+
+  const uint8* data_;
+  int size_;
+  int position_;
+  int limit_;
+  int group_depth_;
+  Error error_;
+
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Decoder);
+};
+
+}  // namespace us
+}  // namespace protobuf
+
+}  // namespace google
+#endif  // GOOGLE_PROTOBUF_US_DECODER_H__
@@ -0,0 +1,151 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// The encoding rules of the UnrealScript CodedOutputStream class, for the
+// structs generated with the cpp_structs option.  Encoder writes into a
+// buffer the caller has sized from GetSerializedSize(), so it does no
+// bounds checks or allocation of its own.  Everything is inline, so that
+// the generated codecs compile down to plain stores.
+//
+// Like CodedOutputStream, Encoder writes negative int32 values as 5 byte
+// varints rather than sign extending them to 10 bytes.
+
+#ifndef GOOGLE_PROTOBUF_US_ENCODER_H__
+#define GOOGLE_PROTOBUF_US_ENCODER_H__
+
+#include <math.h>
+#include <string.h>
+#include <google/protobuf/stubs/common.h>
+
+namespace google {
+namespace protobuf {
+namespace us {
+
+class Encoder {
+ public:
+  // Encodes into the given buffer, which must be large enough for
+  // everything written.
+  explicit Encoder(void* data) : data_(static_cast<uint8*>(data)),
+                                 position_(0) {}
+  ~Encoder() {}
+
+  void WriteVarint32(uint32 value) {
+    while (value >= 0x80) {
+      data_[position_++] = static_cast<uint8>(value | 0x80);
+      value >>= 7;
+    }
+    data_[position_++] = static_cast<uint8>(value);
+  }
+
+  void WriteVarint64(uint64 value) {
+    while (value >= 0x80) {
+      data_[position_++] = static_cast<uint8>(value | 0x80);
+      value >>= 7;
+    }
+    data_[position_++] = static_cast<uint8>(value);
+  }
+
+  void WriteLittleEndian32(uint32 value) {
+    data_[position_++] = static_cast<uint8>(value);
+    data_[position_++] = static_cast<uint8>(value >> 8);
+    data_[position_++] = static_cast<uint8>(value >> 16);
+    data_[position_++] = static_cast<uint8>(value >> 24);
+  }
+
+  void WriteLittleEndian64(uint64 value) {
+    WriteLittleEndian32(static_cast<uint32>(value));
+    WriteLittleEndian32(static_cast<uint32>(value >> 32));
+  }
+
+  void WriteRaw(const void* data, int size) {
+    memcpy(data_ + position_, data, size);
+    position_ += size;
+  }
+
+  // Writes a length delimited value.
+  void WriteString(const string& value) {
+    WriteVarint32(value.size());
+    WriteRaw(value.data(), value.size());
+  }
+
+  static int VarintSize32(uint32 value) {
+    if (value < (1u << 7)) return 1;
+    if (value < (1u << 14)) return 2;
+    if (value < (1u << 21)) return 3;
+    if (value < (1u << 28)) return 4;
+    return 5;
+  }
+
+  static int VarintSize64(uint64 value) {
+    int size = 1;
+    while (value >= 0x80) {
+      value >>= 7;
+      size++;
+    }
+    return size;
+  }
+
+  static int StringSize(const string& value) {
+    return VarintSize32(value.size()) + value.size();
+  }
+
+  // Number of bytes written so far.
+  int position() const { return position_; }
+
+ private:
+  uint8* data_;
+  int position_;
+
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Encoder);
+};
+
+// Fixed-point encoding of fields with the quantize options, the same as
+// QuantizeFloat and DequantizeFloat in CodedUtil.uc.  The arithmetic is
+// done in single precision, like UnrealScript's.
+inline uint32 QuantizeFloat(float value, float min, float max,
+                            float precision) {
+  if (value < min) value = min;
+  if (value > max) value = max;
+  return static_cast<uint32>(floorf((value - min) / precision + 0.5f));
+}
+
+inline float DequantizeFloat(uint32 value, float min, float max,
+                             float precision) {
+  float result = min + static_cast<float>(value) * precision;
+  if (result < min) return min;
+  if (result > max) return max;
+  return result;
+}
+
+}  // namespace us
+}  // namespace protobuf
+
+}  // namespace google
+#endif  // GOOGLE_PROTOBUF_US_ENCODER_H__
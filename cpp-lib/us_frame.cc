@@ -0,0 +1,337 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <errno.h>
+#include <limits.h>
+#include <sys/uio.h>
+
+#include <google/protobuf/us/us_frame.h>
+#include <google/protobuf/message_lite.h>
+
+namespace google {
+namespace protobuf {
+namespace us {
+
+namespace {
+
+// Number of iovecs handed to a single writev() call.  Well below IOV_MAX on
+// every platform we care about.
+const int kMaxIovecs = 64;
+
+// Reads a varint32 from a contiguous buffer.  Returns the number of bytes
+// read, or 0 if the buffer doesn't hold a complete, valid varint32.
+int ReadVarint32FromArray(const uint8* data, int size, uint32* value) {
+  uint32 result = 0;
+
+  for (int i = 0; i < size && i < kMaxVarint32Size; i++) {
+    result |= static_cast<uint32>(data[i] & 0x7F) << (7 * i);
+
+    if (data[i] < 0x80) {
+      *value = result;
+      return i + 1;
+    }
+  }
+
+  return 0;
+}
+
+// Returns the number of bytes needed to encode value as a varint32.
+int Varint32Size(uint32 value) {
+  int size = 1;
+
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+
+  return size;
+}
+
+}  // namespace
+
+// ===================================================================
+
+FrameParser::FrameParser(const void* data, int size)
+  : consumed_(0),
+    total_(size) {
+  Segment segment = { static_cast<const uint8*>(data), size };
+  segments_.push_back(segment);
+  cursor_.segment = 0;
+  cursor_.offset = 0;
+}
+
+FrameParser::FrameParser(const struct iovec* iov, int iovcnt)
+  : consumed_(0),
+    total_(0) {
+  for (int i = 0; i < iovcnt; i++) {
+    if (iov[i].iov_len == 0) continue;
+
+    Segment segment = { static_cast<const uint8*>(iov[i].iov_base),
+                        static_cast<int>(iov[i].iov_len) };
+    segments_.push_back(segment);
+    total_ += segment.size;
+  }
+  cursor_.segment = 0;
+  cursor_.offset = 0;
+}
+
+FrameParser::~FrameParser() {}
+
+FrameParser::Status FrameParser::Next(Frame* frame) {
+  Cursor cursor = cursor_;
+  uint32 length;
+  int header_size;
+
+  Status status = ReadVarint32(&cursor, &length, &header_size);
+  if (status != FRAME_OK) {
+    return status;
+  }
+
+  // Network.uc never sends frames without a type id, nor ones whose
+  // length doesn't fit an int.
+  if (length == 0 || length > static_cast<uint32>(kint32max)) {
+    return FRAME_MALFORMED;
+  }
+
+  int remaining = total_ - consumed_ - header_size;
+  if (static_cast<uint32>(remaining) < length) {
+    return FRAME_INCOMPLETE;
+  }
+
+  // Point at the frame in place if possible, otherwise gather it.
+  const uint8* data;
+  const Segment& segment = segments_[cursor.segment];
+
+  if (segment.size - cursor.offset >= static_cast<int>(length)) {
+    data = segment.data + cursor.offset;
+  } else {
+    scratch_.clear();
+    Cursor c = cursor;
+    int left = length;
+    while (left > 0) {
+      const Segment& s = segments_[c.segment];
+      int count = min(left, s.size - c.offset);
+      scratch_.append(reinterpret_cast<const char*>(s.data + c.offset), count);
+      Skip(&c, count);
+      left -= count;
+    }
+    data = reinterpret_cast<const uint8*>(scratch_.data());
+  }
+
+  int type_id_size = ReadVarint32FromArray(data, length, &frame->type_id);
+  if (type_id_size == 0) {
+    return FRAME_MALFORMED;
+  }
+
+  frame->body = data + type_id_size;
+  frame->body_size = length - type_id_size;
+
+  Skip(&cursor, length);
+  cursor_ = cursor;
+  consumed_ += header_size + length;
+
+  return FRAME_OK;
+}
+
+FrameParser::Status FrameParser::ReadVarint32(Cursor* cursor, uint32* value,
+                                              int* size) const {
+  uint32 result = 0;
+
+  for (int i = 0; i < kMaxVarint32Size; i++) {
+    if (cursor->segment >= static_cast<int>(segments_.size())) {
+      return FRAME_INCOMPLETE;
+    }
+
+    uint8 b = segments_[cursor->segment].data[cursor->offset];
+    Skip(cursor, 1);
+
+    result |= static_cast<uint32>(b & 0x7F) << (7 * i);
+
+    if (b < 0x80) {
+      *value = result;
+      *size = i + 1;
+      return FRAME_OK;
+    }
+  }
+
+  return FRAME_MALFORMED;
+}
+
+void FrameParser::Skip(Cursor* cursor, int count) const {
+  cursor->offset += count;
+
+  while (cursor->segment < static_cast<int>(segments_.size()) &&
+         cursor->offset >= segments_[cursor->segment].size) {
+    cursor->offset -= segments_[cursor->segment].size;
+    cursor->segment++;
+  }
+}
+
+// ===================================================================
+
+FrameWriter::FrameWriter()
+  : pending_bytes_(0),
+    next_chunk_(0),
+    chunk_offset_(0) {
+}
+
+FrameWriter::~FrameWriter() {}
+
+void FrameWriter::AddFrame(uint32 type_id, const void* body, int size) {
+  int offset = buffer_.size();
+
+  WriteVarint32(Varint32Size(type_id) + size);
+  WriteVarint32(type_id);
+  AddBufferChunk(offset);
+
+  if (size > 0) {
+    Chunk chunk = { static_cast<const uint8*>(body), 0, size };
+    chunks_.push_back(chunk);
+    pending_bytes_ += size;
+  }
+}
+
+bool FrameWriter::AddMessage(uint32 type_id, const MessageLite& message) {
+  size_t byte_size = message.ByteSizeLong();
+
+  // The frame length, which also counts the type id, must fit a varint32
+  // that Network.uc reads into an int.
+  if (byte_size > static_cast<size_t>(INT_MAX - Varint32Size(type_id))) {
+    return false;
+  }
+
+  int offset = buffer_.size();
+  int size = static_cast<int>(byte_size);
+
+  WriteVarint32(Varint32Size(type_id) + size);
+  WriteVarint32(type_id);
+
+  int body_offset = buffer_.size();
+  buffer_.resize(body_offset + size);
+  message.SerializeWithCachedSizesToArray(
+    reinterpret_cast<uint8*>(&buffer_[body_offset]));
+
+  AddBufferChunk(offset);
+  return true;
+}
+
+bool FrameWriter::Flush(int fd) {
+  struct iovec iov[kMaxIovecs];
+
+  while (next_chunk_ < static_cast<int>(chunks_.size())) {
+    int count = 0;
+
+    for (int i = next_chunk_;
+         i < static_cast<int>(chunks_.size()) && count < kMaxIovecs; i++) {
+      int skip = (i == next_chunk_) ? chunk_offset_ : 0;
+      iov[count].iov_base = const_cast<uint8*>(ChunkData(chunks_[i]) + skip);
+      iov[count].iov_len = chunks_[i].size - skip;
+      count++;
+    }
+
+    ssize_t written = writev(fd, iov, count);
+
+    if (written < 0) {
+      if (errno == EINTR) continue;
+      return false;
+    }
+
+    pending_bytes_ -= written;
+
+    while (written > 0) {
+      int left = chunks_[next_chunk_].size - chunk_offset_;
+
+      if (written >= left) {
+        written -= left;
+        next_chunk_++;
+        chunk_offset_ = 0;
+      } else {
+        chunk_offset_ += written;
+        written = 0;
+      }
+    }
+  }
+
+  Clear();
+  return true;
+}
+
+void FrameWriter::AppendTo(string* output) const {
+  for (int i = next_chunk_; i < static_cast<int>(chunks_.size()); i++) {
+    int skip = (i == next_chunk_) ? chunk_offset_ : 0;
+    output->append(reinterpret_cast<const char*>(ChunkData(chunks_[i]) + skip),
+                   chunks_[i].size - skip);
+  }
+}
+
+void FrameWriter::Clear() {
+  buffer_.clear();
+  chunks_.clear();
+  pending_bytes_ = 0;
+  next_chunk_ = 0;
+  chunk_offset_ = 0;
+}
+
+void FrameWriter::WriteVarint32(uint32 value) {
+  while (value >= 0x80) {
+    buffer_.push_back(static_cast<char>((value & 0x7F) | 0x80));
+    value >>= 7;
+  }
+  buffer_.push_back(static_cast<char>(value));
+}
+
+void FrameWriter::AddBufferChunk(int offset) {
+  int size = buffer_.size() - offset;
+
+  pending_bytes_ += size;
+
+  if (!chunks_.empty()) {
+    Chunk& last = chunks_.back();
+
+    if (last.data == NULL && last.offset + last.size == offset) {
+      last.size += size;
+      return;
+    }
+  }
+
+  Chunk chunk = { NULL, offset, size };
+  chunks_.push_back(chunk);
+}
+
+const uint8* FrameWriter::ChunkData(const Chunk& chunk) const {
+  if (chunk.data != NULL) {
+    return chunk.data;
+  }
+  return reinterpret_cast<const uint8*>(buffer_.data()) + chunk.offset;
+}
+
+}  // namespace us
+}  // namespace protobuf
+}  // namespace google
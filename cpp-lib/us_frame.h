@@ -0,0 +1,194 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Reading and writing the frames exchanged with the UnrealScript Network
+// class.  Every frame is laid out as
+//
+//   varint32 length | varint32 type id | message body
+//
+// where the length counts the type id and the body, and the type id is the
+// one the UnrealScript generator assigns to the message (see
+// MessageTypeId() in us_helpers.h).
+
+#ifndef GOOGLE_PROTOBUF_US_FRAME_H__
+#define GOOGLE_PROTOBUF_US_FRAME_H__
+
+#include <string>
+#include <vector>
+#include <google/protobuf/stubs/common.h>
+
+struct iovec;
+
+namespace google {
+namespace protobuf {
+  class MessageLite;           // message_lite.h
+
+namespace us {
+
+// Bytes needed for the largest varint32.  Network.uc rejects longer length
+// prefixes, and so does FrameParser.
+static const int kMaxVarint32Size = 5;
+
+// A frame returned by FrameParser.  The body points into the parsed buffer
+// (or, for frames split across iovecs, into the parser) and is only valid
+// as long as those are.
+struct Frame {
+  uint32 type_id;
+  const uint8* body;
+  int body_size;
+};
+
+// Splits received bytes into frames without copying them.  A parser is
+// meant to be created per receive: parse frames until Next() stops
+// returning FRAME_OK, then keep the bytes after consumed() for the next
+// receive.
+class FrameParser {
+ public:
+  enum Status {
+    FRAME_OK,           // A frame was returned.
+    FRAME_INCOMPLETE,   // More bytes are needed to complete the next frame.
+    FRAME_MALFORMED,    // The stream is corrupt and can't be resynchronized.
+  };
+
+  // Parses the given contiguous buffer.
+  FrameParser(const void* data, int size);
+
+  // Parses the given scatter list, e.g. the one filled in by readv().  Frames
+  // lying within a single iovec are returned without copying; frames split
+  // across iovecs are gathered into an internal buffer, which is overwritten
+  // by the next call to Next().
+  FrameParser(const struct iovec* iov, int iovcnt);
+
+  ~FrameParser();
+
+  // Parses the next frame.  On FRAME_OK, fills in *frame and advances past
+  // it; otherwise leaves the parser where it is.
+  Status Next(Frame* frame);
+
+  // Number of bytes making up the frames returned so far.
+  int consumed() const { return consumed_; }
+
+ private:
+  struct Segment {
+    const uint8* data;
+    int size;
+  };
+
+  // A position within segments_.
+  struct Cursor {
+    int segment;
+    int offset;
+  };
+
+  // Reads a varint32 starting at *cursor, which is advanced past it, and
+  // stores the number of bytes read in *size.
+  Status ReadVarint32(Cursor* cursor, uint32* value, int* size) const;
+
+  // Advances *cursor by count bytes, which must be available.
+  void Skip(Cursor* cursor, int count) const;
+
+  vector<Segment> segments_;
+  Cursor cursor_;
+  int consumed_;
+  int total_;
+
+  // Holds frames split across segments.
+  string scratch_;
+
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(FrameParser);
+};
+
+// Queues frames and writes them out together, so that all messages sent
+// during a tick cost a single writev() instead of one write per message.
+class FrameWriter {
+ public:
+  FrameWriter();
+  ~FrameWriter();
+
+  // Queues a frame around an already encoded body.  The body is not copied
+  // and must remain valid until the frame has been flushed or cleared.
+  void AddFrame(uint32 type_id, const void* body, int size);
+
+  // Queues a frame holding the given message, which is serialized into the
+  // writer's own buffer.  Returns false, queuing nothing, if the frame would
+  // be longer than INT_MAX bytes.
+  bool AddMessage(uint32 type_id, const MessageLite& message);
+
+  // Writes the queued frames to fd, resuming after partial writes.  Returns
+  // true once everything has been written, in which case the writer is
+  // cleared.  Returns false with errno set if writev() fails; the frames
+  // not yet written stay queued (e.g. to retry after EAGAIN).
+  bool Flush(int fd);
+
+  // Appends the queued frames to *output, for transports that don't write
+  // to file descriptors.  Doesn't clear the writer.
+  void AppendTo(string* output) const;
+
+  // Drops all queued frames.
+  void Clear();
+
+  // Number of queued bytes not yet written.
+  int pending_bytes() const { return pending_bytes_; }
+
+ private:
+  // A contiguous run of queued bytes.  Runs with a null data pointer lie in
+  // buffer_ at the given offset; buffer_ may move while frames are added,
+  // so they are only resolved to pointers when flushing.
+  struct Chunk {
+    const uint8* data;
+    int offset;
+    int size;
+  };
+
+  // Appends a varint32 to buffer_.
+  void WriteVarint32(uint32 value);
+
+  // Queues buffer_ bytes from offset to the end of buffer_, merging them
+  // with the previous chunk if that ends at offset.
+  void AddBufferChunk(int offset);
+
+  const uint8* ChunkData(const Chunk& chunk) const;
+
+  string buffer_;
+  vector<Chunk> chunks_;
+  int pending_bytes_;
+
+  // Progress of a partially completed Flush().
+  int next_chunk_;
+  int chunk_offset_;
+
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(FrameWriter);
+};
+
+}  // namespace us
+}  // namespace protobuf
+
+}  // namespace google
+#endif  // GOOGLE_PROTOBUF_US_FRAME_H__
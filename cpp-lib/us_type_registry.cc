@@ -0,0 +1,97 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <google/protobuf/us/us_type_registry.h>
+#include <google/protobuf/us/us_frame.h>
+#include <google/protobuf/message_lite.h>
+
+namespace google {
+namespace protobuf {
+namespace us {
+
+TypeRegistry::TypeRegistry() {}
+TypeRegistry::~TypeRegistry() {}
+
+bool TypeRegistry::Register(uint32 type_id, const MessageLite* prototype) {
+  string type_name = prototype->GetTypeName();
+
+  if (prototypes_.count(type_id) > 0 || type_ids_.count(type_name) > 0) {
+    return false;
+  }
+
+  prototypes_[type_id] = prototype;
+  type_ids_[type_name] = type_id;
+  return true;
+}
+
+const MessageLite* TypeRegistry::FindPrototype(uint32 type_id) const {
+  map<uint32, const MessageLite*>::const_iterator iter =
+    prototypes_.find(type_id);
+
+  if (iter == prototypes_.end()) {
+    return NULL;
+  }
+  return iter->second;
+}
+
+bool TypeRegistry::FindTypeId(const MessageLite& message,
+                              uint32* type_id) const {
+  map<string, uint32>::const_iterator iter =
+    type_ids_.find(message.GetTypeName());
+
+  if (iter == type_ids_.end()) {
+    return false;
+  }
+  *type_id = iter->second;
+  return true;
+}
+
+MessageLite* TypeRegistry::ParseFrame(const Frame& frame) const {
+  const MessageLite* prototype = FindPrototype(frame.type_id);
+
+  if (prototype == NULL) {
+    return NULL;
+  }
+
+  MessageLite* message = prototype->New();
+
+  // Messages sent by Network.uc may leave required fields unset, so don't
+  // insist on them being initialized.
+  if (!message->ParsePartialFromArray(frame.body, frame.body_size)) {
+    delete message;
+    return NULL;
+  }
+
+  return message;
+}
+
+}  // namespace us
+}  // namespace protobuf
+}  // namespace google
@@ -0,0 +1,84 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Maps the type ids carried in frame headers to message types, the C++
+// counterpart of the generated UnrealScript registry classes.  The
+// protocol buffer compiler generates a function registering every message
+// of a .proto file when passed the cpp_registry option.
+
+#ifndef GOOGLE_PROTOBUF_US_TYPE_REGISTRY_H__
+#define GOOGLE_PROTOBUF_US_TYPE_REGISTRY_H__
+
+#include <map>
+#include <string>
+#include <google/protobuf/stubs/common.h>
+
+namespace google {
+namespace protobuf {
+  class MessageLite;           // message_lite.h
+
+namespace us {
+
+struct Frame;                  // us_frame.h
+
+class TypeRegistry {
+ public:
+  TypeRegistry();
+  ~TypeRegistry();
+
+  // Registers the message type of prototype, usually its default instance,
+  // under the given type id.  Returns false if either the id or the type is
+  // already registered.
+  bool Register(uint32 type_id, const MessageLite* prototype);
+
+  // Returns the prototype registered under type_id, or NULL.
+  const MessageLite* FindPrototype(uint32 type_id) const;
+
+  // Looks up the type id of the message's type.  Returns false if the type
+  // isn't registered.
+  bool FindTypeId(const MessageLite& message, uint32* type_id) const;
+
+  // Parses the body of the frame into a new message of the registered type.
+  // Returns NULL if the type id is unknown or the body fails to parse.  The
+  // caller takes ownership of the result.
+  MessageLite* ParseFrame(const Frame& frame) const;
+
+ private:
+  map<uint32, const MessageLite*> prototypes_;
+  map<string, uint32> type_ids_;
+
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(TypeRegistry);
+};
+
+}  // namespace us
+}  // namespace protobuf
+
+}  // namespace google
+#endif  // GOOGLE_PROTOBUF_US_TYPE_REGISTRY_H__
@@ -0,0 +1,9 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+// Values of the enum laststand.Player.State.
+class EnumPlayer_State extends Object
+    abstract;
+
+const IDLE = 0;
+const MOVING = 1;
+const DEAD = 7;
@@ -0,0 +1,9 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+// Values of the enum laststand.Team.
+class EnumTeam extends Object
+    abstract;
+
+const RED = 0;
+const BLUE = 1;
+const SPECTATOR = -1;
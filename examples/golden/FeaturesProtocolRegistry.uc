@@ -0,0 +1,18 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+class FeaturesProtocolRegistry extends MessageRegistry;
+
+static function class<Message> GetMessageClass(int typeId)
+{
+    switch (typeId)
+    {
+        case 2092787:
+            return class'MessagePlayer';
+        case 2053582:
+            return class'MessagePlayer_Stats';
+        case 1530660:
+            return class'MessageNode';
+    }
+
+    return none;
+}
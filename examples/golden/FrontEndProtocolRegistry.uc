@@ -0,0 +1,20 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+class FrontEndProtocolRegistry extends MessageRegistry;
+
+static function class<Message> GetMessageClass(int typeId)
+{
+    switch (typeId)
+    {
+        case 916040:
+            return class'MessageTest';
+        case 869825:
+            return class'MessageEmbed';
+        case 1365344:
+            return class'MessageLogin';
+        case 1838772:
+            return class'MessageError';
+    }
+
+    return none;
+}
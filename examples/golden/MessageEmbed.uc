@@ -0,0 +1,81 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+class MessageEmbed extends Message;
+
+// Class constants
+const TYPE_ID = 869825;
+
+const TITLE_FIELD_NUMBER = 1;
+
+const TITLE_TAG = 10;
+
+// Class variables
+var string title;
+var array<byte> _unknownFields;
+
+// Class functions
+function Serialize(CodedOutputStream stream)
+{
+    stream.Reserve(GetSerializedSize());
+    SerializeWithCachedSizes(stream);
+}
+
+function SerializeWithCachedSizes(CodedOutputStream stream)
+{
+    stream.WriteString(TITLE_FIELD_NUMBER, title);
+    stream.WriteRawBytes(_unknownFields);
+}
+
+function Deserialize(CodedInputStream stream)
+{
+    local int tag;
+
+    tag = stream.ReadTag();
+
+    while (tag > 0)
+    {
+        switch (tag)
+        {
+            case TITLE_TAG:
+                title = stream.ReadString();
+                break;
+            default:
+                // Unknown field or unexpected wire type.  Skip it so that newer
+                // senders can add fields, and stop if it can't be skipped.  Any
+                // other error makes the next ReadTag return 0.
+                if (!stream.ReadUnknownField(tag, _unknownFields))
+                {
+                    return;
+                }
+                break;
+        }
+
+        tag = stream.ReadTag();
+    }
+}
+
+function int GetSerializedSize()
+{
+    local int _size;
+    _size = 0;
+
+    _size += class'CodedUtil'.static.ComputeStringSize(TITLE_FIELD_NUMBER, title);
+    _size += _unknownFields.Length;
+
+    cachedSize = _size;
+    return _size;
+}
+
+function Clear(optional MessagePool pool)
+{
+    title = "";
+    _unknownFields.Length = 0;
+
+    super.Clear(pool);
+}
+
+defaultproperties
+{
+    id = "Embed";
+    typeId = 869825;
+}
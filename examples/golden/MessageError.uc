@@ -0,0 +1,90 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+class MessageError extends Message;
+
+// Class constants
+const TYPE_ID = 1838772;
+
+const CODE_FIELD_NUMBER = 1;
+const MESSAGE_FIELD_NUMBER = 2;
+
+const CODE_TAG = 8;
+const MESSAGE_TAG = 18;
+
+// Class variables
+var int code;
+var string message;
+var array<byte> _unknownFields;
+
+// Class functions
+function Serialize(CodedOutputStream stream)
+{
+    stream.Reserve(GetSerializedSize());
+    SerializeWithCachedSizes(stream);
+}
+
+function SerializeWithCachedSizes(CodedOutputStream stream)
+{
+    stream.WriteInt32(CODE_FIELD_NUMBER, code);
+    stream.WriteString(MESSAGE_FIELD_NUMBER, message);
+    stream.WriteRawBytes(_unknownFields);
+}
+
+function Deserialize(CodedInputStream stream)
+{
+    local int tag;
+
+    tag = stream.ReadTag();
+
+    while (tag > 0)
+    {
+        switch (tag)
+        {
+            case CODE_TAG:
+                code = stream.ReadInt32();
+                break;
+            case MESSAGE_TAG:
+                message = stream.ReadString();
+                break;
+            default:
+                // Unknown field or unexpected wire type.  Skip it so that newer
+                // senders can add fields, and stop if it can't be skipped.  Any
+                // other error makes the next ReadTag return 0.
+                if (!stream.ReadUnknownField(tag, _unknownFields))
+                {
+                    return;
+                }
+                break;
+        }
+
+        tag = stream.ReadTag();
+    }
+}
+
+function int GetSerializedSize()
+{
+    local int _size;
+    _size = 0;
+
+    _size += class'CodedUtil'.static.ComputeInt32Size(CODE_FIELD_NUMBER, code);
+    _size += class'CodedUtil'.static.ComputeStringSize(MESSAGE_FIELD_NUMBER, message);
+    _size += _unknownFields.Length;
+
+    cachedSize = _size;
+    return _size;
+}
+
+function Clear(optional MessagePool pool)
+{
+    code = 0;
+    message = "";
+    _unknownFields.Length = 0;
+
+    super.Clear(pool);
+}
+
+defaultproperties
+{
+    id = "Error";
+    typeId = 1838772;
+}
@@ -0,0 +1,90 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+class MessageLogin extends Message;
+
+// Class constants
+const TYPE_ID = 1365344;
+
+const USERNAME_FIELD_NUMBER = 1;
+const PASSWORD_FIELD_NUMBER = 2;
+
+const USERNAME_TAG = 10;
+const PASSWORD_TAG = 18;
+
+// Class variables
+var string username;
+var string password;
+var array<byte> _unknownFields;
+
+// Class functions
+function Serialize(CodedOutputStream stream)
+{
+    stream.Reserve(GetSerializedSize());
+    SerializeWithCachedSizes(stream);
+}
+
+function SerializeWithCachedSizes(CodedOutputStream stream)
+{
+    stream.WriteString(USERNAME_FIELD_NUMBER, username);
+    stream.WriteString(PASSWORD_FIELD_NUMBER, password);
+    stream.WriteRawBytes(_unknownFields);
+}
+
+function Deserialize(CodedInputStream stream)
+{
+    local int tag;
+
+    tag = stream.ReadTag();
+
+    while (tag > 0)
+    {
+        switch (tag)
+        {
+            case USERNAME_TAG:
+                username = stream.ReadString();
+                break;
+            case PASSWORD_TAG:
+                password = stream.ReadString();
+                break;
+            default:
+                // Unknown field or unexpected wire type.  Skip it so that newer
+                // senders can add fields, and stop if it can't be skipped.  Any
+                // other error makes the next ReadTag return 0.
+                if (!stream.ReadUnknownField(tag, _unknownFields))
+                {
+                    return;
+                }
+                break;
+        }
+
+        tag = stream.ReadTag();
+    }
+}
+
+function int GetSerializedSize()
+{
+    local int _size;
+    _size = 0;
+
+    _size += class'CodedUtil'.static.ComputeStringSize(USERNAME_FIELD_NUMBER, username);
+    _size += class'CodedUtil'.static.ComputeStringSize(PASSWORD_FIELD_NUMBER, password);
+    _size += _unknownFields.Length;
+
+    cachedSize = _size;
+    return _size;
+}
+
+function Clear(optional MessagePool pool)
+{
+    username = "";
+    password = "";
+    _unknownFields.Length = 0;
+
+    super.Clear(pool);
+}
+
+defaultproperties
+{
+    id = "Login";
+    typeId = 1365344;
+}
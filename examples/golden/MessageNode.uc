@@ -0,0 +1,174 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+class MessageNode extends Message;
+
+// Class constants
+const TYPE_ID = 1530660;
+
+const VALUE_FIELD_NUMBER = 1;
+const PARENT_FIELD_NUMBER = 2;
+const CHILDREN_FIELD_NUMBER = 3;
+const OWNER_FIELD_NUMBER = 4;
+
+const VALUE_TAG = 8;
+const PARENT_TAG = 18;
+const CHILDREN_TAG = 26;
+const OWNER_TAG = 34;
+
+// Class variables
+var int _value;
+var MessageNode parent;
+var array<MessageNode> children;
+var MessagePlayer owner;
+var array<byte> _unknownFields;
+
+// Class functions
+function Serialize(CodedOutputStream stream)
+{
+    stream.Reserve(GetSerializedSize());
+    SerializeWithCachedSizes(stream);
+}
+
+function SerializeWithCachedSizes(CodedOutputStream stream)
+{
+    local int idx;
+
+    stream.WriteInt32(VALUE_FIELD_NUMBER, _value);
+    if (parent != none)
+    {
+        stream.WriteTag(PARENT_FIELD_NUMBER, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+        stream.WriteRawVarint32(parent.GetCachedSize());
+        parent.SerializeWithCachedSizes(stream);
+    }
+
+    for (idx = 0; idx < children.Length; idx++)
+    {
+        if (children[idx] != none)
+        {
+            stream.WriteTag(CHILDREN_FIELD_NUMBER, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+            stream.WriteRawVarint32(children[idx].GetCachedSize());
+            children[idx].SerializeWithCachedSizes(stream);
+        }
+    }
+    if (owner != none)
+    {
+        stream.WriteTag(OWNER_FIELD_NUMBER, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+        stream.WriteRawVarint32(owner.GetCachedSize());
+        owner.SerializeWithCachedSizes(stream);
+    }
+    stream.WriteRawBytes(_unknownFields);
+}
+
+function Deserialize(CodedInputStream stream)
+{
+    local int tag;
+    local int limit;
+
+    tag = stream.ReadTag();
+
+    while (tag > 0)
+    {
+        switch (tag)
+        {
+            case VALUE_TAG:
+                _value = stream.ReadInt32();
+                break;
+            case PARENT_TAG:
+                limit = stream.PushLimit(stream.ReadRawVarint32());
+                if (parent == none)
+                {
+                    parent = MessageNode(stream.NewMessage(class'MessageNode'));
+                }
+                parent.Deserialize(stream);
+                stream.PopLimit(limit);
+                break;
+            case CHILDREN_TAG:
+                limit = stream.PushLimit(stream.ReadRawVarint32());
+                children.AddItem(MessageNode(stream.NewMessage(class'MessageNode')));
+                children[children.Length - 1].Deserialize(stream);
+                stream.PopLimit(limit);
+                break;
+            case OWNER_TAG:
+                limit = stream.PushLimit(stream.ReadRawVarint32());
+                if (owner == none)
+                {
+                    owner = MessagePlayer(stream.NewMessage(class'MessagePlayer'));
+                }
+                owner.Deserialize(stream);
+                stream.PopLimit(limit);
+                break;
+            default:
+                // Unknown field or unexpected wire type.  Skip it so that newer
+                // senders can add fields, and stop if it can't be skipped.  Any
+                // other error makes the next ReadTag return 0.
+                if (!stream.ReadUnknownField(tag, _unknownFields))
+                {
+                    return;
+                }
+                break;
+        }
+
+        tag = stream.ReadTag();
+    }
+}
+
+function int GetSerializedSize()
+{
+    local int _size;
+    local int idx;
+    _size = 0;
+
+    _size += class'CodedUtil'.static.ComputeInt32Size(VALUE_FIELD_NUMBER, _value);
+    _size += class'CodedUtil'.static.ComputeMessageSize(PARENT_FIELD_NUMBER, parent);
+
+    for (idx = 0; idx < children.Length; idx++)
+    {
+        _size += class'CodedUtil'.static.ComputeMessageSize(CHILDREN_FIELD_NUMBER, children[idx]);
+    }
+    _size += class'CodedUtil'.static.ComputeMessageSize(OWNER_FIELD_NUMBER, owner);
+    _size += _unknownFields.Length;
+
+    cachedSize = _size;
+    return _size;
+}
+
+function Clear(optional MessagePool pool)
+{
+    local int idx;
+
+    _value = 0;
+
+    if (pool != none)
+    {
+        pool.Release(parent);
+    }
+
+    parent = none;
+
+    if (pool != none)
+    {
+        for (idx = 0; idx < children.Length; idx++)
+        {
+            pool.Release(children[idx]);
+        }
+    }
+
+    children.Length = 0;
+
+    if (pool != none)
+    {
+        pool.Release(owner);
+    }
+
+    owner = none;
+
+    _unknownFields.Length = 0;
+
+    super.Clear(pool);
+}
+
+defaultproperties
+{
+    id = "Node";
+    typeId = 1530660;
+}
@@ -0,0 +1,268 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+class MessagePlayer extends Message;
+
+// Class constants
+const TYPE_ID = 2092787;
+
+const NAME_FIELD_NUMBER = 1;
+const STATE_FIELD_NUMBER = 2;
+const TEAM_FIELD_NUMBER = 3;
+const STATS_FIELD_NUMBER = 4;
+const ROUNDS_FIELD_NUMBER = 5;
+const SCORE_FIELD_NUMBER = 6;
+const BALANCE_FIELD_NUMBER = 7;
+const SESSION_FIELD_NUMBER = 8;
+const ACHIEVEMENTS_FIELD_NUMBER = 9;
+const PATH_FIELD_NUMBER = 10;
+const WEIGHTS_FIELD_NUMBER = 11;
+const X_FIELD_NUMBER = 12;
+const HEADINGS_FIELD_NUMBER = 13;
+
+const NAME_TAG = 10;
+const STATE_TAG = 16;
+const TEAM_TAG = 24;
+const STATS_TAG = 34;
+const ROUNDS_TAG = 42;
+const SCORE_TAG = 48;
+const BALANCE_TAG = 56;
+const SESSION_TAG = 65;
+const ACHIEVEMENTS_TAG = 72;
+const ACHIEVEMENTS_PACKED_TAG = 74;
+const PATH_TAG = 80;
+const PATH_PACKED_TAG = 82;
+const WEIGHTS_TAG = 93;
+const WEIGHTS_PACKED_TAG = 90;
+const X_TAG = 96;
+const HEADINGS_TAG = 104;
+
+const X_MIN = -500.0;
+const X_MAX = 500.0;
+const X_PRECISION = 0.01;
+const HEADINGS_MIN = 0.0;
+const HEADINGS_MAX = 360.0;
+const HEADINGS_PRECISION = 0.1;
+
+// Class variables
+var string _name;
+var int _state;
+var int team;
+var MessagePlayer_Stats stats;
+var array<MessagePlayer_Stats> rounds;
+var Int64 score;
+var Int64 balance;
+var Int64 session;
+var array<Int64> achievements;
+var array<int> path;
+var array<float> weights;
+var float x;
+var array<float> headings;
+var array<byte> _unknownFields;
+
+// Class functions
+function Serialize(CodedOutputStream stream)
+{
+    stream.Reserve(GetSerializedSize());
+    SerializeWithCachedSizes(stream);
+}
+
+function SerializeWithCachedSizes(CodedOutputStream stream)
+{
+    local int idx;
+
+    stream.WriteString(NAME_FIELD_NUMBER, _name);
+    stream.WriteInt32(STATE_FIELD_NUMBER, _state);
+    stream.WriteInt32(TEAM_FIELD_NUMBER, team);
+    if (stats != none)
+    {
+        stream.WriteTag(STATS_FIELD_NUMBER, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+        stream.WriteRawVarint32(stats.GetCachedSize());
+        stats.SerializeWithCachedSizes(stream);
+    }
+
+    for (idx = 0; idx < rounds.Length; idx++)
+    {
+        if (rounds[idx] != none)
+        {
+            stream.WriteTag(ROUNDS_FIELD_NUMBER, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+            stream.WriteRawVarint32(rounds[idx].GetCachedSize());
+            rounds[idx].SerializeWithCachedSizes(stream);
+        }
+    }
+    stream.WriteInt64(SCORE_FIELD_NUMBER, score);
+    stream.WriteSInt64(BALANCE_FIELD_NUMBER, balance);
+    stream.WriteFixed64(SESSION_FIELD_NUMBER, session);
+    stream.WritePackedUInt64(ACHIEVEMENTS_FIELD_NUMBER, achievements);
+    stream.WritePackedSInt32(PATH_FIELD_NUMBER, path);
+    stream.WritePackedFloat(WEIGHTS_FIELD_NUMBER, weights);
+    stream.WriteUInt32(X_FIELD_NUMBER, class'CodedUtil'.static.QuantizeFloat(x, X_MIN, X_MAX, X_PRECISION));
+
+    for (idx = 0; idx < headings.Length; idx++)
+    {
+        stream.WriteUInt32(HEADINGS_FIELD_NUMBER, class'CodedUtil'.static.QuantizeFloat(headings[idx], HEADINGS_MIN, HEADINGS_MAX, HEADINGS_PRECISION));
+    }
+    stream.WriteRawBytes(_unknownFields);
+}
+
+function Deserialize(CodedInputStream stream)
+{
+    local int tag;
+    local int limit;
+
+    tag = stream.ReadTag();
+
+    while (tag > 0)
+    {
+        switch (tag)
+        {
+            case NAME_TAG:
+                _name = stream.ReadString();
+                break;
+            case STATE_TAG:
+                _state = stream.ReadInt32();
+                break;
+            case TEAM_TAG:
+                team = stream.ReadInt32();
+                break;
+            case STATS_TAG:
+                limit = stream.PushLimit(stream.ReadRawVarint32());
+                if (stats == none)
+                {
+                    stats = MessagePlayer_Stats(stream.NewMessage(class'MessagePlayer_Stats'));
+                }
+                stats.Deserialize(stream);
+                stream.PopLimit(limit);
+                break;
+            case ROUNDS_TAG:
+                limit = stream.PushLimit(stream.ReadRawVarint32());
+                rounds.AddItem(MessagePlayer_Stats(stream.NewMessage(class'MessagePlayer_Stats')));
+                rounds[rounds.Length - 1].Deserialize(stream);
+                stream.PopLimit(limit);
+                break;
+            case SCORE_TAG:
+                score = stream.ReadInt64();
+                break;
+            case BALANCE_TAG:
+                balance = stream.ReadSInt64();
+                break;
+            case SESSION_TAG:
+                session = stream.ReadFixed64();
+                break;
+            case ACHIEVEMENTS_TAG:
+                achievements.AddItem(stream.ReadUInt64());
+                break;
+            case ACHIEVEMENTS_PACKED_TAG:
+                stream.ReadPackedUInt64(achievements);
+                break;
+            case PATH_TAG:
+                path.AddItem(stream.ReadSInt32());
+                break;
+            case PATH_PACKED_TAG:
+                stream.ReadPackedSInt32(path);
+                break;
+            case WEIGHTS_TAG:
+                weights.AddItem(stream.ReadFloat());
+                break;
+            case WEIGHTS_PACKED_TAG:
+                stream.ReadPackedFloat(weights);
+                break;
+            case X_TAG:
+                x = class'CodedUtil'.static.DequantizeFloat(stream.ReadUInt32(), X_MIN, X_MAX, X_PRECISION);
+                break;
+            case HEADINGS_TAG:
+                headings.AddItem(class'CodedUtil'.static.DequantizeFloat(stream.ReadUInt32(), HEADINGS_MIN, HEADINGS_MAX, HEADINGS_PRECISION));
+                break;
+            default:
+                // Unknown field or unexpected wire type.  Skip it so that newer
+                // senders can add fields, and stop if it can't be skipped.  Any
+                // other error makes the next ReadTag return 0.
+                if (!stream.ReadUnknownField(tag, _unknownFields))
+                {
+                    return;
+                }
+                break;
+        }
+
+        tag = stream.ReadTag();
+    }
+}
+
+function int GetSerializedSize()
+{
+    local int _size;
+    local int idx;
+    _size = 0;
+
+    _size += class'CodedUtil'.static.ComputeStringSize(NAME_FIELD_NUMBER, _name);
+    _size += class'CodedUtil'.static.ComputeInt32Size(STATE_FIELD_NUMBER, _state);
+    _size += class'CodedUtil'.static.ComputeInt32Size(TEAM_FIELD_NUMBER, team);
+    _size += class'CodedUtil'.static.ComputeMessageSize(STATS_FIELD_NUMBER, stats);
+
+    for (idx = 0; idx < rounds.Length; idx++)
+    {
+        _size += class'CodedUtil'.static.ComputeMessageSize(ROUNDS_FIELD_NUMBER, rounds[idx]);
+    }
+    _size += class'CodedUtil'.static.ComputeInt64Size(SCORE_FIELD_NUMBER, score);
+    _size += class'CodedUtil'.static.ComputeSInt64Size(BALANCE_FIELD_NUMBER, balance);
+    _size += class'CodedUtil'.static.ComputeFixed64Size(SESSION_FIELD_NUMBER, session);
+    _size += class'CodedUtil'.static.ComputePackedUInt64Size(ACHIEVEMENTS_FIELD_NUMBER, achievements);
+    _size += class'CodedUtil'.static.ComputePackedSInt32Size(PATH_FIELD_NUMBER, path);
+    _size += class'CodedUtil'.static.ComputePackedFloatSize(WEIGHTS_FIELD_NUMBER, weights);
+    _size += class'CodedUtil'.static.ComputeUInt32Size(X_FIELD_NUMBER, class'CodedUtil'.static.QuantizeFloat(x, X_MIN, X_MAX, X_PRECISION));
+
+    for (idx = 0; idx < headings.Length; idx++)
+    {
+        _size += class'CodedUtil'.static.ComputeUInt32Size(HEADINGS_FIELD_NUMBER, class'CodedUtil'.static.QuantizeFloat(headings[idx], HEADINGS_MIN, HEADINGS_MAX, HEADINGS_PRECISION));
+    }
+    _size += _unknownFields.Length;
+
+    cachedSize = _size;
+    return _size;
+}
+
+function Clear(optional MessagePool pool)
+{
+    local int idx;
+
+    _name = "";
+    _state = 0;
+    team = 0;
+
+    if (pool != none)
+    {
+        pool.Release(stats);
+    }
+
+    stats = none;
+
+    if (pool != none)
+    {
+        for (idx = 0; idx < rounds.Length; idx++)
+        {
+            pool.Release(rounds[idx]);
+        }
+    }
+
+    rounds.Length = 0;
+
+    score.lo = 0;
+    score.hi = 0;
+    balance.lo = 0;
+    balance.hi = 0;
+    session.lo = 0;
+    session.hi = 0;
+    achievements.Length = 0;
+    path.Length = 0;
+    weights.Length = 0;
+    x = 0;
+    headings.Length = 0;
+    _unknownFields.Length = 0;
+
+    super.Clear(pool);
+}
+
+defaultproperties
+{
+    id = "Player";
+    typeId = 2092787;
+}
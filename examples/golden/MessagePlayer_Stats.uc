@@ -0,0 +1,94 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+class MessagePlayer_Stats extends Message;
+
+// Class constants
+const TYPE_ID = 2053582;
+
+const KILLS_FIELD_NUMBER = 1;
+const HISTORY_FIELD_NUMBER = 2;
+
+const KILLS_TAG = 8;
+const HISTORY_TAG = 16;
+const HISTORY_PACKED_TAG = 18;
+
+// Class variables
+var int kills;
+var array<int> history;
+var array<byte> _unknownFields;
+
+// Class functions
+function Serialize(CodedOutputStream stream)
+{
+    stream.Reserve(GetSerializedSize());
+    SerializeWithCachedSizes(stream);
+}
+
+function SerializeWithCachedSizes(CodedOutputStream stream)
+{
+    stream.WriteInt32(KILLS_FIELD_NUMBER, kills);
+    stream.WritePackedInt32(HISTORY_FIELD_NUMBER, history);
+    stream.WriteRawBytes(_unknownFields);
+}
+
+function Deserialize(CodedInputStream stream)
+{
+    local int tag;
+
+    tag = stream.ReadTag();
+
+    while (tag > 0)
+    {
+        switch (tag)
+        {
+            case KILLS_TAG:
+                kills = stream.ReadInt32();
+                break;
+            case HISTORY_TAG:
+                history.AddItem(stream.ReadInt32());
+                break;
+            case HISTORY_PACKED_TAG:
+                stream.ReadPackedInt32(history);
+                break;
+            default:
+                // Unknown field or unexpected wire type.  Skip it so that newer
+                // senders can add fields, and stop if it can't be skipped.  Any
+                // other error makes the next ReadTag return 0.
+                if (!stream.ReadUnknownField(tag, _unknownFields))
+                {
+                    return;
+                }
+                break;
+        }
+
+        tag = stream.ReadTag();
+    }
+}
+
+function int GetSerializedSize()
+{
+    local int _size;
+    _size = 0;
+
+    _size += class'CodedUtil'.static.ComputeInt32Size(KILLS_FIELD_NUMBER, kills);
+    _size += class'CodedUtil'.static.ComputePackedInt32Size(HISTORY_FIELD_NUMBER, history);
+    _size += _unknownFields.Length;
+
+    cachedSize = _size;
+    return _size;
+}
+
+function Clear(optional MessagePool pool)
+{
+    kills = 0;
+    history.Length = 0;
+    _unknownFields.Length = 0;
+
+    super.Clear(pool);
+}
+
+defaultproperties
+{
+    id = "Player_Stats";
+    typeId = 2053582;
+}
@@ -0,0 +1,185 @@
+// Generated by the protocol buffer compiler.  DO NOT EDIT!
+
+class MessageTest extends Message;
+
+// Class constants
+const TYPE_ID = 916040;
+
+const LEVEL_FIELD_NUMBER = 1;
+const USERNAME_FIELD_NUMBER = 2;
+const AGE_FIELD_NUMBER = 3;
+const YEAR_FIELD_NUMBER = 4;
+const RANGE_FIELD_NUMBER = 5;
+const SPEED_FIELD_NUMBER = 6;
+const BANNED_FIELD_NUMBER = 7;
+const VELOCITY_FIELD_NUMBER = 8;
+const EMBED_FIELD_NUMBER = 9;
+const IDENTIFIER_FIELD_NUMBER = 10;
+
+const LEVEL_TAG = 13;
+const USERNAME_TAG = 18;
+const AGE_TAG = 24;
+const YEAR_TAG = 32;
+const RANGE_TAG = 40;
+const SPEED_TAG = 53;
+const BANNED_TAG = 56;
+const VELOCITY_TAG = 69;
+const EMBED_TAG = 74;
+const IDENTIFIER_TAG = 80;
+const IDENTIFIER_PACKED_TAG = 82;
+
+// Class variables
+var int level;
+var string username;
+var int age;
+var int year;
+var int range;
+var int speed;
+var bool banned;
+var float velocity;
+var MessageEmbed embed;
+var array<int> identifier;
+var array<byte> _unknownFields;
+
+// Class functions
+function Serialize(CodedOutputStream stream)
+{
+    stream.Reserve(GetSerializedSize());
+    SerializeWithCachedSizes(stream);
+}
+
+function SerializeWithCachedSizes(CodedOutputStream stream)
+{
+    stream.WriteFixed32(LEVEL_FIELD_NUMBER, level);
+    stream.WriteString(USERNAME_FIELD_NUMBER, username);
+    stream.WriteInt32(AGE_FIELD_NUMBER, age);
+    stream.WriteUInt32(YEAR_FIELD_NUMBER, year);
+    stream.WriteSInt32(RANGE_FIELD_NUMBER, range);
+    stream.WriteSFixed32(SPEED_FIELD_NUMBER, speed);
+    stream.WriteBool(BANNED_FIELD_NUMBER, banned);
+    stream.WriteFloat(VELOCITY_FIELD_NUMBER, velocity);
+    if (embed != none)
+    {
+        stream.WriteTag(EMBED_FIELD_NUMBER, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+        stream.WriteRawVarint32(embed.GetCachedSize());
+        embed.SerializeWithCachedSizes(stream);
+    }
+    stream.WritePackedInt32(IDENTIFIER_FIELD_NUMBER, identifier);
+    stream.WriteRawBytes(_unknownFields);
+}
+
+function Deserialize(CodedInputStream stream)
+{
+    local int tag;
+    local int limit;
+
+    tag = stream.ReadTag();
+
+    while (tag > 0)
+    {
+        switch (tag)
+        {
+            case LEVEL_TAG:
+                level = stream.ReadFixed32();
+                break;
+            case USERNAME_TAG:
+                username = stream.ReadString();
+                break;
+            case AGE_TAG:
+                age = stream.ReadInt32();
+                break;
+            case YEAR_TAG:
+                year = stream.ReadUInt32();
+                break;
+            case RANGE_TAG:
+                range = stream.ReadSInt32();
+                break;
+            case SPEED_TAG:
+                speed = stream.ReadSFixed32();
+                break;
+            case BANNED_TAG:
+                banned = stream.ReadBool();
+                break;
+            case VELOCITY_TAG:
+                velocity = stream.ReadFloat();
+                break;
+            case EMBED_TAG:
+                limit = stream.PushLimit(stream.ReadRawVarint32());
+                if (embed == none)
+                {
+                    embed = MessageEmbed(stream.NewMessage(class'MessageEmbed'));
+                }
+                embed.Deserialize(stream);
+                stream.PopLimit(limit);
+                break;
+            case IDENTIFIER_TAG:
+                identifier.AddItem(stream.ReadInt32());
+                break;
+            case IDENTIFIER_PACKED_TAG:
+                stream.ReadPackedInt32(identifier);
+                break;
+            default:
+                // Unknown field or unexpected wire type.  Skip it so that newer
+                // senders can add fields, and stop if it can't be skipped.  Any
+                // other error makes the next ReadTag return 0.
+                if (!stream.ReadUnknownField(tag, _unknownFields))
+                {
+                    return;
+                }
+                break;
+        }
+
+        tag = stream.ReadTag();
+    }
+}
+
+function int GetSerializedSize()
+{
+    local int _size;
+    _size = 0;
+
+    _size += class'CodedUtil'.static.ComputeFixed32Size(LEVEL_FIELD_NUMBER, level);
+    _size += class'CodedUtil'.static.ComputeStringSize(USERNAME_FIELD_NUMBER, username);
+    _size += class'CodedUtil'.static.ComputeInt32Size(AGE_FIELD_NUMBER, age);
+    _size += class'CodedUtil'.static.ComputeUInt32Size(YEAR_FIELD_NUMBER, year);
+    _size += class'CodedUtil'.static.ComputeSInt32Size(RANGE_FIELD_NUMBER, range);
+    _size += class'CodedUtil'.static.ComputeSFixed32Size(SPEED_FIELD_NUMBER, speed);
+    _size += class'CodedUtil'.static.ComputeBoolSize(BANNED_FIELD_NUMBER, banned);
+    _size += class'CodedUtil'.static.ComputeFloatSize(VELOCITY_FIELD_NUMBER, velocity);
+    _size += class'CodedUtil'.static.ComputeMessageSize(EMBED_FIELD_NUMBER, embed);
+    _size += class'CodedUtil'.static.ComputePackedInt32Size(IDENTIFIER_FIELD_NUMBER, identifier);
+    _size += _unknownFields.Length;
+
+    cachedSize = _size;
+    return _size;
+}
+
+function Clear(optional MessagePool pool)
+{
+    level = 0;
+    username = "";
+    age = 0;
+    year = 0;
+    range = 0;
+    speed = 0;
+    banned = false;
+    velocity = 0;
+
+    if (pool != none)
+    {
+        pool.Release(embed);
+    }
+
+    embed = none;
+
+    identifier.Length = 0;
+    _unknownFields.Length = 0;
+
+    super.Clear(pool);
+}
+
+defaultproperties
+{
+    id = "Test";
+    typeId = 916040;
+}
@@ -0,0 +1,977 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Benchmarks the UnrealScript generator and the code it emits.
+//
+//   us_benchmark [--quick] [--json=<file>] [--baseline=<file>]
+//                [--tolerance=<percent>]
+//
+// Two things are measured on synthetic schemas:
+//
+// - The time UnrealScriptGenerator::Generate takes, from 10 to 10,000
+//   messages of 1 to 500 fields.
+//
+// - The cost of the emitted Serialize and Deserialize functions.  UDK
+//   can't run here, so the benchmark reads the generated classes and walks
+//   their statements over a sample message, charging every call into the
+//   us-lib runtime with the operations that function performs (calls,
+//   switch comparisons, dynamic array appends, byte and string operations).
+//   The weighted cost is reported per encoded byte.  Besides the current
+//   code, the same walk is repeated with single changes to the emitted code
+//   or the runtime, to show what each would save.
+//
+// Operation counts are deterministic, so --baseline compares them with an
+// earlier --json output and fails if any grew by more than the tolerance.
+// Timings are reported but never checked.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/compiler/us/us_generator.h>
+#include <google/protobuf/compiler/us/us_helpers.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/stubs/strutil.h>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace us {
+namespace {
+
+// ===================================================================
+// Synthetic schemas
+
+// Field types cycled through by the synthetic messages.
+struct FieldKind {
+  FieldDescriptorProto::Type type;
+  bool repeated;
+  bool packed;
+};
+
+const FieldKind kFieldKinds[] = {
+  { FieldDescriptorProto::TYPE_INT32,   false, false },
+  { FieldDescriptorProto::TYPE_STRING,  false, false },
+  { FieldDescriptorProto::TYPE_FIXED32, false, false },
+  { FieldDescriptorProto::TYPE_FLOAT,   false, false },
+  { FieldDescriptorProto::TYPE_BOOL,    false, false },
+  { FieldDescriptorProto::TYPE_SINT32,  false, false },
+  { FieldDescriptorProto::TYPE_UINT32,  false, false },
+  { FieldDescriptorProto::TYPE_INT64,   false, false },
+  { FieldDescriptorProto::TYPE_INT32,   true,  true  },
+  { FieldDescriptorProto::TYPE_STRING,  true,  false },
+};
+
+const int kFieldKindCount = sizeof(kFieldKinds) / sizeof(kFieldKinds[0]);
+
+// Builds a file of the given number of messages, each with the given
+// number of fields.
+const FileDescriptor* BuildSchema(DescriptorPool* pool, const string& name,
+                                  int messages, int fields) {
+  FileDescriptorProto file;
+  file.set_name(name);
+  file.set_package("bench");
+
+  for (int i = 0; i < messages; i++) {
+    DescriptorProto* message = file.add_message_type();
+    message->set_name("M" + SimpleItoa(i));
+
+    for (int j = 0; j < fields; j++) {
+      const FieldKind& kind = kFieldKinds[j % kFieldKindCount];
+      FieldDescriptorProto* field = message->add_field();
+
+      field->set_name("f" + SimpleItoa(j));
+      field->set_number(j + 1);
+      field->set_type(kind.type);
+      field->set_label(kind.repeated ? FieldDescriptorProto::LABEL_REPEATED :
+                                       FieldDescriptorProto::LABEL_OPTIONAL);
+      if (kind.packed) {
+        field->mutable_options()->set_packed(true);
+      }
+    }
+  }
+
+  return pool->BuildFile(file);
+}
+
+// Keeps the generated files in memory.
+class MemoryContext : public GeneratorContext {
+ public:
+  MemoryContext() {}
+  ~MemoryContext() {}
+
+  io::ZeroCopyOutputStream* Open(const string& filename) {
+    return new io::StringOutputStream(&files_[filename]);
+  }
+
+  const map<string, string>& files() const { return files_; }
+
+ private:
+  map<string, string> files_;
+};
+
+// Writes a type_ids file numbering the messages of a schema in order.
+// The hashed ids of 10,000 messages are bound to collide.
+string WriteTypeIds(const FileDescriptor* file) {
+  char filename[] = "/tmp/us_benchmark_type_ids.XXXXXX";
+  int fd = mkstemp(filename);
+  if (fd < 0) {
+    fprintf(stderr, "mkstemp: %s\n", strerror(errno));
+    exit(1);
+  }
+  close(fd);
+
+  ofstream output(filename);
+  for (int i = 0; i < file->message_type_count(); i++) {
+    output << file->message_type(i)->full_name() << " " << i + 1 << "\n";
+  }
+
+  return filename;
+}
+
+double Now() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec / 1e6;
+}
+
+struct GeneratorResult {
+  int messages;
+  int fields;
+  double seconds;        // Per run.
+  int64 output_bytes;
+};
+
+GeneratorResult BenchmarkGenerator(int messages, int fields) {
+  DescriptorPool pool;
+  const FileDescriptor* file = BuildSchema(
+    &pool, "bench_" + SimpleItoa(messages) + "x" + SimpleItoa(fields) +
+    ".proto", messages, fields);
+
+  string type_ids = WriteTypeIds(file);
+  string parameter = "type_ids=" + type_ids;
+
+  UnrealScriptGenerator generator;
+  GeneratorResult result;
+  result.messages = messages;
+  result.fields = fields;
+  result.output_bytes = 0;
+
+  // Repeat small schemas to get a measurable time.
+  int runs = 0;
+  double start = Now();
+  double elapsed = 0;
+
+  do {
+    MemoryContext context;
+    string error;
+    if (!generator.Generate(file, parameter, &context, &error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      exit(1);
+    }
+
+    if (runs == 0) {
+      for (map<string, string>::const_iterator it = context.files().begin();
+           it != context.files().end(); ++it) {
+        result.output_bytes += it->second.size();
+      }
+    }
+
+    runs++;
+    elapsed = Now() - start;
+  } while (elapsed < 0.2);
+
+  unlink(type_ids.c_str());
+
+  result.seconds = elapsed / runs;
+  return result;
+}
+
+// ===================================================================
+// Cost model of the generated code
+
+// Operations performed by UnrealScript code.  Function calls and dynamic
+// array appends are by far the most expensive in the UnrealScript VM.
+struct Ops {
+  Ops() : calls(0), compares(0), appends(0), byte_ops(0), string_ops(0) {}
+
+  int64 calls;       // Function calls, runtime and generated.
+  int64 compares;    // Switch cases tested while dispatching on a tag.
+  int64 appends;     // Growths of a dynamic array, e.g. AddItem.
+  int64 byte_ops;    // Reads and writes of array elements.
+  int64 string_ops;  // Mid, Asc, Chr and string concatenations.
+
+  // Weighted by a rough cost in VM instructions: a call pushes a frame and
+  // evaluates every parameter, an append may reallocate the array.
+  int64 cost() const {
+    return 4 * calls + compares + 2 * appends + byte_ops + string_ops;
+  }
+
+  void Add(const Ops& other) {
+    calls += other.calls;
+    compares += other.compares;
+    appends += other.appends;
+    byte_ops += other.byte_ops;
+    string_ops += other.string_ops;
+  }
+};
+
+// A change to the emitted code or the runtime whose effect is modeled.
+enum Variant {
+  VARIANT_CURRENT,         // The code as generated, on us-lib as it is.
+  VARIANT_TABLE_DISPATCH,  // Deserialize finds a field in one comparison.
+  VARIANT_INLINE_BYTES,    // No function call per byte written.
+};
+
+const char* const kVariantNames[] = {
+  "current", "table_dispatch", "inline_bytes",
+};
+
+const int kVariantCount = sizeof(kVariantNames) / sizeof(kVariantNames[0]);
+
+// A value of a field in the sample message.
+struct SampleValue {
+  int64 number;    // Integer types.
+  string text;     // Strings.
+  int count;       // Elements of repeated fields.
+};
+
+int VarintSize(uint64 value) {
+  int size = 1;
+  while (value >= 0x80) {
+    value >>= 7;
+    size++;
+  }
+  return size;
+}
+
+// Size of an int written by WriteRawVarint32, which doesn't sign extend.
+int Varint32Size(int64 value) {
+  return VarintSize(static_cast<uint32>(value));
+}
+
+// Models the functions of us-lib called by the generated code.
+class RuntimeModel {
+ public:
+  explicit RuntimeModel(Variant variant) : variant_(variant) {}
+
+  // WriteRawByte, count times, into the buffer reserved by Serialize.
+  void WriteBytes(int count, Ops* ops) const {
+    if (variant_ != VARIANT_INLINE_BYTES) ops->calls += count;
+    ops->byte_ops += count;
+  }
+
+  void WriteVarint(int size, Ops* ops) const {
+    ops->calls++;
+    WriteBytes(size, ops);
+  }
+
+  // WriteTag, including MakeTag.
+  void WriteTag(int number, Ops* ops) const {
+    ops->calls += 2;
+    WriteVarint(VarintSize(number << 3), ops);
+  }
+
+  // WriteStringNoTag of an ASCII string.
+  void WriteString(const string& text, Ops* ops) const {
+    int length = text.size();
+    ops->calls++;
+
+    if (length * 3 < 0x80) {
+      WriteBytes(1, ops);
+      ops->byte_ops++;
+    } else {
+      ComputeStringSize(text, ops);
+      WriteVarint(VarintSize(length), ops);
+    }
+
+    WriteStringChunk(length, ops);
+  }
+
+  // WriteRawStringChunk, which halves strings over 32 characters.
+  void WriteStringChunk(int length, Ops* ops) const {
+    ops->calls++;
+    if (length > 32) {
+      ops->string_ops += 2;
+      WriteStringChunk(length / 2, ops);
+      WriteStringChunk(length - length / 2, ops);
+      return;
+    }
+
+    // Mid and Asc, then WriteRawUtf8Char.
+    ops->string_ops += 2 * length;
+    ops->calls += length;
+    WriteBytes(length, ops);
+  }
+
+  // ComputeRawStringSize, which walks the string the same way.
+  void ComputeStringSize(const string& text, Ops* ops) const {
+    ops->calls += 2;
+    ops->string_ops += 2 * text.size();
+    ops->calls += text.size();
+  }
+
+  // ReadRawVarint32 and ReadRawVarint64.
+  void ReadVarint(int size, Ops* ops) const {
+    ops->calls++;
+    ops->byte_ops += size;
+  }
+
+  // ReadRawString of an ASCII string: a Chr and a concatenation per
+  // character, chunks of 32 characters joined at the end.
+  void ReadString(const string& text, Ops* ops) const {
+    int length = text.size();
+    int chunks = (length + 31) / 32;
+
+    ops->calls += 3;
+    ops->byte_ops += length;
+    ops->string_ops += 2 * length + chunks;
+    ops->appends += chunks;
+  }
+
+  // A call of a Write<Type> function of CodedOutputStream, with its tag.
+  void Write(const string& method, const FieldDescriptor* field,
+             const SampleValue& value, Ops* ops) const;
+
+  // A call of a Read<Type> function of CodedInputStream.
+  void Read(const string& method, const FieldDescriptor* field,
+            const SampleValue& value, Ops* ops) const;
+
+  // The Compute<Type>Size call of GetSerializedSize.
+  void ComputeSize(const FieldDescriptor* field, const SampleValue& value,
+                   Ops* ops) const;
+
+  Variant variant() const { return variant_; }
+
+ private:
+  Variant variant_;
+};
+
+// Bytes of a single value without its tag, as written by us-lib.
+int ValueSize(const FieldDescriptor* field, const SampleValue& value) {
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_INT32:
+    case FieldDescriptor::TYPE_UINT32:
+      return Varint32Size(value.number);
+    case FieldDescriptor::TYPE_SINT32:
+      return Varint32Size((value.number << 1) ^ (value.number >> 31));
+    case FieldDescriptor::TYPE_INT64:
+      return VarintSize(value.number);
+    case FieldDescriptor::TYPE_FIXED32:
+    case FieldDescriptor::TYPE_FLOAT:
+      return 4;
+    case FieldDescriptor::TYPE_BOOL:
+      return 1;
+    case FieldDescriptor::TYPE_STRING:
+      return VarintSize(value.text.size()) + value.text.size();
+    default:
+      GOOGLE_LOG(FATAL) << "Type not in the synthetic schemas.";
+      return 0;
+  }
+}
+
+void RuntimeModel::Write(const string& method, const FieldDescriptor* field,
+                         const SampleValue& value, Ops* ops) const {
+  ops->calls++;
+
+  if (HasPrefixString(method, "WritePacked")) {
+    if (value.count == 0) return;
+
+    int data_size = 0;
+    for (int i = 0; i < value.count; i++) {
+      data_size += ValueSize(field, value);
+    }
+
+    WriteTag(field->number(), ops);
+
+    // ComputePacked<Type>DataSize, then the values without tags.
+    ops->calls += 1 + value.count;
+    WriteVarint(VarintSize(data_size), ops);
+
+    for (int i = 0; i < value.count; i++) {
+      ops->calls++;
+      WriteVarint(ValueSize(field, value), ops);
+    }
+    return;
+  }
+
+  WriteTag(field->number(), ops);
+
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_SINT32:
+      ops->calls++;  // EncodeZigZag32
+      WriteVarint(ValueSize(field, value), ops);
+      break;
+    case FieldDescriptor::TYPE_FLOAT:
+      ops->calls += 2;  // WriteRawLittleEndian32Float, FloatToBits
+      // Fall through.
+    case FieldDescriptor::TYPE_FIXED32:
+      ops->calls++;
+      WriteBytes(4, ops);
+      break;
+    case FieldDescriptor::TYPE_BOOL:
+      WriteBytes(1, ops);
+      break;
+    case FieldDescriptor::TYPE_STRING:
+      WriteString(value.text, ops);
+      break;
+    default:
+      WriteVarint(ValueSize(field, value), ops);
+      break;
+  }
+}
+
+void RuntimeModel::Read(const string& method, const FieldDescriptor* field,
+                        const SampleValue& value, Ops* ops) const {
+  ops->calls++;
+
+  if (HasPrefixString(method, "ReadPacked")) {
+    // PushLimit, the length, then IsAtEnd, Read<Type> and AddItem per
+    // value, and PopLimit.
+    int data_size = 0;
+    for (int i = 0; i < value.count; i++) {
+      data_size += ValueSize(field, value);
+    }
+
+    ops->calls += 2;
+    ReadVarint(VarintSize(data_size), ops);
+
+    for (int i = 0; i < value.count; i++) {
+      ops->calls += 2;
+      ReadVarint(ValueSize(field, value), ops);
+      ops->appends++;
+    }
+    ops->calls++;
+    return;
+  }
+
+  switch (GetType(field)) {
+    case FieldDescriptor::TYPE_FLOAT:
+      ops->calls += 2;  // ReadRawLittleEndian32Float, BitsToFloat
+      // Fall through.
+    case FieldDescriptor::TYPE_FIXED32:
+      ops->calls += 2;  // ReadRawLittleEndian32, CheckAvailable
+      ops->byte_ops += 4;
+      break;
+    case FieldDescriptor::TYPE_SINT32:
+      ops->calls++;  // DecodeZigZag32
+      ReadVarint(ValueSize(field, value), ops);
+      break;
+    case FieldDescriptor::TYPE_STRING:
+      ReadVarint(VarintSize(value.text.size()), ops);
+      ReadString(value.text, ops);
+      break;
+    default:
+      ReadVarint(ValueSize(field, value), ops);
+      break;
+  }
+}
+
+void RuntimeModel::ComputeSize(const FieldDescriptor* field,
+                               const SampleValue& value, Ops* ops) const {
+  // Compute<Type>Size, ComputeTagSize and ComputeRawVarint32Size, once per
+  // value or, for packed fields, ComputePacked<Type>Size and its data size.
+  if (field->is_repeated() && !IsPacked(field)) {
+    ops->calls += 3 * value.count;
+  } else if (field->is_repeated()) {
+    ops->calls += 3 + value.count;
+  } else {
+    ops->calls += 3;
+  }
+
+  if (GetType(field) == FieldDescriptor::TYPE_STRING) {
+    int count = field->is_repeated() ? value.count : 1;
+    for (int i = 0; i < count; i++) {
+      ComputeStringSize(value.text, ops);
+    }
+  }
+}
+
+// Deterministic sample values, so that operation counts are reproducible.
+class Sampler {
+ public:
+  Sampler() : state_(12345) {}
+
+  uint32 Next() {
+    state_ = state_ * 1103515245 + 12345;
+    return (state_ >> 8) & 0xFFFFFF;
+  }
+
+  SampleValue Sample(const FieldDescriptor* field) {
+    SampleValue value;
+
+    // Mostly small numbers, as game state usually is, and a few large ones.
+    value.number = Next() % 4 == 0 ? Next() * 256 : Next() % 300;
+    if (GetType(field) == FieldDescriptor::TYPE_BOOL) value.number &= 1;
+
+    value.text = string(Next() % 40, 'x');
+    value.count = field->is_repeated() ? Next() % 8 : 1;
+    return value;
+  }
+
+ private:
+  uint32 state_;
+};
+
+// A call of the runtime found in a generated function.
+struct Statement {
+  string method;
+  const FieldDescriptor* field;
+  bool packed_case;   // For Deserialize: reached through the packed tag.
+};
+
+// Extracts the body of the named function from a generated class.
+string FunctionBody(const string& text, const string& signature) {
+  string::size_type start = text.find(signature);
+  if (start == string::npos) return "";
+
+  string::size_type end = text.find("\n}\n", start);
+  return text.substr(start, end - start);
+}
+
+// Finds the field the constant prefix (e.g. "F3" of "F3_TAG") names.
+const FieldDescriptor* FieldForConstant(const Descriptor* descriptor,
+                                        const string& prefix) {
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    if (FieldConstantName(descriptor->field(i)) == prefix + "_FIELD_NUMBER") {
+      return descriptor->field(i);
+    }
+  }
+  return NULL;
+}
+
+// Reads the runtime calls of SerializeWithCachedSizes, in order.
+vector<Statement> ParseSerialize(const string& text,
+                                 const Descriptor* descriptor) {
+  vector<Statement> statements;
+  istringstream body(FunctionBody(text, "function SerializeWithCachedSizes("));
+  string line;
+
+  while (getline(body, line)) {
+    string::size_type call = line.find("stream.Write");
+    string::size_type constant = line.find("_FIELD_NUMBER");
+    if (call == string::npos || constant == string::npos) continue;
+
+    string::size_type open = line.find('(', call);
+    Statement statement;
+    statement.method = line.substr(call + 7, open - call - 7);
+    statement.field = FieldForConstant(descriptor,
+      line.substr(open + 1, constant - open - 1));
+    statement.packed_case = false;
+
+    if (statement.field != NULL) statements.push_back(statement);
+  }
+
+  return statements;
+}
+
+// Reads the cases of the Deserialize switch, in the order they are tested.
+vector<Statement> ParseDeserialize(const string& text,
+                                   const Descriptor* descriptor) {
+  vector<Statement> cases;
+  istringstream body(FunctionBody(text, "function Deserialize("));
+  string line;
+
+  while (getline(body, line)) {
+    string::size_type label = line.find("case ");
+    if (label != string::npos) {
+      string constant = line.substr(label + 5, line.find(':') - label - 5);
+      bool packed = HasSuffixString(constant, "_PACKED_TAG");
+      string prefix = constant.substr(0,
+        constant.size() - (packed ? 11 : 4));
+
+      Statement statement;
+      statement.field = FieldForConstant(descriptor, prefix);
+      statement.packed_case = packed;
+      if (statement.field != NULL) cases.push_back(statement);
+      continue;
+    }
+
+    string::size_type call = line.find("stream.Read");
+    if (call != string::npos && !cases.empty() &&
+        cases.back().method.empty()) {
+      string::size_type open = line.find('(', call);
+      cases.back().method = line.substr(call + 7, open - call - 7);
+    }
+  }
+
+  return cases;
+}
+
+struct RuntimeResult {
+  string name;
+  int fields;
+  Variant variant;
+  int64 bytes;
+  Ops encode;
+  Ops decode;
+};
+
+// Walks the generated Serialize and Deserialize of a message over a
+// sample of it.
+RuntimeResult RunModel(const string& name, const Descriptor* descriptor,
+                       const string& text, Variant variant) {
+  RuntimeModel model(variant);
+  vector<Statement> writes = ParseSerialize(text, descriptor);
+  vector<Statement> cases = ParseDeserialize(text, descriptor);
+
+  Sampler sampler;
+  map<const FieldDescriptor*, SampleValue> values;
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    values[descriptor->field(i)] = sampler.Sample(descriptor->field(i));
+  }
+
+  RuntimeResult result;
+  result.name = name;
+  result.fields = descriptor->field_count();
+  result.variant = variant;
+  result.bytes = 0;
+
+  // Serialize: the size pass, Reserve growing the buffer once, then the
+  // writes.
+  result.encode.calls += 3;
+  result.encode.appends++;
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+    model.ComputeSize(field, values[field], &result.encode);
+  }
+
+  // The wire holds every value written, which Deserialize then reads in
+  // the same order.
+  vector<pair<const FieldDescriptor*, bool> > wire;
+
+  for (int i = 0; i < writes.size(); i++) {
+    const Statement& write = writes[i];
+    const SampleValue& value = values[write.field];
+    bool packed = HasPrefixString(write.method, "WritePacked");
+    int count = write.field->is_repeated() && !packed ? value.count : 1;
+
+    for (int j = 0; j < count; j++) {
+      Ops ops;
+      model.Write(write.method, write.field, value, &ops);
+      result.encode.Add(ops);
+
+      if (packed && value.count == 0) continue;
+
+      int data_size = 0;
+      int values_written = packed ? value.count : 1;
+      for (int k = 0; k < values_written; k++) {
+        data_size += ValueSize(write.field, value);
+      }
+      if (packed) data_size += VarintSize(data_size);
+      result.bytes += VarintSize(write.field->number() << 3) + data_size;
+      wire.push_back(make_pair(write.field, packed));
+    }
+  }
+
+  // Deserialize: a ReadTag and a walk down the switch per field read.
+  for (int i = 0; i < wire.size(); i++) {
+    const FieldDescriptor* field = wire[i].first;
+    const SampleValue& value = values[field];
+
+    Ops ops;
+    ops.calls++;
+    model.ReadVarint(VarintSize(field->number() << 3), &ops);
+
+    for (int j = 0; j < cases.size(); j++) {
+      if (variant != VARIANT_TABLE_DISPATCH) ops.compares++;
+      if (cases[j].field == field && cases[j].packed_case == wire[i].second) {
+        if (variant == VARIANT_TABLE_DISPATCH) ops.compares++;
+
+        model.Read(cases[j].method, field, value, &ops);
+        if (field->is_repeated() && !wire[i].second) ops.appends++;
+        break;
+      }
+    }
+
+    result.decode.Add(ops);
+  }
+
+  // The final ReadTag, at the end of the buffer.
+  result.decode.calls += 2;
+
+  return result;
+}
+
+RuntimeResult BenchmarkRuntime(int fields, Variant variant) {
+  DescriptorPool pool;
+  string name = "runtime_" + SimpleItoa(fields) + ".proto";
+  const FileDescriptor* file = BuildSchema(&pool, name, 1, fields);
+  const Descriptor* descriptor = file->message_type(0);
+
+  MemoryContext context;
+  UnrealScriptGenerator generator;
+  string error;
+  if (!generator.Generate(file, "", &context, &error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    exit(1);
+  }
+
+  map<string, string>::const_iterator text =
+    context.files().find(UnrealScriptClassName(descriptor) + ".uc");
+  if (text == context.files().end()) {
+    fprintf(stderr, "Generated class of %s not found.\n",
+            descriptor->full_name().c_str());
+    exit(1);
+  }
+
+  return RunModel("fields_" + SimpleItoa(fields), descriptor, text->second,
+                  variant);
+}
+
+// ===================================================================
+// Output and regression check
+
+double PerByte(int64 ops, int64 bytes) {
+  return bytes == 0 ? 0 : static_cast<double>(ops) / bytes;
+}
+
+string OpsJson(const Ops& ops, int64 bytes) {
+  char buffer[512];
+  snprintf(buffer, sizeof(buffer),
+           "{\"cost_per_byte\": %.4f, \"calls\": %lld, \"compares\": %lld, "
+           "\"appends\": %lld, \"byte_ops\": %lld, \"string_ops\": %lld}",
+           PerByte(ops.cost(), bytes),
+           static_cast<long long>(ops.calls),
+           static_cast<long long>(ops.compares),
+           static_cast<long long>(ops.appends),
+           static_cast<long long>(ops.byte_ops),
+           static_cast<long long>(ops.string_ops));
+  return buffer;
+}
+
+// Key identifying a runtime result across runs.
+string ResultKey(const RuntimeResult& result) {
+  return result.name + "/" + kVariantNames[result.variant];
+}
+
+// Writes one result per line, which keeps the baseline easy to read back.
+string ToJson(const vector<GeneratorResult>& generator_results,
+              const vector<RuntimeResult>& runtime_results) {
+  string json = "{\n  \"generator\": [\n";
+  char buffer[512];
+
+  for (int i = 0; i < generator_results.size(); i++) {
+    const GeneratorResult& result = generator_results[i];
+    snprintf(buffer, sizeof(buffer),
+             "    {\"messages\": %d, \"fields\": %d, \"seconds\": %.6f, "
+             "\"output_bytes\": %lld, \"fields_per_second\": %.0f}%s\n",
+             result.messages, result.fields, result.seconds,
+             static_cast<long long>(result.output_bytes),
+             result.messages * result.fields / result.seconds,
+             i + 1 < generator_results.size() ? "," : "");
+    json += buffer;
+  }
+
+  json += "  ],\n  \"runtime\": [\n";
+
+  for (int i = 0; i < runtime_results.size(); i++) {
+    const RuntimeResult& result = runtime_results[i];
+    json += "    {\"key\": \"" + ResultKey(result) + "\", ";
+    json += "\"bytes\": " + SimpleItoa(result.bytes) + ", ";
+    json += "\"encode\": " + OpsJson(result.encode, result.bytes) + ", ";
+    json += "\"decode\": " + OpsJson(result.decode, result.bytes) + "}";
+    json += i + 1 < runtime_results.size() ? ",\n" : "\n";
+  }
+
+  json += "  ]\n}\n";
+  return json;
+}
+
+// Reads the encode and decode cost per byte of every runtime result
+// of a file written by ToJson().
+bool ReadBaseline(const string& filename,
+                  map<string, pair<double, double> >* baseline) {
+  ifstream input(filename.c_str());
+  if (!input) return false;
+
+  const string kEncode = "\"encode\": {\"cost_per_byte\": ";
+  const string kDecode = "\"decode\": {\"cost_per_byte\": ";
+
+  string line;
+  while (getline(input, line)) {
+    string::size_type key = line.find("\"key\": \"");
+    string::size_type encode = line.find(kEncode);
+    string::size_type decode = line.find(kDecode);
+    if (key == string::npos || encode == string::npos ||
+        decode == string::npos) {
+      continue;
+    }
+
+    key += 8;
+    string name = line.substr(key, line.find('"', key) - key);
+    (*baseline)[name] = make_pair(
+      strtod(line.c_str() + encode + kEncode.size(), NULL),
+      strtod(line.c_str() + decode + kDecode.size(), NULL));
+  }
+
+  return true;
+}
+
+// Returns the number of results whose cost grew past the tolerance.
+int CheckBaseline(const map<string, pair<double, double> >& baseline,
+                  const vector<RuntimeResult>& results, double tolerance) {
+  int regressions = 0;
+
+  for (int i = 0; i < results.size(); i++) {
+    const RuntimeResult& result = results[i];
+    map<string, pair<double, double> >::const_iterator expected =
+      baseline.find(ResultKey(result));
+    if (expected == baseline.end()) continue;
+
+    double encode = PerByte(result.encode.cost(), result.bytes);
+    double decode = PerByte(result.decode.cost(), result.bytes);
+
+    if (encode > expected->second.first * (1 + tolerance) + 1e-4) {
+      fprintf(stderr, "REGRESSION %s encode: %.4f cost/byte, baseline %.4f\n",
+              ResultKey(result).c_str(), encode, expected->second.first);
+      regressions++;
+    }
+    if (decode > expected->second.second * (1 + tolerance) + 1e-4) {
+      fprintf(stderr, "REGRESSION %s decode: %.4f cost/byte, baseline %.4f\n",
+              ResultKey(result).c_str(), decode, expected->second.second);
+      regressions++;
+    }
+  }
+
+  return regressions;
+}
+
+int Main(int argc, char* argv[]) {
+  bool quick = false;
+  string json_file;
+  string baseline_file;
+  double tolerance = 0.01;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+
+    if (arg == "--quick") {
+      quick = true;
+    } else if (HasPrefixString(arg, "--json=")) {
+      json_file = arg.substr(7);
+    } else if (HasPrefixString(arg, "--baseline=")) {
+      baseline_file = arg.substr(11);
+    } else if (HasPrefixString(arg, "--tolerance=")) {
+      tolerance = strtod(arg.c_str() + 12, NULL) / 100;
+    } else {
+      fprintf(stderr,
+              "Usage: %s [--quick] [--json=<file>] [--baseline=<file>] "
+              "[--tolerance=<percent>]\n", argv[0]);
+      return 2;
+    }
+  }
+
+  // Schemas of up to 500,000 fields, or 50,000 with --quick.
+  const int kMessageCounts[] = { 10, 100, 1000, 10000 };
+  const int kFieldCounts[] = { 1, 10, 100, 500 };
+  int max_fields = quick ? 50000 : 500000;
+
+  vector<GeneratorResult> generator_results;
+  for (int i = 0; i < 4; i++) {
+    for (int j = 0; j < 4; j++) {
+      if (kMessageCounts[i] * kFieldCounts[j] > max_fields) continue;
+
+      GeneratorResult result =
+        BenchmarkGenerator(kMessageCounts[i], kFieldCounts[j]);
+      generator_results.push_back(result);
+
+      printf("generate %5d messages x %3d fields: %10.3f ms, %8.0f fields/s\n",
+             result.messages, result.fields, result.seconds * 1000,
+             result.messages * result.fields / result.seconds);
+    }
+  }
+
+  const int kRuntimeFieldCounts[] = { 1, 10, 50, 500 };
+
+  vector<RuntimeResult> runtime_results;
+  for (int i = 0; i < 4; i++) {
+    for (int variant = 0; variant < kVariantCount; variant++) {
+      RuntimeResult result = BenchmarkRuntime(kRuntimeFieldCounts[i],
+                                              static_cast<Variant>(variant));
+      runtime_results.push_back(result);
+
+      printf("%-30s %6lld bytes: encode %7.2f cost/byte, "
+             "decode %7.2f cost/byte\n",
+             ResultKey(result).c_str(), static_cast<long long>(result.bytes),
+             PerByte(result.encode.cost(), result.bytes),
+             PerByte(result.decode.cost(), result.bytes));
+    }
+  }
+
+  string json = ToJson(generator_results, runtime_results);
+
+  if (!json_file.empty()) {
+    ofstream output(json_file.c_str());
+    output << json;
+    if (!output) {
+      fprintf(stderr, "%s: %s\n", json_file.c_str(), strerror(errno));
+      return 1;
+    }
+  }
+
+  if (!baseline_file.empty()) {
+    map<string, pair<double, double> > baseline;
+    if (!ReadBaseline(baseline_file, &baseline)) {
+      fprintf(stderr, "%s: Unable to open file.\n", baseline_file.c_str());
+      return 1;
+    }
+
+    int regressions = CheckBaseline(baseline, runtime_results, tolerance);
+    if (regressions > 0) {
+      fprintf(stderr, "%d regressions against %s\n", regressions,
+              baseline_file.c_str());
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+}  // namespace
+}  // namespace us
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+int main(int argc, char* argv[]) {
+  return google::protobuf::compiler::us::Main(argc, argv);
+}
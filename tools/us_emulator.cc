@@ -0,0 +1,3466 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "us_emulator.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <google/protobuf/stubs/strutil.h>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace us {
+namespace emulator {
+
+// The engine gives up on a script after this many nested calls, or this
+// many iterations of a single loop.
+const int kMaxCallDepth = 250;
+const int kMaxLoopIterations = 1000000;
+
+namespace {
+
+string Lower(const string& text) {
+  string result = text;
+  LowerString(&result);
+  return result;
+}
+
+string Trim(const string& text) {
+  int start = 0;
+  int end = text.size();
+  while (start < end && isspace(text[start])) start++;
+  while (end > start && isspace(text[end - 1])) end--;
+  return text.substr(start, end - start);
+}
+
+// Words the UnrealScript compiler doesn't take as the name of a class,
+// variable, constant, function or parameter.
+const char* const kReservedWords[] = {
+  "abstract", "array", "arraycount", "assert", "auto", "automated", "bool",
+  "break", "byte", "case", "class", "coerce", "collapsecategories",
+  "config", "const", "continue", "default", "defaultproperties", "delegate",
+  "dependson", "deprecated", "do", "dontcollapsecategories", "editconst",
+  "editinline", "editinlinenew", "else", "enum", "enumcount", "event",
+  "exec", "expands", "export", "extends", "false", "final", "float", "for",
+  "foreach", "function", "global", "globalconfig", "goto",
+  "hidecategories", "if", "ignores", "implements", "import", "instanced",
+  "int", "interface", "intrinsic", "iterator", "latent", "local",
+  "localized", "name", "native", "nativereplication", "new", "noexport",
+  "none", "noteditinlinenew", "notplaceable", "operator", "optional", "out",
+  "perobjectconfig", "placeable", "postoperator", "preoperator", "private",
+  "protected", "public", "reliable", "replication", "return", "self",
+  "showcategories", "simulated", "singular", "state", "static", "string",
+  "struct", "super", "switch", "transient", "true", "unreliable", "until",
+  "var", "while", "within",
+};
+
+bool IsReservedWord(const string& lower) {
+  for (int i = 0; i < sizeof(kReservedWords) / sizeof(kReservedWords[0]);
+       i++) {
+    if (lower == kReservedWords[i]) return true;
+  }
+  return false;
+}
+
+bool IsIdentifierChar(char c) {
+  return ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z') ||
+         ('0' <= c && c <= '9') || c == '_';
+}
+
+// Source files are UTF-8, UnrealScript strings UTF-16.  Characters
+// outside the Basic Multilingual Plane can't be represented and become
+// U+FFFD, as CodedInputStream.ReadRawString does.
+u16string DecodeUtf8(const string& text) {
+  u16string result;
+
+  for (int i = 0; i < text.size(); ) {
+    unsigned char c = text[i++];
+    int value = c;
+    int extra = 0;
+
+    if (c >= 0xF0) {
+      extra = 3;
+      value = -1;
+    } else if (c >= 0xE0) {
+      extra = 2;
+      value = c & 0x0F;
+    } else if (c >= 0xC0) {
+      extra = 1;
+      value = c & 0x1F;
+    } else if (c >= 0x80) {
+      value = -1;
+    }
+
+    for (int j = 0; j < extra && i < text.size(); j++) {
+      if ((text[i] & 0xC0) != 0x80) break;
+      value = (value << 6) | (text[i++] & 0x3F);
+    }
+
+    result.push_back(value < 0 ? 0xFFFD : value);
+  }
+
+  return result;
+}
+
+string EncodeUtf8(const u16string& text) {
+  string result;
+
+  for (int i = 0; i < text.size(); i++) {
+    int value = text[i];
+
+    if (value < 0x80) {
+      result.push_back(value);
+    } else if (value < 0x800) {
+      result.push_back(0xC0 | (value >> 6));
+      result.push_back(0x80 | (value & 0x3F));
+    } else {
+      result.push_back(0xE0 | (value >> 12));
+      result.push_back(0x80 | ((value >> 6) & 0x3F));
+      result.push_back(0x80 | (value & 0x3F));
+    }
+  }
+
+  return result;
+}
+
+// 32 bit arithmetic, wrapping around as the engine does.
+int32 Wrap(int64 value) {
+  return static_cast<int32>(static_cast<uint32>(value));
+}
+
+// Float to int conversion of the engine, which truncates.
+int32 Truncate(float value) {
+  if (!(value > -2147483648.0f && value < 2147483648.0f)) {
+    return kint32min;
+  }
+  return static_cast<int32>(value);
+}
+
+}  // namespace
+
+// ===================================================================
+// Program
+
+// Everything the parser creates is owned by the Program.
+struct Node {
+  virtual ~Node() {}
+};
+
+struct StructDef;
+struct FunctionDef;
+
+struct Type : public Node {
+  enum Kind {
+    INT,
+    BYTE,
+    BOOL,
+    FLOAT,
+    STRING,
+    NAME,
+    OBJECT,        // Also the names to be resolved by the linker.
+    CLASS,
+    STRUCT,
+    ARRAY,
+    STATIC_ARRAY,
+  };
+
+  Type() : kind(INT), element(NULL), size(0), klass(NULL), structure(NULL) {}
+
+  Kind kind;
+  string name;                  // OBJECT, CLASS and STRUCT, lower case.
+  Type* element;                // ARRAY and STATIC_ARRAY.
+  int size;                     // STATIC_ARRAY.
+  const ClassDef* klass;        // OBJECT, once linked.
+  const StructDef* structure;   // STRUCT, once linked.
+};
+
+struct Variable {
+  Variable() : type(NULL) {}
+
+  string name;     // Lower case.
+  Type* type;
+};
+
+struct Expr : public Node {
+  enum Kind {
+    LITERAL,       // value
+    NAME,          // Identifier not resolved yet: name.
+    LOCAL,         // Local variable or parameter: index.
+    FIELD,         // Variable of self: index.
+    SELF,
+    SUPER,         // Only as the object of a call.
+    CLASS_NAME,    // class'name', or a class named in an expression.
+    CONST_OF,      // a.const.name, a being a CLASS_NAME.
+    MEMBER,        // a.name
+    INDEX,         // a[b]
+    CALL,          // name(args), not resolved yet.
+    SELF_CALL,     // name(args), called on self or its class.
+    METHOD_CALL,   // a.name(args)
+    STATIC_CALL,   // a.static.name(args)
+    SUPER_CALL,    // super.name(args): function
+    NATIVE_CALL,   // name(args) of Object: native
+    CAST,          // klass(a)
+    CONVERT,       // type(a), e.g. int(a): type
+    NEW,           // new a
+    UNARY,         // op a
+    PRE_INCREMENT, // op a, op being "++" or "--".
+    POST_INCREMENT,// a op
+    BINARY,        // a op b
+    TERNARY,       // a ? b : c
+    ASSIGN,        // a op b, op being "=", "+=", ...
+  };
+
+  Expr() : kind(LITERAL), index(0), a(NULL), b(NULL), c(NULL),
+           function(NULL), native(0), klass(NULL), type(Type::INT), line(0),
+           cached_class(NULL), cached_index(-1), cached_function(NULL) {}
+
+  Kind kind;
+  string name;               // Lower case.
+  string op;
+  Value value;
+  int index;
+  Expr* a;
+  Expr* b;
+  Expr* c;
+  vector<Expr*> args;
+  const FunctionDef* function;
+  int native;
+  const ClassDef* klass;
+  Type::Kind type;
+  int line;
+
+  // Last class the member or function was looked up in, and the result.
+  const ClassDef* cached_class;
+  int cached_index;
+  const FunctionDef* cached_function;
+};
+
+struct Stmt : public Node {
+  enum Kind {
+    EXPRESSION,    // expr
+    BLOCK,         // body
+    IF,            // if (expr) then else otherwise
+    WHILE,         // while (expr) then
+    DO,            // do then until (expr)
+    FOR,           // for (init; expr; step) then
+    SWITCH,        // switch (expr) cases
+    RETURN,        // return expr
+    BREAK,
+    CONTINUE,
+    EMPTY,
+  };
+
+  struct Case {
+    Expr* label;          // NULL for default.
+    vector<Stmt*> body;
+  };
+
+  Stmt() : kind(EMPTY), expr(NULL), init(NULL), step(NULL), then(NULL),
+           otherwise(NULL), line(0) {}
+
+  Kind kind;
+  Expr* expr;
+  Stmt* init;
+  Stmt* step;
+  Stmt* then;
+  Stmt* otherwise;
+  vector<Stmt*> body;
+  vector<Case> cases;
+  int line;
+};
+
+struct Param : public Variable {
+  Param() : out(false), optional(false), default_value(NULL) {}
+
+  bool out;
+  bool optional;
+  Expr* default_value;
+};
+
+struct FunctionDef : public Node {
+  FunctionDef() : is_static(false), return_type(NULL), body(NULL),
+                  owner(NULL) {}
+
+  string name;                // Lower case.
+  string display_name;
+  bool is_static;
+  Type* return_type;          // NULL for none.
+  vector<Param> params;
+  vector<Variable> locals;    // Slots follow the parameters.
+  Stmt* body;                 // NULL if only declared.
+  const ClassDef* owner;
+};
+
+// An assignment of a defaultproperties block.
+struct DefaultProperty {
+  DefaultProperty() : index(-1), value(NULL), line(0) {}
+
+  string name;
+  int index;        // Element of a static array, or -1.
+  Expr* value;
+  int line;
+};
+
+struct StructDef : public Node {
+  StructDef() : owner(NULL) {}
+
+  string name;
+  const ClassDef* owner;
+  vector<Variable> members;
+  map<string, int> index;
+  vector<DefaultProperty> default_properties;
+  Value defaults;
+};
+
+class ClassDef : public Node {
+ public:
+  ClassDef() : is_abstract(false), parent(NULL), linked(false) {}
+
+  // Returns true if this class is other or a subclass of it.
+  bool IsA(const ClassDef* other) const {
+    for (const ClassDef* klass = this; klass != NULL; klass = klass->parent) {
+      if (klass == other) return true;
+    }
+    return false;
+  }
+
+  const FunctionDef* FindFunction(const string& name) const {
+    map<string, const FunctionDef*>::const_iterator it = vtable.find(name);
+    return it == vtable.end() ? NULL : it->second;
+  }
+
+  int FindVariable(const string& name) const {
+    map<string, int>::const_iterator it = variable_index.find(name);
+    return it == variable_index.end() ? -1 : it->second;
+  }
+
+  string name;                  // Lower case.
+  string display_name;
+  string filename;
+  string parent_name;           // Lower case, empty for Object.
+  bool is_abstract;
+  const ClassDef* parent;
+  bool linked;
+
+  vector<Variable> own_variables;
+  map<string, Expr*> consts;
+  map<string, StructDef*> structs;
+  map<string, FunctionDef*> functions;
+  vector<DefaultProperty> default_properties;
+
+  // Filled in by the linker, including what is inherited.
+  vector<Variable> variables;
+  map<string, int> variable_index;
+  map<string, const FunctionDef*> vtable;
+  vector<Value> defaults;
+};
+
+struct Emulator::Program {
+  ~Program() {
+    for (int i = 0; i < nodes.size(); i++) {
+      delete nodes[i];
+    }
+  }
+
+  template <typename T>
+  T* Make() {
+    T* node = new T;
+    nodes.push_back(node);
+    return node;
+  }
+
+  const ClassDef* FindClass(const string& name) const {
+    map<string, ClassDef*>::const_iterator it = classes.find(name);
+    return it == classes.end() ? NULL : it->second;
+  }
+
+  vector<Node*> nodes;
+  map<string, ClassDef*> classes;
+  set<string> enum_types;
+  map<string, int> enum_values;
+};
+
+// ===================================================================
+// Values
+
+Value Value::Int(int32 value) {
+  Value result;
+  result.kind = INT;
+  result.i = value;
+  return result;
+}
+
+Value Value::Byte(int value) {
+  Value result;
+  result.kind = BYTE;
+  result.i = value & 0xFF;
+  return result;
+}
+
+Value Value::Bool(bool value) {
+  Value result;
+  result.kind = BOOL;
+  result.i = value;
+  return result;
+}
+
+Value Value::Float(float value) {
+  Value result;
+  result.kind = FLOAT;
+  result.f = value;
+  return result;
+}
+
+Value Value::String(const string& utf8) {
+  Value result;
+  result.kind = STRING;
+  result.s = DecodeUtf8(utf8);
+  return result;
+}
+
+Value Value::ObjectRef(Object* object) {
+  Value result;
+  result.kind = OBJECT;
+  result.object = object;
+  return result;
+}
+
+Value Value::Bytes(const string& bytes) {
+  static Type byte_type;
+  static Type array_type;
+  array_type.kind = Type::ARRAY;
+  array_type.element = &byte_type;
+  byte_type.kind = Type::BYTE;
+
+  Value result;
+  result.kind = ARRAY;
+  result.type = &array_type;
+  result.elements.resize(bytes.size(), Byte(0));
+
+  for (int i = 0; i < bytes.size(); i++) {
+    result.elements[i].i = static_cast<uint8>(bytes[i]);
+  }
+
+  return result;
+}
+
+string Value::ToBytes() const {
+  string result(elements.size(), '\0');
+  for (int i = 0; i < elements.size(); i++) {
+    result[i] = static_cast<char>(elements[i].i);
+  }
+  return result;
+}
+
+string Value::ToUtf8() const {
+  return EncodeUtf8(s);
+}
+
+namespace {
+
+Value DefaultValue(const Type* type) {
+  Value result;
+
+  switch (type->kind) {
+    case Type::INT:    result.kind = Value::INT;    break;
+    case Type::BYTE:   result.kind = Value::BYTE;   break;
+    case Type::BOOL:   result.kind = Value::BOOL;   break;
+    case Type::FLOAT:  result.kind = Value::FLOAT;  break;
+    case Type::STRING: result.kind = Value::STRING; break;
+    case Type::NAME:   result.kind = Value::NAME;   break;
+    case Type::OBJECT: result.kind = Value::OBJECT; break;
+    case Type::CLASS:  result.kind = Value::CLASS;  break;
+
+    case Type::STRUCT:
+      result = type->structure->defaults;
+      break;
+
+    case Type::ARRAY:
+      result.kind = Value::ARRAY;
+      result.type = type;
+      break;
+
+    case Type::STATIC_ARRAY:
+      result.kind = Value::ARRAY;
+      result.type = type;
+      result.elements.resize(type->size, DefaultValue(type->element));
+      break;
+  }
+
+  return result;
+}
+
+bool IsNumeric(const Value& value) {
+  return value.kind == Value::INT || value.kind == Value::BYTE ||
+         value.kind == Value::BOOL || value.kind == Value::FLOAT ||
+         value.kind == Value::VOID;
+}
+
+int32 ToInt(const Value& value) {
+  return value.kind == Value::FLOAT ? Truncate(value.f) : value.i;
+}
+
+float ToFloat(const Value& value) {
+  return value.kind == Value::FLOAT ? value.f : static_cast<float>(value.i);
+}
+
+bool ToBool(const Value& value) {
+  return value.kind == Value::FLOAT ? value.f != 0 : value.i != 0;
+}
+
+u16string ToString(const Value& value) {
+  char buffer[64];
+
+  switch (value.kind) {
+    case Value::STRING:
+    case Value::NAME:
+      return value.s;
+    case Value::BOOL:
+      return DecodeUtf8(value.i ? "True" : "False");
+    case Value::FLOAT:
+      snprintf(buffer, sizeof(buffer), "%.2f", value.f);
+      return DecodeUtf8(buffer);
+    case Value::OBJECT:
+      if (value.object == NULL) return DecodeUtf8("None");
+      snprintf(buffer, sizeof(buffer), "_%p", value.object);
+      return DecodeUtf8(value.object->klass->display_name + buffer);
+    case Value::CLASS:
+      return DecodeUtf8(value.klass == NULL ? "None" :
+                        value.klass->display_name);
+    case Value::STRUCT:
+    case Value::ARRAY:
+      return u16string();
+    default:
+      return DecodeUtf8(SimpleItoa(value.i));
+  }
+}
+
+// Assigns a value to a variable, converting it to the variable's type.
+// Values read from none are VOID and reset the variable.
+void Assign(Value* target, const Value& value) {
+  switch (target->kind) {
+    case Value::INT:
+      target->i = ToInt(value);
+      break;
+    case Value::BYTE:
+      target->i = ToInt(value) & 0xFF;
+      break;
+    case Value::BOOL:
+      target->i = ToBool(value);
+      break;
+    case Value::FLOAT:
+      target->f = ToFloat(value);
+      break;
+    case Value::STRING:
+    case Value::NAME:
+      target->s = value.kind == Value::VOID ? u16string() : ToString(value);
+      break;
+    case Value::OBJECT:
+      target->object = value.kind == Value::OBJECT ? value.object : NULL;
+      break;
+    case Value::CLASS:
+      target->klass = value.kind == Value::CLASS ? value.klass : NULL;
+      break;
+    case Value::STRUCT:
+      if (value.kind == Value::STRUCT) {
+        target->elements = value.elements;
+      } else {
+        *target = DefaultValue(target->type);
+      }
+      break;
+    case Value::ARRAY:
+      if (target->type->kind == Type::STATIC_ARRAY) {
+        for (int i = 0; i < target->elements.size(); i++) {
+          Assign(&target->elements[i],
+                 value.kind == Value::ARRAY && i < value.elements.size() ?
+                   value.elements[i] : Value());
+        }
+      } else if (value.kind == Value::ARRAY) {
+        target->elements = value.elements;
+      } else {
+        target->elements.clear();
+      }
+      break;
+    case Value::VOID:
+      *target = value;
+      break;
+  }
+}
+
+bool Equal(const Value& a, const Value& b) {
+  if (IsNumeric(a) && IsNumeric(b) &&
+      !(a.kind == Value::VOID && b.kind == Value::VOID)) {
+    if (a.kind == Value::FLOAT || b.kind == Value::FLOAT) {
+      return ToFloat(a) == ToFloat(b);
+    }
+    return a.i == b.i;
+  }
+
+  switch (a.kind) {
+    case Value::STRING:
+      return ToString(b) == a.s;
+    case Value::NAME:
+      return Lower(EncodeUtf8(a.s)) == Lower(EncodeUtf8(ToString(b)));
+    case Value::STRUCT:
+      if (b.kind != Value::STRUCT ||
+          a.elements.size() != b.elements.size()) {
+        return false;
+      }
+      for (int i = 0; i < a.elements.size(); i++) {
+        if (!Equal(a.elements[i], b.elements[i])) return false;
+      }
+      return true;
+    default:
+      // Objects and classes, none being NULL either way.
+      return (a.kind == Value::CLASS ? static_cast<const void*>(a.klass) :
+                                       static_cast<const void*>(a.object)) ==
+             (b.kind == Value::CLASS ? static_cast<const void*>(b.klass) :
+                                       static_cast<const void*>(b.object));
+  }
+}
+
+// Functions of Object called by the runtime.
+enum Native {
+  NATIVE_NONE,
+  NATIVE_LEN,
+  NATIVE_LEFT,
+  NATIVE_RIGHT,
+  NATIVE_MID,
+  NATIVE_ASC,
+  NATIVE_CHR,
+  NATIVE_INSTR,
+  NATIVE_CAPS,
+  NATIVE_LOCS,
+  NATIVE_MIN,
+  NATIVE_MAX,
+  NATIVE_CLAMP,
+  NATIVE_FMIN,
+  NATIVE_FMAX,
+  NATIVE_FCLAMP,
+  NATIVE_ABS,
+  NATIVE_FFLOOR,
+  NATIVE_FCEIL,
+  NATIVE_ROUND,
+  NATIVE_LOGE,
+  NATIVE_EXP,
+  NATIVE_SQRT,
+  NATIVE_LOG,
+  NATIVE_WARN,
+};
+
+struct NativeFunction {
+  const char* name;
+  Native native;
+  int min_args;
+  int max_args;
+};
+
+const NativeFunction kNatives[] = {
+  { "len",    NATIVE_LEN,    1, 1 },
+  { "left",   NATIVE_LEFT,   2, 2 },
+  { "right",  NATIVE_RIGHT,  2, 2 },
+  { "mid",    NATIVE_MID,    2, 3 },
+  { "asc",    NATIVE_ASC,    1, 1 },
+  { "chr",    NATIVE_CHR,    1, 1 },
+  { "instr",  NATIVE_INSTR,  2, 2 },
+  { "caps",   NATIVE_CAPS,   1, 1 },
+  { "locs",   NATIVE_LOCS,   1, 1 },
+  { "min",    NATIVE_MIN,    2, 2 },
+  { "max",    NATIVE_MAX,    2, 2 },
+  { "clamp",  NATIVE_CLAMP,  3, 3 },
+  { "fmin",   NATIVE_FMIN,   2, 2 },
+  { "fmax",   NATIVE_FMAX,   2, 2 },
+  { "fclamp", NATIVE_FCLAMP, 3, 3 },
+  { "abs",    NATIVE_ABS,    1, 1 },
+  { "ffloor", NATIVE_FFLOOR, 1, 1 },
+  { "fceil",  NATIVE_FCEIL,  1, 1 },
+  { "round",  NATIVE_ROUND,  1, 1 },
+  { "loge",   NATIVE_LOGE,   1, 1 },
+  { "exp",    NATIVE_EXP,    1, 1 },
+  { "sqrt",   NATIVE_SQRT,   1, 1 },
+  { "log",    NATIVE_LOG,    1, 3 },
+  { "warn",   NATIVE_WARN,   1, 1 },
+};
+
+const NativeFunction* FindNative(const string& name) {
+  for (int i = 0; i < sizeof(kNatives) / sizeof(kNatives[0]); i++) {
+    if (name == kNatives[i].name) return &kNatives[i];
+  }
+  return NULL;
+}
+
+// Types that can be converted to with e.g. int(value).
+bool FindConversion(const string& name, Type::Kind* kind) {
+  if (name == "int") {
+    *kind = Type::INT;
+  } else if (name == "byte") {
+    *kind = Type::BYTE;
+  } else if (name == "bool") {
+    *kind = Type::BOOL;
+  } else if (name == "float") {
+    *kind = Type::FLOAT;
+  } else if (name == "string") {
+    *kind = Type::STRING;
+  } else if (name == "name") {
+    *kind = Type::NAME;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// ===================================================================
+// Preprocessor and lexer
+
+// Replaces comments by spaces, keeping line numbers.
+string StripComments(const string& text) {
+  string result = text;
+  int i = 0;
+
+  while (i < result.size()) {
+    char c = result[i];
+
+    if (c == '"') {
+      for (i++; i < result.size() && result[i] != '"' &&
+                result[i] != '\n'; i++) {
+        if (result[i] == '\\') i++;
+      }
+      i++;
+    } else if (c == '/' && i + 1 < result.size() && result[i + 1] == '/') {
+      for (; i < result.size() && result[i] != '\n'; i++) result[i] = ' ';
+    } else if (c == '/' && i + 1 < result.size() && result[i + 1] == '*') {
+      for (; i < result.size(); i++) {
+        if (result[i] == '*' && i + 1 < result.size() &&
+            result[i + 1] == '/') {
+          result[i] = result[i + 1] = ' ';
+          i += 2;
+          break;
+        }
+        if (result[i] != '\n') result[i] = ' ';
+      }
+    } else {
+      i++;
+    }
+  }
+
+  return result;
+}
+
+struct Token {
+  enum Kind {
+    IDENTIFIER,
+    INTEGER,
+    FLOAT,
+    STRING,
+    NAME,
+    SYMBOL,
+    END,
+  };
+
+  Token() : kind(END), integer(0), number(0), line(0) {}
+
+  Kind kind;
+  string text;       // As written, or the contents of STRING and NAME.
+  string lower;      // Lower case IDENTIFIER, NAME and SYMBOL.
+  int64 integer;
+  double number;
+  int line;
+};
+
+// Longest first, so that e.g. ">>>" isn't read as ">>".
+const char* const kSymbols[] = {
+  ">>>", "<<", ">>", "<=", ">=", "==", "!=", "~=", "&&", "||", "^^", "++",
+  "--", "+=", "-=", "*=", "/=", "$=", "@=", "|=", "&=", "**",
+};
+
+bool Tokenize(const string& filename, const string& text,
+              vector<Token>* tokens, string* error) {
+  int line = 1;
+  int i = 0;
+
+  while (i < text.size()) {
+    char c = text[i];
+
+    if (c == '\n') {
+      line++;
+      i++;
+      continue;
+    }
+    if (c == ' ' || c == '\t' || c == '\r') {
+      i++;
+      continue;
+    }
+
+    Token token;
+    token.line = line;
+
+    if (IsIdentifierChar(c) && !('0' <= c && c <= '9')) {
+      int start = i;
+      while (i < text.size() && IsIdentifierChar(text[i])) i++;
+      token.kind = Token::IDENTIFIER;
+      token.text = text.substr(start, i - start);
+    } else if (('0' <= c && c <= '9') ||
+               (c == '.' && i + 1 < text.size() &&
+                '0' <= text[i + 1] && text[i + 1] <= '9')) {
+      int start = i;
+      if (c == '0' && i + 1 < text.size() &&
+          (text[i + 1] == 'x' || text[i + 1] == 'X')) {
+        i += 2;
+        while (i < text.size() && isxdigit(text[i])) i++;
+        token.kind = Token::INTEGER;
+        token.integer = strtoull(text.c_str() + start + 2, NULL, 16);
+      } else {
+        bool is_float = false;
+        while (i < text.size() &&
+               (('0' <= text[i] && text[i] <= '9') || text[i] == '.' ||
+                ((text[i] == 'e' || text[i] == 'E') && is_float))) {
+          if (text[i] == '.') is_float = true;
+          if ((text[i] == 'e' || text[i] == 'E') && i + 1 < text.size() &&
+              (text[i + 1] == '-' || text[i + 1] == '+')) {
+            i++;
+          }
+          i++;
+        }
+        if (i < text.size() && (text[i] == 'f' || text[i] == 'F')) {
+          is_float = true;
+          i++;
+        }
+        token.kind = is_float ? Token::FLOAT : Token::INTEGER;
+        token.number = strtod(text.c_str() + start, NULL);
+        token.integer = strtoll(text.c_str() + start, NULL, 10);
+      }
+      token.text = text.substr(start, i - start);
+    } else if (c == '"' || c == '\'') {
+      token.kind = c == '"' ? Token::STRING : Token::NAME;
+      for (i++; i < text.size() && text[i] != c; i++) {
+        if (text[i] == '\n') break;
+        if (text[i] == '\\' && i + 1 < text.size()) i++;
+        token.text.push_back(text[i]);
+      }
+      if (i >= text.size() || text[i] != c) {
+        *error = filename + ":" + SimpleItoa(line) + ": Unterminated " +
+                 (c == '"' ? "string." : "name.");
+        return false;
+      }
+      i++;
+    } else {
+      token.kind = Token::SYMBOL;
+      for (int j = 0; j < sizeof(kSymbols) / sizeof(kSymbols[0]); j++) {
+        if (text.compare(i, strlen(kSymbols[j]), kSymbols[j]) == 0) {
+          token.text = kSymbols[j];
+          break;
+        }
+      }
+      if (token.text.empty()) token.text = string(1, c);
+      i += token.text.size();
+    }
+
+    token.lower = Lower(token.text);
+    tokens->push_back(token);
+  }
+
+  Token end;
+  end.line = line;
+  tokens->push_back(end);
+  return true;
+}
+
+}  // namespace
+
+// ===================================================================
+// Parser
+
+#define DO(STATEMENT) if (STATEMENT) {} else return false
+
+class Emulator::Parser {
+ public:
+  Parser(Emulator* emulator, const string& filename)
+    : emulator_(emulator), program_(emulator->program_),
+      filename_(filename), pos_(0), function_(NULL) {}
+
+  // Expands the macros of the source, as the UnrealScript preprocessor
+  // does.  Only `define, `if, `else, `endif, `isdefined, `notdefined and
+  // macro calls are supported.
+  bool Preprocess(const string& source, string* output);
+
+  bool Parse(const string& text, ClassDef** klass);
+
+  const string& error() const { return error_; }
+
+ private:
+  bool Expand(const string& text, int depth, string* output);
+  bool ReadMacroArgs(const string& text, int* pos, vector<string>* args);
+
+  const Token& Peek(int offset = 0) const {
+    int index = pos_ + offset;
+    return tokens_[index < tokens_.size() ? index : tokens_.size() - 1];
+  }
+  const Token& Next() {
+    const Token& token = Peek();
+    if (pos_ + 1 < tokens_.size()) pos_++;
+    return token;
+  }
+  bool LookingAt(const string& lower) const {
+    return Peek().kind != Token::STRING && Peek().kind != Token::NAME &&
+           Peek().lower == lower;
+  }
+  bool TryConsume(const string& lower) {
+    if (!LookingAt(lower)) return false;
+    Next();
+    return true;
+  }
+  bool Consume(const string& lower) {
+    if (TryConsume(lower)) return true;
+    return Fail("Expected \"" + lower + "\", found \"" + Peek().text + "\".");
+  }
+  bool ConsumeIdentifier(string* lower, string* display = NULL) {
+    if (Peek().kind != Token::IDENTIFIER) {
+      return Fail("Expected identifier, found \"" + Peek().text + "\".");
+    }
+    if (display != NULL) *display = Peek().text;
+    *lower = Next().lower;
+    return true;
+  }
+  // Reads the name of a declaration, which can't be a keyword.
+  bool ConsumeName(string* lower, string* display = NULL) {
+    if (Peek().kind == Token::IDENTIFIER && IsReservedWord(Peek().lower)) {
+      return Fail("\"" + Peek().text + "\" is a reserved word.");
+    }
+    return ConsumeIdentifier(lower, display);
+  }
+  bool Fail(const string& message) {
+    error_ = filename_ + ":" + SimpleItoa(Peek().line) + ": " + message;
+    return false;
+  }
+
+  bool SkipBalanced(const string& open, const string& close);
+  bool ParseClassHeader(ClassDef* klass);
+  bool ParseType(Type** type);
+  bool ParseDimension(Type** type);
+  bool ParseVariables(vector<Variable>* variables, bool skip_modifiers);
+  bool ParseConst(ClassDef* klass);
+  bool ParseStruct(ClassDef* klass);
+  bool ParseEnum();
+  bool ParseFunction(ClassDef* klass);
+  bool ParseDefaultProperties(vector<DefaultProperty>* properties);
+
+  bool ParseStatement(Stmt** stmt);
+  bool ParseBlock(Stmt** stmt);
+  bool ParseSimpleStatement(Stmt** stmt);
+  bool ParseExpression(Expr** expr);
+  bool ParseBinary(int level, Expr** expr);
+  bool ParseUnary(Expr** expr);
+  bool ParsePostfix(Expr** expr, bool allow_calls);
+  bool ParsePrimary(Expr** expr, bool allow_calls);
+  bool ParseArgs(vector<Expr*>* args);
+
+  Expr* MakeExpr(Expr::Kind kind) {
+    Expr* expr = program_->Make<Expr>();
+    expr->kind = kind;
+    expr->line = Peek().line;
+    return expr;
+  }
+  Stmt* MakeStmt(Stmt::Kind kind) {
+    Stmt* stmt = program_->Make<Stmt>();
+    stmt->kind = kind;
+    stmt->line = Peek().line;
+    return stmt;
+  }
+
+  Emulator* emulator_;
+  Program* program_;
+  string filename_;
+  vector<Token> tokens_;
+  int pos_;
+  FunctionDef* function_;
+  string error_;
+};
+
+bool Emulator::Parser::Preprocess(const string& source, string* output) {
+  return Expand(StripComments(source), 0, output);
+}
+
+// Reads the parenthesized, comma separated arguments of a macro call or
+// directive, starting at text[*pos] == '('.
+bool Emulator::Parser::ReadMacroArgs(const string& text, int* pos,
+                                     vector<string>* args) {
+  int depth = 0;
+  string arg;
+
+  for (; *pos < text.size(); ++*pos) {
+    char c = text[*pos];
+
+    if (c == '"') {
+      int end = *pos + 1;
+      while (end < text.size() && text[end] != '"') {
+        if (text[end] == '\\') end++;
+        end++;
+      }
+      arg += text.substr(*pos, end - *pos + 1);
+      *pos = end;
+      continue;
+    }
+
+    if (c == '(' && depth++ == 0) continue;
+    if (c == ')' && --depth == 0) {
+      args->push_back(arg);
+      ++*pos;
+      return true;
+    }
+    if (c == ',' && depth == 1) {
+      args->push_back(arg);
+      arg.clear();
+      continue;
+    }
+    arg.push_back(c);
+  }
+
+  error_ = filename_ + ": Unterminated macro arguments.";
+  return false;
+}
+
+bool Emulator::Parser::Expand(const string& text, int depth,
+                              string* output) {
+  if (depth > 32) {
+    error_ = filename_ + ": Macros nested too deeply.";
+    return false;
+  }
+
+  // Whether the text is copied, for every `if being read.
+  vector<bool> active;
+  vector<bool> parent_active;
+  bool copying = true;
+
+  for (int i = 0; i < text.size(); ) {
+    char c = text[i];
+
+    if (c == '"') {
+      int end = i + 1;
+      while (end < text.size() && text[end] != '"' && text[end] != '\n') {
+        if (text[end] == '\\') end++;
+        end++;
+      }
+      if (copying) output->append(text, i, end - i + 1);
+      i = end + 1;
+      continue;
+    }
+
+    if (c != '`') {
+      if (copying || c == '\n') output->push_back(c);
+      i++;
+      continue;
+    }
+
+    int start = ++i;
+    if (i < text.size() && text[i] == '{') i++;
+    while (i < text.size() && IsIdentifierChar(text[i])) i++;
+    string name = Lower(text.substr(start, i - start));
+    if (!name.empty() && name[0] == '{') {
+      name = name.substr(1);
+      if (i < text.size() && text[i] == '}') i++;
+    }
+
+    if (name == "if") {
+      vector<string> args;
+      DO(ReadMacroArgs(text, &i, &args));
+      string condition;
+      DO(Expand(args.empty() ? "" : args[0], depth + 1, &condition));
+      parent_active.push_back(copying);
+      copying = copying && !Trim(condition).empty();
+      active.push_back(copying);
+    } else if (name == "else") {
+      if (active.empty()) {
+        error_ = filename_ + ": `else without `if.";
+        return false;
+      }
+      copying = parent_active.back() && !active.back();
+      active.back() = copying;
+    } else if (name == "endif") {
+      if (active.empty()) {
+        error_ = filename_ + ": `endif without `if.";
+        return false;
+      }
+      copying = parent_active.back();
+      active.pop_back();
+      parent_active.pop_back();
+    } else if (!copying) {
+      continue;
+    } else if (name == "define") {
+      while (i < text.size() && (text[i] == ' ' || text[i] == '\t')) i++;
+      int name_start = i;
+      while (i < text.size() && IsIdentifierChar(text[i])) i++;
+      string macro = Lower(text.substr(name_start, i - name_start));
+
+      // Parameters are kept with the body, and bound when it's expanded.
+      int end = text.find('\n', i);
+      if (end == string::npos) end = text.size();
+      emulator_->macros_[macro] = text.substr(i, end - i);
+      i = end;
+    } else if (name == "isdefined" || name == "notdefined") {
+      vector<string> args;
+      DO(ReadMacroArgs(text, &i, &args));
+      string macro;
+      DO(Expand(args.empty() ? "" : args[0], depth + 1, &macro));
+      bool defined = emulator_->macros_.count(
+        Lower(Trim(macro))) > 0;
+      if (defined == (name == "isdefined")) output->append("1");
+    } else if (name == "include") {
+      // Globals.uci is added to the emulator like the engine includes it in
+      // every class; other includes aren't used by the runtime.
+      vector<string> args;
+      DO(ReadMacroArgs(text, &i, &args));
+    } else if (name == "log" || name == "warn") {
+      vector<string> args;
+      if (i < text.size() && text[i] == '(') {
+        DO(ReadMacroArgs(text, &i, &args));
+      }
+      string message;
+      DO(Expand(args.empty() ? "\"\"" : args[0], depth + 1, &message));
+      output->append((name == "log" ? "Log(" : "Warn(") + message + ")");
+    } else {
+      map<string, string>::const_iterator macro =
+        emulator_->macros_.find(name);
+      if (macro == emulator_->macros_.end()) {
+        error_ = filename_ + ": Unknown macro `" + name + ".";
+        return false;
+      }
+
+      string body = macro->second;
+      vector<string> params;
+      if (!body.empty() && body[0] == '(') {
+        int pos = 0;
+        DO(ReadMacroArgs(body, &pos, &params));
+        body = body.substr(pos);
+      }
+
+      vector<string> args;
+      if (!params.empty() && i < text.size() && text[i] == '(') {
+        DO(ReadMacroArgs(text, &i, &args));
+      }
+
+      // Binds `param in the body to the arguments.
+      string bound;
+      for (int j = 0; j < body.size(); j++) {
+        if (body[j] == '`') {
+          int end = j + 1;
+          while (end < body.size() && IsIdentifierChar(body[end])) end++;
+          string param = body.substr(j + 1, end - j - 1);
+          int k = 0;
+          while (k < params.size() && Trim(params[k]) != param) {
+            k++;
+          }
+          if (k < params.size()) {
+            if (k < args.size()) bound += args[k];
+            j = end - 1;
+            continue;
+          }
+        }
+        bound.push_back(body[j]);
+      }
+
+      DO(Expand(bound, depth + 1, output));
+    }
+  }
+
+  if (!active.empty()) {
+    error_ = filename_ + ": `if without `endif.";
+    return false;
+  }
+  return true;
+}
+
+bool Emulator::Parser::SkipBalanced(const string& open,
+                                    const string& close) {
+  DO(Consume(open));
+  int depth = 1;
+
+  while (depth > 0) {
+    if (Peek().kind == Token::END) return Fail("Unexpected end of file.");
+    if (LookingAt(open)) depth++;
+    if (LookingAt(close)) depth--;
+    Next();
+  }
+  return true;
+}
+
+bool Emulator::Parser::Parse(const string& text, ClassDef** result) {
+  DO(Tokenize(filename_, text, &tokens_, &error_));
+
+  ClassDef* klass = program_->Make<ClassDef>();
+  klass->filename = filename_;
+  DO(ParseClassHeader(klass));
+
+  while (Peek().kind != Token::END) {
+    if (TryConsume(";")) {
+      continue;
+    } else if (TryConsume("var")) {
+      DO(ParseVariables(&klass->own_variables, true));
+    } else if (TryConsume("const")) {
+      DO(ParseConst(klass));
+    } else if (TryConsume("struct")) {
+      DO(ParseStruct(klass));
+    } else if (TryConsume("enum")) {
+      DO(ParseEnum());
+    } else if (TryConsume("defaultproperties")) {
+      DO(ParseDefaultProperties(&klass->default_properties));
+    } else if (TryConsume("cpptext") || TryConsume("replication")) {
+      DO(SkipBalanced("{", "}"));
+    } else if (LookingAt("state")) {
+      return Fail("States are not supported.");
+    } else {
+      DO(ParseFunction(klass));
+    }
+  }
+
+  *result = klass;
+  return true;
+}
+
+bool Emulator::Parser::ParseClassHeader(ClassDef* klass) {
+  DO(Consume("class"));
+  DO(ConsumeName(&klass->name, &klass->display_name));
+
+  if (TryConsume("extends")) {
+    DO(ConsumeIdentifier(&klass->parent_name));
+    if (klass->parent_name == "object") klass->parent_name.clear();
+  }
+
+  // Class modifiers, e.g. abstract or config(Game).
+  while (!LookingAt(";")) {
+    if (Peek().kind == Token::END) return Fail("Expected \";\".");
+    if (TryConsume("abstract")) {
+      klass->is_abstract = true;
+    } else if (LookingAt("(")) {
+      DO(SkipBalanced("(", ")"));
+    } else {
+      Next();
+    }
+  }
+
+  return Consume(";");
+}
+
+bool Emulator::Parser::ParseType(Type** result) {
+  Type* type = program_->Make<Type>();
+  string name;
+  DO(ConsumeIdentifier(&name));
+
+  if (name == "int") {
+    type->kind = Type::INT;
+  } else if (name == "byte") {
+    type->kind = Type::BYTE;
+  } else if (name == "bool") {
+    type->kind = Type::BOOL;
+  } else if (name == "float") {
+    type->kind = Type::FLOAT;
+  } else if (name == "string") {
+    type->kind = Type::STRING;
+  } else if (name == "name") {
+    type->kind = Type::NAME;
+  } else if (name == "array" || (name == "class" && LookingAt("<"))) {
+    type->kind = name == "array" ? Type::ARRAY : Type::CLASS;
+    DO(Consume("<"));
+
+    if (type->kind == Type::ARRAY) {
+      DO(ParseType(&type->element));
+    } else {
+      DO(ConsumeIdentifier(&type->name));
+    }
+
+    // The closing brackets of array<class<Message>> are read as ">>".
+    if (LookingAt(">>")) {
+      tokens_[pos_].text = tokens_[pos_].lower = ">";
+    } else {
+      DO(Consume(">"));
+    }
+  } else if (name == "class") {
+    type->kind = Type::CLASS;
+    type->name = "object";
+  } else {
+    type->kind = Type::OBJECT;
+    type->name = name;
+
+    // A struct of another class, e.g. Message.Int64.
+    if (LookingAt(".") && Peek(1).kind == Token::IDENTIFIER) {
+      Next();
+      type->name += "." + Next().lower;
+    }
+  }
+
+  *result = type;
+  return true;
+}
+
+// Reads the size of a static array, e.g. "[2]".
+bool Emulator::Parser::ParseDimension(Type** type) {
+  if (!TryConsume("[")) return true;
+
+  if (Peek().kind != Token::INTEGER) {
+    return Fail("Expected the size of the array.");
+  }
+
+  Type* array = program_->Make<Type>();
+  array->kind = Type::STATIC_ARRAY;
+  array->element = *type;
+  array->size = Next().integer;
+  *type = array;
+
+  return Consume("]");
+}
+
+bool Emulator::Parser::ParseVariables(vector<Variable>* variables,
+                                      bool skip_modifiers) {
+  if (LookingAt("(")) {
+    DO(SkipBalanced("(", ")"));
+  }
+
+  static const char* const kModifiers[] = {
+    "transient", "config", "globalconfig", "const", "private", "protected",
+    "public", "native", "noexport", "editconst", "localized", "repnotify",
+    "duplicatetransient", "instanced", "export", "editinline", "deprecated",
+    "editfixedsize", "input", "noimport", "databinding", "edithide",
+    "editoronly", "notforconsole", "archetype", "crosslevelpassive",
+  };
+
+  while (skip_modifiers) {
+    bool found = false;
+    for (int i = 0; i < sizeof(kModifiers) / sizeof(kModifiers[0]); i++) {
+      if (TryConsume(kModifiers[i])) {
+        found = true;
+        if (LookingAt("(")) {
+          DO(SkipBalanced("(", ")"));
+        }
+        break;
+      }
+    }
+    if (!found) break;
+  }
+
+  Type* type;
+  DO(ParseType(&type));
+
+  do {
+    Variable variable;
+    variable.type = type;
+    DO(ConsumeName(&variable.name));
+    DO(ParseDimension(&variable.type));
+    variables->push_back(variable);
+  } while (TryConsume(","));
+
+  return Consume(";");
+}
+
+bool Emulator::Parser::ParseConst(ClassDef* klass) {
+  string name;
+  DO(ConsumeName(&name));
+  DO(Consume("="));
+
+  Expr* value;
+  DO(ParseExpression(&value));
+  klass->consts[name] = value;
+
+  return Consume(";");
+}
+
+bool Emulator::Parser::ParseStruct(ClassDef* klass) {
+  StructDef* structure = program_->Make<StructDef>();
+  structure->owner = klass;
+
+  // Struct modifiers, e.g. native or immutable.
+  while (Peek(1).kind == Token::IDENTIFIER || LookingAt("(")) {
+    if (LookingAt("(")) {
+      DO(SkipBalanced("(", ")"));
+    } else {
+      Next();
+    }
+  }
+
+  DO(ConsumeName(&structure->name));
+  if (TryConsume("extends")) {
+    return Fail("Struct inheritance is not supported.");
+  }
+  DO(Consume("{"));
+
+  while (!TryConsume("}")) {
+    if (TryConsume("var")) {
+      DO(ParseVariables(&structure->members, true));
+    } else if (TryConsume("structdefaultproperties")) {
+      DO(ParseDefaultProperties(&structure->default_properties));
+    } else if (TryConsume("structcpptext")) {
+      DO(SkipBalanced("{", "}"));
+    } else {
+      return Fail("Expected \"var\", found \"" + Peek().text + "\".");
+    }
+  }
+
+  for (int i = 0; i < structure->members.size(); i++) {
+    structure->index[structure->members[i].name] = i;
+  }
+
+  klass->structs[structure->name] = structure;
+  return Consume(";");
+}
+
+// Enum values are global constants, as in UnrealScript.
+bool Emulator::Parser::ParseEnum() {
+  string name;
+  DO(ConsumeName(&name));
+  DO(Consume("{"));
+  program_->enum_types.insert(name);
+
+  int value = 0;
+  while (!TryConsume("}")) {
+    string value_name;
+    DO(ConsumeName(&value_name));
+    if (LookingAt("(")) {
+      DO(SkipBalanced("(", ")"));
+    }
+    program_->enum_values[value_name] = value++;
+    if (!LookingAt("}")) {
+      DO(Consume(","));
+    }
+  }
+
+  return Consume(";");
+}
+
+bool Emulator::Parser::ParseFunction(ClassDef* klass) {
+  FunctionDef* function = program_->Make<FunctionDef>();
+  function->owner = klass;
+
+  // Modifiers up to the function keyword.
+  while (!TryConsume("function") && !TryConsume("event")) {
+    if (Peek().kind != Token::IDENTIFIER) {
+      return Fail("Expected declaration, found \"" + Peek().text + "\".");
+    }
+    if (TryConsume("static")) {
+      function->is_static = true;
+    } else {
+      Next();
+      if (LookingAt("(")) {
+        DO(SkipBalanced("(", ")"));
+      }
+    }
+  }
+
+  if (!(Peek(1).kind == Token::SYMBOL && Peek(1).text == "(")) {
+    DO(ParseType(&function->return_type));
+  }
+  DO(ConsumeName(&function->name, &function->display_name));
+  DO(Consume("("));
+
+  while (!TryConsume(")")) {
+    Param param;
+
+    while (true) {
+      if (TryConsume("out")) {
+        param.out = true;
+      } else if (TryConsume("optional")) {
+        param.optional = true;
+      } else if (!TryConsume("coerce") && !TryConsume("const")) {
+        break;
+      }
+    }
+
+    DO(ParseType(&param.type));
+    DO(ConsumeName(&param.name));
+    DO(ParseDimension(&param.type));
+    if (TryConsume("=")) {
+      DO(ParseExpression(&param.default_value));
+    }
+    function->params.push_back(param);
+
+    if (!LookingAt(")")) {
+      DO(Consume(","));
+    }
+  }
+
+  // Function modifiers after the parameters, e.g. const.
+  while (Peek().kind == Token::IDENTIFIER) Next();
+
+  if (klass->functions.count(function->name) > 0) {
+    return Fail("Function " + function->display_name + " defined twice.");
+  }
+  klass->functions[function->name] = function;
+
+  if (TryConsume(";")) return true;
+
+  function_ = function;
+  DO(ParseBlock(&function->body));
+  function_ = NULL;
+  return true;
+}
+
+bool Emulator::Parser::ParseDefaultProperties(
+    vector<DefaultProperty>* properties) {
+  DO(Consume("{"));
+
+  while (!TryConsume("}")) {
+    if (TryConsume(";")) continue;
+
+    DefaultProperty property;
+    property.line = Peek().line;
+    DO(ConsumeIdentifier(&property.name));
+
+    if (TryConsume("(") || TryConsume("[")) {
+      if (Peek().kind != Token::INTEGER) {
+        return Fail("Expected an array index.");
+      }
+      property.index = Next().integer;
+      if (!TryConsume(")")) {
+        DO(Consume("]"));
+      }
+    }
+
+    DO(Consume("="));
+    DO(ParseExpression(&property.value));
+    properties->push_back(property);
+  }
+
+  return true;
+}
+
+bool Emulator::Parser::ParseBlock(Stmt** result) {
+  Stmt* block = MakeStmt(Stmt::BLOCK);
+  DO(Consume("{"));
+
+  while (!TryConsume("}")) {
+    if (Peek().kind == Token::END) return Fail("Expected \"}\".");
+    Stmt* stmt;
+    DO(ParseStatement(&stmt));
+    if (stmt != NULL) block->body.push_back(stmt);
+  }
+
+  *result = block;
+  return true;
+}
+
+bool Emulator::Parser::ParseStatement(Stmt** result) {
+  *result = NULL;
+
+  if (LookingAt("{")) {
+    return ParseBlock(result);
+  }
+
+  if (TryConsume(";")) {
+    *result = MakeStmt(Stmt::EMPTY);
+    return true;
+  }
+
+  if (TryConsume("local")) {
+    if (function_ == NULL) return Fail("Local outside of a function.");
+    return ParseVariables(&function_->locals, false);
+  }
+
+  Stmt* stmt;
+
+  if (TryConsume("if")) {
+    stmt = MakeStmt(Stmt::IF);
+    DO(Consume("("));
+    DO(ParseExpression(&stmt->expr));
+    DO(Consume(")"));
+    DO(ParseStatement(&stmt->then));
+    if (TryConsume("else")) {
+      DO(ParseStatement(&stmt->otherwise));
+    }
+  } else if (TryConsume("while")) {
+    stmt = MakeStmt(Stmt::WHILE);
+    DO(Consume("("));
+    DO(ParseExpression(&stmt->expr));
+    DO(Consume(")"));
+    DO(ParseStatement(&stmt->then));
+  } else if (TryConsume("do")) {
+    stmt = MakeStmt(Stmt::DO);
+    DO(ParseStatement(&stmt->then));
+    DO(Consume("until"));
+    DO(Consume("("));
+    DO(ParseExpression(&stmt->expr));
+    DO(Consume(")"));
+    TryConsume(";");
+  } else if (TryConsume("for")) {
+    stmt = MakeStmt(Stmt::FOR);
+    DO(Consume("("));
+    DO(ParseSimpleStatement(&stmt->init));
+    DO(Consume(";"));
+    DO(ParseExpression(&stmt->expr));
+    DO(Consume(";"));
+    DO(ParseSimpleStatement(&stmt->step));
+    DO(Consume(")"));
+    DO(ParseStatement(&stmt->then));
+  } else if (TryConsume("switch")) {
+    stmt = MakeStmt(Stmt::SWITCH);
+    DO(Consume("("));
+    DO(ParseExpression(&stmt->expr));
+    DO(Consume(")"));
+    DO(Consume("{"));
+
+    while (!TryConsume("}")) {
+      if (TryConsume("case")) {
+        Stmt::Case label;
+        DO(ParseExpression(&label.label));
+        DO(Consume(":"));
+        stmt->cases.push_back(label);
+      } else if (TryConsume("default")) {
+        Stmt::Case label;
+        label.label = NULL;
+        DO(Consume(":"));
+        stmt->cases.push_back(label);
+      } else {
+        if (stmt->cases.empty()) return Fail("Expected \"case\".");
+        Stmt* body;
+        DO(ParseStatement(&body));
+        if (body != NULL) stmt->cases.back().body.push_back(body);
+      }
+    }
+  } else if (TryConsume("return")) {
+    stmt = MakeStmt(Stmt::RETURN);
+    if (!LookingAt(";")) {
+      DO(ParseExpression(&stmt->expr));
+    }
+    DO(Consume(";"));
+  } else if (TryConsume("break")) {
+    stmt = MakeStmt(Stmt::BREAK);
+    DO(Consume(";"));
+  } else if (TryConsume("continue")) {
+    stmt = MakeStmt(Stmt::CONTINUE);
+    DO(Consume(";"));
+  } else {
+    DO(ParseSimpleStatement(&stmt));
+    DO(Consume(";"));
+  }
+
+  *result = stmt;
+  return true;
+}
+
+// An expression or an assignment, as in the clauses of a for loop.
+bool Emulator::Parser::ParseSimpleStatement(Stmt** result) {
+  Stmt* stmt = MakeStmt(Stmt::EXPRESSION);
+  DO(ParseExpression(&stmt->expr));
+
+  static const char* const kAssignments[] = {
+    "=", "+=", "-=", "*=", "/=", "$=", "@=", "|=", "&=",
+  };
+
+  for (int i = 0; i < sizeof(kAssignments) / sizeof(kAssignments[0]); i++) {
+    if (Peek().kind == Token::SYMBOL && Peek().text == kAssignments[i]) {
+      Expr* assign = MakeExpr(Expr::ASSIGN);
+      assign->op = Next().text;
+      assign->a = stmt->expr;
+      DO(ParseExpression(&assign->b));
+      stmt->expr = assign;
+      break;
+    }
+  }
+
+  *result = stmt;
+  return true;
+}
+
+namespace {
+
+// Binary operators by precedence, tightest first, as in UnrealScript.
+const char* const kBinaryOperators[][7] = {
+  { "**" },
+  { "*", "/", "%" },
+  { "+", "-" },
+  { "<<", ">>", ">>>" },
+  { "<", ">", "<=", ">=", "==", "!=", "~=" },
+  { "&", "|", "^" },
+  { "&&", "^^" },
+  { "||" },
+  { "$", "@" },
+};
+
+const int kBinaryLevels =
+  sizeof(kBinaryOperators) / sizeof(kBinaryOperators[0]);
+
+}  // namespace
+
+bool Emulator::Parser::ParseExpression(Expr** result) {
+  DO(ParseBinary(kBinaryLevels - 1, result));
+
+  if (TryConsume("?")) {
+    Expr* ternary = MakeExpr(Expr::TERNARY);
+    ternary->a = *result;
+    DO(ParseExpression(&ternary->b));
+    DO(Consume(":"));
+    DO(ParseExpression(&ternary->c));
+    *result = ternary;
+  }
+
+  return true;
+}
+
+bool Emulator::Parser::ParseBinary(int level, Expr** result) {
+  if (level < 0) return ParseUnary(result);
+  DO(ParseBinary(level - 1, result));
+
+  while (Peek().kind == Token::SYMBOL) {
+    const char* const* ops = kBinaryOperators[level];
+    int i = 0;
+    while (i < 7 && ops[i] != NULL && Peek().text != ops[i]) i++;
+    if (i == 7 || ops[i] == NULL) break;
+
+    Expr* binary = MakeExpr(Expr::BINARY);
+    binary->op = Next().text;
+    binary->a = *result;
+    DO(ParseBinary(level - 1, &binary->b));
+    *result = binary;
+  }
+
+  return true;
+}
+
+bool Emulator::Parser::ParseUnary(Expr** result) {
+  if (Peek().kind == Token::SYMBOL) {
+    const string& op = Peek().text;
+
+    if (op == "!" || op == "-" || op == "~" || op == "+") {
+      Expr* unary = MakeExpr(Expr::UNARY);
+      unary->op = Next().text;
+      DO(ParseUnary(&unary->a));
+      *result = unary;
+      return true;
+    }
+
+    if (op == "++" || op == "--") {
+      Expr* increment = MakeExpr(Expr::PRE_INCREMENT);
+      increment->op = Next().text;
+      DO(ParseUnary(&increment->a));
+      *result = increment;
+      return true;
+    }
+  }
+
+  return ParsePostfix(result, true);
+}
+
+bool Emulator::Parser::ParseArgs(vector<Expr*>* args) {
+  DO(Consume("("));
+
+  while (!TryConsume(")")) {
+    // Optional arguments may be left out, as in F(a,,c).
+    if (LookingAt(",")) {
+      args->push_back(NULL);
+    } else {
+      Expr* arg;
+      DO(ParseExpression(&arg));
+      args->push_back(arg);
+    }
+    if (!LookingAt(")")) {
+      DO(Consume(","));
+    }
+  }
+
+  return true;
+}
+
+bool Emulator::Parser::ParsePostfix(Expr** result, bool allow_calls) {
+  DO(ParsePrimary(result, allow_calls));
+
+  while (true) {
+    if (TryConsume(".")) {
+      string name;
+      DO(ConsumeIdentifier(&name));
+
+      if (name == "static") {
+        Expr* call = MakeExpr(Expr::STATIC_CALL);
+        call->a = *result;
+        DO(Consume("."));
+        DO(ConsumeIdentifier(&call->name));
+        DO(ParseArgs(&call->args));
+        *result = call;
+      } else if (name == "const") {
+        Expr* constant = MakeExpr(Expr::CONST_OF);
+        constant->a = *result;
+        DO(Consume("."));
+        DO(ConsumeIdentifier(&constant->name));
+        *result = constant;
+      } else if (name == "default") {
+        return Fail("Default values of classes are not supported.");
+      } else if (allow_calls && LookingAt("(")) {
+        Expr* call = MakeExpr(Expr::METHOD_CALL);
+        call->a = *result;
+        call->name = name;
+        DO(ParseArgs(&call->args));
+        *result = call;
+      } else {
+        Expr* member = MakeExpr(Expr::MEMBER);
+        member->a = *result;
+        member->name = name;
+        *result = member;
+      }
+    } else if (TryConsume("[")) {
+      Expr* index = MakeExpr(Expr::INDEX);
+      index->a = *result;
+      DO(ParseExpression(&index->b));
+      DO(Consume("]"));
+      *result = index;
+    } else if (LookingAt("++") || LookingAt("--")) {
+      Expr* increment = MakeExpr(Expr::POST_INCREMENT);
+      increment->op = Next().text;
+      increment->a = *result;
+      *result = increment;
+    } else {
+      return true;
+    }
+  }
+}
+
+bool Emulator::Parser::ParsePrimary(Expr** result, bool allow_calls) {
+  const Token& token = Peek();
+  Expr* expr = MakeExpr(Expr::LITERAL);
+
+  switch (token.kind) {
+    case Token::INTEGER:
+      expr->value = Value::Int(Wrap(Next().integer));
+      break;
+
+    case Token::FLOAT:
+      expr->value = Value::Float(static_cast<float>(Next().number));
+      break;
+
+    case Token::STRING:
+      expr->value = Value::String(Next().text);
+      break;
+
+    case Token::NAME:
+      expr->value = Value::String(Next().text);
+      expr->value.kind = Value::NAME;
+      break;
+
+    case Token::SYMBOL:
+      if (!TryConsume("(")) {
+        return Fail("Unexpected \"" + token.text + "\".");
+      }
+      DO(ParseExpression(&expr));
+      DO(Consume(")"));
+      break;
+
+    case Token::IDENTIFIER: {
+      string name = Next().lower;
+
+      if (name == "true" || name == "false") {
+        expr->value = Value::Bool(name == "true");
+      } else if (name == "none") {
+        expr->value = Value::ObjectRef(NULL);
+      } else if (name == "self") {
+        expr->kind = Expr::SELF;
+      } else if (name == "super") {
+        expr->kind = Expr::SUPER;
+        if (LookingAt("(")) {
+          return Fail("super(Class) is not supported.");
+        }
+      } else if (name == "new") {
+        expr->kind = Expr::NEW;
+        if (LookingAt("(")) {
+          DO(SkipBalanced("(", ")"));
+        }
+        DO(ParsePostfix(&expr->a, false));
+      } else if (name == "class" && Peek().kind == Token::NAME) {
+        expr->kind = Expr::CLASS_NAME;
+        expr->name = Next().lower;
+      } else if (allow_calls && LookingAt("(")) {
+        expr->kind = Expr::CALL;
+        expr->name = name;
+        DO(ParseArgs(&expr->args));
+      } else {
+        expr->kind = Expr::NAME;
+        expr->name = name;
+      }
+      break;
+    }
+
+    case Token::END:
+      return Fail("Unexpected end of file.");
+  }
+
+  *result = expr;
+  return true;
+}
+
+// ===================================================================
+// Linker
+
+class Emulator::Linker {
+ public:
+  explicit Linker(Emulator* emulator)
+    : emulator_(emulator), program_(emulator->program_) {}
+
+  bool Link(ClassDef* klass);
+
+  const string& error() const { return error_; }
+
+ private:
+  bool Fail(const ClassDef* klass, int line, const string& message) {
+    error_ = klass->filename + ":" + SimpleItoa(line) + ": " + message;
+    return false;
+  }
+
+  bool ResolveType(const ClassDef* klass, Type* type);
+  const StructDef* FindStruct(const ClassDef* klass, const string& name);
+  bool LinkStruct(StructDef* structure);
+  bool FindConst(const ClassDef* klass, const string& name, Value* value);
+  bool Evaluate(const ClassDef* klass, Expr* expr, Value* value);
+  bool ApplyDefaults(const ClassDef* klass,
+                     const vector<DefaultProperty>& properties,
+                     const vector<Variable>& variables,
+                     const map<string, int>& index,
+                     vector<Value>* values);
+  bool LinkFunction(ClassDef* klass, FunctionDef* function);
+  bool ResolveStmt(Stmt* stmt);
+  bool ResolveExpr(Expr* expr);
+
+  Emulator* emulator_;
+  Program* program_;
+  string error_;
+
+  // While resolving a function.
+  const ClassDef* klass_;
+  const FunctionDef* function_;
+  map<string, int> locals_;
+  set<const StructDef*> linking_structs_;
+};
+
+bool Emulator::Linker::Link(ClassDef* klass) {
+  if (klass->linked) return true;
+
+  if (!klass->parent_name.empty()) {
+    map<string, ClassDef*>::iterator parent =
+      program_->classes.find(klass->parent_name);
+    if (parent == program_->classes.end()) {
+      return Fail(klass, 1, "Unknown parent class " + klass->parent_name +
+                  ".");
+    }
+    if (parent->second->IsA(klass)) {
+      return Fail(klass, 1, "Class extends itself.");
+    }
+    DO(Link(parent->second));
+    klass->parent = parent->second;
+
+    klass->variables = klass->parent->variables;
+    klass->variable_index = klass->parent->variable_index;
+    klass->vtable = klass->parent->vtable;
+    klass->defaults = klass->parent->defaults;
+  }
+
+  // Marked first, as functions may refer to the class itself.
+  klass->linked = true;
+
+  for (map<string, StructDef*>::iterator it = klass->structs.begin();
+       it != klass->structs.end(); ++it) {
+    DO(LinkStruct(it->second));
+  }
+
+  for (int i = 0; i < klass->own_variables.size(); i++) {
+    Variable variable = klass->own_variables[i];
+    DO(ResolveType(klass, variable.type));
+
+    if (klass->variable_index.count(variable.name) > 0) {
+      return Fail(klass, 1, "Variable " + variable.name + " defined twice.");
+    }
+    klass->variable_index[variable.name] = klass->variables.size();
+    klass->variables.push_back(variable);
+    klass->defaults.push_back(DefaultValue(variable.type));
+  }
+
+  for (map<string, FunctionDef*>::iterator it = klass->functions.begin();
+       it != klass->functions.end(); ++it) {
+    klass->vtable[it->first] = it->second;
+  }
+
+  DO(ApplyDefaults(klass, klass->default_properties, klass->variables,
+                   klass->variable_index, &klass->defaults));
+
+  for (map<string, FunctionDef*>::iterator it = klass->functions.begin();
+       it != klass->functions.end(); ++it) {
+    DO(LinkFunction(klass, it->second));
+  }
+
+  return true;
+}
+
+const StructDef* Emulator::Linker::FindStruct(const ClassDef* klass,
+                                              const string& name) {
+  string::size_type dot = name.find('.');
+  if (dot != string::npos) {
+    klass = program_->FindClass(name.substr(0, dot));
+    if (klass == NULL) return NULL;
+    return FindStruct(klass, name.substr(dot + 1));
+  }
+
+  for (; klass != NULL; klass = klass->parent) {
+    map<string, StructDef*>::const_iterator it = klass->structs.find(name);
+    if (it != klass->structs.end()) return it->second;
+  }
+  return NULL;
+}
+
+bool Emulator::Linker::LinkStruct(StructDef* structure) {
+  if (structure->defaults.kind == Value::STRUCT) return true;
+
+  if (linking_structs_.count(structure) > 0) {
+    return Fail(structure->owner, 1,
+                "Struct " + structure->name + " contains itself.");
+  }
+  linking_structs_.insert(structure);
+
+  Value defaults;
+  for (int i = 0; i < structure->members.size(); i++) {
+    DO(ResolveType(structure->owner, structure->members[i].type));
+    defaults.elements.push_back(
+      DefaultValue(structure->members[i].type));
+  }
+
+  DO(ApplyDefaults(structure->owner, structure->default_properties,
+                   structure->members, structure->index,
+                   &defaults.elements));
+
+  linking_structs_.erase(structure);
+
+  Type* type = program_->Make<Type>();
+  type->kind = Type::STRUCT;
+  type->name = structure->name;
+  type->structure = structure;
+
+  defaults.kind = Value::STRUCT;
+  defaults.type = type;
+  structure->defaults = defaults;
+  return true;
+}
+
+bool Emulator::Linker::ResolveType(const ClassDef* klass, Type* type) {
+  if (type->element != NULL) {
+    return ResolveType(klass, type->element);
+  }
+
+  if (type->kind == Type::CLASS) {
+    if (type->name != "object" && program_->FindClass(type->name) == NULL) {
+      return Fail(klass, 1, "Unknown class " + type->name + ".");
+    }
+    type->klass = program_->FindClass(type->name);
+    return true;
+  }
+
+  if (type->kind != Type::OBJECT || type->klass != NULL ||
+      type->structure != NULL) {
+    return true;
+  }
+
+  if (program_->enum_types.count(type->name) > 0) {
+    type->kind = Type::BYTE;
+    return true;
+  }
+
+  const StructDef* structure = FindStruct(klass, type->name);
+  if (structure != NULL) {
+    DO(LinkStruct(const_cast<StructDef*>(structure)));
+    type->kind = Type::STRUCT;
+    type->structure = structure;
+    return true;
+  }
+
+  type->klass = program_->FindClass(type->name);
+  if (type->klass == NULL && type->name != "object") {
+    return Fail(klass, 1, "Unknown type " + type->name + ".");
+  }
+  return true;
+}
+
+bool Emulator::Linker::FindConst(const ClassDef* klass, const string& name,
+                                 Value* value) {
+  for (; klass != NULL; klass = klass->parent) {
+    map<string, Expr*>::const_iterator it = klass->consts.find(name);
+    if (it != klass->consts.end()) {
+      return Evaluate(klass, it->second, value);
+    }
+  }
+
+  map<string, int>::const_iterator it = program_->enum_values.find(name);
+  if (it != program_->enum_values.end()) {
+    *value = Value::Byte(it->second);
+    return true;
+  }
+
+  return false;
+}
+
+// Evaluates the constant expressions of consts and default properties.
+bool Emulator::Linker::Evaluate(const ClassDef* klass, Expr* expr,
+                                Value* value) {
+  switch (expr->kind) {
+    case Expr::LITERAL:
+      *value = expr->value;
+      return true;
+
+    case Expr::UNARY:
+      DO(Evaluate(klass, expr->a, value));
+      if (expr->op == "-" && value->kind == Value::FLOAT) {
+        value->f = -value->f;
+      } else if (expr->op == "-") {
+        value->i = Wrap(-static_cast<int64>(value->i));
+      } else if (expr->op != "+") {
+        return Fail(klass, expr->line, "Expected a constant.");
+      }
+      return true;
+
+    case Expr::NAME:
+      if (FindConst(klass, expr->name, value)) return true;
+      return Fail(klass, expr->line, "Unknown constant " + expr->name + ".");
+
+    case Expr::CLASS_NAME:
+      value->kind = Value::CLASS;
+      value->klass = program_->FindClass(expr->name);
+      if (value->klass != NULL) return true;
+      return Fail(klass, expr->line, "Unknown class " + expr->name + ".");
+
+    default:
+      return Fail(klass, expr->line, "Expected a constant.");
+  }
+}
+
+bool Emulator::Linker::ApplyDefaults(const ClassDef* klass,
+                                     const vector<DefaultProperty>& properties,
+                                     const vector<Variable>& variables,
+                                     const map<string, int>& index,
+                                     vector<Value>* values) {
+  for (int i = 0; i < properties.size(); i++) {
+    const DefaultProperty& property = properties[i];
+    map<string, int>::const_iterator it = index.find(property.name);
+    if (it == index.end()) {
+      return Fail(klass, property.line,
+                  "Unknown variable " + property.name + ".");
+    }
+
+    Value value;
+    DO(Evaluate(klass, property.value, &value));
+    Value* target = &(*values)[it->second];
+
+    if (property.index >= 0) {
+      if (target->kind != Value::ARRAY) {
+        return Fail(klass, property.line, property.name + " is no array.");
+      }
+      if (property.index >= target->elements.size()) {
+        if (variables[it->second].type->kind == Type::STATIC_ARRAY) {
+          return Fail(klass, property.line, "Index out of bounds.");
+        }
+        target->elements.resize(property.index + 1,
+          DefaultValue(variables[it->second].type->element));
+      }
+      target = &target->elements[property.index];
+    }
+
+    Assign(target, value);
+  }
+
+  return true;
+}
+
+bool Emulator::Linker::LinkFunction(ClassDef* klass, FunctionDef* function) {
+  klass_ = klass;
+  function_ = function;
+  locals_.clear();
+
+  if (function->return_type != NULL) {
+    DO(ResolveType(klass, function->return_type));
+  }
+
+  for (int i = 0; i < function->params.size(); i++) {
+    Param* param = &function->params[i];
+    DO(ResolveType(klass, param->type));
+    if (param->default_value != NULL) {
+      DO(ResolveExpr(param->default_value));
+    }
+    locals_[param->name] = i;
+  }
+
+  for (int i = 0; i < function->locals.size(); i++) {
+    DO(ResolveType(klass, function->locals[i].type));
+    if (locals_.count(function->locals[i].name) > 0) {
+      return Fail(klass, 1, "Local " + function->locals[i].name +
+                  " of " + function->display_name + " defined twice.");
+    }
+    locals_[function->locals[i].name] = function->params.size() + i;
+  }
+
+  // A function overriding another one must take the same parameters.
+  const FunctionDef* overridden =
+    klass->parent == NULL ? NULL : klass->parent->FindFunction(function->name);
+  if (overridden != NULL &&
+      overridden->params.size() != function->params.size()) {
+    return Fail(klass, 1, function->display_name + " doesn't match the " +
+                "function it overrides.");
+  }
+
+  if (function->body != NULL) {
+    DO(ResolveStmt(function->body));
+  }
+  return true;
+}
+
+bool Emulator::Linker::ResolveStmt(Stmt* stmt) {
+  if (stmt == NULL) return true;
+
+  if (stmt->expr != NULL) {
+    DO(ResolveExpr(stmt->expr));
+  }
+  DO(ResolveStmt(stmt->init));
+  DO(ResolveStmt(stmt->step));
+  DO(ResolveStmt(stmt->then));
+  DO(ResolveStmt(stmt->otherwise));
+
+  for (int i = 0; i < stmt->body.size(); i++) {
+    DO(ResolveStmt(stmt->body[i]));
+  }
+
+  for (int i = 0; i < stmt->cases.size(); i++) {
+    if (stmt->cases[i].label != NULL) {
+      DO(ResolveExpr(stmt->cases[i].label));
+    }
+    for (int j = 0; j < stmt->cases[i].body.size(); j++) {
+      DO(ResolveStmt(stmt->cases[i].body[j]));
+    }
+  }
+
+  return true;
+}
+
+bool Emulator::Linker::ResolveExpr(Expr* expr) {
+  if (expr->a != NULL && expr->a->kind != Expr::SUPER) {
+    DO(ResolveExpr(expr->a));
+  }
+  if (expr->b != NULL) {
+    DO(ResolveExpr(expr->b));
+  }
+  if (expr->c != NULL) {
+    DO(ResolveExpr(expr->c));
+  }
+
+  for (int i = 0; i < expr->args.size(); i++) {
+    if (expr->args[i] != NULL) {
+      DO(ResolveExpr(expr->args[i]));
+    }
+  }
+
+  switch (expr->kind) {
+    case Expr::NAME: {
+      map<string, int>::const_iterator local = locals_.find(expr->name);
+      if (local != locals_.end()) {
+        expr->kind = Expr::LOCAL;
+        expr->index = local->second;
+        return true;
+      }
+
+      int field = klass_->FindVariable(expr->name);
+      if (field >= 0) {
+        if (function_->is_static) {
+          return Fail(klass_, expr->line, "Variable " + expr->name +
+                      " used in a static function.");
+        }
+        expr->kind = Expr::FIELD;
+        expr->index = field;
+        return true;
+      }
+
+      if (FindConst(klass_, expr->name, &expr->value)) {
+        expr->kind = Expr::LITERAL;
+        return true;
+      }
+
+      // A class, e.g. in "new MessagePool".
+      if (program_->FindClass(expr->name) != NULL) {
+        expr->kind = Expr::LITERAL;
+        expr->value.kind = Value::CLASS;
+        expr->value.klass = program_->FindClass(expr->name);
+        return true;
+      }
+
+      return Fail(klass_, expr->line, "Unknown identifier " + expr->name +
+                  ".");
+    }
+
+    case Expr::CLASS_NAME:
+      DO(Evaluate(klass_, expr, &expr->value));
+      expr->kind = Expr::LITERAL;
+      return true;
+
+    case Expr::CONST_OF:
+      if (expr->a->kind != Expr::LITERAL ||
+          expr->a->value.kind != Value::CLASS) {
+        return Fail(klass_, expr->line, "Expected class'Name'.const.");
+      }
+      if (!FindConst(expr->a->value.klass, expr->name, &expr->value)) {
+        return Fail(klass_, expr->line, "Unknown constant " + expr->name +
+                    ".");
+      }
+      expr->kind = Expr::LITERAL;
+      return true;
+
+    case Expr::CALL: {
+      Type::Kind conversion;
+      const NativeFunction* native;
+
+      if (klass_->FindFunction(expr->name) != NULL) {
+        expr->kind = Expr::SELF_CALL;
+        expr->function = klass_->FindFunction(expr->name);
+      } else if (program_->FindClass(expr->name) != NULL) {
+        if (expr->args.size() != 1 || expr->args[0] == NULL) {
+          return Fail(klass_, expr->line, "Expected a single argument.");
+        }
+        expr->kind = Expr::CAST;
+        expr->klass = program_->FindClass(expr->name);
+      } else if (FindConversion(expr->name, &conversion)) {
+        if (expr->args.size() != 1 || expr->args[0] == NULL) {
+          return Fail(klass_, expr->line, "Expected a single argument.");
+        }
+        expr->kind = Expr::CONVERT;
+        expr->type = conversion;
+      } else if ((native = FindNative(expr->name)) != NULL) {
+        if (expr->args.size() < native->min_args ||
+            expr->args.size() > native->max_args) {
+          return Fail(klass_, expr->line, "Wrong number of arguments for " +
+                      expr->name + ".");
+        }
+        expr->kind = Expr::NATIVE_CALL;
+        expr->native = native->native;
+      } else {
+        return Fail(klass_, expr->line, "Unknown function " + expr->name +
+                    ".");
+      }
+      return true;
+    }
+
+    case Expr::METHOD_CALL:
+      if (expr->a->kind == Expr::SUPER) {
+        if (klass_->parent == NULL ||
+            klass_->parent->FindFunction(expr->name) == NULL) {
+          return Fail(klass_, expr->line, "No function " + expr->name +
+                      " in the parent class.");
+        }
+        expr->kind = Expr::SUPER_CALL;
+        expr->function = klass_->parent->FindFunction(expr->name);
+      }
+      return true;
+
+    case Expr::SUPER:
+      return Fail(klass_, expr->line, "Expected a call of super.");
+
+    case Expr::SELF:
+      if (function_->is_static) {
+        return Fail(klass_, expr->line, "self used in a static function.");
+      }
+      return true;
+
+    default:
+      return true;
+  }
+}
+
+// ===================================================================
+// Interpreter
+
+class Emulator::Interpreter {
+ public:
+  explicit Interpreter(Emulator* emulator)
+    : emulator_(emulator), depth_(0), aborted_(false) {}
+
+  // Calls a function found on the object or the class.
+  bool Invoke(Object* self, const ClassDef* klass,
+              const FunctionDef* function, const vector<Value*>& args,
+              Value* result);
+
+  const string& error() const { return error_; }
+
+ private:
+  enum Flow {
+    NEXT,
+    BREAK,
+    CONTINUE,
+    RETURN,
+    ABORT,
+  };
+
+  struct Frame {
+    Object* self;
+    const ClassDef* klass;
+    const FunctionDef* function;
+    vector<Value> slots;
+    vector<Value*> refs;   // Where every slot is, out parameters elsewhere.
+    Value result;
+  };
+
+  void Abort(const Expr* expr, const string& message);
+  void Warn(const Frame& frame, const Expr* expr, const string& message);
+
+  Flow Execute(Stmt* stmt, Frame* frame);
+  Flow Loop(Stmt* stmt, Frame* frame);
+
+  Value Eval(const Expr* expr, Frame* frame);
+  Value* Ref(const Expr* expr, Frame* frame, Value* temp);
+  Value* LValue(const Expr* expr, Frame* frame);
+  Value* Member(const Expr* expr, Frame* frame, Value* owner);
+  Value* Element(const Expr* expr, Frame* frame, Value* array, int index,
+                 bool write);
+  Value Binary(const string& op, const Value& a, const Value& b,
+               const Frame& frame, const Expr* expr);
+  Value Call(const Expr* expr, Frame* frame, Object* self,
+             const ClassDef* klass, const FunctionDef* function);
+  Value CallMethod(const Expr* expr, Frame* frame);
+  Value CallArrayMethod(const Expr* expr, Frame* frame, Value* array);
+  Value CallNative(const Expr* expr, Frame* frame);
+  const FunctionDef* Dispatch(const Expr* expr, const ClassDef* klass);
+
+  Emulator* emulator_;
+  int depth_;
+  bool aborted_;
+  string error_;
+};
+
+void Emulator::Interpreter::Abort(const Expr* expr, const string& message) {
+  if (!aborted_) {
+    aborted_ = true;
+    error_ = message;
+    if (expr != NULL) error_ += " (line " + SimpleItoa(expr->line) + ")";
+  }
+}
+
+void Emulator::Interpreter::Warn(const Frame& frame, const Expr* expr,
+                                 const string& message) {
+  emulator_->Warn(frame.klass->display_name + "." +
+                  frame.function->display_name + ":" +
+                  SimpleItoa(expr->line) + ": " + message);
+}
+
+bool Emulator::Interpreter::Invoke(Object* self, const ClassDef* klass,
+                                   const FunctionDef* function,
+                                   const vector<Value*>& args,
+                                   Value* result) {
+  Frame frame;
+  frame.self = self;
+  frame.klass = klass;
+  frame.function = function;
+
+  int slots = function->params.size() + function->locals.size();
+  frame.slots.resize(slots);
+  frame.refs.resize(slots);
+
+  for (int i = 0; i < function->params.size(); i++) {
+    const Param& param = function->params[i];
+    frame.slots[i] = DefaultValue(param.type);
+    frame.refs[i] = &frame.slots[i];
+
+    if (i < args.size() && args[i] != NULL) {
+      if (param.out) {
+        frame.refs[i] = args[i];
+      } else {
+        Assign(&frame.slots[i], *args[i]);
+      }
+    } else if (param.default_value != NULL) {
+      Assign(&frame.slots[i], Eval(param.default_value, &frame));
+    } else if (!param.optional) {
+      Abort(NULL, "Missing argument " + param.name + " of " +
+            function->display_name + ".");
+      return false;
+    }
+  }
+
+  for (int i = 0; i < function->locals.size(); i++) {
+    int slot = function->params.size() + i;
+    frame.slots[slot] = DefaultValue(function->locals[i].type);
+    frame.refs[slot] = &frame.slots[slot];
+  }
+
+  if (function->return_type != NULL) {
+    frame.result = DefaultValue(function->return_type);
+  }
+
+  emulator_->stats_.calls++;
+  if (++depth_ > kMaxCallDepth) {
+    Abort(NULL, "Infinite script recursion in " + function->display_name +
+          ".");
+  } else if (function->body != NULL) {
+    Execute(function->body, &frame);
+  }
+  depth_--;
+
+  if (result != NULL) *result = frame.result;
+  return !aborted_;
+}
+
+Emulator::Interpreter::Flow Emulator::Interpreter::Execute(Stmt* stmt,
+                                                            Frame* frame) {
+  if (aborted_) return ABORT;
+  if (stmt->kind != Stmt::BLOCK) emulator_->stats_.statements++;
+
+  switch (stmt->kind) {
+    case Stmt::EXPRESSION:
+      Eval(stmt->expr, frame);
+      break;
+
+    case Stmt::BLOCK:
+      for (int i = 0; i < stmt->body.size(); i++) {
+        Flow flow = Execute(stmt->body[i], frame);
+        if (flow != NEXT) return flow;
+      }
+      break;
+
+    case Stmt::IF:
+      if (ToBool(Eval(stmt->expr, frame))) {
+        return Execute(stmt->then, frame);
+      } else if (stmt->otherwise != NULL) {
+        return Execute(stmt->otherwise, frame);
+      }
+      break;
+
+    case Stmt::WHILE:
+    case Stmt::DO:
+    case Stmt::FOR:
+      return Loop(stmt, frame);
+
+    case Stmt::SWITCH: {
+      Value value = Eval(stmt->expr, frame);
+
+      // Cases are tested one after the other, as the engine does.
+      int start = -1;
+      for (int i = 0; i < stmt->cases.size() && start < 0; i++) {
+        if (stmt->cases[i].label == NULL) continue;
+        emulator_->stats_.compares++;
+        if (Equal(value, Eval(stmt->cases[i].label, frame))) start = i;
+      }
+      for (int i = 0; i < stmt->cases.size() && start < 0; i++) {
+        if (stmt->cases[i].label == NULL) start = i;
+      }
+      if (start < 0) break;
+
+      for (int i = start; i < stmt->cases.size(); i++) {
+        for (int j = 0; j < stmt->cases[i].body.size(); j++) {
+          Flow flow = Execute(stmt->cases[i].body[j], frame);
+          if (flow == BREAK) return NEXT;
+          if (flow != NEXT) return flow;
+        }
+      }
+      break;
+    }
+
+    case Stmt::RETURN:
+      if (stmt->expr != NULL) {
+        Value value = Eval(stmt->expr, frame);
+        if (frame->function->return_type != NULL) {
+          Assign(&frame->result, value);
+        }
+      }
+      return aborted_ ? ABORT : RETURN;
+
+    case Stmt::BREAK:
+      return BREAK;
+
+    case Stmt::CONTINUE:
+      return CONTINUE;
+
+    case Stmt::EMPTY:
+      break;
+  }
+
+  return aborted_ ? ABORT : NEXT;
+}
+
+Emulator::Interpreter::Flow Emulator::Interpreter::Loop(Stmt* stmt,
+                                                         Frame* frame) {
+  if (stmt->init != NULL) Execute(stmt->init, frame);
+
+  for (int iterations = 0; ; iterations++) {
+    if (iterations >= kMaxLoopIterations) {
+      Abort(stmt->expr, "Runaway loop in " + frame->function->display_name +
+            ".");
+      return ABORT;
+    }
+
+    if (stmt->kind != Stmt::DO && !ToBool(Eval(stmt->expr, frame))) break;
+
+    Flow flow = Execute(stmt->then, frame);
+    if (flow == BREAK) break;
+    if (flow == RETURN || flow == ABORT) return flow;
+
+    if (stmt->step != NULL) Execute(stmt->step, frame);
+    if (stmt->kind == Stmt::DO && ToBool(Eval(stmt->expr, frame))) break;
+    if (aborted_) return ABORT;
+  }
+
+  return aborted_ ? ABORT : NEXT;
+}
+
+// Returns where the value of an expression is stored, or the value in
+// temp if it isn't stored anywhere.
+Value* Emulator::Interpreter::Ref(const Expr* expr, Frame* frame,
+                                  Value* temp) {
+  switch (expr->kind) {
+    case Expr::LOCAL:
+    case Expr::FIELD:
+    case Expr::MEMBER:
+    case Expr::INDEX: {
+      Value* value = LValue(expr, frame);
+      if (value != NULL) return value;
+      *temp = Value();
+      return temp;
+    }
+    default:
+      *temp = Eval(expr, frame);
+      return temp;
+  }
+}
+
+// Returns the variable an expression refers to, or NULL after a warning
+// if there is none, e.g. a member of none.
+Value* Emulator::Interpreter::LValue(const Expr* expr, Frame* frame) {
+  switch (expr->kind) {
+    case Expr::LOCAL:
+      return frame->refs[expr->index];
+
+    case Expr::FIELD:
+      return &frame->self->fields[expr->index];
+
+    case Expr::MEMBER: {
+      Value temp;
+      Value* owner = Ref(expr->a, frame, &temp);
+      if (owner == &temp && temp.kind != Value::OBJECT) {
+        Abort(expr, "Member " + expr->name + " of a temporary value.");
+        return NULL;
+      }
+      return Member(expr, frame, owner);
+    }
+
+    case Expr::INDEX: {
+      Value* array = LValue(expr->a, frame);
+      int index = ToInt(Eval(expr->b, frame));
+      if (array == NULL) return NULL;
+      return Element(expr, frame, array, index, true);
+    }
+
+    default:
+      Abort(expr, "Expression can't be assigned to.");
+      return NULL;
+  }
+}
+
+Value* Emulator::Interpreter::Member(const Expr* expr, Frame* frame,
+                                     Value* owner) {
+  switch (owner->kind) {
+    case Value::OBJECT: {
+      if (owner->object == NULL) {
+        Warn(*frame, expr, "Accessed None '" + expr->name + "'");
+        return NULL;
+      }
+
+      const ClassDef* klass = owner->object->klass;
+      Expr* cache = const_cast<Expr*>(expr);
+      if (cache->cached_class != klass) {
+        cache->cached_class = klass;
+        cache->cached_index = klass->FindVariable(expr->name);
+      }
+
+      if (expr->cached_index < 0) {
+        Abort(expr, "No variable " + expr->name + " in " +
+              klass->display_name + ".");
+        return NULL;
+      }
+      return &owner->object->fields[expr->cached_index];
+    }
+
+    case Value::STRUCT: {
+      const map<string, int>& index = owner->type->structure->index;
+      map<string, int>::const_iterator it = index.find(expr->name);
+      if (it == index.end()) {
+        Abort(expr, "No member " + expr->name + " in struct " +
+              owner->type->structure->name + ".");
+        return NULL;
+      }
+      return &owner->elements[it->second];
+    }
+
+    case Value::VOID:
+      return NULL;
+
+    default:
+      Abort(expr, "Member " + expr->name + " of a value that has none.");
+      return NULL;
+  }
+}
+
+Value* Emulator::Interpreter::Element(const Expr* expr, Frame* frame,
+                                      Value* array, int index, bool write) {
+  if (array->kind != Value::ARRAY) {
+    if (array->kind != Value::VOID) Abort(expr, "Indexed a non-array.");
+    return NULL;
+  }
+
+  if (index < 0 || index >= array->elements.size()) {
+    if (!write || index < 0 || array->type->kind == Type::STATIC_ARRAY) {
+      Warn(*frame, expr, "Accessed array out of bounds (" +
+           SimpleItoa(index) + "/" + SimpleItoa(array->elements.size()) +
+           ")");
+      return NULL;
+    }
+
+    // Assigning past the end grows a dynamic array.
+    emulator_->stats_.grows++;
+    array->elements.resize(index + 1, DefaultValue(array->type->element));
+  }
+
+  return &array->elements[index];
+}
+
+Value Emulator::Interpreter::Eval(const Expr* expr, Frame* frame) {
+  if (aborted_) return Value();
+
+  switch (expr->kind) {
+    case Expr::LITERAL:
+      return expr->value;
+
+    case Expr::LOCAL:
+      return *frame->refs[expr->index];
+
+    case Expr::FIELD:
+      return frame->self->fields[expr->index];
+
+    case Expr::SELF:
+      return Value::ObjectRef(frame->self);
+
+    case Expr::MEMBER: {
+      Value temp;
+      Value* owner = Ref(expr->a, frame, &temp);
+
+      if (owner->kind == Value::ARRAY && expr->name == "length") {
+        return Value::Int(owner->elements.size());
+      }
+      if (owner->kind == Value::OBJECT && owner->object != NULL &&
+          expr->name == "class") {
+        Value klass;
+        klass.kind = Value::CLASS;
+        klass.klass = owner->object->klass;
+        return klass;
+      }
+
+      Value* member = Member(expr, frame, owner);
+      return member == NULL ? Value() : *member;
+    }
+
+    case Expr::INDEX: {
+      Value temp;
+      Value* array = Ref(expr->a, frame, &temp);
+      int index = ToInt(Eval(expr->b, frame));
+      Value* element = Element(expr, frame, array, index, false);
+      if (element != NULL) return *element;
+      if (array->kind == Value::ARRAY) {
+        return DefaultValue(array->type->element);
+      }
+      return Value();
+    }
+
+    case Expr::SELF_CALL: {
+      // Static functions are looked up on the class they were called
+      // through, others on the object.
+      const ClassDef* klass =
+        frame->self != NULL ? frame->self->klass : frame->klass;
+      const FunctionDef* function = Dispatch(expr, klass);
+      if (function == NULL) return Value();
+      return Call(expr, frame, function->is_static ? NULL : frame->self,
+                  klass, function);
+    }
+
+    case Expr::SUPER_CALL:
+      return Call(expr, frame, frame->self, frame->klass, expr->function);
+
+    case Expr::METHOD_CALL:
+      return CallMethod(expr, frame);
+
+    case Expr::STATIC_CALL: {
+      Value klass = Eval(expr->a, frame);
+      if (klass.kind == Value::OBJECT && klass.object != NULL) {
+        klass.klass = klass.object->klass;
+      } else if (klass.kind != Value::CLASS || klass.klass == NULL) {
+        Warn(*frame, expr, "Accessed None calling " + expr->name);
+        return Value();
+      }
+
+      const FunctionDef* function = Dispatch(expr, klass.klass);
+      if (function == NULL) return Value();
+      if (!function->is_static) {
+        Abort(expr, function->display_name + " is not static.");
+        return Value();
+      }
+      return Call(expr, frame, NULL, klass.klass, function);
+    }
+
+    case Expr::NATIVE_CALL:
+      emulator_->stats_.native_calls++;
+      return CallNative(expr, frame);
+
+    case Expr::CAST: {
+      Value value = Eval(expr->args[0], frame);
+      if (value.kind != Value::OBJECT) {
+        Abort(expr, "Cast of a value that is no object.");
+        return Value();
+      }
+      if (value.object != NULL && !value.object->klass->IsA(expr->klass)) {
+        value.object = NULL;
+      }
+      return value;
+    }
+
+    case Expr::CONVERT: {
+      Type type;
+      type.kind = expr->type;
+      Value result = DefaultValue(&type);
+      Assign(&result, Eval(expr->args[0], frame));
+      return result;
+    }
+
+    case Expr::NEW: {
+      Value klass = Eval(expr->a, frame);
+      if (klass.kind != Value::CLASS || klass.klass == NULL) {
+        Warn(*frame, expr, "new of None");
+        return Value::ObjectRef(NULL);
+      }
+      Object* object = emulator_->New(klass.klass->name);
+      if (object == NULL) {
+        Warn(*frame, expr, "new of abstract class " +
+             klass.klass->display_name);
+      }
+      return Value::ObjectRef(object);
+    }
+
+    case Expr::UNARY: {
+      Value value = Eval(expr->a, frame);
+      if (expr->op == "!") return Value::Bool(!ToBool(value));
+      if (expr->op == "~") return Value::Int(~ToInt(value));
+      if (expr->op == "+") return value;
+      if (value.kind == Value::FLOAT) return Value::Float(-value.f);
+      return Value::Int(Wrap(-static_cast<int64>(ToInt(value))));
+    }
+
+    case Expr::PRE_INCREMENT:
+    case Expr::POST_INCREMENT: {
+      Value* target = LValue(expr->a, frame);
+      if (target == NULL) return Value();
+
+      Value before = *target;
+      if (target->kind == Value::FLOAT) {
+        target->f += expr->op == "++" ? 1 : -1;
+      } else {
+        Assign(target, Value::Int(Wrap(static_cast<int64>(target->i) +
+                                       (expr->op == "++" ? 1 : -1))));
+      }
+      return expr->kind == Expr::PRE_INCREMENT ? *target : before;
+    }
+
+    case Expr::BINARY: {
+      // Logical operators don't evaluate the right side if the left one
+      // decides.
+      if (expr->op == "&&" || expr->op == "||") {
+        bool left = ToBool(Eval(expr->a, frame));
+        if (left == (expr->op == "||")) return Value::Bool(left);
+        return Value::Bool(ToBool(Eval(expr->b, frame)));
+      }
+
+      Value a = Eval(expr->a, frame);
+      Value b = Eval(expr->b, frame);
+      return Binary(expr->op, a, b, *frame, expr);
+    }
+
+    case Expr::TERNARY:
+      return ToBool(Eval(expr->a, frame)) ? Eval(expr->b, frame) :
+                                            Eval(expr->c, frame);
+
+    case Expr::ASSIGN: {
+      // Assigning the length of an array resizes it.
+      if (expr->a->kind == Expr::MEMBER && expr->a->name == "length") {
+        Value* array = LValue(expr->a->a, frame);
+        if (array != NULL && array->kind == Value::ARRAY) {
+          int length = ToInt(Eval(expr->b, frame));
+          if (length < 0 || array->type->kind == Type::STATIC_ARRAY) {
+            Abort(expr, "Invalid length of an array.");
+            return Value();
+          }
+          if (length > array->elements.size()) {
+            emulator_->stats_.grows++;
+          }
+          array->elements.resize(length,
+                                 DefaultValue(array->type->element));
+          return Value();
+        }
+      }
+
+      Value value = Eval(expr->b, frame);
+      Value* target = LValue(expr->a, frame);
+      if (target == NULL) return Value();
+
+      if (expr->op != "=") {
+        value = Binary(expr->op.substr(0, 1), *target, value, *frame, expr);
+      }
+      Assign(target, value);
+      return Value();
+    }
+
+    default:
+      Abort(expr, "Unexpected expression.");
+      return Value();
+  }
+}
+
+Value Emulator::Interpreter::Binary(const string& op, const Value& a,
+                                    const Value& b, const Frame& frame,
+                                    const Expr* expr) {
+  if (op == "$" || op == "@") {
+    Value result;
+    result.kind = Value::STRING;
+    result.s = ToString(a);
+    if (op == "@") result.s.push_back(' ');
+    result.s += ToString(b);
+    return result;
+  }
+
+  if (op == "==") return Value::Bool(Equal(a, b));
+  if (op == "!=") return Value::Bool(!Equal(a, b));
+  if (op == "^^") return Value::Bool(ToBool(a) != ToBool(b));
+
+  if (op == "~=") {
+    return Value::Bool(Lower(EncodeUtf8(ToString(a))) ==
+                       Lower(EncodeUtf8(ToString(b))));
+  }
+
+  if ((a.kind == Value::STRING || a.kind == Value::NAME) &&
+      (op == "<" || op == ">" || op == "<=" || op == ">=")) {
+    u16string x = ToString(a);
+    u16string y = ToString(b);
+    if (op == "<") return Value::Bool(x < y);
+    if (op == ">") return Value::Bool(x > y);
+    if (op == "<=") return Value::Bool(x <= y);
+    return Value::Bool(x >= y);
+  }
+
+  if (!IsNumeric(a) || !IsNumeric(b)) {
+    Abort(expr, "Operator " + op + " of values that aren't numbers.");
+    return Value();
+  }
+
+  if (op == "**" || op == "%" || a.kind == Value::FLOAT ||
+      b.kind == Value::FLOAT) {
+    float x = ToFloat(a);
+    float y = ToFloat(b);
+
+    if (op == "+") return Value::Float(x + y);
+    if (op == "-") return Value::Float(x - y);
+    if (op == "*") return Value::Float(x * y);
+    if (op == "/") {
+      if (y == 0) {
+        Warn(frame, expr, "Divide by zero");
+        return Value::Float(0);
+      }
+      return Value::Float(x / y);
+    }
+    if (op == "**") return Value::Float(powf(x, y));
+    if (op == "%") return Value::Float(fmodf(x, y));
+    if (op == "<") return Value::Bool(x < y);
+    if (op == ">") return Value::Bool(x > y);
+    if (op == "<=") return Value::Bool(x <= y);
+    if (op == ">=") return Value::Bool(x >= y);
+  }
+
+  int64 x = ToInt(a);
+  int64 y = ToInt(b);
+  int shift = static_cast<int>(y) & 31;
+
+  if (op == "+") return Value::Int(Wrap(x + y));
+  if (op == "-") return Value::Int(Wrap(x - y));
+  if (op == "*") return Value::Int(Wrap(x * y));
+  if (op == "/") {
+    if (y == 0) {
+      Warn(frame, expr, "Divide by zero");
+      return Value::Int(0);
+    }
+    return Value::Int(Wrap(x / y));
+  }
+  if (op == "<<") return Value::Int(Wrap(static_cast<uint32>(x) << shift));
+  if (op == ">>") return Value::Int(static_cast<int32>(x) >> shift);
+  if (op == ">>>") return Value::Int(Wrap(static_cast<uint32>(x) >> shift));
+  if (op == "&") return Value::Int(Wrap(x & y));
+  if (op == "|") return Value::Int(Wrap(x | y));
+  if (op == "^") return Value::Int(Wrap(x ^ y));
+  if (op == "<") return Value::Bool(x < y);
+  if (op == ">") return Value::Bool(x > y);
+  if (op == "<=") return Value::Bool(x <= y);
+  if (op == ">=") return Value::Bool(x >= y);
+
+  Abort(expr, "Unknown operator " + op + ".");
+  return Value();
+}
+
+const FunctionDef* Emulator::Interpreter::Dispatch(const Expr* expr,
+                                                   const ClassDef* klass) {
+  Expr* cache = const_cast<Expr*>(expr);
+  if (cache->cached_class != klass) {
+    cache->cached_class = klass;
+    cache->cached_function = klass->FindFunction(expr->name);
+  }
+
+  if (expr->cached_function == NULL) {
+    Abort(expr, "No function " + expr->name + " in " + klass->display_name +
+          ".");
+  }
+  return expr->cached_function;
+}
+
+Value Emulator::Interpreter::Call(const Expr* expr, Frame* frame,
+                                  Object* self, const ClassDef* klass,
+                                  const FunctionDef* function) {
+  if (expr->args.size() > function->params.size()) {
+    Abort(expr, "Too many arguments for " + function->display_name + ".");
+    return Value();
+  }
+
+  // Arguments are evaluated before the call.  Out parameters are bound to
+  // the variables passed, or to a copy of other values.
+  vector<Value> values(expr->args.size());
+  vector<Value*> args(expr->args.size());
+
+  for (int i = 0; i < expr->args.size(); i++) {
+    if (expr->args[i] == NULL) continue;
+
+    if (function->params[i].out) {
+      args[i] = Ref(expr->args[i], frame, &values[i]);
+    } else {
+      values[i] = Eval(expr->args[i], frame);
+      args[i] = &values[i];
+    }
+  }
+
+  if (aborted_) return Value();
+
+  Value result;
+  Invoke(self, klass, function, args, &result);
+  return result;
+}
+
+Value Emulator::Interpreter::CallMethod(const Expr* expr, Frame* frame) {
+  Value temp;
+  Value* owner = Ref(expr->a, frame, &temp);
+
+  if (owner->kind == Value::ARRAY) {
+    emulator_->stats_.native_calls++;
+    return CallArrayMethod(expr, frame, owner);
+  }
+
+  if (owner->kind == Value::CLASS && owner->klass != NULL) {
+    const FunctionDef* function = Dispatch(expr, owner->klass);
+    if (function == NULL) return Value();
+    return Call(expr, frame, NULL, owner->klass, function);
+  }
+
+  if (owner->kind != Value::OBJECT && owner->kind != Value::CLASS &&
+      owner->kind != Value::VOID) {
+    Abort(expr, "Call of " + expr->name + " on a value that is no object.");
+    return Value();
+  }
+
+  if (owner->object == NULL) {
+    Warn(*frame, expr, "Accessed None calling " + expr->name);
+
+    // The result is the default value of what the function would return,
+    // which depends on the class the object would have.  It's unknown, so
+    // VOID resets whatever it's assigned to.
+    for (int i = 0; i < expr->args.size(); i++) {
+      if (expr->args[i] != NULL) Eval(expr->args[i], frame);
+    }
+    return Value();
+  }
+
+  Object* object = owner->object;
+  const FunctionDef* function = Dispatch(expr, object->klass);
+  if (function == NULL) return Value();
+  return Call(expr, frame, function->is_static ? NULL : object,
+              object->klass, function);
+}
+
+Value Emulator::Interpreter::CallArrayMethod(const Expr* expr, Frame* frame,
+                                             Value* array) {
+  vector<Value> args;
+  for (int i = 0; i < expr->args.size(); i++) {
+    args.push_back(expr->args[i] == NULL ? Value() :
+                                           Eval(expr->args[i], frame));
+  }
+  if (aborted_) return Value();
+
+  const string& name = expr->name;
+  vector<Value>& elements = array->elements;
+  bool is_static = array->type->kind == Type::STATIC_ARRAY;
+
+  if (name == "find" && args.size() == 1) {
+    for (int i = 0; i < elements.size(); i++) {
+      if (Equal(elements[i], args[0])) return Value::Int(i);
+    }
+    return Value::Int(-1);
+  }
+
+  if (is_static) {
+    Abort(expr, name + " of a static array.");
+    return Value();
+  }
+
+  if (name == "additem" && args.size() == 1) {
+    emulator_->stats_.grows++;
+    elements.push_back(DefaultValue(array->type->element));
+    Assign(&elements.back(), args[0]);
+    return Value::Int(elements.size() - 1);
+  }
+
+  if (name == "add" && args.size() == 1) {
+    int count = ToInt(args[0]);
+    int length = elements.size();
+    if (count > 0) {
+      emulator_->stats_.grows++;
+      elements.resize(length + count, DefaultValue(array->type->element));
+    }
+    return Value::Int(length);
+  }
+
+  if (name == "insertitem" && args.size() == 2) {
+    int index = ToInt(args[0]);
+    if (index < 0 || index > elements.size()) {
+      Warn(*frame, expr, "InsertItem out of bounds");
+      return Value::Int(-1);
+    }
+    emulator_->stats_.grows++;
+    Value element = DefaultValue(array->type->element);
+    Assign(&element, args[1]);
+    elements.insert(elements.begin() + index, element);
+    return Value::Int(index);
+  }
+
+  if (name == "insert" && args.size() == 2) {
+    int index = ToInt(args[0]);
+    int count = ToInt(args[1]);
+    if (index < 0 || index > elements.size() || count < 0) {
+      Warn(*frame, expr, "Insert out of bounds");
+      return Value();
+    }
+    if (count > 0) emulator_->stats_.grows++;
+    elements.insert(elements.begin() + index, count,
+                    DefaultValue(array->type->element));
+    return Value();
+  }
+
+  if (name == "remove" && args.size() == 2) {
+    int index = ToInt(args[0]);
+    int count = ToInt(args[1]);
+    if (index < 0 || count < 0 || index + count > elements.size()) {
+      Warn(*frame, expr, "Remove out of bounds");
+      return Value();
+    }
+    elements.erase(elements.begin() + index,
+                   elements.begin() + index + count);
+    return Value();
+  }
+
+  if (name == "removeitem" && args.size() == 1) {
+    for (int i = elements.size() - 1; i >= 0; i--) {
+      if (Equal(elements[i], args[0])) elements.erase(elements.begin() + i);
+    }
+    return Value();
+  }
+
+  Abort(expr, "Unknown array function " + name + ".");
+  return Value();
+}
+
+Value Emulator::Interpreter::CallNative(const Expr* expr, Frame* frame) {
+  vector<Value> args;
+  for (int i = 0; i < expr->args.size(); i++) {
+    args.push_back(expr->args[i] == NULL ? Value() :
+                                           Eval(expr->args[i], frame));
+  }
+  if (aborted_) return Value();
+
+  Value result;
+  result.kind = Value::STRING;
+
+  switch (expr->native) {
+    case NATIVE_LEN:
+      return Value::Int(ToString(args[0]).size());
+
+    case NATIVE_LEFT: {
+      u16string s = ToString(args[0]);
+      int count = ToInt(args[1]);
+      result.s = s.substr(0, count < 0 ? 0 : count);
+      return result;
+    }
+
+    case NATIVE_RIGHT: {
+      u16string s = ToString(args[0]);
+      int count = ToInt(args[1]);
+      if (count < 0) count = 0;
+      if (count > s.size()) count = s.size();
+      result.s = s.substr(s.size() - count);
+      return result;
+    }
+
+    case NATIVE_MID: {
+      // Mid(S, i, j) clamps the range to the string.
+      u16string s = ToString(args[0]);
+      int start = ToInt(args[1]);
+      int count = args.size() > 2 ? ToInt(args[2]) : s.size();
+      if (start < 0) {
+        count += start;
+        start = 0;
+      }
+      if (start > s.size()) start = s.size();
+      if (count > static_cast<int>(s.size()) - start) {
+        count = s.size() - start;
+      }
+      if (count < 0) count = 0;
+      result.s = s.substr(start, count);
+      return result;
+    }
+
+    case NATIVE_ASC: {
+      u16string s = ToString(args[0]);
+      return Value::Int(s.empty() ? 0 : s[0]);
+    }
+
+    case NATIVE_CHR:
+      result.s.push_back(static_cast<char16_t>(ToInt(args[0])));
+      return result;
+
+    case NATIVE_INSTR: {
+      u16string::size_type pos = ToString(args[0]).find(ToString(args[1]));
+      return Value::Int(pos == u16string::npos ? -1 : pos);
+    }
+
+    case NATIVE_CAPS:
+    case NATIVE_LOCS:
+      result.s = ToString(args[0]);
+      for (int i = 0; i < result.s.size(); i++) {
+        char16_t c = result.s[i];
+        if (expr->native == NATIVE_CAPS && 'a' <= c && c <= 'z') {
+          result.s[i] = c - 'a' + 'A';
+        } else if (expr->native == NATIVE_LOCS && 'A' <= c && c <= 'Z') {
+          result.s[i] = c - 'A' + 'a';
+        }
+      }
+      return result;
+
+    case NATIVE_MIN:
+      return Value::Int(min(ToInt(args[0]), ToInt(args[1])));
+
+    case NATIVE_MAX:
+      return Value::Int(max(ToInt(args[0]), ToInt(args[1])));
+
+    case NATIVE_CLAMP:
+      return Value::Int(max(ToInt(args[1]),
+                            min(ToInt(args[0]), ToInt(args[2]))));
+
+    case NATIVE_FMIN:
+      return Value::Float(min(ToFloat(args[0]), ToFloat(args[1])));
+
+    case NATIVE_FMAX:
+      return Value::Float(max(ToFloat(args[0]), ToFloat(args[1])));
+
+    case NATIVE_FCLAMP:
+      return Value::Float(max(ToFloat(args[1]),
+                              min(ToFloat(args[0]), ToFloat(args[2]))));
+
+    case NATIVE_ABS:
+      return Value::Float(fabsf(ToFloat(args[0])));
+
+    case NATIVE_FFLOOR:
+      return Value::Float(floorf(ToFloat(args[0])));
+
+    case NATIVE_FCEIL:
+      return Value::Float(ceilf(ToFloat(args[0])));
+
+    case NATIVE_ROUND:
+      return Value::Int(Truncate(floorf(ToFloat(args[0]) + 0.5f)));
+
+    case NATIVE_LOGE:
+      return Value::Float(logf(ToFloat(args[0])));
+
+    case NATIVE_EXP:
+      return Value::Float(expf(ToFloat(args[0])));
+
+    case NATIVE_SQRT:
+      return Value::Float(sqrtf(ToFloat(args[0])));
+
+    case NATIVE_LOG:
+      emulator_->log_.push_back(EncodeUtf8(ToString(args[0])));
+      return Value();
+
+    case NATIVE_WARN:
+      Warn(*frame, expr, EncodeUtf8(ToString(args[0])));
+      return Value();
+
+    default:
+      Abort(expr, "Unknown native function.");
+      return Value();
+  }
+}
+
+// ===================================================================
+// Emulator
+
+Emulator::Emulator()
+  : program_(new Program), warnings_(0), linked_(true) {}
+
+Emulator::~Emulator() {
+  CollectGarbage();
+  delete program_;
+}
+
+void Emulator::Define(const string& name, const string& value) {
+  macros_[Lower(name)] = value;
+}
+
+bool Emulator::AddFile(const string& filename, const string& source,
+                       string* error) {
+  Parser parser(this, filename);
+
+  string text;
+  if (!parser.Preprocess(source, &text)) {
+    *error = parser.error();
+    return false;
+  }
+
+  // Include files only define macros.
+  if (HasSuffixString(filename, ".uci")) return true;
+
+  ClassDef* klass;
+  if (!parser.Parse(text, &klass)) {
+    *error = parser.error();
+    return false;
+  }
+
+  if (program_->classes.count(klass->name) > 0) {
+    *error = filename + ": Class " + klass->display_name + " defined twice.";
+    return false;
+  }
+
+  program_->classes[klass->name] = klass;
+  linked_ = false;
+  return true;
+}
+
+bool Emulator::Link(string* error) {
+  Linker linker(this);
+
+  for (map<string, ClassDef*>::iterator it = program_->classes.begin();
+       it != program_->classes.end(); ++it) {
+    if (!linker.Link(it->second)) {
+      *error = linker.error();
+      return false;
+    }
+  }
+
+  linked_ = true;
+  return true;
+}
+
+bool Emulator::HasClass(const string& class_name) const {
+  return program_->FindClass(Lower(class_name)) != NULL;
+}
+
+bool Emulator::DefinesFunction(const string& class_name,
+                               const string& function) const {
+  const ClassDef* klass = program_->FindClass(Lower(class_name));
+  return klass != NULL && klass->functions.count(Lower(function)) > 0;
+}
+
+Object* Emulator::New(const string& class_name) {
+  GOOGLE_CHECK(linked_) << "Link() must be called first.";
+
+  const ClassDef* klass = program_->FindClass(Lower(class_name));
+  if (klass == NULL || klass->is_abstract) return NULL;
+
+  Object* object = new Object(klass);
+  object->fields = klass->defaults;
+  objects_.push_back(object);
+  return object;
+}
+
+bool Emulator::Call(Object* object, const string& function,
+                    const vector<Value*>& args, Value* result,
+                    string* error) {
+  GOOGLE_CHECK(linked_) << "Link() must be called first.";
+
+  const FunctionDef* definition =
+    object->klass->FindFunction(Lower(function));
+  if (definition == NULL) {
+    *error = "No function " + function + " in " +
+             object->klass->display_name + ".";
+    return false;
+  }
+
+  Interpreter interpreter(this);
+  if (!interpreter.Invoke(definition->is_static ? NULL : object,
+                          object->klass, definition, args, result)) {
+    *error = interpreter.error();
+    return false;
+  }
+  return true;
+}
+
+Value* Emulator::Field(Object* object, const string& name) {
+  int index = object->klass->FindVariable(Lower(name));
+  return index < 0 ? NULL : &object->fields[index];
+}
+
+void Emulator::ClearLog() {
+  log_.clear();
+  warnings_ = 0;
+}
+
+void Emulator::Warn(const string& message) {
+  log_.push_back("Warning: " + message);
+  warnings_++;
+}
+
+void Emulator::CollectGarbage() {
+  for (int i = 0; i < objects_.size(); i++) {
+    delete objects_[i];
+  }
+  objects_.clear();
+}
+
+}  // namespace emulator
+}  // namespace us
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
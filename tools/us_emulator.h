@@ -0,0 +1,210 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Runs the subset of UnrealScript used by us-lib and the generated classes,
+// so that they can be checked without the engine.
+//
+// Covered are int, byte, bool, float, string and name values, objects,
+// class references, structs, static and dynamic arrays with their methods
+// (Length, AddItem, Remove, ...), the operators including >>>, **, $ and
+// @, consts, default properties, static and virtual functions with out
+// and optional parameters, super calls, class casts, switch statements and
+// the string and math functions of Object.  Macros are expanded as by the
+// UnrealScript preprocessor.
+//
+// Values behave as in UnrealScript: int arithmetic wraps at 32 bits,
+// bytes at 8, floats are single precision, and strings hold UTF-16 code
+// units.  Accessing none or an array out of bounds logs a warning and
+// carries on, as the engine does.
+
+#ifndef GOOGLE_PROTOBUF_COMPILER_US_EMULATOR_H__
+#define GOOGLE_PROTOBUF_COMPILER_US_EMULATOR_H__
+
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+#include <google/protobuf/stubs/common.h>
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace us {
+namespace emulator {
+
+class ClassDef;
+class Object;
+struct Type;
+
+// A value of UnrealScript.  Arrays and structs are held by value, as in
+// UnrealScript, so copying a Value copies their elements.
+struct Value {
+  enum Kind {
+    VOID,
+    INT,
+    BYTE,
+    BOOL,
+    FLOAT,
+    STRING,
+    NAME,
+    OBJECT,
+    CLASS,
+    STRUCT,
+    ARRAY,
+  };
+
+  Value() : kind(VOID), i(0), f(0), object(NULL), klass(NULL), type(NULL) {}
+
+  static Value Int(int32 value);
+  static Value Byte(int value);
+  static Value Bool(bool value);
+  static Value Float(float value);
+  static Value String(const string& utf8);
+  static Value ObjectRef(Object* object);
+
+  // An array of bytes, e.g. for CodedInputStream.buffer.
+  static Value Bytes(const string& bytes);
+
+  // The bytes of an array of bytes.
+  string ToBytes() const;
+
+  // The string as UTF-8.
+  string ToUtf8() const;
+
+  Kind kind;
+  int32 i;                  // INT, BYTE and BOOL.
+  float f;                  // FLOAT.
+  u16string s;              // STRING and NAME.
+  Object* object;           // OBJECT, NULL for none.
+  const ClassDef* klass;    // CLASS, NULL for none.
+  const Type* type;         // Type of a STRUCT or an ARRAY.
+  vector<Value> elements;   // Members of a STRUCT, elements of an ARRAY.
+};
+
+// An instance of an UnrealScript class, created by Emulator::New() or by
+// the script.
+class Object {
+ public:
+  explicit Object(const ClassDef* klass) : klass(klass) {}
+
+  const ClassDef* klass;
+  vector<Value> fields;  // In the order laid out by the class.
+
+ private:
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Object);
+};
+
+// Work done by the script, counted as the engine would execute it.
+struct Stats {
+  Stats() : statements(0), calls(0), native_calls(0), grows(0),
+            compares(0) {}
+
+  int64 statements;    // Statements executed.
+  int64 calls;         // Calls of script functions.
+  int64 native_calls;  // Calls of functions of Object, e.g. Mid or Asc.
+  int64 grows;         // Dynamic arrays grown, e.g. by AddItem, each a
+                       // potential reallocation.
+  int64 compares;      // Switch cases tested.
+};
+
+class Emulator {
+ public:
+  Emulator();
+  ~Emulator();
+
+  // Defines a macro for the preprocessor, e.g. PROTOBUF_DEBUG.
+  void Define(const string& name, const string& value);
+
+  // Parses an UnrealScript class.  Files ending in .uci only define
+  // macros, as Globals.uci does.
+  bool AddFile(const string& filename, const string& source, string* error);
+
+  // Resolves the names used by the classes added so far.  Must be called
+  // before creating objects, and after adding more classes.
+  bool Link(string* error);
+
+  // Returns true if the class was added, under any case.
+  bool HasClass(const string& class_name) const;
+
+  // Returns true if the class itself defines the function, rather than
+  // inheriting it.
+  bool DefinesFunction(const string& class_name, const string& function) const;
+
+  // Creates an object as "new" would.  Returns NULL if the class is
+  // unknown or abstract.
+  Object* New(const string& class_name);
+
+  // Calls a function of the object.  Out parameters are bound to the
+  // given values.  Returns false if the script can't continue, e.g. it
+  // recurses infinitely or loops forever.
+  bool Call(Object* object, const string& function,
+            const vector<Value*>& args, Value* result, string* error);
+
+  // Returns the variable of the object, or NULL if there is none.
+  Value* Field(Object* object, const string& name);
+
+  // Messages logged by the script and warnings such as "Accessed None".
+  const vector<string>& log() const { return log_; }
+  int warnings() const { return warnings_; }
+  void ClearLog();
+
+  const Stats& stats() const { return stats_; }
+  void ResetStats() { stats_ = Stats(); }
+
+  // Frees the objects created so far.  Objects and values referring to
+  // them must no longer be used.
+  void CollectGarbage();
+
+ private:
+  class Interpreter;
+  class Linker;
+  class Parser;
+  struct Program;
+
+  void Warn(const string& message);
+
+  Program* program_;
+  map<string, string> macros_;
+  vector<Object*> objects_;
+  vector<string> log_;
+  int warnings_;
+  Stats stats_;
+  bool linked_;
+
+  GOOGLE_DISALLOW_EVIL_CONSTRUCTORS(Emulator);
+};
+
+}  // namespace emulator
+}  // namespace us
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+#endif  // GOOGLE_PROTOBUF_COMPILER_US_EMULATOR_H__
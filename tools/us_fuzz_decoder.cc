@@ -0,0 +1,445 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Fuzzes the Decoder of cpp-lib, the reference for the decoding rules of
+// CodedInputStream.uc.
+//
+//   us_fuzz_decoder [--iterations=<n>] [--seed=<n>] [<input file>...]
+//
+// Random messages of every wire type, nested in length delimited fields
+// and groups, are written with Encoder, then mutated: bytes flipped,
+// inserted and dropped, the message truncated or random bytes appended.
+// Input files, e.g. a frame body that failed elsewhere, are checked as is
+// instead.  Every input must decode without crashing, and:
+//
+// - The position never passes the end of the buffer, and SkipMessage
+//   succeeds exactly when no error is set, having read the whole buffer.
+// - The first error is kept, and once it is set IsAtEnd() is true and
+//   ReadTag() returns 0, whatever is read after it.
+// - A message Decoder accepts is accepted by libprotobuf as well, so a
+//   frame body that passes the check can be parsed on the server.
+// - The unknown fields ReadUnknownField copies out of an accepted message
+//   are copied again into the same bytes.
+// - Decoding the length delimited fields as nested messages under
+//   PushLimit either ends on the limit or sets an error.
+//
+// Built with -DUS_FUZZ_DECODER_LIBFUZZER, the same checks run from
+// LLVMFuzzerTestOneInput instead, for coverage guided fuzzing with
+// clang -fsanitize=fuzzer.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/stubs/common.h>
+#include <google/protobuf/stubs/strutil.h>
+#include <google/protobuf/us/us_decoder.h>
+#include <google/protobuf/us/us_encoder.h>
+#include <google/protobuf/wire_format_lite.h>
+
+namespace google {
+namespace protobuf {
+namespace us {
+namespace {
+
+typedef internal::WireFormatLite WireFormatLite;
+
+// ===================================================================
+// Checks
+
+// Checks that an error, once set, sticks and stops the decoding loops,
+// whatever is read after it.
+void CheckErrorIsSticky(Decoder* decoder) {
+  Decoder::Error error = decoder->error();
+  GOOGLE_CHECK_NE(error, Decoder::ERROR_NONE);
+
+  string value;
+  decoder->ReadVarint32();
+  decoder->ReadVarint64();
+  decoder->ReadLittleEndian64();
+  decoder->ReadString(&value);
+
+  GOOGLE_CHECK(decoder->IsAtEnd());
+  GOOGLE_CHECK_EQ(decoder->ReadTag(), 0);
+  GOOGLE_CHECK(!decoder->SkipMessage());
+  GOOGLE_CHECK_EQ(decoder->error(), error);
+}
+
+// Walks the fields of a message, decoding the length delimited ones as
+// nested messages under PushLimit.  Those needn't be messages, so only the
+// limits are checked.  As in CodedInputStream, a field inside a limit is
+// checked against the end of the buffer, so it may run past the limit, but
+// then PopLimit must set an error.
+void CheckLimits(Decoder* decoder, int size, int depth) {
+  for (uint32 tag = decoder->ReadTag(); tag > 0; tag = decoder->ReadTag()) {
+    if (WireFormatLite::GetTagWireType(tag) !=
+        WireFormatLite::WIRETYPE_LENGTH_DELIMITED || depth > 8) {
+      if (!decoder->SkipField(tag)) break;
+      continue;
+    }
+
+    int length = decoder->ReadVarint32();
+    int end = decoder->position() + length;
+    int old_limit = decoder->PushLimit(length);
+    if (decoder->error() != Decoder::ERROR_NONE) break;
+
+    CheckLimits(decoder, size, depth + 1);
+    bool overrun = decoder->position() > end;
+    decoder->PopLimit(old_limit);
+
+    if (overrun) GOOGLE_CHECK_NE(decoder->error(), Decoder::ERROR_NONE);
+    if (decoder->error() != Decoder::ERROR_NONE) break;
+    GOOGLE_CHECK_EQ(decoder->position(), end);
+  }
+
+  GOOGLE_CHECK_LE(decoder->position(), size);
+}
+
+void CheckInput(const uint8* data, int size) {
+  Decoder decoder(data, size);
+  bool accepted = decoder.SkipMessage();
+
+  GOOGLE_CHECK_LE(decoder.position(), size);
+  GOOGLE_CHECK_EQ(accepted, decoder.error() == Decoder::ERROR_NONE);
+  if (!accepted) {
+    CheckErrorIsSticky(&decoder);
+    return;
+  }
+  GOOGLE_CHECK_EQ(decoder.position(), size);
+
+  // libprotobuf must accept it too, having read every byte.
+  io::CodedInputStream input(data, size);
+  GOOGLE_CHECK(WireFormatLite::SkipMessage(&input));
+  GOOGLE_CHECK_EQ(input.CurrentPosition(), size);
+
+  // Tags are written back in their shortest form, so the unknown fields
+  // may be shorter than the input, but copying them again changes nothing.
+  string unknown_fields;
+  Decoder unknown(data, size);
+  for (uint32 tag = unknown.ReadTag(); tag > 0; tag = unknown.ReadTag()) {
+    GOOGLE_CHECK(unknown.ReadUnknownField(tag, &unknown_fields));
+  }
+  GOOGLE_CHECK_EQ(unknown.error(), Decoder::ERROR_NONE);
+  GOOGLE_CHECK_LE(unknown_fields.size(), size);
+
+  string copy;
+  Decoder again(unknown_fields.data(), unknown_fields.size());
+  for (uint32 tag = again.ReadTag(); tag > 0; tag = again.ReadTag()) {
+    GOOGLE_CHECK(again.ReadUnknownField(tag, &copy));
+  }
+  GOOGLE_CHECK_EQ(again.error(), Decoder::ERROR_NONE);
+  GOOGLE_CHECK(copy == unknown_fields);
+
+  Decoder limits(data, size);
+  CheckLimits(&limits, size, 0);
+}
+
+#ifndef US_FUZZ_DECODER_LIBFUZZER
+
+// ===================================================================
+// Inputs
+
+void CheckInput(const string& input) {
+  CheckInput(reinterpret_cast<const uint8*>(input.data()), input.size());
+}
+
+// Checks an input SkipMessage must end with the given error.
+void CheckDecodes(const string& input, Decoder::Error error) {
+  Decoder decoder(input.data(), input.size());
+  decoder.SkipMessage();
+  GOOGLE_CHECK_EQ(decoder.error(), error);
+
+  CheckInput(input);
+}
+
+// A small deterministic generator, so that a --seed reproduces a failure
+// on any platform.
+class Random {
+ public:
+  explicit Random(uint32 seed) : state_(seed * 2654435761u + 1) {}
+
+  uint32 Next() {
+    state_ ^= state_ << 13;
+    state_ ^= state_ >> 17;
+    state_ ^= state_ << 5;
+    return state_;
+  }
+
+  // Returns a value in [0, n).
+  uint32 Uniform(uint32 n) { return Next() % n; }
+
+ private:
+  uint32 state_;
+};
+
+// Appends what Encoder writes for a value, as a cpp_structs codec would.
+void AppendVarint32(uint32 value, string* output) {
+  uint8 buffer[10];
+  Encoder encoder(buffer);
+  encoder.WriteVarint32(value);
+  output->append(reinterpret_cast<char*>(buffer), encoder.position());
+}
+
+void AppendVarint64(uint64 value, string* output) {
+  uint8 buffer[10];
+  Encoder encoder(buffer);
+  encoder.WriteVarint64(value);
+  output->append(reinterpret_cast<char*>(buffer), encoder.position());
+}
+
+void AppendLittleEndian32(uint32 value, string* output) {
+  uint8 buffer[4];
+  Encoder encoder(buffer);
+  encoder.WriteLittleEndian32(value);
+  output->append(reinterpret_cast<char*>(buffer), encoder.position());
+}
+
+void AppendLittleEndian64(uint64 value, string* output) {
+  uint8 buffer[8];
+  Encoder encoder(buffer);
+  encoder.WriteLittleEndian64(value);
+  output->append(reinterpret_cast<char*>(buffer), encoder.position());
+}
+
+void AppendTag(uint32 number, WireFormatLite::WireType type,
+               string* output) {
+  AppendVarint32(WireFormatLite::MakeTag(number, type), output);
+}
+
+// Appends a random valid message of up to field_count fields.
+void RandomMessage(Random* random, int depth, int field_count,
+                   string* output) {
+  for (int i = 0; i < field_count; i++) {
+    // Mostly small field numbers, sometimes up to the largest.
+    uint32 number = random->Uniform(4) == 0 ?
+        1 + random->Uniform((1 << 29) - 1) : 1 + random->Uniform(20);
+
+    switch (random->Uniform(depth < 4 ? 7 : 5)) {
+      case 0:
+        AppendTag(number, WireFormatLite::WIRETYPE_VARINT, output);
+        AppendVarint32(random->Next() >> random->Uniform(32), output);
+        break;
+
+      case 1:
+        // Negative int32 values are sign extended to 10 bytes by other
+        // encoders.
+        AppendTag(number, WireFormatLite::WIRETYPE_VARINT, output);
+        AppendVarint64(static_cast<uint64>(
+            -1 - static_cast<int64>(random->Uniform(1000))), output);
+        break;
+
+      case 2:
+        AppendTag(number, WireFormatLite::WIRETYPE_FIXED32, output);
+        AppendLittleEndian32(random->Next(), output);
+        break;
+
+      case 3:
+        AppendTag(number, WireFormatLite::WIRETYPE_FIXED64, output);
+        AppendLittleEndian64(
+            (static_cast<uint64>(random->Next()) << 32) | random->Next(),
+            output);
+        break;
+
+      case 4: {
+        int size = random->Uniform(40);
+        AppendTag(number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, output);
+        AppendVarint32(size, output);
+        for (int j = 0; j < size; j++) {
+          output->push_back(static_cast<char>(random->Next()));
+        }
+        break;
+      }
+
+      case 5: {
+        string nested;
+        RandomMessage(random, depth + 1, random->Uniform(6), &nested);
+        AppendTag(number, WireFormatLite::WIRETYPE_LENGTH_DELIMITED, output);
+        AppendVarint32(nested.size(), output);
+        output->append(nested);
+        break;
+      }
+
+      case 6:
+        AppendTag(number, WireFormatLite::WIRETYPE_START_GROUP, output);
+        RandomMessage(random, depth + 1, random->Uniform(6), output);
+        AppendTag(number, WireFormatLite::WIRETYPE_END_GROUP, output);
+        break;
+    }
+  }
+}
+
+// Applies one to four random edits to input.
+void Mutate(Random* random, string* input) {
+  int count = 1 + random->Uniform(4);
+
+  for (int i = 0; i < count; i++) {
+    switch (random->Uniform(5)) {
+      case 0:
+        if (!input->empty()) {
+          (*input)[random->Uniform(input->size())] =
+              static_cast<char>(random->Next());
+        }
+        break;
+
+      case 1:
+        input->insert(random->Uniform(input->size() + 1), 1,
+                      static_cast<char>(random->Next()));
+        break;
+
+      case 2:
+        if (!input->empty()) {
+          input->erase(random->Uniform(input->size()), 1);
+        }
+        break;
+
+      case 3:
+        input->resize(random->Uniform(input->size() + 1));
+        break;
+
+      case 4:
+        for (int j = random->Uniform(16); j > 0; j--) {
+          input->push_back(static_cast<char>(random->Next()));
+        }
+        break;
+    }
+  }
+}
+
+bool ReadFile(const string& filename, string* contents) {
+  ifstream input(filename.c_str(), ios::in | ios::binary);
+  if (!input) return false;
+
+  ostringstream buffer;
+  buffer << input.rdbuf();
+  *contents = buffer.str();
+  return true;
+}
+
+int Main(int argc, char* argv[]) {
+  int iterations = 1000000;
+  uint32 seed = 1;
+  vector<string> filenames;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+
+    if (HasPrefixString(arg, "--iterations=")) {
+      iterations = atoi(arg.c_str() + 13);
+    } else if (HasPrefixString(arg, "--seed=")) {
+      seed = strtoul(arg.c_str() + 7, NULL, 10);
+    } else if (!HasPrefixString(arg, "--")) {
+      filenames.push_back(arg);
+    } else {
+      iterations = 0;
+      break;
+    }
+  }
+
+  if (iterations < 1) {
+    fprintf(stderr,
+            "Usage: %s [--iterations=<n>] [--seed=<n>] [<input file>...]\n",
+            argv[0]);
+    return 2;
+  }
+
+  if (!filenames.empty()) {
+    for (size_t i = 0; i < filenames.size(); i++) {
+      string input;
+      if (!ReadFile(filenames[i], &input)) {
+        fprintf(stderr, "%s: %s\n", filenames[i].c_str(), strerror(errno));
+        return 1;
+      }
+      CheckInput(input);
+    }
+    printf("Checked %d files.\n", static_cast<int>(filenames.size()));
+    return 0;
+  }
+
+  // Groups nested up to and past the limit, and a length past the end of
+  // a limit.
+  int depth = Decoder::kMaxGroupDepth;
+  CheckDecodes(string(depth, '\x0b') + string(depth, '\x0c'),
+               Decoder::ERROR_NONE);
+  CheckDecodes(string(depth + 1, '\x0b') + string(depth + 1, '\x0c'),
+               Decoder::ERROR_TOO_DEEP);
+  CheckDecodes(string("\x0a\x05\x0a\x06" "abc", 7),
+               Decoder::ERROR_NONE);
+  CheckDecodes(string("\x0a\x06" "abc", 5), Decoder::ERROR_TRUNCATED);
+  CheckDecodes(string(11, '\x80'), Decoder::ERROR_MALFORMED_VARINT);
+
+  Random random(seed);
+  int rejected = 0;
+
+  for (int i = 0; i < iterations; i++) {
+    string input;
+    RandomMessage(&random, 0, random.Uniform(12), &input);
+    CheckInput(input);
+
+    Mutate(&random, &input);
+    CheckInput(input);
+
+    Decoder decoder(input.data(), input.size());
+    if (!decoder.SkipMessage()) rejected++;
+  }
+
+  printf("Checked %d valid and %d mutated inputs, %d mutated ones "
+         "rejected.\n", iterations, iterations, rejected);
+  return 0;
+}
+
+#endif  // !US_FUZZ_DECODER_LIBFUZZER
+
+}  // namespace
+}  // namespace us
+}  // namespace protobuf
+}  // namespace google
+
+#ifdef US_FUZZ_DECODER_LIBFUZZER
+
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+  if (size > static_cast<size_t>(google::protobuf::kint32max)) return 0;
+  google::protobuf::us::CheckInput(data, static_cast<int>(size));
+  return 0;
+}
+
+#else
+
+int main(int argc, char* argv[]) {
+  return google::protobuf::us::Main(argc, argv);
+}
+
+#endif
@@ -0,0 +1,793 @@
+// Protocol Buffers - Google's data interchange format
+// Copyright 2008 Google Inc.  All rights reserved.
+// http://code.google.com/p/protobuf/
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+// Checks the generated UnrealScript against libprotobuf without UDK.
+//
+//   us_roundtrip [--us_lib=<dir>] [--parameter=<generator parameter>]
+//                [--define=<macro>] [--golden=<dir>] [--update_golden]
+//                [--iterations=<n>] [--verbose] <descriptor set>
+//
+// The descriptor set is written by protoc, e.g. for the examples, whose
+// generated classes are kept in examples/golden:
+//
+//   protoc --include_imports --descriptor_set_out=examples.pb \
+//       -Iexamples -Icompiler/us examples/protocol.proto \
+//       examples/features.proto
+//
+// The classes of every file in the set are generated in memory and, with
+// --golden, compared with the files in that directory, so that any change
+// to the emitted code shows up in review.  --update_golden rewrites them.
+//
+// The classes are then run in the emulator together with the us-lib
+// runtime.  For every message, random instances are encoded by libprotobuf,
+// decoded by the generated Deserialize, encoded again by Serialize and
+// parsed back by libprotobuf, which must yield the same message.
+// Messages generated with the delta option also go through SerializeDelta
+// and ApplyDelta.  Any warning of the script, such as an access to none,
+// fails the run.
+//
+// The time, the statements and the array growths the emulator takes to
+// decode and encode are reported per message.  They don't predict the
+// time UDK takes, but a change that makes the generated code do less work
+// shows in both.
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/time.h>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <google/protobuf/compiler/code_generator.h>
+#include <google/protobuf/compiler/us/us_generator.h>
+#include <google/protobuf/compiler/us/us_helpers.h>
+#include <google/protobuf/descriptor.h>
+#include <google/protobuf/descriptor.pb.h>
+#include <google/protobuf/dynamic_message.h>
+#include <google/protobuf/io/zero_copy_stream_impl_lite.h>
+#include <google/protobuf/stubs/strutil.h>
+
+#include "us_emulator.h"
+
+namespace google {
+namespace protobuf {
+namespace compiler {
+namespace us {
+namespace {
+
+using emulator::Emulator;
+using emulator::Object;
+using emulator::Value;
+
+// The us-lib classes the generated code depends on.  The sample classes
+// and the game specific ones, e.g. Network, are left out.
+const char* const kRuntimeFiles[] = {
+  "Globals.uci",
+  "Message.uc",
+  "CodedInputStream.uc",
+  "CodedOutputStream.uc",
+  "CodedUtil.uc",
+  "WireFormat.uc",
+  "MessagePool.uc",
+  "MessageRegistry.uc",
+};
+
+// Nested messages are filled up to this depth; deeper ones are left unset.
+const int kMaxDepth = 3;
+
+bool ReadFile(const string& filename, string* contents) {
+  ifstream input(filename.c_str(), ios::in | ios::binary);
+  if (!input) return false;
+
+  ostringstream buffer;
+  buffer << input.rdbuf();
+  *contents = buffer.str();
+  return true;
+}
+
+bool WriteFile(const string& filename, const string& contents) {
+  ofstream output(filename.c_str(), ios::out | ios::binary);
+  output << contents;
+  return !!output;
+}
+
+double Now() {
+  struct timeval now;
+  gettimeofday(&now, NULL);
+  return now.tv_sec + now.tv_usec / 1e6;
+}
+
+// Keeps the generated files in memory.
+class MemoryContext : public GeneratorContext {
+ public:
+  MemoryContext() {}
+  ~MemoryContext() {}
+
+  io::ZeroCopyOutputStream* Open(const string& filename) {
+    return new io::StringOutputStream(&files_[filename]);
+  }
+
+  const map<string, string>& files() const { return files_; }
+
+ private:
+  map<string, string> files_;
+};
+
+// ===================================================================
+// Random messages
+
+// Deterministic, so that a failure can be reproduced by running again.
+class Random {
+ public:
+  explicit Random(uint32 seed) : state_(seed * 2654435761u + 1) {}
+
+  uint32 Next() {
+    state_ = state_ * 6364136223846793005ULL + 1442695040888963407ULL;
+    return static_cast<uint32>(state_ >> 32);
+  }
+
+  uint64 Next64() {
+    return (static_cast<uint64>(Next()) << 32) | Next();
+  }
+
+  int Uniform(int n) { return Next() % n; }
+
+  // Mostly small values, which is what messages usually hold, but every
+  // varint length now and then.
+  uint64 Varint() {
+    switch (Uniform(4)) {
+      case 0:  return Uniform(128);
+      case 1:  return Uniform(65536);
+      case 2:  return Next();
+      default: return Next64();
+    }
+  }
+
+  float Float() {
+    switch (Uniform(4)) {
+      case 0:  return 0;
+      case 1:  return Uniform(2001) - 1000;
+      case 2:  return (static_cast<int32>(Next()) / 65536.0f);
+      default: {
+        // Any finite float, denormals included.
+        uint32 bits = Next();
+        if (((bits >> 23) & 0xFF) == 0xFF) bits &= ~(1u << 30);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+      }
+    }
+  }
+
+  // Characters of the Basic Multilingual Plane, which UnrealScript strings
+  // hold, surrogates excluded.
+  string String() {
+    string result;
+    int length = Uniform(4) == 0 ? Uniform(200) : Uniform(12);
+
+    for (int i = 0; i < length; i++) {
+      int c;
+      switch (Uniform(3)) {
+        case 0:  c = ' ' + Uniform(95); break;
+        case 1:  c = 0x80 + Uniform(0x780); break;
+        default:
+          c = 0x800 + Uniform(0xF800 - 0x800);
+          if (c >= 0xD800) c += 0x800;
+          break;
+      }
+
+      if (c < 0x80) {
+        result.push_back(c);
+      } else if (c < 0x800) {
+        result.push_back(0xC0 | (c >> 6));
+        result.push_back(0x80 | (c & 0x3F));
+      } else {
+        result.push_back(0xE0 | (c >> 12));
+        result.push_back(0x80 | ((c >> 6) & 0x3F));
+        result.push_back(0x80 | (c & 0x3F));
+      }
+    }
+
+    return result;
+  }
+
+ private:
+  uint64 state_;
+};
+
+void FillMessage(Message* message, Random* random, int depth);
+
+// Sets or adds a random value of the field.
+void FillValue(Message* message, const FieldDescriptor* field,
+               Random* random, int depth) {
+  const Reflection* reflection = message->GetReflection();
+  bool repeated = field->is_repeated();
+
+  switch (field->cpp_type()) {
+#define HANDLE_TYPE(CPPTYPE, METHOD, VALUE)                                 \
+    case FieldDescriptor::CPPTYPE_##CPPTYPE:                                \
+      if (repeated) {                                                       \
+        reflection->Add##METHOD(message, field, VALUE);                     \
+      } else {                                                              \
+        reflection->Set##METHOD(message, field, VALUE);                     \
+      }                                                                     \
+      break;
+
+    HANDLE_TYPE(INT32,  Int32,  static_cast<int32>(random->Varint()));
+    HANDLE_TYPE(INT64,  Int64,  static_cast<int64>(random->Varint()));
+    HANDLE_TYPE(UINT64, UInt64, random->Varint());
+    HANDLE_TYPE(DOUBLE, Double, random->Float());
+    HANDLE_TYPE(FLOAT,  Float,  random->Float());
+    HANDLE_TYPE(BOOL,   Bool,   random->Uniform(2) == 1);
+    HANDLE_TYPE(STRING, String, random->String());
+#undef HANDLE_TYPE
+
+    case FieldDescriptor::CPPTYPE_UINT32: {
+      uint32 value = random->Varint();
+
+      // A quantized field only holds the steps between min and max.
+      double min, max, precision;
+      if (IsQuantized(field) &&
+          GetQuantization(field, &min, &max, &precision)) {
+        value %= static_cast<uint32>((max - min) / precision) + 1;
+      }
+
+      if (repeated) {
+        reflection->AddUInt32(message, field, value);
+      } else {
+        reflection->SetUInt32(message, field, value);
+      }
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_ENUM: {
+      const EnumDescriptor* type = field->enum_type();
+      const EnumValueDescriptor* value =
+        type->value(random->Uniform(type->value_count()));
+      if (repeated) {
+        reflection->AddEnum(message, field, value);
+      } else {
+        reflection->SetEnum(message, field, value);
+      }
+      break;
+    }
+
+    case FieldDescriptor::CPPTYPE_MESSAGE:
+      FillMessage(repeated ? reflection->AddMessage(message, field) :
+                             reflection->MutableMessage(message, field),
+                  random, depth + 1);
+      break;
+  }
+}
+
+// Sets every singular field, since the generated Serialize writes them all,
+// and adds a few elements to the repeated ones.  Optional messages are
+// none when unset and left out, so some of them are skipped.
+void FillMessage(Message* message, Random* random, int depth) {
+  const Descriptor* descriptor = message->GetDescriptor();
+
+  for (int i = 0; i < descriptor->field_count(); i++) {
+    const FieldDescriptor* field = descriptor->field(i);
+
+    if (field->type() == FieldDescriptor::TYPE_GROUP) continue;
+    if (field->cpp_type() == FieldDescriptor::CPPTYPE_MESSAGE &&
+        (depth >= kMaxDepth ||
+         (field->is_optional() && random->Uniform(4) == 0))) {
+      continue;
+    }
+
+    int count = field->is_repeated() ? random->Uniform(5) : 1;
+    for (int j = 0; j < count; j++) {
+      FillValue(message, field, random, depth);
+    }
+  }
+}
+
+// ===================================================================
+// Round trips
+
+struct MessageResult {
+  MessageResult() : runs(0), failures(0), identical(0), bytes(0),
+                    decode_seconds(0), encode_seconds(0),
+                    decode_statements(0), encode_statements(0),
+                    decode_grows(0), encode_grows(0) {}
+
+  string class_name;
+  int runs;
+  int failures;
+  int identical;         // Encoded to the very bytes libprotobuf wrote.
+  int64 bytes;
+  double decode_seconds;
+  double encode_seconds;
+  int64 decode_statements;
+  int64 encode_statements;
+  int64 decode_grows;
+  int64 encode_grows;
+};
+
+class RoundTripper {
+ public:
+  RoundTripper(Emulator* emulator, bool verbose)
+    : emulator_(emulator), verbose_(verbose) {}
+
+  MessageResult Run(const Descriptor* descriptor, int iterations);
+
+ private:
+  bool RunOnce(const Descriptor* descriptor, const string& class_name,
+               Random* random, MessageResult* result);
+  bool RunDelta(const Descriptor* descriptor, const string& class_name,
+                Object* message, Random* random);
+  bool ApplyDelta(const string& class_name, Object* message,
+                  Object* baseline, const string& target);
+  Object* Decode(const string& class_name, const string& bytes);
+  bool Call(Object* object, const string& function, Value* arg,
+            Value* result = NULL);
+  Object* NewInputStream(const string& bytes);
+  bool CheckWarnings(const string& what);
+  bool Fail(const string& message);
+
+  Emulator* emulator_;
+  DynamicMessageFactory factory_;
+  bool verbose_;
+};
+
+MessageResult RoundTripper::Run(const Descriptor* descriptor,
+                                int iterations) {
+  MessageResult result;
+  result.class_name = UnrealScriptClassName(descriptor);
+
+  for (int i = 0; i < iterations; i++) {
+    Random random(i);
+    result.runs++;
+    if (!RunOnce(descriptor, result.class_name, &random, &result)) {
+      fprintf(stderr, "%s: iteration %d failed.\n",
+              result.class_name.c_str(), i);
+      result.failures++;
+    }
+
+    emulator_->CollectGarbage();
+    emulator_->ClearLog();
+  }
+
+  return result;
+}
+
+bool RoundTripper::Fail(const string& message) {
+  fprintf(stderr, "%s\n", message.c_str());
+  return false;
+}
+
+bool RoundTripper::Call(Object* object, const string& function, Value* arg,
+                        Value* result) {
+  vector<Value*> args;
+  if (arg != NULL) args.push_back(arg);
+
+  string error;
+  if (!emulator_->Call(object, function, args, result, &error)) {
+    return Fail(function + ": " + error);
+  }
+  return CheckWarnings(function);
+}
+
+// The script carries on after a warning, but it is always a bug of the
+// generated code or the runtime.
+bool RoundTripper::CheckWarnings(const string& what) {
+  if (emulator_->warnings() == 0) {
+    if (verbose_) {
+      for (int i = 0; i < emulator_->log().size(); i++) {
+        fprintf(stderr, "  %s\n", emulator_->log()[i].c_str());
+      }
+    }
+    emulator_->ClearLog();
+    return true;
+  }
+
+  fprintf(stderr, "%s logged warnings:\n", what.c_str());
+  for (int i = 0; i < emulator_->log().size(); i++) {
+    fprintf(stderr, "  %s\n", emulator_->log()[i].c_str());
+  }
+  emulator_->ClearLog();
+  return false;
+}
+
+Object* RoundTripper::NewInputStream(const string& bytes) {
+  Object* stream = emulator_->New("CodedInputStream");
+  *emulator_->Field(stream, "buffer") = Value::Bytes(bytes);
+  return stream;
+}
+
+// The bytes written to a CodedOutputStream, which are followed by the
+// space reserved for more.
+string Written(Emulator* emulator, Object* stream) {
+  string bytes = emulator->Field(stream, "buffer")->ToBytes();
+  return bytes.substr(0, emulator->Field(stream, "cursor")->i);
+}
+
+string Hex(const string& bytes) {
+  string result;
+  char buffer[4];
+  for (int i = 0; i < bytes.size(); i++) {
+    snprintf(buffer, sizeof(buffer), "%02x ", static_cast<uint8>(bytes[i]));
+    result += buffer;
+  }
+  return result;
+}
+
+bool RoundTripper::RunOnce(const Descriptor* descriptor,
+                           const string& class_name, Random* random,
+                           MessageResult* result) {
+  const Message* prototype = factory_.GetPrototype(descriptor);
+  scoped_ptr<Message> original(prototype->New());
+  FillMessage(original.get(), random, 0);
+  string bytes = original->SerializeAsString();
+
+  // Decode.
+  Object* message = emulator_->New(class_name);
+  if (message == NULL) {
+    return Fail("Class " + class_name + " not generated.");
+  }
+
+  Value input = Value::ObjectRef(NewInputStream(bytes));
+  emulator_->ResetStats();
+  double start = Now();
+  if (!Call(message, "Deserialize", &input)) return false;
+  result->decode_seconds += Now() - start;
+  result->decode_statements += emulator_->stats().statements;
+  result->decode_grows += emulator_->stats().grows;
+
+  int error = emulator_->Field(input.object, "error")->i;
+  int cursor = emulator_->Field(input.object, "cursor")->i;
+  if (error != 0 || cursor != bytes.size()) {
+    return Fail("Deserialize stopped at " + SimpleItoa(cursor) + " of " +
+                SimpleItoa(bytes.size()) + " bytes with error " +
+                SimpleItoa(error) + ": " + Hex(bytes));
+  }
+
+  // Encode.
+  Value output = Value::ObjectRef(emulator_->New("CodedOutputStream"));
+  emulator_->ResetStats();
+  start = Now();
+  if (!Call(message, "Serialize", &output)) return false;
+  result->encode_seconds += Now() - start;
+  result->encode_statements += emulator_->stats().statements;
+  result->encode_grows += emulator_->stats().grows;
+
+  string encoded = Written(emulator_, output.object);
+  result->bytes += encoded.size();
+
+  Value size;
+  if (!Call(message, "GetSerializedSize", NULL, &size)) return false;
+  if (size.i != encoded.size()) {
+    return Fail("GetSerializedSize returned " + SimpleItoa(size.i) +
+                ", Serialize wrote " + SimpleItoa(encoded.size()) +
+                " bytes.");
+  }
+
+  // Serialize reserves the exact size, so the buffer never grows further.
+  int reserved = emulator_->Field(output.object, "buffer")->elements.size();
+  if (reserved != encoded.size()) {
+    return Fail("Serialize wrote " + SimpleItoa(encoded.size()) +
+                " bytes into a buffer of " + SimpleItoa(reserved) + ".");
+  }
+
+  // libprotobuf must read back what it wrote.  Fields may come in another
+  // order or be split differently, so the bytes themselves aren't compared.
+  scoped_ptr<Message> parsed(prototype->New());
+  if (!parsed->ParseFromString(encoded)) {
+    return Fail("libprotobuf can't parse " + Hex(encoded));
+  }
+  if (parsed->SerializeAsString() != bytes) {
+    return Fail("Round trip changed the message.\n"
+                "  sent:     " + original->ShortDebugString() + "\n"
+                "  received: " + parsed->ShortDebugString());
+  }
+  if (encoded == bytes) result->identical++;
+
+  // Messages with only dirty tracking have ApplyDelta but no SerializeDelta.
+  if (emulator_->DefinesFunction(class_name, "SerializeDelta")) {
+    return RunDelta(descriptor, class_name, message, random);
+  }
+  return true;
+}
+
+// A delta against none holds every field, so it is applied to another
+// random message, whose nested messages ApplyDelta must replace, clear or
+// reset to none.  A delta against that message is applied to a copy of it.
+bool RoundTripper::RunDelta(const Descriptor* descriptor,
+                            const string& class_name, Object* message,
+                            Random* random) {
+  scoped_ptr<Message> other(factory_.GetPrototype(descriptor)->New());
+  FillMessage(other.get(), random, 0);
+  string bytes = other->SerializeAsString();
+
+  Object* baseline = Decode(class_name, bytes);
+  if (baseline == NULL) return false;
+
+  return ApplyDelta(class_name, message, NULL, bytes) &&
+         ApplyDelta(class_name, message, baseline, bytes);
+}
+
+// Applies the delta of message against baseline to the message decoded
+// from target, which must then equal message.
+bool RoundTripper::ApplyDelta(const string& class_name, Object* message,
+                              Object* baseline, const string& target) {
+  Value output = Value::ObjectRef(emulator_->New("CodedOutputStream"));
+  Value base = Value::ObjectRef(baseline);
+  vector<Value*> args;
+  args.push_back(&output);
+  args.push_back(&base);
+
+  string error;
+  if (!emulator_->Call(message, "SerializeDelta", args, NULL, &error)) {
+    return Fail("SerializeDelta: " + error);
+  }
+  if (!CheckWarnings("SerializeDelta")) return false;
+
+  string delta = Written(emulator_, output.object);
+  Value input = Value::ObjectRef(NewInputStream(delta));
+  Object* copy = Decode(class_name, target);
+  if (copy == NULL) return false;
+  if (!Call(copy, "ApplyDelta", &input)) return false;
+
+  if (emulator_->Field(input.object, "error")->i != 0 ||
+      emulator_->Field(input.object, "cursor")->i != delta.size()) {
+    return Fail("ApplyDelta didn't read the whole delta: " + Hex(delta));
+  }
+
+  Value other = Value::ObjectRef(message);
+  Value equal;
+  if (!Call(copy, "Equals", &other, &equal)) return false;
+  if (!equal.i) {
+    return Fail(string("ApplyDelta yielded another message from a delta ") +
+                (baseline == NULL ? "against none" : "against a baseline") +
+                ": " + Hex(delta));
+  }
+  return true;
+}
+
+// Returns a new instance of the class decoded from bytes, or NULL.
+Object* RoundTripper::Decode(const string& class_name, const string& bytes) {
+  Object* message = emulator_->New(class_name);
+  Value input = Value::ObjectRef(NewInputStream(bytes));
+  if (!Call(message, "Deserialize", &input)) return NULL;
+  return message;
+}
+
+// ===================================================================
+// Golden files
+
+// Returns the number of generated files differing from the golden ones.
+int CheckGolden(const map<string, string>& files, const string& golden_dir,
+                bool update) {
+  int mismatches = 0;
+
+  for (map<string, string>::const_iterator it = files.begin();
+       it != files.end(); ++it) {
+    string filename = golden_dir + "/" + it->first;
+
+    if (update) {
+      if (!WriteFile(filename, it->second)) {
+        fprintf(stderr, "%s: %s\n", filename.c_str(), strerror(errno));
+        mismatches++;
+      }
+      continue;
+    }
+
+    string golden;
+    if (!ReadFile(filename, &golden)) {
+      fprintf(stderr, "%s: missing golden file.\n", filename.c_str());
+      mismatches++;
+    } else if (golden != it->second) {
+      fprintf(stderr, "%s: generated code differs from the golden file.\n",
+              filename.c_str());
+      mismatches++;
+    }
+  }
+
+  return mismatches;
+}
+
+int Main(int argc, char* argv[]) {
+  string us_lib = "us-lib";
+  string parameter;
+  string golden_dir;
+  string descriptor_set;
+  bool update_golden = false;
+  bool verbose = false;
+  int iterations = 20;
+  vector<string> defines;
+
+  for (int i = 1; i < argc; i++) {
+    string arg = argv[i];
+
+    if (HasPrefixString(arg, "--us_lib=")) {
+      us_lib = arg.substr(9);
+    } else if (HasPrefixString(arg, "--parameter=")) {
+      parameter = arg.substr(12);
+    } else if (HasPrefixString(arg, "--define=")) {
+      defines.push_back(arg.substr(9));
+    } else if (HasPrefixString(arg, "--golden=")) {
+      golden_dir = arg.substr(9);
+    } else if (arg == "--update_golden") {
+      update_golden = true;
+    } else if (HasPrefixString(arg, "--iterations=")) {
+      iterations = atoi(arg.c_str() + 13);
+    } else if (arg == "--verbose") {
+      verbose = true;
+    } else if (descriptor_set.empty() && !HasPrefixString(arg, "--")) {
+      descriptor_set = arg;
+    } else {
+      descriptor_set.clear();
+      break;
+    }
+  }
+
+  if (descriptor_set.empty() || iterations < 1 ||
+      (update_golden && golden_dir.empty())) {
+    fprintf(stderr,
+            "Usage: %s [--us_lib=<dir>] [--parameter=<generator parameter>] "
+            "[--define=<macro>] [--golden=<dir>] [--update_golden] "
+            "[--iterations=<n>] [--verbose] <descriptor set>\n", argv[0]);
+    return 2;
+  }
+
+  string contents;
+  FileDescriptorSet set;
+  if (!ReadFile(descriptor_set, &contents) ||
+      !set.ParseFromString(contents)) {
+    fprintf(stderr, "%s: Unable to read descriptor set.\n",
+            descriptor_set.c_str());
+    return 1;
+  }
+
+  // Imports come first in a set written with --include_imports.  Those of
+  // protobuf itself, e.g. descriptor.proto for us_options.proto, and files
+  // only declaring options have nothing to generate.
+  DescriptorPool pool;
+  vector<const FileDescriptor*> files;
+  for (int i = 0; i < set.file_size(); i++) {
+    const FileDescriptor* file = pool.BuildFile(set.file(i));
+    if (file == NULL) {
+      fprintf(stderr, "%s: Unable to build %s.\n", descriptor_set.c_str(),
+              set.file(i).name().c_str());
+      return 1;
+    }
+    if (HasPrefixString(file->name(), "google/protobuf/") ||
+        (file->message_type_count() == 0 && file->enum_type_count() == 0)) {
+      continue;
+    }
+    files.push_back(file);
+  }
+
+  // Generate.
+  UnrealScriptGenerator generator;
+  MemoryContext context;
+  for (int i = 0; i < files.size(); i++) {
+    string error;
+    if (!generator.Generate(files[i], parameter, &context, &error)) {
+      fprintf(stderr, "%s: %s\n", files[i]->name().c_str(), error.c_str());
+      return 1;
+    }
+  }
+
+  int failures = 0;
+
+  if (!golden_dir.empty()) {
+    int mismatches = CheckGolden(context.files(), golden_dir, update_golden);
+    if (update_golden) {
+      printf("Updated %d golden files in %s.\n",
+             static_cast<int>(context.files().size()), golden_dir.c_str());
+    }
+    failures += mismatches;
+  }
+
+  // Load the runtime and the generated classes.
+  Emulator emulator;
+  for (int i = 0; i < defines.size(); i++) {
+    emulator.Define(defines[i], "");
+  }
+
+  for (int i = 0; i < sizeof(kRuntimeFiles) / sizeof(kRuntimeFiles[0]); i++) {
+    string filename = us_lib + "/" + kRuntimeFiles[i];
+    string source;
+    string error;
+    if (!ReadFile(filename, &source)) {
+      fprintf(stderr, "%s: %s\n", filename.c_str(), strerror(errno));
+      return 1;
+    }
+    if (!emulator.AddFile(filename, source, &error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+  }
+
+  for (map<string, string>::const_iterator it = context.files().begin();
+       it != context.files().end(); ++it) {
+    if (!HasSuffixString(it->first, ".uc")) continue;
+
+    string error;
+    if (!emulator.AddFile(it->first, it->second, &error)) {
+      fprintf(stderr, "%s\n", error.c_str());
+      return 1;
+    }
+  }
+
+  string error;
+  if (!emulator.Link(&error)) {
+    fprintf(stderr, "%s\n", error.c_str());
+    return 1;
+  }
+
+  // Round trip every message of every file.
+  RoundTripper round_tripper(&emulator, verbose);
+
+  for (int i = 0; i < files.size(); i++) {
+    vector<const Descriptor*> messages;
+    ListMessages(files[i], &messages);
+
+    for (int j = 0; j < messages.size(); j++) {
+      MessageResult result = round_tripper.Run(messages[j], iterations);
+      failures += result.failures;
+
+      printf("%-30s %3d/%d ok, %3d identical, %6.1f bytes\n",
+             result.class_name.c_str(), result.runs - result.failures,
+             result.runs, result.identical,
+             static_cast<double>(result.bytes) / result.runs);
+      printf("  decode %8.1f us %6lld stmts %4lld grows, "
+             "encode %8.1f us %6lld stmts %4lld grows\n",
+             result.decode_seconds * 1e6 / result.runs,
+             static_cast<long long>(result.decode_statements / result.runs),
+             static_cast<long long>(result.decode_grows / result.runs),
+             result.encode_seconds * 1e6 / result.runs,
+             static_cast<long long>(result.encode_statements / result.runs),
+             static_cast<long long>(result.encode_grows / result.runs));
+    }
+  }
+
+  if (failures > 0) {
+    fprintf(stderr, "%d failures.\n", failures);
+    return 1;
+  }
+  return 0;
+}
+
+}  // namespace
+}  // namespace us
+}  // namespace compiler
+}  // namespace protobuf
+}  // namespace google
+
+int main(int argc, char* argv[]) {
+  return google::protobuf::compiler::us::Main(argc, argv);
+}
@@ -1,9 +1,52 @@
 class CodedInputStream extends Object;
 
+// Class Constants
+const MAX_VARINT32_SIZE = 5;
+const MAX_VARINT64_SIZE = 10;
+
+/*
+ * Groups nested deeper than this are rejected rather
+ * than risking the script recursion limit.
+ */
+const MAX_GROUP_DEPTH = 64;
+
+const ERROR_NONE = 0;
+const ERROR_MALFORMED_VARINT = 1;
+const ERROR_TRUNCATED = 2;
+const ERROR_INVALID_TAG = 3;
+const ERROR_TOO_DEEP = 4;
+
 // Class Vars
 var array<byte> buffer;
 var int cursor;
 
+/*
+ * Cursor position at which the message currently 
+ * being read ends.  See PushLimit.
+ */
+var int currentLimit;
+
+/*
+ * Pool the nested messages are acquired from, if 
+ * any.  See NewMessage.
+ */
+var MessagePool pool;
+
+/*
+ * Set to one of the ERROR_ constants when malformed
+ * input has been read, see SetError.  Stays set 
+ * until cleared by the caller.  While it is set IsAtEnd returns true,
+ * so every decoding loop stops at the next tag or
+ * packed value and the rest of the input is never
+ * looked at.
+ */
+var int error;
+
+/*
+ * Number of groups being skipped.  See SkipGroup.
+ */
+var int groupDepth;
+
 // Class Functions
 function float ReadFloat()
 {
@@ -35,186 +78,840 @@ function int ReadSInt32()
 	return class'CodedUtil'.static.DecodeZigZag32(ReadRawVarint32());
 }
 
+function Message.Int64 ReadInt64()
+{
+	return ReadRawVarint64();
+}
+
+function Message.Int64 ReadUInt64()
+{
+	return ReadRawVarint64();
+}
+
+function Message.Int64 ReadSInt64()
+{
+	return class'CodedUtil'.static.DecodeZigZag64(ReadRawVarint64());
+}
+
+function Message.Int64 ReadFixed64()
+{
+	return ReadRawLittleEndian64();
+}
+
+function Message.Int64 ReadSFixed64()
+{
+	return ReadRawLittleEndian64();
+}
+
 function bool ReadBool()
 {
 	return ReadRawVarint32() != 0;
 }
 
+/*
+ * Packed readers append every value of a length 
+ * delimited run to the given array.
+ */
+function ReadPackedFloat(out array<float> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadFloat());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedInt32(out array<int> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadInt32());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedUInt32(out array<int> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadUInt32());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedSInt32(out array<int> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadSInt32());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedFixed32(out array<int> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadFixed32());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedSFixed32(out array<int> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadSFixed32());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedInt64(out array<Message.Int64> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadInt64());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedUInt64(out array<Message.Int64> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadUInt64());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedSInt64(out array<Message.Int64> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadSInt64());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedFixed64(out array<Message.Int64> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadFixed64());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedSFixed64(out array<Message.Int64> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadSFixed64());
+	}
+
+	PopLimit(limit);
+}
+
+function ReadPackedBool(out array<bool> values)
+{
+	local int limit;
+
+	limit = PushLimit(ReadRawVarint32());
+
+	while (!IsAtEnd())
+	{
+		values.AddItem(ReadBool());
+	}
+
+	PopLimit(limit);
+}
+
 function string ReadString()
 {
-	local int size, idx;
-	local string result;
+	return ReadRawString(ReadRawVarint32());
+}
 
-	size = ReadRawVarint32();
+/*
+ * Decodes size bytes of UTF-8.  Appending characters
+ * one at a time to a growing string is quadratic, so
+ * characters are gathered into short chunks which 
+ * are joined at the end.
+ * 
+ * Characters outside the Basic Multilingual Plane 
+ * and malformed sequences decode to U+FFFD.  So do
+ * overlong encodings, e.g. C0 80 which would end 
+ * the string at a 0, and surrogates, which the 
+ * encoder never writes.
+ */
+function string ReadRawString(int size)
+{
+	local array<string> chunks;
+	local string chunk;
+	local int end, count, value, extra, idx;
 
-	if (size > 0)
+	if (!CheckAvailable(size))
 	{
-		for (idx = 0; idx < size; idx++)
+		return "";
+	}
+
+	end = cursor + size;
+
+	while (cursor < end)
+	{
+		value = buffer[cursor++];
+
+		if (value >= 0x80)
 		{
-			result $= Chr(ReadRawByte());
+			if (value >= 0xF0)
+			{
+				extra = 3;
+				value = -1;
+			}
+			else if (value >= 0xE0)
+			{
+				extra = 2;
+				value = value & 0x0F;
+			}
+			else if (value >= 0xC0)
+			{
+				extra = 1;
+				value = value & 0x1F;
+			}
+			else
+			{
+				extra = 0;
+				value = -1;
+			}
+
+			for (idx = 0; idx < extra && cursor < end; idx++)
+			{
+				if ((buffer[cursor] & 0xC0) != 0x80)
+				{
+					break;
+				}
+
+				value = (value << 6) | (buffer[cursor++] & 0x3F);
+			}
+
+			if (idx < extra || value < 0 
+				|| (extra == 1 && value < 0x80) 
+				|| (extra == 2 && (value < 0x800 || (value >= 0xD800 && value <= 0xDFFF))))
+			{
+				value = 0xFFFD;
+			}
+		}
+
+		chunk $= Chr(value);
+		count++;
+
+		if (count == class'CodedUtil'.const.STRING_CHUNK_SIZE)
+		{
+			chunks.AddItem(chunk);
+			chunk = "";
+			count = 0;
 		}
 	}
 
-	return result;
+	if (count > 0)
+	{
+		chunks.AddItem(chunk);
+	}
+
+	return class'CodedUtil'.static.JoinStrings(chunks);
 }
 
+/*
+ * Reads a length delimited message in place by 
+ * limiting this stream to the message's bytes 
+ * while it deserializes.
+ */
 function Message ReadMessage(class<Message> messageClazz)
 {
-	local int size, idx;
+	local int limit;
 	local Message message;
-	local array<byte> tempBuffer;
 
-	local CodedInputStream stream;
+	message = NewMessage(messageClazz);
+
+	limit = PushLimit(ReadRawVarint32());
+
+	message.Deserialize(self);
 
-	size = ReadRawVarint32();
+	PopLimit(limit);
 
-	for (idx = 0; idx < size; idx++)
+	return message;
+}
+
+/*
+ * Returns a message to deserialize into, from the 
+ * pool if the stream has one.
+ */
+function Message NewMessage(class<Message> messageClazz)
+{
+	if (pool != none)
 	{
-		tempBuffer.AddItem(ReadRawByte());
+		return pool.Acquire(messageClazz);
 	}
 
-	stream = new class'CodedInputStream';
-	stream.buffer = tempBuffer;
+	return new messageClazz;
+}
 
-	message = new messageClazz;
-	
-	message.Deserialize(stream);
+/*
+ * Returns 0 once the end of the buffer or of the
+ * current limit has been reached, or once an error
+ * has been set.  Tags with a field number of 0 are
+ * never valid and set ERROR_INVALID_TAG.
+ */
+function int ReadTag()
+{
+	local int tag;
 
-	return message;
+	if (IsAtEnd())
+	{
+		return 0;
+	}
+
+	tag = ReadRawVarint32();
+
+	if ((tag >>> 3) == 0)
+	{
+		SetError(ERROR_INVALID_TAG);
+
+		return 0;
+	}
+
+	return tag;
 }
 
-function int ReadTag()
+/*
+ * Limits reading to the next byteLimit bytes so 
+ * that a nested message can be deserialized from 
+ * this stream without copying it.  ReadTag returns 
+ * 0 when the limit is reached.
+ * 
+ * Returns the previous limit which must be passed 
+ * to PopLimit once the nested message is read.
+ * 
+ * Sets ERROR_TRUNCATED if the limit is negative or 
+ * lies past the end of the buffer or of the current
+ * limit, so a corrupt length is rejected before any
+ * of the nested message is read.
+ */
+function int PushLimit(int byteLimit)
 {
-	return ReadRawVarint32();
+	local int oldLimit;
+
+	oldLimit = currentLimit;
+
+	if (byteLimit < 0 || byteLimit > Min(buffer.Length, currentLimit) - cursor)
+	{
+		SetError(ERROR_TRUNCATED);
+		byteLimit = 0;
+	}
+
+	currentLimit = cursor + byteLimit;
+
+	return oldLimit;
 }
 
+/*
+ * Sets ERROR_TRUNCATED if the last field read ran 
+ * past the limit being popped.
+ */
+function PopLimit(int oldLimit)
+{
+	if (cursor > currentLimit)
+	{
+		SetError(ERROR_TRUNCATED);
+	}
+
+	currentLimit = oldLimit;
+}
+
+function bool IsAtEnd()
+{
+	return cursor >= buffer.Length || cursor >= currentLimit || error != ERROR_NONE;
+}
+
+/*
+ * Records the cause of a decoding failure.  Only 
+ * the first error is kept, since what is read after
+ * it is garbage and would report a wrong cause.
+ */
+function SetError(int code)
+{
+	if (error == ERROR_NONE)
+	{
+		error = code;
+	}
+}
+
+/*
+ * Returns true if count more bytes can be read. 
+ * Otherwise sets ERROR_TRUNCATED and moves the 
+ * cursor to the end of the buffer.
+ */
+function bool CheckAvailable(int count)
+{
+	if (count >= 0 && count <= buffer.Length - cursor)
+	{
+		return true;
+	}
+
+	SetError(ERROR_TRUNCATED);
+	cursor = buffer.Length;
+
+	return false;
+}
+
+/*
+ * Sets error and returns 0 if the varint is 
+ * truncated or longer than 10 bytes.
+ */
 function int ReadRawVarint32()
 {
-	local int temp;
-	local int result, idx;
+	local int b, result;
 
-	if (buffer.Length <= cursor)
+	if (cursor >= buffer.Length)
 	{
+		SetError(ERROR_TRUNCATED);
+
 		return 0;
 	}
 
-	temp = ReadRawSignedByte();
+	// Tags and small values take a single byte.
+	b = buffer[cursor];
 
-	if (temp >= 0)
+	if (b < 0x80)
 	{
-		result = temp;
+		cursor++;
+
+		return b;
+	}
+
+	// With a whole varint32 worth of bytes left, they 
+	// can be read without checking the length each time.
+	if (buffer.Length - cursor < MAX_VARINT32_SIZE)
+	{
+		return ReadRawVarint32Slow();
+	}
+
+	result = b & 0x7F;
+
+	b = buffer[cursor + 1];
+	result = result | ((b & 0x7F) << 7);
+
+	if (b < 0x80)
+	{
+		cursor += 2;
+
+		return result;
+	}
+
+	b = buffer[cursor + 2];
+	result = result | ((b & 0x7F) << 14);
+
+	if (b < 0x80)
+	{
+		cursor += 3;
+
+		return result;
 	}
-	else
+
+	b = buffer[cursor + 3];
+	result = result | ((b & 0x7F) << 21);
+
+	if (b < 0x80)
 	{
-		result = temp & 0x7F;
+		cursor += 4;
 
-		temp = ReadRawSignedByte();
+		return result;
+	}
+
+	b = buffer[cursor + 4];
+	result = result | (b << 28);
+
+	cursor += 5;
 
-		if (temp >= 0)
+	if (b < 0x80)
+	{
+		return result;
+	}
+
+	return SkipRawVarint64Tail(result);
+}
+
+/*
+ * Same as ReadRawVarint32 for varints that may run 
+ * past the end of the buffer.
+ */
+function int ReadRawVarint32Slow()
+{
+	local int b, result, shift;
+
+	result = 0;
+
+	for (shift = 0; shift < 35; shift += 7)
+	{
+		if (cursor >= buffer.Length)
 		{
-			result = result | (temp << 7);
+			SetError(ERROR_TRUNCATED);
+
+			return 0;
 		}
-		else
+
+		b = buffer[cursor++];
+		result = result | ((b & 0x7F) << shift);
+
+		if (b < 0x80)
 		{
-			result = result | ((temp & 0x7F) << 7);
+			return result;
+		}
+	}
 
-			temp = ReadRawSignedByte();
+	return SkipRawVarint64Tail(result);
+}
 
-			if (temp >= 0)
-			{
-				result = result | (temp << 14);
-			}
-			else
-			{
-				result = result | ((temp & 0x7F) << 14);
+/*
+ * Negative int32 values sent by other implementations
+ * are sign extended to 10 bytes.  Skips the 5 bytes 
+ * past the ones making up the 32 bit value.
+ */
+function int SkipRawVarint64Tail(int result)
+{
+	local int idx;
 
-				temp = ReadRawSignedByte();
+	for (idx = 0; idx < MAX_VARINT64_SIZE - MAX_VARINT32_SIZE; idx++)
+	{
+		if (cursor >= buffer.Length)
+		{
+			SetError(ERROR_TRUNCATED);
 
-				if (temp >= 0)
-				{
-					result = result | (temp << 21);
-				}
-				else
-				{
-					result = result | ((temp & 0x7F) << 21);
+			return 0;
+		}
 
-					temp = ReadRawSignedByte();
+		if (buffer[cursor++] < 0x80)
+		{
+			return result;
+		}
+	}
 
-					result = result | ((temp & 0x7F) << 28);
+	SetError(ERROR_MALFORMED_VARINT);
 
-					if (temp < 0)
-					{
-						for (idx = 0; idx < 5; idx++)
-						{
-							if (ReadRawSignedByte() >= 0)
-							{
-								return result;
-							}
-						}
+	return 0;
+}
 
-						// TODO: Signal error condition.
-					}
-				}
-			}
+/*
+ * Sets error and returns 0 if the varint is 
+ * truncated or longer than 10 bytes.
+ */
+function Message.Int64 ReadRawVarint64()
+{
+	local Message.Int64 result;
+	local int b, shift;
+
+	for (shift = 0; shift < 64; shift += 7)
+	{
+		if (cursor >= buffer.Length)
+		{
+			SetError(ERROR_TRUNCATED);
+			result.lo = 0;
+			result.hi = 0;
+
+			return result;
+		}
+
+		b = buffer[cursor++];
+
+		// The fifth byte straddles the two words.
+		if (shift < 32)
+		{
+			result.lo = result.lo | ((b & 0x7F) << shift);
+		}
+
+		if (shift == 28)
+		{
+			result.hi = (b & 0x7F) >>> 4;
+		}
+		else if (shift > 28)
+		{
+			result.hi = result.hi | ((b & 0x7F) << (shift - 32));
+		}
+
+		if (b < 0x80)
+		{
+			return result;
 		}
 	}
 
+	SetError(ERROR_MALFORMED_VARINT);
+	result.lo = 0;
+	result.hi = 0;
+
 	return result;
 }
 
+/*
+ * The bytes are checked once up front, and read 
+ * without going through ReadRawByte.
+ */
 function int ReadRawLittleEndian32()
 {
 	local int result;
 
-	result = ReadRawByte();
-	result = result | (ReadRawByte() << 8);
-	result = result | (ReadRawByte() << 16);
-	result = result | (ReadRawByte() << 24);
+	if (!CheckAvailable(4))
+	{
+		return 0;
+	}
+
+	result = buffer[cursor];
+	result = result | (buffer[cursor + 1] << 8);
+	result = result | (buffer[cursor + 2] << 16);
+	result = result | (buffer[cursor + 3] << 24);
+
+	cursor += 4;
 
 	return result;
 }
 
-function float ReadRawLittleEndian32Float()
+function Message.Int64 ReadRawLittleEndian64()
 {
-	local float result;
+	local Message.Int64 result;
 
-	result = ReadRawByte();
-	result = result | (ReadRawByte() << 8);
-	result = result | (ReadRawByte() << 16);
-	result = result | (ReadRawByte() << 24);
+	if (!CheckAvailable(8))
+	{
+		return result;
+	}
+
+	result.lo = ReadRawLittleEndian32();
+	result.hi = ReadRawLittleEndian32();
 
 	return result;
 }
 
-function int ReadRawSignedByte()
+function float ReadRawLittleEndian32Float()
 {
-	local byte temp;
-	local int result;
+	return class'CodedUtil'.static.BitsToFloat(ReadRawLittleEndian32());
+}
 
-	temp = ReadRawByte();
+/*
+ * Sets ERROR_TRUNCATED and returns 0 at the end of
+ * the buffer.
+ */
+function byte ReadRawByte()
+{
+	if (cursor >= buffer.Length)
+	{
+		SetError(ERROR_TRUNCATED);
 
-	if ((temp & 0x80) == 0x80)
+		return 0;
+	}
+
+	return buffer[cursor++];
+}
+
+function SkipBytes(int count)
+{
+	if (CheckAvailable(count))
 	{
-		temp = temp & 0x7F;
+		cursor += count;
+	}
+}
+
+function SkipRawVarint()
+{
+	local int idx;
+
+	for (idx = 0; idx < MAX_VARINT64_SIZE; idx++)
+	{
+		if (ReadRawByte() < 0x80 || error != ERROR_NONE)
+		{
+			return;
+		}
+	}
+
+	SetError(ERROR_MALFORMED_VARINT);
+}
+
+/*
+ * Skips the value of a field whose tag has just 
+ * been read.  Returns false and sets error if the
+ * tag has an invalid wire type, in which case the
+ * rest of the message can't be read.
+ */
+function bool SkipField(int tag)
+{
+	switch (class'WireFormat'.static.GetTagWireType(tag))
+	{
+		case class'WireFormat'.const.WIRE_TYPE_VARINT:
+			SkipRawVarint();
+			return true;
+
+		case class'WireFormat'.const.WIRE_TYPE_FIXED64:
+			SkipBytes(8);
+			return true;
 
-		result = temp;
+		case class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED:
+			SkipBytes(ReadRawVarint32());
+			return true;
 
-		result = result | 0x80000000;
+		case class'WireFormat'.const.WIRE_TYPE_START_GROUP:
+			return SkipGroup(class'WireFormat'.static.GetTagFieldNumber(tag));
+
+		case class'WireFormat'.const.WIRE_TYPE_FIXED32:
+			SkipBytes(4);
+			return true;
+
+		default:
+			SetError(ERROR_INVALID_TAG);
+			return false;
 	}
-	else
+}
+
+/*
+ * Skips the fields of a group up to and including 
+ * its end group tag.
+ */
+function bool SkipGroup(int fieldNumber)
+{
+	local bool result;
+
+	if (groupDepth >= MAX_GROUP_DEPTH)
 	{
-		result = temp;
+		SetError(ERROR_TOO_DEEP);
+
+		return false;
 	}
 
+	groupDepth++;
+	result = SkipGroupFields(fieldNumber);
+	groupDepth--;
+
 	return result;
 }
 
-function byte ReadRawByte()
+function bool SkipGroupFields(int fieldNumber)
 {
-	return buffer[cursor++];
+	local int tag;
+
+	tag = ReadTag();
+
+	while (tag > 0)
+	{
+		if (class'WireFormat'.static.GetTagWireType(tag) == class'WireFormat'.const.WIRE_TYPE_END_GROUP)
+		{
+			if (class'WireFormat'.static.GetTagFieldNumber(tag) == fieldNumber)
+			{
+				return true;
+			}
+
+			break;
+		}
+
+		if (!SkipField(tag))
+		{
+			return false;
+		}
+
+		tag = ReadTag();
+	}
+
+	// Unterminated group or mismatched end group tag.
+	SetError(ERROR_INVALID_TAG);
+
+	return false;
 }
 
-function SkipBytes(int count)
+/*
+ * Skips a field whose tag has just been read and 
+ * appends its tag and raw bytes to unknownFields so
+ * they can be written back out unchanged.  Returns
+ * false under the same conditions as SkipField.
+ */
+function bool ReadUnknownField(int tag, out array<byte> unknownFields)
+{
+	local int start, end, idx;
+
+	start = cursor;
+
+	if (!SkipField(tag))
+	{
+		return false;
+	}
+
+	end = Min(cursor, buffer.Length);
+
+	while ((tag & ~0x7F) != 0)
+	{
+		unknownFields.AddItem((tag & 0x7F) | 0x80);
+
+		tag = tag >>> 7;
+	}
+
+	unknownFields.AddItem(tag);
+
+	for (idx = start; idx < end; idx++)
+	{
+		unknownFields.AddItem(buffer[idx]);
+	}
+
+	return true;
+}
+
+defaultproperties
 {
-	cursor += count;
+	currentLimit = 2147483647; // No limit.
 }
\ No newline at end of file
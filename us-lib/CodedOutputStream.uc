@@ -1,7 +1,50 @@
 class CodedOutputStream extends Object;
 
+// Class Constants
+
+/*
+ * Bytes reserved by the first write that finds the
+ * buffer full.  See WriteRawByte.
+ */
+const MIN_RESERVE = 64;
+
 // Class Vars
+
+/*
+ * The bytes written are buffer[0] to buffer[cursor - 1].
+ * The buffer is usually longer: the bytes past the
+ * cursor are reserved for the next writes and hold
+ * garbage.
+ */
 var array<byte> buffer;
+var int cursor;
+
+// Class Functions
+
+/*
+ * Makes room for count more bytes, so that writing
+ * them doesn't grow the buffer.  Serialize reserves
+ * the serialized size of the message, which makes an
+ * encode a single allocation, or none at all when
+ * the stream is reused.
+ */
+function Reserve(int count)
+{
+	if (cursor + count > buffer.Length)
+	{
+		buffer.Length = cursor + count;
+	}
+}
+
+/*
+ * Discards the bytes written but keeps the buffer
+ * allocated, so that the stream can be reused for
+ * the next message.
+ */
+function Reset()
+{
+	cursor = 0;
+}
 
 function WriteFloat(int fieldNumber, float value)
 {
@@ -39,53 +82,431 @@ function WriteSFixed32(int fieldNumber, int value)
 	WriteRawLittleEndian32(value);
 }
 
+function WriteInt64(int fieldNumber, Message.Int64 value)
+{
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_VARINT);
+	WriteRawVarint64(value);
+}
+
+function WriteUInt64(int fieldNumber, Message.Int64 value)
+{
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_VARINT);
+	WriteRawVarint64(value);
+}
+
+function WriteSInt64(int fieldNumber, Message.Int64 value)
+{
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_VARINT);
+	WriteRawVarint64(class'CodedUtil'.static.EncodeZigZag64(value));
+}
+
+function WriteFixed64(int fieldNumber, Message.Int64 value)
+{
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_FIXED64);
+	WriteRawLittleEndian64(value);
+}
+
+function WriteSFixed64(int fieldNumber, Message.Int64 value)
+{
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_FIXED64);
+	WriteRawLittleEndian64(value);
+}
+
 function WriteBool(int fieldNumber, bool value)
 {
 	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_VARINT);
 	WriteRawByte(value ? 1 : 0);
 }
 
+function WriteFloatNoTag(float value)
+{
+	WriteRawLittleEndian32Float(value);
+}
+
+function WriteInt32NoTag(int value)
+{
+	WriteRawVarint32(value);
+}
+
+function WriteUInt32NoTag(int value)
+{
+	WriteRawVarint32(value);
+}
+
+function WriteSInt32NoTag(int value)
+{
+	WriteRawVarint32(class'CodedUtil'.static.EncodeZigZag32(value));
+}
+
+function WriteFixed32NoTag(int value)
+{
+	WriteRawLittleEndian32(value);
+}
+
+function WriteSFixed32NoTag(int value)
+{
+	WriteRawLittleEndian32(value);
+}
+
+function WriteInt64NoTag(Message.Int64 value)
+{
+	WriteRawVarint64(value);
+}
+
+function WriteUInt64NoTag(Message.Int64 value)
+{
+	WriteRawVarint64(value);
+}
+
+function WriteSInt64NoTag(Message.Int64 value)
+{
+	WriteRawVarint64(class'CodedUtil'.static.EncodeZigZag64(value));
+}
+
+function WriteFixed64NoTag(Message.Int64 value)
+{
+	WriteRawLittleEndian64(value);
+}
+
+function WriteSFixed64NoTag(Message.Int64 value)
+{
+	WriteRawLittleEndian64(value);
+}
+
+function WriteBoolNoTag(bool value)
+{
+	WriteRawByte(value ? 1 : 0);
+}
+
 /*
- * Only supports ASCII strings.
+ * Packed repeated fields are written as a single 
+ * length delimited run of values without tags.
+ * Nothing is written for an empty array.
  */
-function WriteString(int fieldNumber, string value)
+function WritePackedFloat(int fieldNumber, out array<float> values)
 {
+	local int idx;
+
+	if (values.Length == 0)
+	{
+		return;
+	}
+
 	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
-	WriteRawVarint32(Len(value));
-	WriteRawString(value);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedFloatDataSize(values));
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteFloatNoTag(values[idx]);
+	}
 }
 
-function WriteRawString(string value)
+function WritePackedInt32(int fieldNumber, out array<int> values)
 {
 	local int idx;
-	local string substring;
 
-	for (idx = 0; idx < Len(value); idx++)
+	if (values.Length == 0)
 	{
-		substring = Mid(value, idx, 1);
+		return;
+	}
 
-		WriteRawByte(Asc(substring));
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedInt32DataSize(values));
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteInt32NoTag(values[idx]);
 	}
 }
 
-function WriteMessage(int fieldNumber, Message message)
+function WritePackedUInt32(int fieldNumber, out array<int> values)
+{
+	local int idx;
+
+	if (values.Length == 0)
+	{
+		return;
+	}
+
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedUInt32DataSize(values));
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteUInt32NoTag(values[idx]);
+	}
+}
+
+function WritePackedSInt32(int fieldNumber, out array<int> values)
+{
+	local int idx;
+
+	if (values.Length == 0)
+	{
+		return;
+	}
+
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedSInt32DataSize(values));
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteSInt32NoTag(values[idx]);
+	}
+}
+
+function WritePackedFixed32(int fieldNumber, out array<int> values)
 {
-	local CodedOutputStream stream;
 	local int idx;
 
-	stream = new class'CodedOutputStream';
+	if (values.Length == 0)
+	{
+		return;
+	}
+
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedFixed32DataSize(values));
 
-	message.Serialize(stream);
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteFixed32NoTag(values[idx]);
+	}
+}
+
+function WritePackedSFixed32(int fieldNumber, out array<int> values)
+{
+	local int idx;
+
+	if (values.Length == 0)
+	{
+		return;
+	}
+
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedSFixed32DataSize(values));
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteSFixed32NoTag(values[idx]);
+	}
+}
+
+function WritePackedInt64(int fieldNumber, out array<Message.Int64> values)
+{
+	local int idx;
+
+	if (values.Length == 0)
+	{
+		return;
+	}
 
 	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
-	WriteRawVarint32(stream.buffer.Length);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedInt64DataSize(values));
 
-	for (idx = 0; idx < stream.buffer.Length; idx++)
+	for (idx = 0; idx < values.Length; idx++)
 	{
-		WriteRawByte(stream.buffer[idx]);
+		WriteInt64NoTag(values[idx]);
 	}
 }
 
+function WritePackedUInt64(int fieldNumber, out array<Message.Int64> values)
+{
+	local int idx;
+
+	if (values.Length == 0)
+	{
+		return;
+	}
+
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedUInt64DataSize(values));
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteUInt64NoTag(values[idx]);
+	}
+}
+
+function WritePackedSInt64(int fieldNumber, out array<Message.Int64> values)
+{
+	local int idx;
+
+	if (values.Length == 0)
+	{
+		return;
+	}
+
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedSInt64DataSize(values));
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteSInt64NoTag(values[idx]);
+	}
+}
+
+function WritePackedFixed64(int fieldNumber, out array<Message.Int64> values)
+{
+	local int idx;
+
+	if (values.Length == 0)
+	{
+		return;
+	}
+
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedFixed64DataSize(values));
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteFixed64NoTag(values[idx]);
+	}
+}
+
+function WritePackedSFixed64(int fieldNumber, out array<Message.Int64> values)
+{
+	local int idx;
+
+	if (values.Length == 0)
+	{
+		return;
+	}
+
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedSFixed64DataSize(values));
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteSFixed64NoTag(values[idx]);
+	}
+}
+
+function WritePackedBool(int fieldNumber, out array<bool> values)
+{
+	local int idx;
+
+	if (values.Length == 0)
+	{
+		return;
+	}
+
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(class'CodedUtil'.static.ComputePackedBoolDataSize(values));
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		WriteBoolNoTag(values[idx]);
+	}
+}
+
+/*
+ * Strings are encoded as UTF-8.
+ */
+function WriteString(int fieldNumber, string value)
+{
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteStringNoTag(value);
+}
+
+function WriteStringNoTag(string value)
+{
+	local int length, start;
+
+	length = Len(value);
+
+	// A character takes at most 3 bytes, so short strings 
+	// get a single byte length which is filled in once the 
+	// string is encoded.  This saves a pass over the string.
+	if (length * 3 < 0x80)
+	{
+		start = cursor;
+
+		WriteRawByte(0);
+		WriteRawStringChunk(value, length);
+
+		buffer[start] = cursor - start - 1;
+	}
+	else
+	{
+		WriteRawVarint32(class'CodedUtil'.static.ComputeRawStringSize(value));
+		WriteRawStringChunk(value, length);
+	}
+}
+
+function WriteRawString(string value)
+{
+	WriteRawStringChunk(value, Len(value));
+}
+
+/*
+ * Halves the string until the chunks are short 
+ * enough to walk one character at a time.  See
+ * CodedUtil.STRING_CHUNK_SIZE.
+ */
+function WriteRawStringChunk(string value, int length)
+{
+	local int half, idx;
+
+	if (length > class'CodedUtil'.const.STRING_CHUNK_SIZE)
+	{
+		half = length / 2;
+
+		WriteRawStringChunk(Left(value, half), half);
+		WriteRawStringChunk(Mid(value, half), length - half);
+
+		return;
+	}
+
+	for (idx = 0; idx < length; idx++)
+	{
+		WriteRawUtf8Char(Asc(Mid(value, idx, 1)));
+	}
+}
+
+function WriteRawUtf8Char(int value)
+{
+	if (value < 0x80)
+	{
+		WriteRawByte(value);
+	}
+	else if (value < 0x800)
+	{
+		WriteRawByte(0xC0 | (value >> 6));
+		WriteRawByte(0x80 | (value & 0x3F));
+	}
+	else
+	{
+		// Lone surrogates are not valid UTF-8.
+		if (value >= 0xD800 && value <= 0xDFFF)
+		{
+			value = 0xFFFD;
+		}
+
+		WriteRawByte(0xE0 | (value >> 12));
+		WriteRawByte(0x80 | ((value >> 6) & 0x3F));
+		WriteRawByte(0x80 | (value & 0x3F));
+	}
+}
+
+/*
+ * Writes the length prefix from the message's
+ * serialized size and then serializes the message
+ * directly into this stream.  The size pass caches
+ * the sizes of all nested messages along the way.
+ */
+function WriteMessage(int fieldNumber, Message message)
+{
+	if (message == none)
+	{
+		return;
+	}
+
+	WriteTag(fieldNumber, class'WireFormat'.const.WIRE_TYPE_LENGTH_DELIMITED);
+	WriteRawVarint32(message.GetSerializedSize());
+
+	message.SerializeWithCachedSizes(self);
+}
+
 function WriteTag(int fieldNumber, int wireType)
 {
 	WriteRawVarint32(class'WireFormat'.static.MakeTag(fieldNumber, wireType));
@@ -110,6 +531,28 @@ function WriteRawVarint32(int value)
 	}
 }
 
+/*
+ * Shifts the 64 bit value right by 7 bits per byte,
+ * carrying bits from the high word into the low one.
+ */
+function WriteRawVarint64(Message.Int64 value)
+{
+	local int lo, hi;
+
+	lo = value.lo;
+	hi = value.hi;
+
+	while (hi != 0 || (lo & ~0x7F) != 0)
+	{
+		WriteRawByte((lo & 0x7F) | 0x80);
+
+		lo = (lo >>> 7) | (hi << 25);
+		hi = hi >>> 7;
+	}
+
+	WriteRawByte(lo);
+}
+
 function WriteRawLittleEndian32(int value)
 {
 	WriteRawByte(value & 0xFF);
@@ -118,15 +561,40 @@ function WriteRawLittleEndian32(int value)
 	WriteRawByte((value >> 24) & 0xFF);
 }
 
+function WriteRawLittleEndian64(Message.Int64 value)
+{
+	WriteRawLittleEndian32(value.lo);
+	WriteRawLittleEndian32(value.hi);
+}
+
 function WriteRawLittleEndian32Float(float value)
 {
-	WriteRawByte(value & 0xFF);
-	WriteRawByte((value >> 8) & 0xFF);
-	WriteRawByte((value >> 16) & 0xFF);
-	WriteRawByte((value >> 24) & 0xFF);
-} 
+	WriteRawLittleEndian32(class'CodedUtil'.static.FloatToBits(value));
+}
+
+function WriteRawBytes(out array<byte> values)
+{
+	local int idx;
+
+	Reserve(values.Length);
 
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		buffer[cursor++] = values[idx];
+	}
+}
+
+/*
+ * Unreserved writes double the buffer when it is 
+ * full, so that it still only grows a logarithmic 
+ * number of times.
+ */
 function WriteRawByte(byte value)
 {
-	buffer.AddItem(value);
+	if (cursor >= buffer.Length)
+	{
+		Reserve(Max(buffer.Length, MIN_RESERVE));
+	}
+
+	buffer[cursor++] = value;
 }
\ No newline at end of file
@@ -2,6 +2,17 @@ class CodedUtil extends Object;
 
 // Class Consts
 const LITTLE_ENDIAN_32_SIZE = 4;
+const LITTLE_ENDIAN_64_SIZE = 8;
+const LOGE_2 = 0.6931472;
+
+/*
+ * Strings are passed by value in UnrealScript, so 
+ * walking a long string one character at a time 
+ * copies it once per character.  The string codec
+ * splits strings into chunks of at most this many
+ * characters and works on those instead.
+ */
+const STRING_CHUNK_SIZE = 32;
 
 // Class Functions
 static function int ComputeFloatSize(int fieldNumber, float value)
@@ -9,16 +20,15 @@ static function int ComputeFloatSize(int fieldNumber, float value)
 	return ComputeTagSize(fieldNumber) + LITTLE_ENDIAN_32_SIZE;
 }
 
+/*
+ * Negative values take 5 bytes since WriteRawVarint32
+ * only encodes the 32 bits UnrealScript has.  This must
+ * match the writer exactly as the size is used as the
+ * length prefix of nested messages.
+ */
 static function int ComputeInt32Size(int fieldNumber, int value)
 {
-	if (value >= 0)
-	{
-		return ComputeTagSize(fieldNumber) + ComputeRawVarint32Size(value);
-	}
-	else
-	{
-		return ComputeTagSize(fieldNumber) + 10;
-	}
+	return ComputeTagSize(fieldNumber) + ComputeRawVarint32Size(value);
 }
 
 static function int ComputeUInt32Size(int fieldNumber, int value)
@@ -41,30 +51,419 @@ static function int ComputeSFixed32Size(int fieldNumber, int value)
 	return ComputeTagSize(fieldNumber) + LITTLE_ENDIAN_32_SIZE;
 }
 
+/*
+ * Unlike int32, negative int64 values take the full
+ * 10 bytes, as in every other implementation.
+ */
+static function int ComputeInt64Size(int fieldNumber, Message.Int64 value)
+{
+	return ComputeTagSize(fieldNumber) + ComputeRawVarint64Size(value);
+}
+
+static function int ComputeUInt64Size(int fieldNumber, Message.Int64 value)
+{
+	return ComputeTagSize(fieldNumber) + ComputeRawVarint64Size(value);
+}
+
+static function int ComputeSInt64Size(int fieldNumber, Message.Int64 value)
+{
+	return ComputeTagSize(fieldNumber) + ComputeRawVarint64Size(EncodeZigZag64(value));
+}
+
+static function int ComputeFixed64Size(int fieldNumber, Message.Int64 value)
+{
+	return ComputeTagSize(fieldNumber) + LITTLE_ENDIAN_64_SIZE;
+}
+
+static function int ComputeSFixed64Size(int fieldNumber, Message.Int64 value)
+{
+	return ComputeTagSize(fieldNumber) + LITTLE_ENDIAN_64_SIZE;
+}
+
 static function int ComputeBoolSize(int fieldNumber, bool value)
 {
 	return ComputeTagSize(fieldNumber) + 1;
 }
 
-/*
- * Only supports ASCII strings.
- */
 static function int ComputeStringSize(int fieldNumber, string value)
 {
-	return ComputeTagSize(fieldNumber) + ComputeRawStringSize(value);
+	local int size;
+
+	size = ComputeRawStringSize(value);
+
+	return ComputeTagSize(fieldNumber) + ComputeRawVarint32Size(size) + size;
 }
 
 /*
- * Only supports ASCII strings.
+ * Returns the length of the string encoded as UTF-8.
  */
 static function int ComputeRawStringSize(string value)
 {
-	return Len(value);
+	return ComputeRawStringChunkSize(value, Len(value));
+}
+
+static function int ComputeRawStringChunkSize(string value, int length)
+{
+	local int half, size, idx;
+
+	if (length > STRING_CHUNK_SIZE)
+	{
+		half = length / 2;
+
+		return ComputeRawStringChunkSize(Left(value, half), half)
+			+ ComputeRawStringChunkSize(Mid(value, half), length - half);
+	}
+
+	for (idx = 0; idx < length; idx++)
+	{
+		size += ComputeUtf8CharSize(Asc(Mid(value, idx, 1)));
+	}
+
+	return size;
+}
+
+/*
+ * Surrogates are encoded as U+FFFD since a lone
+ * surrogate is not valid UTF-8.
+ */
+static function int ComputeUtf8CharSize(int value)
+{
+	if (value < 0x80) return 1;
+	if (value < 0x800) return 2;
+
+	return 3;
+}
+
+/*
+ * Joins the strings pairwise so that every character
+ * is copied once per level instead of once per string.
+ */
+static function string JoinStrings(out array<string> strings)
+{
+	local int idx, count;
+
+	if (strings.Length == 0)
+	{
+		return "";
+	}
+
+	while (strings.Length > 1)
+	{
+		count = 0;
+
+		for (idx = 0; idx + 1 < strings.Length; idx += 2)
+		{
+			strings[count++] = strings[idx] $ strings[idx + 1];
+		}
+
+		if (idx < strings.Length)
+		{
+			strings[count++] = strings[idx];
+		}
+
+		strings.Length = count;
+	}
+
+	return strings[0];
 }
 
 static function int ComputeMessageSize(int fieldNumber, Message message)
 {
-	return ComputeTagSize(fieldNumber) + message.GetSerializedSize();
+	local int size;
+
+	// Unset messages are not written at all.
+	if (message == none)
+	{
+		return 0;
+	}
+
+	size = message.GetSerializedSize();
+
+	return ComputeTagSize(fieldNumber) + ComputeRawVarint32Size(size) + size;
+}
+
+/*
+ * Sizes of values without their tag, as written by 
+ * the *NoTag functions of CodedOutputStream.
+ */
+static function int ComputeFloatSizeNoTag(float value)
+{
+	return LITTLE_ENDIAN_32_SIZE;
+}
+
+static function int ComputeInt32SizeNoTag(int value)
+{
+	return ComputeRawVarint32Size(value);
+}
+
+static function int ComputeUInt32SizeNoTag(int value)
+{
+	return ComputeRawVarint32Size(value);
+}
+
+static function int ComputeSInt32SizeNoTag(int value)
+{
+	return ComputeRawVarint32Size(EncodeZigZag32(value));
+}
+
+static function int ComputeFixed32SizeNoTag(int value)
+{
+	return LITTLE_ENDIAN_32_SIZE;
+}
+
+static function int ComputeSFixed32SizeNoTag(int value)
+{
+	return LITTLE_ENDIAN_32_SIZE;
+}
+
+static function int ComputeInt64SizeNoTag(Message.Int64 value)
+{
+	return ComputeRawVarint64Size(value);
+}
+
+static function int ComputeUInt64SizeNoTag(Message.Int64 value)
+{
+	return ComputeRawVarint64Size(value);
+}
+
+static function int ComputeSInt64SizeNoTag(Message.Int64 value)
+{
+	return ComputeRawVarint64Size(EncodeZigZag64(value));
+}
+
+static function int ComputeFixed64SizeNoTag(Message.Int64 value)
+{
+	return LITTLE_ENDIAN_64_SIZE;
+}
+
+static function int ComputeSFixed64SizeNoTag(Message.Int64 value)
+{
+	return LITTLE_ENDIAN_64_SIZE;
+}
+
+static function int ComputeBoolSizeNoTag(bool value)
+{
+	return 1;
+}
+
+static function int ComputeStringSizeNoTag(string value)
+{
+	local int size;
+
+	size = ComputeRawStringSize(value);
+
+	return ComputeRawVarint32Size(size) + size;
+}
+
+/*
+ * Missing messages are written as empty ones.
+ */
+static function int ComputeMessageSizeNoTag(Message message)
+{
+	local int size;
+
+	if (message == none)
+	{
+		return 1;
+	}
+
+	size = message.GetSerializedSize();
+
+	return ComputeRawVarint32Size(size) + size;
+}
+
+/*
+ * Singular messages of a delta are prefixed by their 
+ * size plus one, so that 0 can stand for none.
+ */
+static function int ComputeDeltaMessageSize(Message message)
+{
+	local int size;
+
+	if (message == none)
+	{
+		return 1;
+	}
+
+	size = message.GetSerializedSize();
+
+	return ComputeRawVarint32Size(size + 1) + size;
+}
+
+/*
+ * Packed repeated fields take a single tag and 
+ * length prefix followed by the untagged values.
+ */
+static function int ComputePackedFloatSize(int fieldNumber, out array<float> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedFloatDataSize(values));
+}
+
+static function int ComputePackedInt32Size(int fieldNumber, out array<int> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedInt32DataSize(values));
+}
+
+static function int ComputePackedUInt32Size(int fieldNumber, out array<int> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedUInt32DataSize(values));
+}
+
+static function int ComputePackedSInt32Size(int fieldNumber, out array<int> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedSInt32DataSize(values));
+}
+
+static function int ComputePackedFixed32Size(int fieldNumber, out array<int> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedFixed32DataSize(values));
+}
+
+static function int ComputePackedSFixed32Size(int fieldNumber, out array<int> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedSFixed32DataSize(values));
+}
+
+static function int ComputePackedInt64Size(int fieldNumber, out array<Message.Int64> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedInt64DataSize(values));
+}
+
+static function int ComputePackedUInt64Size(int fieldNumber, out array<Message.Int64> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedUInt64DataSize(values));
+}
+
+static function int ComputePackedSInt64Size(int fieldNumber, out array<Message.Int64> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedSInt64DataSize(values));
+}
+
+static function int ComputePackedFixed64Size(int fieldNumber, out array<Message.Int64> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedFixed64DataSize(values));
+}
+
+static function int ComputePackedSFixed64Size(int fieldNumber, out array<Message.Int64> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedSFixed64DataSize(values));
+}
+
+static function int ComputePackedBoolSize(int fieldNumber, out array<bool> values)
+{
+	return ComputePackedSize(fieldNumber, ComputePackedBoolDataSize(values));
+}
+
+static function int ComputePackedSize(int fieldNumber, int dataSize)
+{
+	if (dataSize == 0)
+	{
+		return 0;
+	}
+
+	return ComputeTagSize(fieldNumber) + ComputeRawVarint32Size(dataSize) + dataSize;
+}
+
+static function int ComputePackedFloatDataSize(out array<float> values)
+{
+	return values.Length * LITTLE_ENDIAN_32_SIZE;
+}
+
+static function int ComputePackedInt32DataSize(out array<int> values)
+{
+	local int idx, size;
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		size += ComputeRawVarint32Size(values[idx]);
+	}
+
+	return size;
+}
+
+static function int ComputePackedUInt32DataSize(out array<int> values)
+{
+	local int idx, size;
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		size += ComputeRawVarint32Size(values[idx]);
+	}
+
+	return size;
+}
+
+static function int ComputePackedSInt32DataSize(out array<int> values)
+{
+	local int idx, size;
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		size += ComputeRawVarint32Size(EncodeZigZag32(values[idx]));
+	}
+
+	return size;
+}
+
+static function int ComputePackedFixed32DataSize(out array<int> values)
+{
+	return values.Length * LITTLE_ENDIAN_32_SIZE;
+}
+
+static function int ComputePackedSFixed32DataSize(out array<int> values)
+{
+	return values.Length * LITTLE_ENDIAN_32_SIZE;
+}
+
+static function int ComputePackedInt64DataSize(out array<Message.Int64> values)
+{
+	local int idx, size;
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		size += ComputeRawVarint64Size(values[idx]);
+	}
+
+	return size;
+}
+
+static function int ComputePackedUInt64DataSize(out array<Message.Int64> values)
+{
+	local int idx, size;
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		size += ComputeRawVarint64Size(values[idx]);
+	}
+
+	return size;
+}
+
+static function int ComputePackedSInt64DataSize(out array<Message.Int64> values)
+{
+	local int idx, size;
+
+	for (idx = 0; idx < values.Length; idx++)
+	{
+		size += ComputeRawVarint64Size(EncodeZigZag64(values[idx]));
+	}
+
+	return size;
+}
+
+static function int ComputePackedFixed64DataSize(out array<Message.Int64> values)
+{
+	return values.Length * LITTLE_ENDIAN_64_SIZE;
+}
+
+static function int ComputePackedSFixed64DataSize(out array<Message.Int64> values)
+{
+	return values.Length * LITTLE_ENDIAN_64_SIZE;
+}
+
+static function int ComputePackedBoolDataSize(out array<bool> values)
+{
+	return values.Length;
 }
 
 static function int ComputeTagSize(int fieldNumber)
@@ -82,6 +481,23 @@ static function int ComputeRawVarint32Size(int value)
 	return 5;
 }
 
+/*
+ * Each byte holds 7 bits, so the first 5 bytes hold
+ * the low word and 3 bits of the high word.
+ */
+static function int ComputeRawVarint64Size(Message.Int64 value)
+{
+	if (value.hi == 0) return ComputeRawVarint32Size(value.lo);
+
+	if ((value.hi & (0xffffffff << 3)) == 0) return 5;
+	if ((value.hi & (0xffffffff << 10)) == 0) return 6;
+	if ((value.hi & (0xffffffff << 17)) == 0) return 7;
+	if ((value.hi & (0xffffffff << 24)) == 0) return 8;
+	if ((value.hi & (0xffffffff << 31)) == 0) return 9;
+
+	return 10;
+}
+
 static function int EncodeZigZag32(int value)
 {
 	return (value << 1) ^ (value >> 31);
@@ -92,14 +508,145 @@ static function int DecodeZigZag32(int value)
 	return (value >>> 1) ^ -(value & 1);
 }
 
+/*
+ * (value << 1) ^ (value >> 63), one word at a time.
+ */
+static function Message.Int64 EncodeZigZag64(Message.Int64 value)
+{
+	local Message.Int64 result;
+	local int sign;
+
+	sign = value.hi >> 31;
+
+	result.lo = (value.lo << 1) ^ sign;
+	result.hi = ((value.hi << 1) | (value.lo >>> 31)) ^ sign;
+
+	return result;
+}
+
+/*
+ * (value >>> 1) ^ -(value & 1), one word at a time.
+ */
+static function Message.Int64 DecodeZigZag64(Message.Int64 value)
+{
+	local Message.Int64 result;
+	local int sign;
+
+	sign = -(value.lo & 1);
+
+	result.lo = ((value.lo >>> 1) | (value.hi << 31)) ^ sign;
+	result.hi = (value.hi >>> 1) ^ sign;
+
+	return result;
+}
+
+/*
+ * UnrealScript can't reinterpret a float as an int,
+ * so the IEEE-754 single precision bit pattern is 
+ * built from the value arithmetically.  NaN is 
+ * written as 0.
+ */
+static function int FloatToBits(float value)
+{
+	local int sign, exponent, mantissa;
+
+	if (value == 0 || value != value)
+	{
+		return 0;
+	}
+
+	if (value < 0)
+	{
+		sign = 1 << 31;
+		value = -value;
+	}
+
+	// Only infinity is unchanged by halving.
+	if (value * 0.5 == value)
+	{
+		return sign | 0x7F800000;
+	}
+
+	// Scale the value into [1, 2).  Loge gives the 
+	// exponent up to rounding, which the loops fix.
+	exponent = Clamp(FFloor(Loge(value) / LOGE_2), -149, 127);
+	value = value / (2.0 ** exponent);
+
+	while (value >= 2.0)
+	{
+		value *= 0.5;
+		exponent++;
+	}
+
+	while (value < 1.0)
+	{
+		value *= 2.0;
+		exponent--;
+	}
+
+	if (exponent < -126)
+	{
+		// Subnormal, stored without the implicit 1.
+		mantissa = Round(value * (2.0 ** (exponent + 126)) * 8388608.0);
+
+		return sign | mantissa;
+	}
+
+	// Exact, as the value has at most 24 significant bits.
+	mantissa = Round((value - 1.0) * 8388608.0);
+
+	return sign | ((exponent + 127) << 23) | mantissa;
+}
+
+static function float BitsToFloat(int bits)
+{
+	local int exponent, mantissa;
+	local float value;
+
+	exponent = (bits >>> 23) & 0xFF;
+	mantissa = bits & 0x7FFFFF;
+
+	if (exponent == 0xFF)
+	{
+		// Infinity overflows to itself, NaN reads as 0.
+		value = mantissa == 0 ? (2.0 ** 127) * 2.0 : 0;
+	}
+	else if (exponent == 0)
+	{
+		value = (mantissa / 8388608.0) * (2.0 ** -126);
+	}
+	else
+	{
+		value = (1.0 + mantissa / 8388608.0) * (2.0 ** (exponent - 127));
+	}
+
+	return bits < 0 ? -value : value;
+}
+
+/*
+ * Fixed-point encoding of fields with the quantize
+ * options, see us_options.proto.  The value is 
+ * clamped to the range and sent as the number of 
+ * precision steps above min.
+ */
+static function int QuantizeFloat(float value, float min, float max, float precision)
+{
+	return Round((FClamp(value, min, max) - min) / precision);
+}
+
+static function float DequantizeFloat(int value, float min, float max, float precision)
+{
+	return FClamp(min + value * precision, min, max);
+}
+
 static function PrintBytes(out array<byte> bytes)
 {
 	local int idx;
 
-	`Log("bytes.Length = " $ bytes.Length);
+	`PBLog("bytes.Length = " $ bytes.Length);
 
 	for (idx = 0; idx < bytes.Length; idx++)
 	{
-		`Log("bytes[" $ idx $ "] = " $ bytes[idx]);
+		`PBLog("bytes[" $ idx $ "] = " $ bytes[idx]);
 	}
 }
\ No newline at end of file
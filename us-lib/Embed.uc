@@ -28,7 +28,7 @@ function Deserialize(CodedInputStream stream)
 			title = stream.ReadString();
 		}
 
-		`Log("title = '" $ title $ "'");
+		`PBLog("title = '" $ title $ "'");
 
 		tag = stream.ReadTag();
 	}
@@ -23,12 +23,12 @@ function Deserialize(CodedInputStream stream)
 
 	while (tag > 0)
 	{
-		`Log("tag = " $ tag);
+		`PBLog("tag = " $ tag);
 
 		fieldNumber = class'WireFormat'.static.GetTagFieldNumber(tag);
 		wireType = class'WireFormat'.static.GetTagWireType(tag);
 
-		`Log("fieldNumber = " $ fieldNumber $ ", wireType = " $ wireType);
+		`PBLog("fieldNumber = " $ fieldNumber $ ", wireType = " $ wireType);
 
 		if (fieldNumber == CODE_FIELD_NUMBER)
 		{
@@ -42,7 +42,7 @@ function Deserialize(CodedInputStream stream)
 		tag = stream.ReadTag();
 	}
 
-	`Log("code = " $ code $ ", message = '" $ message $ "'");
+	`PBLog("code = " $ code $ ", message = '" $ message $ "'");
 }
 
 function int GetSerializedSize()
@@ -65,6 +65,12 @@ event PostBeginPlay()
 	network.serverAddress = "192.168.1.136";
 	network.portNumber = 5770;
 
+	// Register the classes generated from protocol.proto.
+	network.registries.AddItem(class'FrontEndProtocolRegistry');
+
+	// OnMessageReceived doesn't keep the messages.
+	network.bReleaseReceivedMessages = true;
+
 	// Set relevent delegates.
 	network.OnOpened = OnOpened;
 	network.OnClosed = OnClosed;
@@ -1,11 +1,36 @@
 class Message extends Object abstract;
 
+/*
+ * UnrealScript has no 64-bit integer type, so the
+ * *64 field types are held as their low and high 
+ * 32 bits.  Signed values are two's complement 
+ * across both halves, e.g. -1 is lo = -1, hi = -1.
+ */
+struct Int64
+{
+	var int lo;
+	var int hi;
+};
+
 /*
  * Must be set by subclasses in defaultproperties
  * block.
  */
 var string id;
 
+/*
+ * Identifies the message type in frame headers.
+ * Set by generated subclasses in defaultproperties
+ * block.
+ */
+var int typeId;
+
+/*
+ * Serialized size computed by the last call to 
+ * GetSerializedSize.  Negative until then.
+ */
+var transient int cachedSize;
+
 /*
  * Takes a CodedOutputStream and writes all 
  * data to dematerialize this message.
@@ -17,6 +42,18 @@ function Serialize(CodedOutputStream stream)
 	// Intentionally empty.
 }
 
+/*
+ * Same as Serialize but expects GetSerializedSize
+ * to have been called beforehand, so nested messages 
+ * can use their cached sizes as length prefixes.
+ * 
+ * Should be overriden by subclasses.
+ */
+function SerializeWithCachedSizes(CodedOutputStream stream)
+{
+	Serialize(stream);
+}
+
 /*
  * Takes a CodedInputStream and reads data to
  * materialize this message.
@@ -28,6 +65,110 @@ function Deserialize(CodedInputStream stream)
 	// Intentionally empty.
 }
 
+/*
+ * Resets every field to its default value and sets
+ * nested messages to none.  Nested messages are 
+ * released to the pool if one is given, for reuse.
+ * 
+ * Should be overriden by subclasses.
+ */
+function Clear(optional MessagePool pool)
+{
+	cachedSize = -1;
+}
+
+/*
+ * Returns whether the other message is of the same
+ * class and holds the same values.
+ * 
+ * Overriden by subclasses generated with the delta 
+ * option.
+ */
+function bool Equals(Message other)
+{
+	return other == self;
+}
+
+/*
+ * Equals for fields that may be none.
+ */
+static function bool MessagesEqual(Message a, Message b)
+{
+	if (a == b)
+	{
+		return true;
+	}
+
+	if (a == none || b == none)
+	{
+		return false;
+	}
+
+	return a.Equals(b);
+}
+
+/*
+ * Writes the fields that differ from the baseline,
+ * or every field if there is no baseline.  The 
+ * receiver must hold the same baseline and apply the
+ * delta with ApplyDelta.
+ * 
+ * Overriden by subclasses generated with the delta 
+ * option.
+ */
+function SerializeDelta(CodedOutputStream stream, Message baseline)
+{
+	// Intentionally empty.
+}
+
+/*
+ * Reads a delta written by SerializeDelta and 
+ * updates the fields it holds.
+ * 
+ * Overriden by subclasses generated with the delta 
+ * option.
+ */
+function ApplyDelta(CodedInputStream stream)
+{
+	// Intentionally empty.
+}
+
+/*
+ * Writes the fields assigned through the setters 
+ * since the last call, in the format read by 
+ * ApplyDelta, and marks them clean.
+ * 
+ * Overriden by subclasses generated with the 
+ * (us.dirty_tracking) option.
+ */
+function SerializeDirty(CodedOutputStream stream)
+{
+	// Intentionally empty.
+}
+
+/*
+ * Returns the number of bytes SerializeDirty would 
+ * write.
+ * 
+ * Overriden by subclasses generated with the 
+ * (us.dirty_tracking) option.
+ */
+function int GetDirtySerializedSize()
+{
+	return -1;
+}
+
+/*
+ * Marks all fields clean.
+ * 
+ * Overriden by subclasses generated with the 
+ * (us.dirty_tracking) option.
+ */
+function ClearDirty()
+{
+	// Intentionally empty.
+}
+
 /*
  * Returns the serialized size of this 
  * message.
@@ -37,4 +178,24 @@ function Deserialize(CodedInputStream stream)
 function int GetSerializedSize()
 {
 	return -1;
+}
+
+/*
+ * Returns the size computed by the last call to
+ * GetSerializedSize without walking the message
+ * again.
+ */
+function int GetCachedSize()
+{
+	if (cachedSize < 0)
+	{
+		return GetSerializedSize();
+	}
+
+	return cachedSize;
+}
+
+defaultproperties
+{
+	cachedSize = -1;
 }
\ No newline at end of file
@@ -0,0 +1,98 @@
+class MessagePool extends Object;
+
+/*
+ * Released messages of a single class.
+ */
+struct FreeList
+{
+	var class<Message> messageClazz;
+	var array<Message> messages;
+};
+
+// Class Vars
+var array<FreeList> freeLists;
+
+/*
+ * Most released messages kept per class.  Messages 
+ * released beyond that are left to the garbage 
+ * collector.
+ */
+var int maxFreeMessages;
+
+// Class Functions
+
+/*
+ * Returns a cleared message of the given class, 
+ * reusing a released one if possible.
+ */
+function Message Acquire(class<Message> messageClazz)
+{
+	local int idx, last;
+	local Message message;
+
+	idx = FindFreeList(messageClazz);
+
+	if (idx >= 0 && freeLists[idx].messages.Length > 0)
+	{
+		last = freeLists[idx].messages.Length - 1;
+
+		message = freeLists[idx].messages[last];
+		freeLists[idx].messages.Remove(last, 1);
+
+		return message;
+	}
+
+	return new messageClazz;
+}
+
+/*
+ * Clears the message, along with its nested messages,
+ * and keeps it for the next Acquire of its class.  
+ * The message must not be used afterwards, nor 
+ * released twice.
+ */
+function Release(Message message)
+{
+	local int idx;
+
+	if (message == none)
+	{
+		return;
+	}
+
+	message.Clear(self);
+
+	idx = FindFreeList(message.Class);
+
+	if (idx < 0)
+	{
+		idx = freeLists.Length;
+		freeLists.Length = idx + 1;
+		freeLists[idx].messageClazz = message.Class;
+	}
+
+	if (freeLists[idx].messages.Length < maxFreeMessages)
+	{
+		freeLists[idx].messages.AddItem(message);
+	}
+}
+
+function int FindFreeList(class<Message> messageClazz)
+{
+	local int idx;
+
+	for (idx = 0; idx < freeLists.Length; idx++)
+	{
+		if (freeLists[idx].messageClazz == messageClazz)
+		{
+			return idx;
+		}
+	}
+
+	return -1;
+}
+
+defaultproperties
+{
+	maxFreeMessages = 64;
+}
\ No newline at end of file
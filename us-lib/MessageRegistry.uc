@@ -0,0 +1,13 @@
+class MessageRegistry extends Object abstract;
+
+/*
+ * Maps the type ids carried in frame headers to 
+ * message classes.  The protocol buffer compiler 
+ * generates a subclass for every .proto file.
+ * 
+ * Returns none for unknown type ids.
+ */
+static function class<Message> GetMessageClass(int typeId)
+{
+	return none;
+}
\ No newline at end of file
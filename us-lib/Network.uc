@@ -1,13 +1,62 @@
 class Network extends TcpLink;
 
 // Class Constants
-const MESSAGE_NAME_LENGTH_SIZE = 1;
+const MAX_VARINT32_SIZE = 5;
+
+/*
+ * Consumed bytes are only removed from the front of
+ * the receive buffer once there are at least this 
+ * many of them, or when the buffer is fully drained.
+ */
+const RECEIVE_COMPACT_SIZE = 4096;
+
+/*
+ * SendBinary only takes this many bytes at a time.
+ */
+const SEND_CHUNK_SIZE = 255;
 
 // Class Vars
 var string serverAddress;
 var int portNumber;
 
-var array<byte> receiveBuffer;
+/*
+ * Registries used to look up the class of received 
+ * messages, usually one generated per .proto file.
+ */
+var array< class<MessageRegistry> > registries;
+
+/*
+ * Holds the received bytes.  Its cursor is the read
+ * offset of the next frame, and frames are decoded 
+ * in place from its buffer.
+ */
+var CodedInputStream receiveStream;
+
+/*
+ * Holds the frames queued by SendMessage.  They are
+ * written to the connection once per tick.
+ */
+var CodedOutputStream sendStream;
+
+/*
+ * Received messages, and the messages nested in 
+ * them, are taken from this pool.
+ */
+var MessagePool messagePool;
+
+/*
+ * Whether received messages go back to the pool once
+ * OnMessageReceived returns.  Only set this if the 
+ * handlers don't keep references to the messages.
+ */
+var bool bReleaseReceivedMessages;
+
+/*
+ * Number of received frames that were dropped 
+ * because their type id is unknown, their body 
+ * failed to decode or their header was corrupt.
+ */
+var int droppedFrames;
 
 // Class Delegates
 delegate OnOpened();
@@ -15,10 +64,34 @@ delegate OnClosed();
 delegate OnMessageReceived(Message message);
 
 // Class Functions
+event PostBeginPlay()
+{
+	super.PostBeginPlay();
+
+	receiveStream = new class'CodedInputStream';
+	sendStream = new class'CodedOutputStream';
+
+	messagePool = new class'MessagePool';
+	receiveStream.pool = messagePool;
+}
+
+/*
+ * Flushes the messages sent during the tick.
+ */
+event Tick(float DeltaTime)
+{
+	super.Tick(DeltaTime);
+
+	if (sendStream.cursor > 0 && IsConnected())
+	{
+		FlushSendBuffer();
+	}
+}
+
 function Start()
 {
-	`Log("Starting network.");
-	`Log("Connecting to " $ serverAddress $ ":" $ portNumber);
+	`PBLog("Starting network.");
+	`PBLog("Connecting to " $ serverAddress $ ":" $ portNumber);
 
 	// Configure the link.
 	ReceiveMode = RMODE_Event; // May need to go RMODE_Manual eventually.
@@ -30,184 +103,302 @@ function Start()
 
 function Stop()
 {
+	if (IsConnected())
+	{
+		FlushSendBuffer();
+	}
+
 	Close();
 }
 
 /*
  * This function is responsible for coordinating the 
- * message serialization and writing the resulting
- * bytes to the outgoing connection.
+ * message serialization.  The frame is appended to 
+ * the send buffer, which is written to the outgoing
+ * connection on the next tick.
  */
 function SendMessage(Message message)
 {
-	local CodedOutputStream header;
-	local CodedOutputStream body;
-
 	local int messageLength;
 
-	`Log("Sending message: " $ message.id);
-	
-	body = new class'CodedOutputStream';
-
-	message.Serialize(body);
+	`PBLog("Sending message: " $ message.id);
 
-	messageLength = body.buffer.Length 
-		+ class'CodedUtil'.static.ComputeRawStringSize(message.id) 
-		+ MESSAGE_NAME_LENGTH_SIZE;
+	messageLength = message.GetSerializedSize() 
+		+ class'CodedUtil'.static.ComputeRawVarint32Size(message.typeId);
 
-	header = new class'CodedOutputStream';
+	// Grow the send buffer at most once for the frame.
+	sendStream.Reserve(messageLength 
+		+ class'CodedUtil'.static.ComputeRawVarint32Size(messageLength));
 
 	// Write the header.
-	header.WriteRawVarint32(messageLength);
-	header.WriteRawByte(Len(message.id));
-	header.WriteRawString(message.id);
+	sendStream.WriteRawVarint32(messageLength);
+	sendStream.WriteRawVarint32(message.typeId);
 
-	SendBuffer(header.buffer); // Send header
-	SendBuffer(body.buffer); // Send body
+	// Write the body, reusing the size computed above.
+	message.SerializeWithCachedSizes(sendStream);
 }
 
 /*
- * A simple method for writing the contents of 
- * a byte array to the open connection.
+ * Writes the send buffer to the open connection.  
+ * Whatever the connection does not accept stays 
+ * queued for the next tick.
  */
-function SendBuffer(out array<byte> buffer)
+function FlushSendBuffer()
 {
-	local byte bytes[255];
-	local int total, count, idx;
+	local byte bytes[SEND_CHUNK_SIZE];
+	local int total, count, sent, idx;
+	local CodedOutputStream stream;
 
+	stream = sendStream;
 	total = 0;
 
-	while (total < buffer.Length)
+	while (total < stream.cursor)
 	{
-		count = Min(buffer.Length - total, 255);
+		count = Min(stream.cursor - total, SEND_CHUNK_SIZE);
 
 		for (idx = 0; idx < count; idx++)
 		{
-			bytes[idx] = buffer[total + idx];
+			bytes[idx] = stream.buffer[total + idx];
 		}
 
-		total += SendBinary(count, bytes);
+		sent = SendBinary(count, bytes);
+		total += sent;
+
+		if (sent < count)
+		{
+			break;
+		}
+	}
+
+	// The buffer is kept for the next frames, so that
+	// sending doesn't allocate once it is large enough.
+	if (total >= stream.cursor)
+	{
+		stream.Reset();
+	}
+	else if (total > 0)
+	{
+		stream.buffer.Remove(0, total);
+		stream.cursor -= total;
 	}
 }
 
 /*
  * Responsible for processing the buffer by
- * checking that a complete message has been 
- * received and then deserializing it.
+ * decoding every complete message that has been
+ * received and then compacting the buffer if 
+ * enough of it has been consumed.
  */
 function ProcessBuffer()
 {
-	local byte temp;
-	local int idx, cursor;
+	while (ProcessFrame())
+	{
+		// Keep draining.
+	}
 
-	local array<byte> tempBuffer;
+	CompactReceiveBuffer();
+}
 
-	local int messageLength;
-	local string messageName;
+/*
+ * Decodes and dispatches the frame at the read 
+ * offset.  Returns false if the frame has not been 
+ * completely received yet.
+ */
+function bool ProcessFrame()
+{
+	local int start, idx, limit;
+
+	local int messageLength, frameEnd, typeId;
 	local Message message;
 	local class<Message> messageClazz;
 
 	local CodedInputStream stream;
 
-	cursor = 0;
+	stream = receiveStream;
+	start = stream.cursor;
 
-	// Read Varint32 bytes for message length.
-	for (idx = 0; idx < 5; idx++)
+	// Check that the Varint32 message length is available.
+	idx = start;
+
+	while (idx < stream.buffer.Length && stream.buffer[idx] >= 0x80)
 	{
-		// If fifth iteration (i.e. wider than an int).
-		if (idx == 4)
-		{
-			// TODO: Signal error here.
+		idx++;
+	}
 
-			return;
-		}
+	if (idx - start >= MAX_VARINT32_SIZE)
+	{
+		DropReceiveBuffer("length varint too long");
 
-		if (receiveBuffer.Length > cursor)
-		{
-			tempBuffer.AddItem(receiveBuffer[cursor++]);
-			
-			if (tempBuffer[idx] >= 0)
-			{
-				break;	
-			}
-		}
+		return false;
 	}
 
-	stream = new class'CodedInputStream';
-	stream.buffer = tempBuffer;
+	if (idx >= stream.buffer.Length)
+	{
+		return false;
+	}
 
 	messageLength = stream.ReadRawVarint32();
 
-	if (messageLength <= 0)
+	if (messageLength < 0)
 	{
-		// TODO: Signal error here.
+		DropReceiveBuffer("negative length " $ messageLength);
 
-		return;
+		return false;
 	}
 
-	// Check that the entire message is available.
-	if (receiveBuffer.Length < (cursor + messageLength))
+	// Check that the entire message is available.  This 
+	// is compared with what is left rather than the frame 
+	// end, which overflows for lengths near 2^31.
+	if (messageLength > stream.buffer.Length - stream.cursor)
 	{
-		return;
+		stream.cursor = start;
+
+		return false;
 	}
 
-	// Check that message name length byte is available.
-	if (receiveBuffer.Length < (cursor + 1))
+	frameEnd = stream.cursor + messageLength;
+
+	// Get message type id, which must lie within the 
+	// frame.
+	limit = stream.PushLimit(messageLength);
+
+	typeId = stream.ReadRawVarint32();
+
+	if (stream.cursor > frameEnd || stream.error != class'CodedInputStream'.const.ERROR_NONE)
 	{
-		return;
+		DropFrame(frameEnd, limit);
+
+		return true;
 	}
 
-	// Get message name length.
-	temp = receiveBuffer[cursor++];
+	`PBLog("Message type id = " $ typeId);
+
+	messageClazz = GetMessageClass(typeId);
 
-	if (temp <= 0)
+	if (messageClazz == none)
 	{
-		// TODO: Signal error here.
+		DropFrame(frameEnd, limit);
 
-		return;
+		return true;
 	}
 
-	// Get message name.
-	for (idx = 0; idx < temp; idx++)
+	// Create and deserialize message straight from the 
+	// receive buffer.
+	message = messagePool.Acquire(messageClazz);
+
+	message.Deserialize(stream);
+
+	stream.PopLimit(limit);
+
+	if (stream.error != class'CodedInputStream'.const.ERROR_NONE)
 	{
-		messageName $= Chr(receiveBuffer[cursor++]);
+		messagePool.Release(message);
+
+		DropFrame(frameEnd, limit);
+
+		return true;
 	}
 
-	`Log("Message name = '" $ messageName $ "'");
+	stream.cursor = frameEnd;
 
-	// Copy message bytes into tempBuffer.
-	tempBuffer.Remove(0, tempBuffer.Length);
+	// Dispatch message.
+	OnMessageReceived(message);
 
-	temp = cursor + (messageLength - temp - MESSAGE_NAME_LENGTH_SIZE);
+	if (bReleaseReceivedMessages)
+	{
+		messagePool.Release(message);
+	}
+
+	return true;
+}
+
+/*
+ * Skips the rest of a frame that can't be decoded.
+ * Frames are length prefixed, so the frames after 
+ * it are still read.
+ */
+function DropFrame(int frameEnd, int limit)
+{
+	local CodedInputStream stream;
 
-	for (idx = cursor; idx < temp; idx++)
+	stream = receiveStream;
+
+	`PBLog("Dropping frame, error = " $ stream.error);
+
+	droppedFrames++;
+
+	stream.currentLimit = limit;
+
+	// Never go back over bytes that were already read.
+	if (frameEnd > stream.cursor)
 	{
-		tempBuffer.AddItem(receiveBuffer[cursor++]);
+		stream.cursor = frameEnd;
 	}
 
-	// Dynamically load the message class.
-	messageClazz = class<Message>(DynamicLoadObject("LastStand." $ messageName, class'Class'));
+	stream.error = class'CodedInputStream'.const.ERROR_NONE;
+}
 
-	if (messageClazz == none)
+/*
+ * Discards everything received so far after a 
+ * corrupt frame header.  The frame boundaries are 
+ * lost, so the stream can't be resynchronized; the 
+ * discarded bytes count as one dropped frame.
+ */
+function DropReceiveBuffer(string reason)
+{
+	local CodedInputStream stream;
+
+	stream = receiveStream;
+
+	`PBLog("Dropping " $ (stream.buffer.Length - stream.cursor) $ " received bytes: " $ reason);
+
+	droppedFrames++;
+
+	stream.cursor = stream.buffer.Length;
+}
+
+/*
+ * Looks the type id up in every registry.
+ */
+function class<Message> GetMessageClass(int typeId)
+{
+	local int idx;
+	local class<Message> messageClazz;
+
+	for (idx = 0; idx < registries.Length; idx++)
 	{
-		// TODO: Signal error here.
+		messageClazz = registries[idx].static.GetMessageClass(typeId);
 
-		return;
+		if (messageClazz != none)
+		{
+			return messageClazz;
+		}
 	}
 
-	// Create and deserialize message.
-	message = new messageClazz;
-
-	stream = new class'CodedInputStream';
-	stream.buffer = tempBuffer;
+	return none;
+}
 
-	message.Deserialize(stream);
+/*
+ * Drops the consumed bytes from the front of the 
+ * receive buffer.  This shifts the unread bytes, so 
+ * it is only done once enough has been consumed.
+ */
+function CompactReceiveBuffer()
+{
+	local CodedInputStream stream;
 
-	// Dispatch message.
-	OnMessageReceived(message);
+	stream = receiveStream;
 
-	// Clear message bytes from the receive buffer.
-	receiveBuffer.Remove(0, cursor);
+	if (stream.cursor >= stream.buffer.Length)
+	{
+		stream.buffer.Length = 0;
+		stream.cursor = 0;
+	}
+	else if (stream.cursor >= RECEIVE_COMPACT_SIZE)
+	{
+		stream.buffer.Remove(0, stream.cursor);
+		stream.cursor = 0;
+	}
 }
 
 /*
@@ -215,7 +406,7 @@ function ProcessBuffer()
  */
 event Resolved(IpAddr address)
 {
-	`Log(serverAddress $ " resolved to " $ IpAddrToString(address));
+	`PBLog(serverAddress $ " resolved to " $ IpAddrToString(address));
 
 	address.Port = portNumber;
 	
@@ -226,7 +417,7 @@ event Resolved(IpAddr address)
 	if (!Open(address))
 	{
 		// This does not appear to work as advertised.
-		`Log("Unable to connect to specified address.");
+		`PBLog("Unable to connect to specified address.");
 	}
 }
 
@@ -235,7 +426,7 @@ event Resolved(IpAddr address)
  */
 event ResolveFailed()
 {
-	`Log("Failed to resolve " $ serverAddress $ ".  Connection aborted.");
+	`PBLog("Failed to resolve " $ serverAddress $ ".  Connection aborted.");
 }
 
 /*
@@ -243,7 +434,7 @@ event ResolveFailed()
  */
 event Opened()
 {
-	`Log("The connection has been established.");
+	`PBLog("The connection has been established.");
 
 	OnOpened();
 }
@@ -253,7 +444,7 @@ event Opened()
  */
 event Closed()
 {
-	`Log("The connection has been closed.");
+	`PBLog("The connection has been closed.");
 
 	OnClosed();
 }
@@ -263,13 +454,18 @@ event Closed()
  */
 event ReceivedBinary(int count, byte buffer[255])
 {
-	local int idx;
+	local int idx, start;
+
+	`PBLog("Received " $ count $ " bytes of data.");
+
+	// Grow the buffer once rather than once per byte.
+	start = receiveStream.buffer.Length;
 
-	`Log("Received " $ count $ " bytes of data.");
+	receiveStream.buffer.Length = start + count;
 
 	for (idx = 0; idx < count; idx++)
 	{
-		receiveBuffer.AddItem(buffer[idx]);
+		receiveStream.buffer[start + idx] = buffer[idx];
 	}
 
 	ProcessBuffer();
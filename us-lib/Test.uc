@@ -64,55 +64,55 @@ function Deserialize(CodedInputStream stream)
 		{
 			username = stream.ReadString();
 
-			`Log("username = '" $ username $ "'");
+			`PBLog("username = '" $ username $ "'");
 		}
 		else if (fieldNumber == AGE_FIELD_NUMBER)
 		{
 			age = stream.ReadInt32();
 
-			`Log("age = " $ age);
+			`PBLog("age = " $ age);
 		}
 		else if (fieldNumber == YEAR_FIELD_NUMBER)
 		{
 			year = stream.ReadUInt32();
 
-			`Log("year = " $ year);
+			`PBLog("year = " $ year);
 		}
 		else if (fieldNumber == RANGE_FIELD_NUMBER)
 		{
 			range = stream.ReadSInt32();
 
-			`Log("range = " $ range);
+			`PBLog("range = " $ range);
 		}
 		else if (fieldNumber == SPEED_FIELD_NUMBER)
 		{
 			speed = stream.ReadSFixed32();
 
-			`Log("speed = " $ speed);
+			`PBLog("speed = " $ speed);
 		}
 		else if (fieldNumber == BANNED_FIELD_NUMBER)
 		{
 			banned = stream.ReadBool();
 
-			`Log("banned = " $ banned);
+			`PBLog("banned = " $ banned);
 		}
 		else if (fieldNumber == VELOCITY_FIELD_NUMBER)
 		{
 			velocity = stream.ReadFloat();
 
-			`Log("velocity = " $ velocity);
+			`PBLog("velocity = " $ velocity);
 		}
 		else if (fieldNumber == EMBED_FIELD_NUMBER)
 		{
 			embed = Embed(stream.ReadMessage(class'Embed'));
 
-			`Log("embed.title = '" $ embed.title $ "'");
+			`PBLog("embed.title = '" $ embed.title $ "'");
 		}
 		else if (fieldNumber == ROLES_FIELD_NUMBER)
 		{
 			roles.AddItem(stream.ReadString());
 
-			`Log("role = '" $ roles[roles.Length - 1] $ "'");
+			`PBLog("role = '" $ roles[roles.Length - 1] $ "'");
 		}
 
 		tag = stream.ReadTag();